@@ -21,8 +21,16 @@ AST_RTTI_END(ast_NodeBase)
 AST_RTTI_CAST_BEGIN(NodeBase)
 AST_RTTI_CAST_END(NodeBase)
 
+std::recursive_mutex& NodeBase::_linkLock()
+{
+    static std::recursive_mutex lock;
+    return lock;
+}
+
 NodeBase::~NodeBase()
 {
+    std::lock_guard<std::recursive_mutex> guard(_linkLock());
+
     for ( auto c : _childs )
         c->_parents.remove(this);
 
@@ -50,6 +58,8 @@ NodeBase::~NodeBase()
 
 void NodeBase::addChild(node_ptr<NodeBase> node)
 {
+    std::lock_guard<std::recursive_mutex> guard(_linkLock());
+
     if ( ! node.get() )
         return;
 
@@ -70,6 +80,8 @@ void NodeBase::addChild(node_ptr<NodeBase> node)
 
 void NodeBase::removeChild(node_ptr<NodeBase> node)
 {
+    std::lock_guard<std::recursive_mutex> guard(_linkLock());
+
     if ( ! node )
         return;
 
@@ -103,6 +115,8 @@ void NodeBase::removeChild(node_ptr<NodeBase> node)
 
 void NodeBase::removeChild(node_list::iterator i)
 {
+    std::lock_guard<std::recursive_mutex> guard(_linkLock());
+
     auto node = *i;
 
     bool found = false;
@@ -122,6 +136,8 @@ void NodeBase::removeChild(node_list::iterator i)
 
 void NodeBase::removeFromParents()
 {
+    std::lock_guard<std::recursive_mutex> guard(_linkLock());
+
     bool changed = false;
 
     do {
@@ -151,6 +167,8 @@ void NodeBase::replace(shared_ptr<NodeBase> n, shared_ptr<NodeBase> parent)
     if ( n.get() == this )
         return;
 
+    std::lock_guard<std::recursive_mutex> guard(_linkLock());
+
     std::list<NodeBase*> parents = _parents;
 
     bool changed;
@@ -215,12 +233,16 @@ bool NodeBase::hasChild(node_ptr<NodeBase> node, bool recursive) const
 
 bool NodeBase::hasChild(NodeBase* node, bool recursive) const
 {
+    std::lock_guard<std::recursive_mutex> guard(_linkLock());
+
     node_set done;
     return hasChildInternal(node, recursive, &done);
 }
 
 const NodeBase::node_list NodeBase::childs(bool recursive) const
 {
+    std::lock_guard<std::recursive_mutex> guard(_linkLock());
+
     if ( ! recursive )
         return _childs;
 
@@ -247,6 +269,8 @@ void NodeBase::childsInternal(const NodeBase* node, bool recursive, node_set* ch
 
 NodeBase* NodeBase::siblingOfChild(NodeBase* child) const
 {
+    std::lock_guard<std::recursive_mutex> guard(_linkLock());
+
     for ( auto i = _childs.begin(); i != _childs.end(); i++ ) {
         if ( (*i).get() == child ) {
             ++i;
@@ -270,7 +294,7 @@ NodeBase::operator string()
 
     string parents = "";
 
-    for ( auto p : _parents )
+    for ( auto p : NodeBase::parents() )
         parents += util::fmt(" p:%p", p);
 
     return util::fmt("%s [%d/%s %p%s] %s", name, _childs.size(), location.c_str(), this,
@@ -5,6 +5,7 @@
 #include <cassert>
 #include <iostream>
 #include <list>
+#include <mutex>
 #include <set>
 #include <sstream>
 
@@ -246,6 +247,7 @@ public:
 
     NodeBase(const NodeBase& other)
     {
+        std::lock_guard<std::recursive_mutex> guard(_linkLock());
         _location = other._location;
         _comments = other._comments;
         _childs = other._childs;
@@ -255,8 +257,9 @@ public:
 
     /// Returns the parents of this node. A node gets a parent once it gets
     /// added to another node via addChild().
-    const std::list<NodeBase*>& parents() const
+    std::list<NodeBase*> parents() const
     {
+        std::lock_guard<std::recursive_mutex> guard(_linkLock());
         return _parents;
     }
 
@@ -288,6 +291,8 @@ public:
     template <typename T>
     std::list<shared_ptr<T>> parents()
     {
+        std::lock_guard<std::recursive_mutex> guard(_linkLock());
+
         std::list<shared_ptr<T>> dst;
         std::set<NodeBase*> done;
         _parentsInternal(this, &dst, &done);
@@ -459,6 +464,11 @@ private:
     void childsInternal(const NodeBase* node, bool recursive, node_set* childs) const;
     void dump(std::ostream& out, int level, node_set* seen);
 
+    // Guards all nodes' links to their parents and childs. Code generators
+    // compiling modules concurrently share the ASTs of what the modules
+    // have in common, and link new nodes to them.
+    static std::recursive_mutex& _linkLock();
+
     std::list<NodeBase*> _parents;
     node_list _childs;
 
@@ -0,0 +1,134 @@
+
+#include <sched.h>
+
+#include "CompletionQueue.h"
+
+using namespace bro::hilti;
+
+CompletionQueue::CompletionQueue()
+{
+    stub.next.store(nullptr, std::memory_order_relaxed);
+    head.store(&stub, std::memory_order_relaxed);
+    tail = &stub;
+}
+
+CompletionQueue::~CompletionQueue()
+{
+    for ( auto n : held )
+        delete n;
+
+    while ( auto n = Pop() )
+        delete n;
+}
+
+void CompletionQueue::Push(Callback cb, const void* owner)
+{
+    auto n = new Node;
+    n->cb = std::move(cb);
+    n->owner = owner;
+    PushNode(n);
+}
+
+void CompletionQueue::PushNode(Node* n)
+{
+    n->next.store(nullptr, std::memory_order_relaxed);
+    auto prev = head.exchange(n, std::memory_order_acq_rel);
+    prev->next.store(n, std::memory_order_release);
+}
+
+CompletionQueue::Node* CompletionQueue::Pop()
+{
+    while ( true ) {
+        auto t = tail;
+        auto next = t->next.load(std::memory_order_acquire);
+
+        if ( t == &stub ) {
+            if ( ! next )
+                return nullptr;
+
+            tail = next;
+            t = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+
+        if ( next ) {
+            tail = next;
+            return t;
+        }
+
+        if ( t != head.load(std::memory_order_acquire) ) {
+            // A producer has swapped in a new head but not linked it yet.
+            // It'll do so momentarily.
+            sched_yield();
+            continue;
+        }
+
+        // t is the last node; put the stub behind it so that we can take
+        // it out.
+        PushNode(&stub);
+
+        next = t->next.load(std::memory_order_acquire);
+
+        if ( next ) {
+            tail = next;
+            return t;
+        }
+
+        // Another push got in between; try again once it's linked.
+        sched_yield();
+    }
+}
+
+unsigned int CompletionQueue::Run()
+{
+    unsigned int cnt = 0;
+
+    // Callbacks held back earlier were queued before anything we pop now.
+    while ( held.size() ) {
+        auto n = held.front();
+        held.pop_front();
+        n->cb();
+        delete n;
+        ++cnt;
+    }
+
+    while ( auto n = Pop() ) {
+        n->cb();
+        delete n;
+        ++cnt;
+    }
+
+    return cnt;
+}
+
+unsigned int CompletionQueue::Run(const void* owner)
+{
+    unsigned int cnt = 0;
+
+    std::deque<Node*> others;
+    others.swap(held);
+
+    for ( auto n : others ) {
+        if ( n->owner != owner ) {
+            held.push_back(n);
+            continue;
+        }
+
+        n->cb();
+        delete n;
+        ++cnt;
+    }
+
+    while ( auto n = Pop() ) {
+        if ( n->owner != owner ) {
+            held.push_back(n);
+            continue;
+        }
+
+        n->cb();
+        delete n;
+        ++cnt;
+    }
+
+    return cnt;
+}
@@ -0,0 +1,91 @@
+// Queue passing work from HILTI worker threads back to Bro's main thread.
+//
+// With parallel analysis, Spicy parsers run on HILTI worker threads, yet
+// anything touching Bro's state, such as raising an event or reporting a
+// weird, must happen on the main thread. Workers hence wrap such operations
+// into callbacks and push them here, and the main thread runs them each
+// time Bro drains its event queue.
+//
+// The queue is an intrusive multi-producer, single-consumer list in the
+// style of Dmitry Vyukov's. Pushing is wait-free; popping needs no locks
+// either, but may briefly have to wait for a producer that's in the middle
+// of a push. Callbacks pushed by the same thread run in the order they were
+// pushed. As all chunks of a connection get parsed by the same virtual
+// thread, that preserves the order of a connection's events.
+//
+// Each callback may carry an owner, such as the analyzer it belongs to, so
+// that an owner going away can run just its own callbacks first.
+
+#ifndef BRO_PLUGIN_HILTI_COMPLETIONQUEUE_H
+#define BRO_PLUGIN_HILTI_COMPLETIONQUEUE_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+
+namespace bro {
+namespace hilti {
+
+class CompletionQueue {
+public:
+    typedef std::function<void()> Callback;
+
+    /**
+     * Constructor.
+     */
+    CompletionQueue();
+
+    /**
+     * Destructor. Deletes all callbacks not run yet.
+     */
+    ~CompletionQueue();
+
+    /**
+     * Queues a callback for running on the main thread. This is safe to
+     * call from any thread.
+     *
+     * @param cb The callback.
+     *
+     * @param owner The owner to associate with the callback, or null for
+     * none.
+     */
+    void Push(Callback cb, const void* owner = nullptr);
+
+    /**
+     * Runs all callbacks queued so far. Must only be called from the main
+     * thread.
+     *
+     * @return The number of callbacks run.
+     */
+    unsigned int Run();
+
+    /**
+     * Runs all callbacks queued so far for a given owner. Callbacks of
+     * other owners remain queued, keeping their order, and run with the
+     * next Run(). Must only be called from the main thread.
+     *
+     * @param owner The owner.
+     *
+     * @return The number of callbacks run.
+     */
+    unsigned int Run(const void* owner);
+
+private:
+    struct Node {
+        std::atomic<Node*> next;
+        Callback cb;
+        const void* owner;
+    };
+
+    void PushNode(Node* n);
+    Node* Pop();
+
+    std::atomic<Node*> head; // Most recently pushed node, updated by producers.
+    Node* tail;              // Oldest node, owned by the consumer.
+    Node stub;               // Placeholder keeping the list non-empty.
+    std::deque<Node*> held;  // Popped nodes of other owners not run yet, owned by the consumer.
+};
+}
+}
+
+#endif
@@ -4,6 +4,7 @@
 
 #include <memory>
 
+#include <dlfcn.h>
 #include <glob.h>
 
 extern "C" {
@@ -34,6 +35,7 @@ extern "C" {
 #include <spicy/expression.h>
 #include <spicy/function.h>
 #include <spicy/jit.h>
+#include <spicy/passes/field-pruner.h>
 #include <spicy/scope.h>
 #include <spicy/spicy.h>
 #include <spicy/statement.h>
@@ -41,8 +43,11 @@ extern "C" {
 
 // LLVM includes.
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/GlobalVariable.h>
 
 // Plugin includes.
+#include "CompletionQueue.h"
 #include "Converter.h"
 #include "LocalReporter.h"
 #include "Manager.h"
@@ -108,6 +113,7 @@ struct bro::hilti::SpicyAnalyzerInfo {
         unit_name_resp; // The fully-qualified name of the unit type to parse the originator side.
     shared_ptr<SpicyAST::UnitInfo> unit_orig; // The type of the unit to parse the originator side.
     shared_ptr<SpicyAST::UnitInfo> unit_resp; // The type of the unit to parse the originator side.
+    string spec;               // The definition as given in the *.evt file.
     spicy_parser* parser_orig; // The parser for the originator side (coming out of JIT).
     spicy_parser* parser_resp; // The parser for the responder side (coming out of JIT).
 };
@@ -120,6 +126,7 @@ struct bro::hilti::SpicyFileAnalyzerInfo {
     std::list<string> mime_types;        // The mime_types associated with the analyzer.
     string unit_name;                    // The fully-qualified name of the unit type to parse with.
     shared_ptr<SpicyAST::UnitInfo> unit; // The type of the unit to parse the originator side.
+    string spec;                         // The definition as given in the *.evt file.
     spicy_parser* parser;                // The parser coming out of JIT.
 };
 
@@ -181,6 +188,96 @@ struct bro::hilti::SpicyEventInfo {
     accessor_list expr_accessors;      // One HILTI function per expression to access the value.
 };
 
+// Typed trampolines calling compiled script functions with a given number
+// of arguments. We pick the right one once per function when we first see
+// it, so that a call from Bro is just an indirect call into the trampoline,
+// which then passes the arguments on without looking at their count again.
+typedef ::Val* (*native_trampoline)(void* native, val_list* args, hlt_exception** excpt,
+                                    hlt_execution_context* ctx);
+
+#define ARG(i) (*args)[i]
+#define HILTI_C hlt_exception**, hlt_execution_context*
+
+static ::Val* call_native0(void* native, val_list* args, hlt_exception** excpt,
+                           hlt_execution_context* ctx)
+{
+    typedef ::Val* (*f)(HILTI_C);
+    return (*(f)native)(excpt, ctx);
+}
+
+static ::Val* call_native1(void* native, val_list* args, hlt_exception** excpt,
+                           hlt_execution_context* ctx)
+{
+    typedef ::Val* (*f)(Val*, HILTI_C);
+    return (*(f)native)(ARG(0), excpt, ctx);
+}
+
+static ::Val* call_native2(void* native, val_list* args, hlt_exception** excpt,
+                           hlt_execution_context* ctx)
+{
+    typedef ::Val* (*f)(Val*, Val*, HILTI_C);
+    return (*(f)native)(ARG(0), ARG(1), excpt, ctx);
+}
+
+static ::Val* call_native3(void* native, val_list* args, hlt_exception** excpt,
+                           hlt_execution_context* ctx)
+{
+    typedef ::Val* (*f)(Val*, Val*, Val*, HILTI_C);
+    return (*(f)native)(ARG(0), ARG(1), ARG(2), excpt, ctx);
+}
+
+static ::Val* call_native4(void* native, val_list* args, hlt_exception** excpt,
+                           hlt_execution_context* ctx)
+{
+    typedef ::Val* (*f)(Val*, Val*, Val*, Val*, HILTI_C);
+    return (*(f)native)(ARG(0), ARG(1), ARG(2), ARG(3), excpt, ctx);
+}
+
+static ::Val* call_native5(void* native, val_list* args, hlt_exception** excpt,
+                           hlt_execution_context* ctx)
+{
+    typedef ::Val* (*f)(Val*, Val*, Val*, Val*, Val*, HILTI_C);
+    return (*(f)native)(ARG(0), ARG(1), ARG(2), ARG(3), ARG(4), excpt, ctx);
+}
+
+static ::Val* call_native6(void* native, val_list* args, hlt_exception** excpt,
+                           hlt_execution_context* ctx)
+{
+    typedef ::Val* (*f)(Val*, Val*, Val*, Val*, Val*, Val*, HILTI_C);
+    return (*(f)native)(ARG(0), ARG(1), ARG(2), ARG(3), ARG(4), ARG(5), excpt, ctx);
+}
+
+static ::Val* call_native7(void* native, val_list* args, hlt_exception** excpt,
+                           hlt_execution_context* ctx)
+{
+    typedef ::Val* (*f)(Val*, Val*, Val*, Val*, Val*, Val*, Val*, HILTI_C);
+    return (*(f)native)(ARG(0), ARG(1), ARG(2), ARG(3), ARG(4), ARG(5), ARG(6), excpt, ctx);
+}
+
+static ::Val* call_native8(void* native, val_list* args, hlt_exception** excpt,
+                           hlt_execution_context* ctx)
+{
+    typedef ::Val* (*f)(Val*, Val*, Val*, Val*, Val*, Val*, Val*, Val*, HILTI_C);
+    return (*(f)native)(ARG(0), ARG(1), ARG(2), ARG(3), ARG(4), ARG(5), ARG(6), ARG(7), excpt,
+                        ctx);
+}
+
+#undef ARG
+#undef HILTI_C
+
+static const native_trampoline native_trampolines[] = {call_native0, call_native1, call_native2,
+                                                       call_native3, call_native4, call_native5,
+                                                       call_native6, call_native7, call_native8};
+
+static const int MaxNativeArgs = sizeof(native_trampolines) / sizeof(native_trampolines[0]) - 1;
+
+// A compiled script function along with the trampoline to call it.
+struct NativeCall {
+    void* native = nullptr;
+    native_trampoline trampoline = nullptr;
+    int arity = 0;
+};
+
 // Implementation of the Manager class attributes.
 struct Manager::PIMPL {
     typedef std::list<shared_ptr<SpicyModuleInfo>> spicy_module_list;
@@ -209,9 +306,15 @@ struct Manager::PIMPL {
     bool save_hilti; // Saves all HILTI modules into a file, set from BifConst::Hilti::save_hilti.
     bool save_llvm;  // Saves the final linked LLVM code into a file, set from
                      // BifConst::Hilti::save_llvm.
-    bool spicy_to_compiler;     // If compiling scripts, raise event hooks from Spicy code directly.
-    unsigned int profile;       // True to enable run-time profiling.
-    unsigned int hilti_workers; // Number of HILTI worker threads to spawn.
+    bool spicy_to_compiler;       // If compiling scripts, raise event hooks from Spicy code directly.
+    unsigned int profile;         // True to enable run-time profiling.
+    unsigned int hilti_workers;   // Number of HILTI worker threads to spawn.
+    bool parallel_analysis;       // Parse protocol analyzers' input on the HILTI worker threads.
+    bool parallel_file_analysis;  // Parse file analyzers' input on the HILTI worker threads.
+    bool prune_fields;            // Don't store unit fields that nobody reads.
+    unsigned int compile_threads; // Number of threads to compile HILTI modules with.
+    string save_bundle;           // Path to save a precompiled bundle to, set from
+                                  // BifConst::Hilti::save_bundle.
 
     std::list<string> import_paths;
     SpicyAST* spicy_ast;
@@ -230,6 +333,11 @@ struct Manager::PIMPL {
     path_set evt_files;                  // All loaded *.evt files.
     path_set spicy_files;                // All loaded *.spicy files.
     path_set hlt_files;                  // All loaded *.hlt files specified by the user.
+    CompletionQueue completions;         // Callbacks from worker threads for the main thread.
+
+    // The handlers of all events raised from worker threads, indexed as
+    // generated into the code. Null for events that Bro doesn't know.
+    std::vector<EventHandler*> parallel_event_handlers;
 
     shared_ptr<::hilti::CompilerContextJIT<::spicy::JIT>> hilti_context = nullptr;
     shared_ptr<::spicy::CompilerContext> spicy_context = nullptr;
@@ -247,8 +355,17 @@ struct Manager::PIMPL {
     // The execution engine used for JITing llvm_linked_module.
     std::unique_ptr<::hilti::JIT> jit;
 
-    // Pointers to compiled script functions indxed by their unique ID.
-    std::vector<void*> native_functions;
+    // Compiled script functions indexed by their unique ID.
+    std::vector<NativeCall> native_functions;
+
+    // A precompiled bundle loaded instead of compiling sources, as returned
+    // by dlopen().
+    void* bundle = nullptr;
+    string bundle_path;
+
+    // The events a loaded bundle raises, with the descriptions of their
+    // signatures at the time the bundle was built.
+    std::list<std::pair<string, string>> bundle_events;
 };
 
 Manager::Manager()
@@ -266,6 +383,15 @@ Manager::Manager()
 
 Manager::~Manager()
 {
+    if ( pimpl->bundle ) {
+        auto hlt_done = (void (*)())dlsym(pimpl->bundle, "__hlt_done");
+
+        if ( hlt_done )
+            (*hlt_done)();
+
+        dlclose(pimpl->bundle);
+    }
+
     delete pimpl->spicy_ast;
     delete pimpl;
 }
@@ -332,6 +458,11 @@ bool Manager::InitPostScripts()
     for ( auto t : ::util::strsplit(BifConst::Hilti::cg_debug->CheckString(), ":") )
         cg_debug.insert(t);
 
+    std::list<string> jit_warm_up;
+
+    for ( auto t : ::util::strsplit(BifConst::Hilti::jit_warm_up->CheckString(), ":") )
+        jit_warm_up.push_back(t);
+
     pimpl->compile_all = BifConst::Hilti::compile_all;
     pimpl->compile_scripts = BifConst::Hilti::compile_scripts;
     pimpl->profile = BifConst::Hilti::profile;
@@ -344,22 +475,67 @@ bool Manager::InitPostScripts()
     pimpl->save_llvm = BifConst::Hilti::save_llvm;
     pimpl->spicy_to_compiler = BifConst::Hilti::spicy_to_compiler;
     pimpl->hilti_workers = BifConst::Hilti::hilti_workers;
+    pimpl->parallel_analysis = BifConst::Hilti::parallel_analysis;
+    pimpl->parallel_file_analysis = BifConst::Hilti::parallel_file_analysis;
+    pimpl->prune_fields = BifConst::Hilti::prune_fields;
+
+    if ( pimpl->parallel_analysis && ! pimpl->hilti_workers ) {
+        reporter::warning("Hilti::parallel_analysis requires Hilti::hilti_workers, ignoring");
+        pimpl->parallel_analysis = false;
+    }
+
+    if ( pimpl->parallel_file_analysis && ! pimpl->hilti_workers ) {
+        reporter::warning("Hilti::parallel_file_analysis requires Hilti::hilti_workers, ignoring");
+        pimpl->parallel_file_analysis = false;
+    }
+
+    pimpl->compile_threads = BifConst::Hilti::compile_threads;
+    pimpl->save_bundle = BifConst::Hilti::save_bundle->CheckString();
+
+    bool jit_lazy = BifConst::Hilti::jit_lazy;
+
+    // With worker threads, compiling on demand could happen in several
+    // threads at the same time, which LLVM's JIT doesn't support.
+    if ( jit_lazy && pimpl->hilti_workers ) {
+        reporter::warning("Hilti::jit_lazy requires Hilti::hilti_workers=0, ignoring");
+        jit_lazy = false;
+    }
 
     pimpl->hilti_options->jit = true;
     pimpl->hilti_options->debug = true;
     pimpl->hilti_options->optimize = BifConst::Hilti::optimize;
     pimpl->hilti_options->profile = BifConst::Hilti::profile;
+    pimpl->hilti_options->profile_fast = BifConst::Hilti::profile_fast;
     pimpl->hilti_options->verify = ! BifConst::Hilti::no_verify;
     pimpl->hilti_options->cg_debug = cg_debug;
     pimpl->hilti_options->module_cache = BifConst::Hilti::use_cache ? ".cache" : "";
+    pimpl->hilti_options->jit_lazy = jit_lazy;
+    pimpl->hilti_options->jit_warm_up = jit_warm_up;
+    pimpl->hilti_options->pgo_generate = BifConst::Hilti::pgo_generate;
+    pimpl->hilti_options->pgo_use = BifConst::Hilti::pgo_use->CheckString();
+    pimpl->hilti_options->thin_link = BifConst::Hilti::thin_link;
+    pimpl->hilti_options->thin_link_threads = pimpl->compile_threads;
+    pimpl->hilti_options->perf_map = BifConst::Hilti::perf_map;
+    pimpl->hilti_options->perf_jitdump = BifConst::Hilti::perf_jitdump;
+    pimpl->hilti_options->frame_pointers = (BifConst::Hilti::sample_rate > 0);
 
     pimpl->spicy_options->jit = true;
     pimpl->spicy_options->debug = BifConst::Hilti::debug;
     pimpl->spicy_options->optimize = BifConst::Hilti::optimize;
     pimpl->spicy_options->profile = BifConst::Hilti::profile;
+    pimpl->spicy_options->profile_fast = BifConst::Hilti::profile_fast;
     pimpl->spicy_options->verify = ! BifConst::Hilti::no_verify;
     pimpl->spicy_options->cg_debug = cg_debug;
     pimpl->spicy_options->module_cache = BifConst::Hilti::use_cache ? ".cache" : "";
+    pimpl->spicy_options->jit_lazy = jit_lazy;
+    pimpl->spicy_options->jit_warm_up = jit_warm_up;
+    pimpl->spicy_options->pgo_generate = BifConst::Hilti::pgo_generate;
+    pimpl->spicy_options->pgo_use = BifConst::Hilti::pgo_use->CheckString();
+    pimpl->spicy_options->thin_link = BifConst::Hilti::thin_link;
+    pimpl->spicy_options->thin_link_threads = pimpl->compile_threads;
+    pimpl->spicy_options->perf_map = BifConst::Hilti::perf_map;
+    pimpl->spicy_options->perf_jitdump = BifConst::Hilti::perf_jitdump;
+    pimpl->spicy_options->frame_pointers = (BifConst::Hilti::sample_rate > 0);
 
     pimpl->jit = nullptr;
 
@@ -436,6 +612,14 @@ bool Manager::LoadFile(const std::string& file)
         return pimpl->compiler->LoadExternalHiltiCode(path);
     }
 
+    if ( ::util::endsWith(path, ".so") || ::util::endsWith(path, ".dylib") ) {
+        if ( pimpl->bundle_path == path )
+            // Already loaded.
+            return true;
+
+        return LoadBundle(path);
+    }
+
     reporter::internal_error(::util::fmt("unknown file type passed to HILTI loader: %s", path));
     return false;
 }
@@ -578,6 +762,9 @@ bool Manager::Compile()
     assert(pre_scripts_init_run);
     assert(post_scripts_init_run);
 
+    if ( pimpl->bundle )
+        return RunBundle();
+
     if ( ! CompileBroScripts() )
         return false;
 
@@ -629,7 +816,13 @@ bool Manager::Compile()
             return false;
     }
 
-    // Compile all the *.spicy modules.
+    if ( pimpl->prune_fields && ! PruneSpicyFields() )
+        return false;
+
+    // Compile all the *.spicy modules. Unlike the HILTI modules further
+    // below, these get compiled one after the other: compiling a module
+    // finalizes it within the shared Spicy and HILTI contexts, and each
+    // generated hooks module imports its grammar's module.
     for ( auto m : pimpl->spicy_modules ) {
         // Compile the *.spicy module itself.
         shared_ptr<::hilti::Module> hilti_module_out;
@@ -726,7 +919,10 @@ bool Manager::Compile()
 
     pimpl->hilti_modules.push_back(libbro);
 
-    // Compile all the *.hlt modules.
+    // Compile all the *.hlt modules. We finalize them all first so that
+    // they can then be compiled independently of each other.
+    std::list<shared_ptr<::hilti::Module>> bro_funcs;
+
     for ( auto m : pimpl->spicy_modules ) {
         AddHiltiTypesForModule(m);
 
@@ -746,25 +942,16 @@ bool Manager::Compile()
         if ( ! hilti_module )
             return false;
 
-        pimpl->hilti_modules.push_back(hilti_module);
-
         // TODO: Not sure why we need this import here.
         pimpl->hilti_context->importModule(std::make_shared<::hilti::ID>("LibBro"));
         pimpl->hilti_context->finalize(hilti_module);
 
-        auto llvm_hilti_module = m->hilti_context->compile(hilti_module);
-
-        if ( ! llvm_hilti_module ) {
-            reporter::error("compiling LibBro library module failed");
-            return false;
-        }
-
-        pimpl->llvm_modules.push_back(std::move(llvm_hilti_module));
-
-        // m->llvm_modules.push_back(llvm_hilti_module);
-        // pimpl->hilti_context->updateCache(m->key, m->llvm_modules);
+        bro_funcs.push_back(hilti_module);
     }
 
+    if ( ! CompileHiltiModules(bro_funcs) )
+        return false;
+
     if ( pimpl->save_hilti ) {
         for ( auto m : pimpl->hilti_modules ) {
             ofstream out(::util::fmt("bro.%s.hlt", m->id()->name()));
@@ -801,9 +988,18 @@ bool Manager::Compile()
 
     llvm_module->setModuleIdentifier("__bro_linked__");
 
+    if ( pimpl->save_bundle.size() && ! SaveBundle(llvm_module.get(), pimpl->save_bundle) )
+        return false;
+
     auto result = RunJIT(std::move(llvm_module));
     PLUGIN_DBG_LOG(HiltiPlugin, "Done with compilation");
 
+    RegisterAnalyzersThroughEvents();
+    return result;
+}
+
+void Manager::RegisterAnalyzersThroughEvents()
+{
     PLUGIN_DBG_LOG(HiltiPlugin, "Registering analyzers through events");
 
     for ( auto a : pimpl->spicy_analyzers ) {
@@ -825,25 +1021,49 @@ bool Manager::Compile()
             mgr.QueueEvent(handler, vals);
         }
     }
-
-    return result;
 }
 
 bool Manager::CompileBroScripts()
 {
     compiler::Compiler::module_list modules = pimpl->compiler->CompileAll();
+    return CompileHiltiModules(modules);
+}
 
-    for ( auto m : modules ) {
-        if ( ! CompileHiltiModule(m) )
-            return false;
+bool Manager::CompileHiltiModules(const std::list<std::shared_ptr<::hilti::Module>>& modules)
+{
+    // With save_llvm we want to record each module as compiled, so we go
+    // through them one by one.
+    if ( pimpl->compile_threads == 1 || pimpl->save_llvm || modules.size() < 2 ) {
+        for ( auto m : modules ) {
+            if ( ! CompileHiltiModule(m) )
+                return false;
+        }
+
+        return true;
+    }
+
+    PLUGIN_DBG_LOG(HiltiPlugin, "Compiling %lu HILTI modules concurrently", modules.size());
+
+    auto lms = pimpl->hilti_context->compile(modules, pimpl->compile_threads);
+
+    if ( lms.empty() ) {
+        reporter::error("compiling HILTI modules failed");
+        return false;
     }
 
+    for ( auto& lm : lms )
+        pimpl->llvm_modules.push_back(std::move(lm));
+
+    for ( auto m : modules )
+        pimpl->hilti_modules.push_back(m);
+
     return true;
 }
 
 bool Manager::CompileHiltiModule(std::shared_ptr<::hilti::Module> m)
 {
-    // TODO: Add caching.
+    // If enabled, this returns a cached version if the module's code hasn't
+    // changed.
     auto lm = pimpl->hilti_context->compile(m);
 
     if ( ! lm ) {
@@ -862,15 +1082,22 @@ bool Manager::CompileHiltiModule(std::shared_ptr<::hilti::Module> m)
     return true;
 }
 
-bool Manager::RunJIT(std::unique_ptr<llvm::Module> llvm_module)
+void Manager::ConfigureRuntime()
 {
-    PLUGIN_DBG_LOG(HiltiPlugin, "Initializing HILTI runtime");
-
     hlt_config cfg = *hlt_config_get();
     cfg.fiber_stack_size = 5000 * 1024;
     cfg.profiling = pimpl->profile;
+    cfg.sampling = BifConst::Hilti::sample_rate;
+    cfg.max_inflated_size = BifConst::Hilti::max_inflated_size;
     cfg.num_workers = pimpl->hilti_workers;
     hlt_config_set(&cfg);
+}
+
+bool Manager::RunJIT(std::unique_ptr<llvm::Module> llvm_module)
+{
+    PLUGIN_DBG_LOG(HiltiPlugin, "Initializing HILTI runtime");
+
+    ConfigureRuntime();
 
     PLUGIN_DBG_LOG(HiltiPlugin, "Running JIT on LLVM module");
 
@@ -883,6 +1110,11 @@ bool Manager::RunJIT(std::unique_ptr<llvm::Module> llvm_module)
 
     pimpl->jit = std::move(jit);
 
+    return InitNativeCode();
+}
+
+bool Manager::InitNativeCode()
+{
     PLUGIN_DBG_LOG(HiltiPlugin, "Retrieving spicy_parsers() function");
 
 #ifdef BRO_PLUGIN_HAVE_PROFILING
@@ -890,7 +1122,7 @@ bool Manager::RunJIT(std::unique_ptr<llvm::Module> llvm_module)
 #endif
 
     typedef hlt_list* (*spicy_parsers_func)(hlt_exception * *excpt, hlt_execution_context * ctx);
-    auto spicy_parsers = (spicy_parsers_func)pimpl->jit->nativeFunction("spicy_parsers");
+    auto spicy_parsers = (spicy_parsers_func)NativeFunction("spicy_parsers");
 
 #ifdef BRO_PLUGIN_HAVE_PROFILING
     profile_update(PROFILE_JIT_LAND, PROFILE_STOP);
@@ -923,13 +1155,8 @@ bool Manager::RunJIT(std::unique_ptr<llvm::Module> llvm_module)
             auto symbol = i.first;
             auto func = i.second;
 
-            auto native = pimpl->jit->nativeFunction(symbol);
-            auto id = func->GetUniqueFuncID();
-
-            if ( pimpl->native_functions.size() <= id )
-                pimpl->native_functions.resize(id + 1);
-
-            pimpl->native_functions[id] = native;
+            auto native = NativeFunction(symbol);
+            RegisterNativeFunction(func, native);
 
             PLUGIN_DBG_LOG(HiltiPlugin, "    %s -> %s at %p", func->Name(), symbol.c_str(), native);
         }
@@ -1298,6 +1525,199 @@ error:
     return false;
 }
 
+void* Manager::NativeFunction(const string& name)
+{
+    if ( pimpl->bundle )
+        return dlsym(pimpl->bundle, name.c_str());
+
+    return pimpl->jit->nativeFunction(name);
+}
+
+// Prefix for the first line of a bundle's meta data.
+static const char* BundleMagic = "bro-hilti-bundle";
+
+bool Manager::SaveBundle(llvm::Module* llvm_module, const string& path)
+{
+    PLUGIN_DBG_LOG(HiltiPlugin, "Saving bundle to %s", path.c_str());
+
+    if ( pimpl->compile_scripts || HaveCustomHiltiCode() ) {
+        reporter::error("bundles can include only Spicy analyzers, not compiled scripts or *.hlt");
+        return false;
+    }
+
+    // The meta data is a series of lines, with the first one identifying
+    // the version of HILTI that the code was compiled with. Analyzers are
+    // recorded in their original *.evt syntax, and events with the
+    // description of their Bro signature.
+    std::list<string> meta;
+    meta.push_back(::util::fmt("%s %s", BundleMagic, ::hilti::version()));
+
+    for ( auto a : pimpl->spicy_analyzers )
+        meta.push_back(a->spec);
+
+    for ( auto a : pimpl->spicy_file_analyzers )
+        meta.push_back(a->spec);
+
+    for ( auto ev : pimpl->spicy_events ) {
+        ODesc d;
+        d.SetShort();
+        ev->bro_event_type->Describe(&d);
+        meta.push_back(::util::fmt("event %s %s", ev->name, d.Description()));
+    }
+
+    auto data = llvm::ConstantDataArray::getString(llvm_module->getContext(),
+                                                   ::util::strjoin(meta, "\n"));
+    new llvm::GlobalVariable(*llvm_module, data->getType(), true,
+                             llvm::GlobalValue::ExternalLinkage, data, "__bro_hilti_bundle");
+
+    return pimpl->hilti_context->buildSharedLibrary(llvm_module, path);
+}
+
+bool Manager::LoadBundle(const string& path)
+{
+    if ( pimpl->bundle ) {
+        reporter::error(::util::fmt("cannot load bundle %s, already have %s", path,
+                                    pimpl->bundle_path));
+        return false;
+    }
+
+    PLUGIN_DBG_LOG(HiltiPlugin, "Loading bundle %s", path.c_str());
+
+    auto bundle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+
+    if ( ! bundle ) {
+        reporter::error(::util::fmt("cannot load bundle %s: %s", path, dlerror()));
+        return false;
+    }
+
+    auto data = (const char*)dlsym(bundle, "__bro_hilti_bundle");
+
+    if ( ! data ) {
+        reporter::error(::util::fmt("%s is not a HILTI bundle", path));
+        dlclose(bundle);
+        return false;
+    }
+
+    auto meta = ::util::strsplit(data, "\n");
+
+    if ( meta.empty() || meta.front() != ::util::fmt("%s %s", BundleMagic, ::hilti::version()) ) {
+        reporter::error(
+            ::util::fmt("bundle %s was built with a different version of HILTI", path));
+        dlclose(bundle);
+        return false;
+    }
+
+    pimpl->bundle = bundle;
+    pimpl->bundle_path = path;
+
+    meta.pop_front();
+
+    for ( auto m : meta ) {
+        reporter::push_location(path, 0);
+
+        if ( looking_at(m, 0, "protocol") ) {
+            auto a = ParseSpicyAnalyzerSpec(m);
+
+            if ( ! a ) {
+                reporter::pop_location();
+                return false;
+            }
+
+            a->spec = m;
+            pimpl->spicy_analyzers.push_back(a);
+            RegisterBroAnalyzer(a);
+        }
+
+        else if ( looking_at(m, 0, "file") ) {
+            auto a = ParseSpicyFileAnalyzerSpec(m);
+
+            if ( ! a ) {
+                reporter::pop_location();
+                return false;
+            }
+
+            a->spec = m;
+            pimpl->spicy_file_analyzers.push_back(a);
+            RegisterBroFileAnalyzer(a);
+        }
+
+        else if ( looking_at(m, 0, "event") ) {
+            size_t i = 0;
+            string name;
+
+            eat_token(m, &i, "event");
+
+            if ( ! extract_id(m, &i, &name) ) {
+                reporter::pop_location();
+                return false;
+            }
+
+            eat_spaces(m, &i);
+            pimpl->bundle_events.push_back(std::make_pair(name, m.substr(i)));
+            HiltiPlugin.AddEvent(name);
+        }
+
+        reporter::pop_location();
+    }
+
+    return true;
+}
+
+bool Manager::RunBundle()
+{
+    if ( pimpl->spicy_files.size() || pimpl->evt_files.size() || pimpl->hlt_files.size() ||
+         pimpl->compile_scripts ) {
+        reporter::error(::util::fmt("cannot compile further code in addition to bundle %s",
+                                    pimpl->bundle_path));
+        return false;
+    }
+
+    // We can't adapt the compiled code anymore, so we insist on the events
+    // having the same signature as when the bundle was built.
+    for ( auto ev : pimpl->bundle_events ) {
+        EventHandlerPtr handler = event_registry->Lookup(ev.first.c_str());
+
+        if ( ! (handler && handler->FType()) )
+            continue;
+
+        ODesc d;
+        d.SetShort();
+        handler->FType()->Describe(&d);
+
+        if ( ev.second != d.Description() ) {
+            reporter::error(::util::fmt("event %s has changed its signature since bundle %s was "
+                                        "built; was '%s', is now '%s'",
+                                        ev.first, pimpl->bundle_path, ev.second,
+                                        d.Description()));
+            return false;
+        }
+    }
+
+    PLUGIN_DBG_LOG(HiltiPlugin, "Initializing HILTI runtime for bundle %s",
+                   pimpl->bundle_path.c_str());
+
+    ConfigureRuntime();
+
+    // Same as the JIT does: let the bundle use the global libhilti state
+    // of the current process.
+    auto hrss = (void (*)(void*))NativeFunction("__hlt_runtime_state_set");
+    auto hlt_init = (void (*)())NativeFunction("__hlt_init");
+
+    if ( ! (hrss && hlt_init) ) {
+        reporter::error(::util::fmt("bundle %s is missing the HILTI runtime", pimpl->bundle_path));
+        return false;
+    }
+
+    (*hrss)(__hlt_runtime_state_get());
+    (*hlt_init)();
+
+    if ( ! InitNativeCode() )
+        return false;
+
+    RegisterAnalyzersThroughEvents();
+    return true;
+}
+
 bool Manager::LoadSpicyEvents(const string& path)
 {
     std::ifstream in(path);
@@ -1351,6 +1771,7 @@ bool Manager::LoadSpicyEvents(const string& path)
             if ( ! a )
                 goto error;
 
+            a->spec = chunk;
             pimpl->spicy_analyzers.push_back(a);
             RegisterBroAnalyzer(a);
             PLUGIN_DBG_LOG(HiltiPlugin, "Finished processing analyzer definition for %s",
@@ -1364,6 +1785,7 @@ bool Manager::LoadSpicyEvents(const string& path)
             if ( ! a )
                 goto error;
 
+            a->spec = chunk;
             pimpl->spicy_file_analyzers.push_back(a);
             RegisterBroFileAnalyzer(a);
             PLUGIN_DBG_LOG(HiltiPlugin, "Finished processing file analyzer definition for %s",
@@ -2071,6 +2493,55 @@ bool Manager::CreateSpicyHook(SpicyEventInfo* ev)
     return true;
 }
 
+bool Manager::PruneSpicyFields()
+{
+    // Custom HILTI code may access any field of a parse object.
+    if ( HaveCustomHiltiCode() ) {
+        PLUGIN_DBG_LOG(HiltiPlugin, "Not pruning unit fields because of custom HILTI code");
+        return true;
+    }
+
+    ::spicy::passes::FieldPruner pruner;
+
+    for ( auto m : pimpl->spicy_modules )
+        pruner.addUses(m->module);
+
+    // Of the generated code, only that of events we raise matters. We
+    // don't scan the hooks themselves as they pass the whole unit on to
+    // the raise function, which then evaluates the argument expressions.
+    for ( auto ev : pimpl->spicy_events ) {
+        if ( ! WantEvent(ev) )
+            continue;
+
+        pruner.addHook(ev->hook_local);
+
+        if ( ev->condition.size() ) {
+            auto cond = pimpl->spicy_context->parseExpression(ev->condition);
+
+            if ( cond )
+                pruner.addUses(cond);
+        }
+
+        for ( auto acc : ev->expr_accessors ) {
+            if ( acc->spicy_func )
+                pruner.addUses(acc->spicy_func);
+
+            // Values that we convert into Bro values get accessed as a whole.
+            pruner.addUse(acc->btype);
+        }
+    }
+
+    for ( auto m : pimpl->spicy_modules ) {
+        if ( ! pruner.run(m->module) )
+            return false;
+    }
+
+    for ( auto f : pruner.pruned() )
+        PLUGIN_DBG_LOG(HiltiPlugin, "Not storing unused field %s", f.c_str());
+
+    return true;
+}
+
 bool Manager::CreateExpressionAccessors(shared_ptr<SpicyEventInfo> ev)
 {
     int nr = 0;
@@ -2274,7 +2745,9 @@ bool Manager::CreateHiltiEventFunction(SpicyEventInfo* ev)
     mbuilder->builder()->addInstruction(::hilti::instruction::profiler::Start,
                                         ::hilti::builder::string::create(string("bro/") + fname));
 
-    if ( pimpl->compile_scripts && pimpl->spicy_to_compiler )
+    if ( pimpl->parallel_analysis || pimpl->parallel_file_analysis )
+        CreateHiltiEventFunctionBodyForParallel(ev, fname);
+    else if ( pimpl->compile_scripts && pimpl->spicy_to_compiler )
         CreateHiltiEventFunctionBodyForHilti(ev);
     else
         CreateHiltiEventFunctionBodyForBro(ev);
@@ -2291,12 +2764,150 @@ bool Manager::CreateHiltiEventFunction(SpicyEventInfo* ev)
     return true;
 }
 
-bool Manager::CreateHiltiEventFunctionBodyForBro(SpicyEventInfo* ev)
+bool Manager::CreateHiltiEventFunctionBodyForParallel(SpicyEventInfo* ev, const std::string& fname)
+{
+    // We are running on a worker thread here. We evaluate the event's
+    // arguments right away, as they refer to the parsing state that will
+    // have moved on by the time the main thread gets to it. We then bind
+    // the values to a function that raises the event, and leave that
+    // to the main thread.
+    auto mbuilder = ev->minfo->hilti_mbuilder;
+
+    // Before doing any of that, skip events that nobody handles. The
+    // worker can't get to the main thread's handler globals, so it asks
+    // the manager by index.
+    auto idx = pimpl->parallel_event_handlers.size();
+    pimpl->parallel_event_handlers.push_back(
+        ev->bro_event_handler ? ev->bro_event_handler.Ptr() : nullptr);
+
+    auto active = mbuilder->addTmp("active", ::hilti::builder::boolean::type());
+    mbuilder->builder()->addInstruction(active, ::hilti::instruction::flow::CallResult,
+                                        ::hilti::builder::id::create(
+                                            "LibBro::parallel_event_active"),
+                                        ::hilti::builder::tuple::create(
+                                            {::hilti::builder::integer::create(idx)}));
+
+    auto ablocks = mbuilder->builder()->addIf(active);
+    auto block_active = std::get<0>(ablocks);
+    auto block_done = std::get<1>(ablocks);
+
+    mbuilder->pushBuilder(block_active);
+
+    ::hilti::builder::tuple::element_list vals;
+    ::hilti::builder::function::parameter_list params;
+
+    int i = 0;
+
+    for ( auto e : ev->expr_accessors ) {
+        if ( e->expr == "$conn" || e->expr == "$file" || e->expr == "$is_orig" ) {
+            // These are taken from the cookie on the main thread.
+            i++;
+            continue;
+        }
+
+        auto tmp = mbuilder->addTmp("t", e->htype);
+        auto func_id =
+            e->hlt_func ? e->hlt_func->id() : ::hilti::builder::id::node("null-function>");
+
+        auto args = ::hilti::builder::tuple::element_list();
+
+        for ( auto m : ev->unit_type->scope()->map() ) {
+            auto n = (m.first != "$$" ? m.first : "__dollardollar");
+            auto t = ::ast::rtti::tryCast<::spicy::expression::ParserState>(m.second->front());
+
+            if ( t )
+                args.push_back(::hilti::builder::id::create(n));
+        }
+
+        args.push_back(::hilti::builder::id::create("cookie"));
+
+        mbuilder->builder()->addInstruction(tmp, ::hilti::instruction::flow::CallResult,
+                                            ::hilti::builder::id::create(func_id),
+                                            ::hilti::builder::tuple::create(args));
+
+        auto id = ::hilti::builder::id::node(::util::fmt("__a%d", i));
+        params.push_back(::hilti::builder::function::parameter(id, e->htype, false, nullptr));
+        vals.push_back(tmp);
+        i++;
+    }
+
+    params.push_back(
+        ::hilti::builder::function::parameter("cookie",
+                                              ::hilti::builder::type::byName("LibBro::SpicyCookie"),
+                                              false, nullptr));
+    vals.push_back(::hilti::builder::id::create("cookie"));
+
+    auto mname = fname + "_main";
+    auto result = ::hilti::builder::function::result(::hilti::builder::void_::type());
+    mbuilder->pushFunction(mname, result, params);
+    CreateHiltiEventFunctionBodyForBro(ev, true);
+    mbuilder->popFunction();
+
+    auto tc = ::hilti::builder::callable::type(::hilti::builder::void_::type());
+    auto rtc = ::hilti::builder::reference::type(tc);
+    auto c = mbuilder->addTmp("c", rtc);
+
+    mbuilder->builder()->addInstruction(c, ::hilti::instruction::callable::NewFunction,
+                                        ::hilti::builder::type::create(tc),
+                                        ::hilti::builder::id::create(mname),
+                                        ::hilti::builder::tuple::create(vals));
+
+    mbuilder->builder()->addInstruction(::hilti::instruction::flow::CallVoid,
+                                        ::hilti::builder::id::create("LibBro::defer_event"),
+                                        ::hilti::builder::tuple::create(
+                                            {c, ::hilti::builder::id::create("cookie")}));
+
+    mbuilder->builder()->addInstruction(::hilti::instruction::flow::Jump, block_done->block());
+    mbuilder->popBuilder(block_active);
+
+    mbuilder->pushBuilder(block_done);
+
+    return true;
+}
+
+bool Manager::CreateHiltiEventFunctionBodyForBro(SpicyEventInfo* ev, bool from_params)
 {
     auto mbuilder = ev->minfo->hilti_mbuilder;
 
     pimpl->hilti_context->resolveTypes(mbuilder->module());
 
+    auto canon_name = ::util::strreplace(ev->name, "::", "_");
+    auto handler = mbuilder->addGlobal(util::fmt("__bro_handler_%s_%p", canon_name, ev),
+                                       ::hilti::builder::type::byName("LibBro::BroEventHandler"));
+
+    auto cond = mbuilder->addTmp("no_handler", ::hilti::builder::boolean::type());
+    mbuilder->builder()->addInstruction(cond, ::hilti::instruction::operator_::Equal, handler,
+                                        ::hilti::builder::caddr::create());
+
+
+    auto blocks = mbuilder->builder()->addIf(cond);
+    auto block_true = std::get<0>(blocks);
+    auto block_cont = std::get<1>(blocks);
+
+    mbuilder->pushBuilder(block_true);
+    mbuilder->builder()->addInstruction(handler, ::hilti::instruction::flow::CallResult,
+                                        ::hilti::builder::id::create("LibBro::get_event_handler"),
+                                        ::hilti::builder::tuple::create(
+                                            {::hilti::builder::bytes::create(ev->name)}));
+    mbuilder->builder()->addInstruction(::hilti::instruction::flow::Jump, block_cont->block());
+    mbuilder->popBuilder(block_true);
+
+    mbuilder->pushBuilder(block_cont);
+
+    // Skip the conversion of the arguments if nobody is going to see the
+    // event, including when its handlers have been disabled at runtime.
+    auto active = mbuilder->addTmp("active", ::hilti::builder::boolean::type());
+    mbuilder->builder()->addInstruction(active, ::hilti::instruction::flow::CallResult,
+                                        ::hilti::builder::id::create(
+                                            "LibBro::event_handler_active"),
+                                        ::hilti::builder::tuple::create({handler}));
+
+    auto ablocks = mbuilder->builder()->addIf(active);
+    auto block_active = std::get<0>(ablocks);
+    auto block_done = std::get<1>(ablocks);
+
+    mbuilder->pushBuilder(block_active);
+
     ::hilti::builder::tuple::element_list vals;
 
     int i = 0;
@@ -2328,6 +2939,13 @@ bool Manager::CreateHiltiEventFunctionBodyForBro(SpicyEventInfo* ev)
                                                     {::hilti::builder::id::create("cookie")}));
         }
 
+        else if ( from_params ) {
+            auto arg = ::hilti::builder::id::create(::util::fmt("__a%d", i));
+            ev->minfo->value_converter->Convert(arg, val, e->btype,
+                                                ev->bro_event_type->AsFuncType()->Args()->FieldType(
+                                                    i));
+        }
+
         else {
             auto tmp = mbuilder->addTmp("t", e->htype);
             auto func_id =
@@ -2358,34 +2976,16 @@ bool Manager::CreateHiltiEventFunctionBodyForBro(SpicyEventInfo* ev)
         i++;
     }
 
-    auto canon_name = ::util::strreplace(ev->name, "::", "_");
-    auto handler = mbuilder->addGlobal(util::fmt("__bro_handler_%s_%p", canon_name, ev),
-                                       ::hilti::builder::type::byName("LibBro::BroEventHandler"));
-
-    auto cond = mbuilder->addTmp("no_handler", ::hilti::builder::boolean::type());
-    mbuilder->builder()->addInstruction(cond, ::hilti::instruction::operator_::Equal, handler,
-                                        ::hilti::builder::caddr::create());
-
-
-    auto blocks = mbuilder->builder()->addIf(cond);
-    auto block_true = std::get<0>(blocks);
-    auto block_cont = std::get<1>(blocks);
-
-    mbuilder->pushBuilder(block_true);
-    mbuilder->builder()->addInstruction(handler, ::hilti::instruction::flow::CallResult,
-                                        ::hilti::builder::id::create("LibBro::get_event_handler"),
-                                        ::hilti::builder::tuple::create(
-                                            {::hilti::builder::bytes::create(ev->name)}));
-    mbuilder->builder()->addInstruction(::hilti::instruction::flow::Jump, block_cont->block());
-    mbuilder->popBuilder(block_true);
-
-    mbuilder->pushBuilder(block_cont);
-
     mbuilder->builder()->addInstruction(::hilti::instruction::flow::CallVoid,
                                         ::hilti::builder::id::create("LibBro::raise_event"),
                                         ::hilti::builder::tuple::create(
                                             {handler, ::hilti::builder::tuple::create(vals)}));
 
+    mbuilder->builder()->addInstruction(::hilti::instruction::flow::Jump, block_done->block());
+    mbuilder->popBuilder(block_active);
+
+    mbuilder->pushBuilder(block_done);
+
     return true;
 }
 
@@ -2612,6 +3212,93 @@ bool Manager::HaveCustomHiltiCode()
     return pimpl->hlt_files.size();
 }
 
+bool Manager::ParallelAnalysis() const
+{
+    return pimpl->parallel_analysis;
+}
+
+bool Manager::ParallelFileAnalysis() const
+{
+    return pimpl->parallel_file_analysis;
+}
+
+bool Manager::ParallelEventActive(int64_t idx) const
+{
+    // Unsynchronized, a worker may still see a handler that's just been
+    // disabled. That's fine, the main thread checks again before raising
+    // the event.
+    auto h = pimpl->parallel_event_handlers[idx];
+    return h && *h;
+}
+
+// Events deferred by the current thread but not yet passed on to the
+// main thread.
+static thread_local std::vector<hlt_callable*> deferred_events;
+
+// The owner of the callbacks the current thread queues.
+static thread_local const void* completion_owner = nullptr;
+
+static const size_t MaxDeferredEvents = 64;
+
+void Manager::QueueCompletion(std::function<void()> cb)
+{
+    FlushDeferredEvents();
+    pimpl->completions.Push(std::move(cb), completion_owner);
+}
+
+void Manager::DeferEvent(hlt_callable* c)
+{
+    if ( deferred_events.empty() )
+        deferred_events.reserve(MaxDeferredEvents);
+
+    deferred_events.push_back(c);
+
+    if ( deferred_events.size() >= MaxDeferredEvents )
+        FlushDeferredEvents();
+}
+
+void Manager::FlushDeferredEvents()
+{
+    if ( deferred_events.empty() )
+        return;
+
+    auto batch = std::make_shared<std::vector<hlt_callable*>>();
+    batch->swap(deferred_events);
+
+    auto run = [batch]() {
+        hlt_execution_context* ctx = hlt_global_execution_context();
+
+        for ( auto c : *batch ) {
+            hlt_exception* excpt = 0;
+            HLT_CALLABLE_RUN(c, 0, Hilti_CallbackSchedule, &excpt, ctx);
+            GC_DTOR(c, hlt_callable, ctx);
+
+            if ( excpt ) {
+                char* e = hlt_exception_to_asciiz(excpt, &excpt, ctx);
+                reporter::error(::util::fmt("exception in deferred Spicy event: %s", e));
+                hlt_free(e);
+            }
+        }
+    };
+
+    pimpl->completions.Push(run, completion_owner);
+}
+
+unsigned int Manager::RunCompletions()
+{
+    return pimpl->completions.Run();
+}
+
+unsigned int Manager::RunCompletions(const void* owner)
+{
+    return pimpl->completions.Run(owner);
+}
+
+void Manager::SetCompletionOwner(const void* owner)
+{
+    completion_owner = owner;
+}
+
 bool Manager::RuntimeRaiseEvent(Event* event)
 {
     auto efunc = event->Handler()->LocalHandler();
@@ -2632,34 +3319,32 @@ bool Manager::RuntimeRaiseEvent(Event* event)
 
 ::Val* Manager::RuntimeCallFunctionInternal(const ::Func* func, val_list* args)
 {
-    // TODO: We should cache the nativeFunction() lookup here between
-    // calls to speed it up, unless that method itself is already as fast
-    // as we would that get that way.
-
-    assert(pimpl->jit);
-
     auto id = func->GetUniqueFuncID();
 
-    void* native = 0;
-
-    if ( pimpl->native_functions.size() <= id )
-        pimpl->native_functions.resize(id + 1);
-
-    native = pimpl->native_functions[id];
-
-    if ( ! native ) {
+    if ( id >= pimpl->native_functions.size() || ! pimpl->native_functions[id].trampoline ) {
         // First try again to get it, it could be a custom user
         // function that we haven't used yet.
         auto symbol = pimpl->compiler->HiltiStubSymbol(func, nullptr, true);
-        native = pimpl->jit->nativeFunction(symbol);
+        auto native = NativeFunction(symbol);
 
-        if ( native )
-            pimpl->native_functions[id] = native;
-
-        else {
+        if ( ! native ) {
             reporter::warning(::util::fmt("no HILTI function %s for %s", symbol, func->Name()));
             return new ::Val(0, ::TYPE_ERROR);
         }
+
+        RegisterNativeFunction(func, native);
+
+        if ( ! pimpl->native_functions[id].trampoline )
+            return new ::Val(0, ::TYPE_ERROR);
+    }
+
+    // Copy, the vector may grow during the call.
+    auto call = pimpl->native_functions[id];
+
+    if ( args->length() != call.arity ) {
+        reporter::error(::util::fmt("function/event %s called with %d arguments, expected %d",
+                                    func->Name(), args->length(), call.arity));
+        return new ::Val(0, ::TYPE_ERROR);
     }
 
     hlt_exception* excpt = 0;
@@ -2670,46 +3355,7 @@ bool Manager::RuntimeRaiseEvent(Event* event)
     profile_update(PROFILE_HILTI_LAND, PROFILE_START);
 #endif
 
-    ::Val* result = nullptr;
-
-    switch ( args->length() ) {
-    case 0:
-        typedef ::Val* (*e0)(hlt_exception**, hlt_execution_context*);
-        result = (*(e0)native)(&excpt, ctx);
-        break;
-
-    case 1:
-        typedef ::Val* (*e1)(Val*, hlt_exception**, hlt_execution_context*);
-        result = (*(e1)native)((*args)[0], &excpt, ctx);
-        break;
-
-    case 2:
-        typedef ::Val* (*e2)(Val*, Val*, hlt_exception**, hlt_execution_context*);
-        result = (*(e2)native)((*args)[0], (*args)[1], &excpt, ctx);
-        break;
-
-    case 3:
-        typedef ::Val* (*e3)(Val*, Val*, Val*, hlt_exception**, hlt_execution_context*);
-        result = (*(e3)native)((*args)[0], (*args)[1], (*args)[2], &excpt, ctx);
-        break;
-
-    case 4:
-        typedef ::Val* (*e4)(Val*, Val*, Val*, Val*, hlt_exception**, hlt_execution_context*);
-        result = (*(e4)native)((*args)[0], (*args)[1], (*args)[2], (*args)[3], &excpt, ctx);
-        break;
-
-    case 5:
-        typedef ::Val* (*e5)(Val*, Val*, Val*, Val*, Val*, hlt_exception**, hlt_execution_context*);
-        result =
-            (*(e5)native)((*args)[0], (*args)[1], (*args)[2], (*args)[3], (*args)[4], &excpt, ctx);
-        break;
-
-    default:
-        reporter::error(::util::fmt(
-            "function/event %s with %d parameters not yet supported in RuntimeCallFunction()",
-            func->Name(), args->length()));
-        return new ::Val(0, ::TYPE_ERROR);
-    }
+    ::Val* result = (*call.trampoline)(call.native, args, &excpt, ctx);
 
 #ifdef BRO_PLUGIN_HAVE_PROFILING
     profile_update(PROFILE_HILTI_LAND, PROFILE_STOP);
@@ -2729,7 +3375,28 @@ bool Manager::RuntimeRaiseEvent(Event* event)
 void Manager::RegisterNativeFunction(const ::Func* func, void* native)
 {
     auto id = func->GetUniqueFuncID();
-    pimpl->native_functions[id] = native;
+
+    if ( pimpl->native_functions.size() <= id )
+        pimpl->native_functions.resize(id + 1);
+
+    auto& call = pimpl->native_functions[id];
+    call.native = native;
+    call.trampoline = nullptr;
+
+    if ( ! native )
+        return;
+
+    int arity = func->FType()->Args()->NumFields();
+
+    if ( arity > MaxNativeArgs ) {
+        reporter::error(::util::fmt(
+            "function/event %s with %d parameters not yet supported in RuntimeCallFunction()",
+            func->Name(), arity));
+        return;
+    }
+
+    call.trampoline = native_trampolines[arity];
+    call.arity = arity;
 }
 
 bool Manager::WantEvent(SpicyEventInfo* ev)
@@ -41,6 +41,7 @@
 
 class BroType;
 
+struct __hlt_callable;
 struct __hlt_list;
 struct __spicy_parser;
 
@@ -143,7 +144,9 @@ public:
     /**
      * Marks an *.spicy, *.evt, or *.hlt file for loading. Note that it
      * won't necessarily load them all immediately, but may queue some
-     * for later compilation via LoadAll().
+     * for later compilation via LoadAll(). This also accepts a precompiled
+     * bundle (*.so) as written with \c Hilti::save_bundle, which then
+     * replaces compiling any source files.
      */
     bool LoadFile(const std::string& file);
 
@@ -224,13 +227,94 @@ public:
      */
     bool RuntimeRaiseEvent(Event* event);
 
+    /**
+     * Returns true if Spicy protocol analyzers parse their input on HILTI
+     * worker threads, as configured through \c Hilti::parallel_analysis.
+     */
+    bool ParallelAnalysis() const;
+
+    /**
+     * Returns true if Spicy file analyzers parse their input on HILTI
+     * worker threads, as configured through \c Hilti::parallel_file_analysis.
+     */
+    bool ParallelFileAnalysis() const;
+
+    /**
+     * Returns true if an event raised from a worker thread has any
+     * handlers enabled. Safe to call from any thread.
+     *
+     * @param idx The event's index, as generated into the code.
+     */
+    bool ParallelEventActive(int64_t idx) const;
+
+    /**
+     * Queues a callback for running on Bro's main thread the next time it
+     * drains its event queue. With parallel analysis, code running on
+     * worker threads uses this for all operations touching Bro's state.
+     * This is safe to call from any thread. Flushes the calling thread's
+     * deferred events first, so that order is preserved.
+     *
+     * @param cb The callback.
+     */
+    void QueueCompletion(std::function<void()> cb);
+
+    /**
+     * Defers raising an event to Bro's main thread. The callable raises
+     * the event when run, converting its arguments into Bro values only
+     * then. Events get collected in a per-thread batch that's passed on
+     * to the main thread as a whole once full, or when flushed.
+     *
+     * @param c The callable, which must already be a copy owned by the
+     * main thread. Takes ownership.
+     */
+    void DeferEvent(__hlt_callable* c);
+
+    /**
+     * Passes all events deferred by the calling thread on to the main
+     * thread.
+     */
+    void FlushDeferredEvents();
+
+    /**
+     * Runs all callbacks queued through QueueCompletion() so far. Must be
+     * called only from Bro's main thread.
+     *
+     * @return The number of callbacks run.
+     */
+    unsigned int RunCompletions();
+
+    /**
+     * Runs all callbacks queued so far on behalf of a given owner, leaving
+     * all others queued. Must be called only from Bro's main thread.
+     *
+     * @param owner The owner, as passed to SetCompletionOwner().
+     *
+     * @return The number of callbacks run.
+     */
+    unsigned int RunCompletions(const void* owner);
+
+    /**
+     * Associates all callbacks that the calling thread queues from now on,
+     * including those for deferred events, with an owner. That lets the
+     * owner run its callbacks before going away.
+     *
+     * @param owner The owner, or null for none.
+     */
+    void SetCompletionOwner(const void* owner);
+
     /**
      * XXX
      */
     std::pair<bool, Val*> RuntimeCallFunction(const Func* func, Frame* parent, val_list* args);
 
     /**
-     * XXX
+     * Records the compiled code for a Bro function, along with the
+     * trampoline that calls it with the function's number of arguments.
+     * Calls from Bro then dispatch directly through that.
+     *
+     * @param func The Bro function.
+     *
+     * @param native The compiled code's stub, or null if not available.
      */
     void RegisterNativeFunction(const ::Func* func, void* native);
 
@@ -404,6 +488,16 @@ protected:
      */
     bool CreateSpicyHook(SpicyEventInfo* ev);
 
+    /**
+     * Marks all unit fields as transient that neither the Spicy modules
+     * nor any of the events we generate code for read. The parsers then
+     * skip storing them. Must be called after all Spicy hooks have been
+     * created, but before the Spicy modules get compiled.
+     *
+     * @return True if successful.
+     */
+    bool PruneSpicyFields();
+
     /**
      * XXX
      */
@@ -433,9 +527,31 @@ protected:
     bool CreateHiltiEventFunction(SpicyEventInfo* ev);
 
     /**
-     * XXX
+     * Creates the code that converts an event's arguments into Bro
+     * values and raises it.
+     *
+     * @param event The event to create the code for.
+     *
+     * @param from_params If true, the function being built receives the
+     * values of the argument expressions as its parameters, rather than
+     * the parse objects to compute them from.
+     *
+     * @return True if successful.
+     */
+    bool CreateHiltiEventFunctionBodyForBro(SpicyEventInfo* ev, bool from_params = false);
+
+    /**
+     * With parallel analysis, creates the code that computes an event's
+     * arguments on the worker thread and then defers raising it to Bro's
+     * main thread through another function created here.
+     *
+     * @param event The event to create the code for.
+     *
+     * @param fname The name of the raise() function being built.
+     *
+     * @return True if successful.
      */
-    bool CreateHiltiEventFunctionBodyForBro(SpicyEventInfo* ev);
+    bool CreateHiltiEventFunctionBodyForParallel(SpicyEventInfo* ev, const std::string& fname);
 
     /**
      * XXX
@@ -465,11 +581,73 @@ protected:
      */
     bool RunJIT(std::unique_ptr<llvm::Module> llvm_module);
 
+    /**
+     * Initializes the HILTI runtime inside a loaded bundle and retrieves
+     * its parsers. This is the counterpart to RunJIT() for precompiled
+     * code.
+     */
+    bool RunBundle();
+
+    /**
+     * Sets the HILTI runtime's configuration before initializing it.
+     */
+    void ConfigureRuntime();
+
+    /**
+     * Queues the events that register our analyzers' ports and MIME types
+     * with Bro's script layer.
+     */
+    void RegisterAnalyzersThroughEvents();
+
+    /**
+     * Sets up our analyzers with the parsers from the compiled code, once
+     * that's either JITed or loaded from a bundle.
+     */
+    bool InitNativeCode();
+
+    /**
+     * Returns a pointer to a function inside the compiled code, either
+     * JITed or loaded from a bundle. Returns null if not found.
+     */
+    void* NativeFunction(const std::string& name);
+
+    /**
+     * Loads a precompiled bundle written by SaveBundle() and registers
+     * the analyzers and events it provides.
+     *
+     * @param path The full path to load the bundle from.
+     *
+     * @return True if successfull.
+     */
+    bool LoadBundle(const std::string& path);
+
+    /**
+     * Compiles the final linked module into a shared library bundle, along
+     * with the information that LoadBundle() needs to use it without the
+     * sources.
+     *
+     * @param llvm_module The linked module. The method adds the bundle's
+     * meta data to it.
+     *
+     * @param path The path of the bundle to write.
+     *
+     * @return True if successfull.
+     */
+    bool SaveBundle(llvm::Module* llvm_module, const std::string& path);
+
     /**
      * XXX
      */
     bool CompileHiltiModule(std::shared_ptr<::hilti::Module> m);
 
+    /**
+     * Compiles a set of finalized HILTI modules, concurrently if
+     * configured through \c Hilti::compile_threads.
+     *
+     * @param modules The modules to compile.
+     */
+    bool CompileHiltiModules(const std::list<std::shared_ptr<::hilti::Module>>& modules);
+
     /**
      * XXX
      */
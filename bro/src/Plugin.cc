@@ -83,6 +83,11 @@ void plugin::Bro_Hilti::Plugin::InitPostScript()
     if ( ! _manager->InitPostScripts() )
         exit(1);
 
+    // Parallel analyzers pass their results back whenever Bro drains its
+    // event queue.
+    if ( _manager->ParallelAnalysis() || _manager->ParallelFileAnalysis() )
+        EnableHook(plugin::HOOK_DRAIN_EVENTS);
+
     if ( ! _manager->FinishLoading() )
         exit(1);
 
@@ -172,7 +177,7 @@ void plugin::Bro_Hilti::Plugin::RequestEvent(EventHandlerPtr handler)
 
 int plugin::Bro_Hilti::Plugin::HookLoadFile(const std::string& file, const std::string& ext)
 {
-    if ( ext == "spicy" || ext == "evt" || ext == "hlt" )
+    if ( ext == "spicy" || ext == "evt" || ext == "hlt" || ext == "so" || ext == "dylib" )
         return _manager->LoadFile(file) ? 1 : 0;
 
     return -1;
@@ -221,6 +226,7 @@ void plugin::Bro_Hilti::Plugin::HookUpdateNetworkTime(double network_time)
 
 void plugin::Bro_Hilti::Plugin::HookDrainEvents()
 {
+    _manager->RunCompletions();
 }
 
 void plugin::Bro_Hilti::Plugin::HookBroObjDtor(void* obj)
@@ -23,6 +23,7 @@ extern "C" {
 }
 
 #include "LocalReporter.h"
+#include "Manager.h"
 #include "RuntimeInterface.h"
 
 #undef List
@@ -382,6 +383,18 @@ void* libbro_get_event_handler(hlt_bytes* name, hlt_exception** excpt, hlt_execu
     return ev && ev.Ptr() ? ev.Ptr() : &no_handler;
 }
 
+int8_t libbro_event_handler_active(void* hdl, hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    EventHandler* ev = (EventHandler*)hdl;
+    return ev != &no_handler && *ev;
+}
+
+int8_t libbro_parallel_event_active(int64_t idx, hlt_exception** excpt,
+                                    hlt_execution_context* ctx)
+{
+    return HiltiPlugin.Mgr()->ParallelEventActive(idx);
+}
+
 void libbro_raise_event(void* hdl, const hlt_type_info* type, void* tuple, hlt_exception** excpt,
                         hlt_execution_context* ctx)
 {
@@ -423,6 +436,25 @@ void libbro_raise_event(void* hdl, const hlt_type_info* type, void* tuple, hlt_e
     return result;
 }
 
+void libbro_defer_event(hlt_callable* c, void* cookie, hlt_exception** excpt,
+                        hlt_execution_context* ctx)
+{
+    if ( ctx->vid == HLT_VID_MAIN ) {
+        HLT_CALLABLE_RUN(c, 0, Hilti_CallbackSchedule, excpt, ctx);
+        return;
+    }
+
+    // The main thread can't share the worker's values, so it gets its own
+    // copy of the callable with all its arguments.
+    hlt_callable* copy = 0;
+    hlt_clone_for_thread(&copy, &hlt_type_info_hlt_callable, &c, HLT_VID_MAIN, excpt, ctx);
+
+    if ( *excpt )
+        return;
+
+    HiltiPlugin.Mgr()->DeferEvent(copy);
+}
+
 extern void profile_start(int64_t t);
 extern void profile_stop(int64_t t);
 
@@ -692,6 +724,11 @@ void libbro_bro_vector_append(::VectorVal* vval, ::Val* val, hlt_exception** exc
     vval->Assign(vval->Size(), val);
 }
 
+int64_t libbro_bro_vector_size(::VectorVal* vval, hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    return vval->Size();
+}
+
 ::VectorType* libbro_bro_vector_type_new(::BroType* ytype, hlt_exception** excpt,
                                          hlt_execution_context* ctx)
 {
@@ -851,14 +888,141 @@ void* libbro_object_mapping_lookup_hilti(::BroObj* obj, hlt_exception** excpt,
     return &m->second.second;
 }
 
+// Bro tables converted from HILTI maps and sets, for
+// Hilti::cache_table_conversions. Entries hold references to both sides so
+// that neither address gets recycled while cached. Compiled scripts run on
+// the main thread only, so this doesn't need locking.
+
+struct table_conversion {
+    const hlt_type_info* ti; // Type of the HILTI map or set.
+    ::TableVal* val;         // The Bro table converted from it.
+    uint64_t version;        // Version of the map or set at the time of conversion.
+    int size;                // Size of the Bro table at the time of conversion.
+};
+
+typedef std::map<void*, table_conversion> table_conversion_map;
+static table_conversion_map table_conversions;
+
+// Maximum number of conversions cached. Once reached, we start over.
+static const size_t MaxTableConversions = 1024;
+
+static uint64_t _table_version(const hlt_type_info* ti, void* hobj, hlt_exception** excpt,
+                               hlt_execution_context* ctx)
+{
+    if ( ti->type == HLT_TYPE_MAP )
+        return hlt_map_version((hlt_map*)hobj, excpt, ctx);
+    else
+        return hlt_set_version((hlt_set*)hobj, excpt, ctx);
+}
+
+static void _table_conversion_remove(table_conversion_map::iterator i, hlt_execution_context* ctx)
+{
+    void* hobj = i->first;
+    const hlt_type_info* ti = i->second.ti;
+
+    Unref(i->second.val);
+    table_conversions.erase(i);
+
+    GC_DTOR_GENERIC(&hobj, ti, ctx);
+}
+
+::TableVal* libbro_h2b_table_cache_lookup(hlt_type_info* ti, void** hobj, hlt_exception** excpt,
+                                          hlt_execution_context* ctx)
+{
+    auto i = table_conversions.find(*hobj);
+
+    if ( i == table_conversions.end() )
+        return 0;
+
+    auto& c = i->second;
+
+    // We can hand out the table again only if neither side has changed.
+    // On the Bro side, we require that nobody else holds on to it. That's
+    // not a guarantee that the interpreter didn't modify it while it had
+    // it, but the size catches the common cases.
+    if ( c.version != _table_version(ti, *hobj, excpt, ctx) || c.val->RefCnt() != 1 ||
+         c.val->Size() != c.size ) {
+        _table_conversion_remove(i, ctx);
+        return 0;
+    }
+
+    Ref(c.val);
+    return c.val;
+}
+
+void libbro_h2b_table_cache_insert(hlt_type_info* ti, void** hobj, ::TableVal* val,
+                                   hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    if ( ! *hobj )
+        return;
+
+    auto i = table_conversions.find(*hobj);
+
+    if ( i != table_conversions.end() )
+        _table_conversion_remove(i, ctx);
+
+    if ( table_conversions.size() >= MaxTableConversions ) {
+        while ( table_conversions.size() )
+            _table_conversion_remove(table_conversions.begin(), ctx);
+    }
+
+    GC_CCTOR_GENERIC(hobj, ti, ctx);
+    Ref(val);
+
+    table_conversions[*hobj] = {ti, val, _table_version(ti, *hobj, excpt, ctx), val->Size()};
+}
+
 // User-visible Bro::* functions.
+//
+// With parallel analysis, these may be called from HILTI worker threads. All
+// that touch Bro's state then defer their work to the main thread. The
+// deferred work must not read the cookie again, as the worker may have
+// flipped the connection's roles by the time it runs, so it copies what it
+// needs. The analyzer itself remains valid, as it runs all its deferred
+// work before going away.
 
-static string _file_id(bro::hilti::spicy_cookie::Protocol* c)
+static string _file_id(analyzer::Analyzer* analyzer, bool is_orig)
 {
-    auto id = ::util::fmt("%p-%d", c->analyzer, (int)c->is_orig);
+    auto id = ::util::fmt("%p-%d", analyzer, (int)is_orig);
     return file_mgr->HashHandle(id);
 }
 
+static string _file_id(bro::hilti::spicy_cookie::Protocol* c)
+{
+    return _file_id(c->analyzer, c->is_orig);
+}
+
+static inline bool _on_worker(hlt_execution_context* ctx)
+{
+    return ctx->vid != HLT_VID_MAIN;
+}
+
+static inline void _defer(std::function<void()> cb)
+{
+    HiltiPlugin.Mgr()->QueueCompletion(std::move(cb));
+}
+
+static string _bytes_to_string(hlt_bytes* data, hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    string s;
+
+    hlt_bytes_block block;
+    hlt_iterator_bytes start = hlt_bytes_begin(data, excpt, ctx);
+    hlt_iterator_bytes end = hlt_bytes_end(data, excpt, ctx);
+
+    void* bcookie = 0;
+
+    while ( true ) {
+        bcookie = hlt_bytes_iterate_raw(&block, bcookie, start, end, excpt, ctx);
+        s.append((const char*)block.start, block.end - block.start);
+
+        if ( ! bcookie )
+            break;
+    }
+
+    return s;
+}
+
 int8_t bro_is_orig(void* cookie, hlt_exception** excpt, hlt_execution_context* ctx)
 {
     auto c = get_protocol_cookie(cookie, "$conn");
@@ -874,6 +1038,18 @@ void bro_file_set_size(uint64_t size, void* cookie, hlt_exception** excpt,
                        hlt_execution_context* ctx)
 {
     auto c = get_protocol_cookie(cookie, "file_set_size()");
+
+    if ( _on_worker(ctx) ) {
+        auto analyzer = c->analyzer;
+        auto tag = c->tag;
+        auto is_orig = c->is_orig;
+
+        _defer([=]() {
+            file_mgr->SetSize(size, tag, analyzer->Conn(), is_orig, _file_id(analyzer, is_orig));
+        });
+        return;
+    }
+
     file_mgr->SetSize(size, c->tag, c->analyzer->Conn(), c->is_orig, _file_id(c));
 }
 
@@ -882,6 +1058,19 @@ void bro_file_data_in(hlt_bytes* data, void* cookie, hlt_exception** excpt,
 {
     auto c = get_protocol_cookie(cookie, "file_data_in()");
 
+    if ( _on_worker(ctx) ) {
+        auto s = _bytes_to_string(data, excpt, ctx);
+        auto analyzer = c->analyzer;
+        auto tag = c->tag;
+        auto is_orig = c->is_orig;
+
+        _defer([=]() {
+            file_mgr->DataIn((const u_char*)s.data(), s.size(), tag, analyzer->Conn(), is_orig,
+                             _file_id(analyzer, is_orig));
+        });
+        return;
+    }
+
     hlt_bytes_block block;
     hlt_iterator_bytes start = hlt_bytes_begin(data, excpt, ctx);
     hlt_iterator_bytes end = hlt_bytes_end(data, excpt, ctx);
@@ -904,6 +1093,19 @@ void bro_file_data_in_at_offset(hlt_bytes* data, uint64_t offset, void* cookie,
 {
     auto c = get_protocol_cookie(cookie, "file_data_in_at_offset()");
 
+    if ( _on_worker(ctx) ) {
+        auto s = _bytes_to_string(data, excpt, ctx);
+        auto analyzer = c->analyzer;
+        auto tag = c->tag;
+        auto is_orig = c->is_orig;
+
+        _defer([=]() {
+            file_mgr->DataIn((const u_char*)s.data(), s.size(), offset, tag, analyzer->Conn(),
+                             is_orig, _file_id(analyzer, is_orig));
+        });
+        return;
+    }
+
     hlt_bytes_block block;
     hlt_iterator_bytes start = hlt_bytes_begin(data, excpt, ctx);
     hlt_iterator_bytes end = hlt_bytes_end(data, excpt, ctx);
@@ -927,18 +1129,45 @@ void bro_file_gap(uint64_t offset, uint64_t len, void* cookie, hlt_exception** e
                   hlt_execution_context* ctx)
 {
     auto c = get_protocol_cookie(cookie, "file_gap()");
+
+    if ( _on_worker(ctx) ) {
+        auto analyzer = c->analyzer;
+        auto tag = c->tag;
+        auto is_orig = c->is_orig;
+
+        _defer([=]() {
+            file_mgr->Gap(offset, len, tag, analyzer->Conn(), is_orig, _file_id(analyzer, is_orig));
+        });
+        return;
+    }
+
     file_mgr->Gap(offset, len, c->tag, c->analyzer->Conn(), c->is_orig, _file_id(c));
 }
 
 void bro_file_end(void* cookie, hlt_exception** excpt, hlt_execution_context* ctx)
 {
     auto c = get_protocol_cookie(cookie, "file_end()");
+
+    if ( _on_worker(ctx) ) {
+        auto id = _file_id(c);
+        _defer([=]() { file_mgr->EndOfFile(id); });
+        return;
+    }
+
     file_mgr->EndOfFile(_file_id(c));
 }
 
 void bro_dpd_confirm(void* cookie, hlt_exception** excpt, hlt_execution_context* ctx)
 {
     auto c = get_protocol_cookie(cookie, "dpd_confirm()");
+
+    if ( _on_worker(ctx) ) {
+        auto analyzer = c->analyzer;
+        auto tag = c->tag;
+        _defer([=]() { analyzer->ProtocolConfirmation(tag); });
+        return;
+    }
+
     c->analyzer->ProtocolConfirmation(c->tag);
 }
 
@@ -970,6 +1199,18 @@ void bro_rule_match(hlt_enum pattern_type, hlt_bytes* data, int8_t bol, int8_t e
     else
         bro::hilti::reporter::internal_error("unknown pattern type in bro_rule_match()");
 
+    if ( _on_worker(ctx) ) {
+        auto s = _bytes_to_string(data, excpt, ctx);
+        auto analyzer = c->analyzer;
+        auto is_orig = c->is_orig;
+
+        _defer([=]() {
+            analyzer->Conn()->Match(bro_type, (const u_char*)s.data(), s.size(), is_orig, bol, eol,
+                                    clear);
+        });
+        return;
+    }
+
     hlt_bytes_block block;
     hlt_iterator_bytes start = hlt_bytes_begin(data, excpt, ctx);
     hlt_iterator_bytes end = hlt_bytes_end(data, excpt, ctx);
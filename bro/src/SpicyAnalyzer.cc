@@ -20,6 +20,22 @@ using namespace spicy;
 
 using std::shared_ptr;
 
+// A unit of work for the worker thread parsing a connection.
+struct Spicy_Analyzer::Job : public SpicyJobs::Job {
+    enum Kind { FEED, RESET, FLIP };
+
+    Kind kind;
+    Spicy_Analyzer* analyzer;
+    std::string data; // For FEED.
+    bool is_orig;     // For FEED.
+    bool eod;         // For FEED.
+
+    void Run(hlt_execution_context* ctx) override
+    {
+        analyzer->RunJob(this, ctx);
+    }
+};
+
 Spicy_Analyzer::Spicy_Analyzer(analyzer::Analyzer* analyzer)
 {
     orig.cookie.type = SpicyCookie::PROTOCOL;
@@ -48,21 +64,90 @@ void Spicy_Analyzer::Init()
     orig.cookie.protocol_cookie.tag =
         HiltiPlugin.Mgr()->TagForAnalyzer(orig.cookie.protocol_cookie.analyzer->GetAnalyzerTag());
     resp.cookie.protocol_cookie.tag = orig.cookie.protocol_cookie.tag;
+
+    if ( HiltiPlugin.Mgr()->ParallelAnalysis() && ! jobs.Enabled() ) {
+        // Pin the connection to one virtual thread so that its chunks get
+        // parsed in order.
+        auto key = orig.cookie.protocol_cookie.analyzer->Conn()->Key();
+        jobs.Enable(key ? key->Hash() : 0);
+    }
 }
 
 void Spicy_Analyzer::Done()
 {
-    hlt_execution_context* ctx = hlt_global_execution_context();
+    if ( jobs.Enabled() ) {
+        auto job = new Job;
+        job->kind = Job::RESET;
+        Schedule(job);
+        return;
+    }
+
+    Reset(hlt_global_execution_context());
+}
+
+void Spicy_Analyzer::Reset(hlt_execution_context* ctx)
+{
+    // With parallel analysis, the parsers are shared between threads
+    // without holding a reference, as reference counting isn't thread-safe.
+    // The manager keeps them alive.
+    if ( ! jobs.Enabled() ) {
+        GC_DTOR(orig.parser, hlt_SpicyHilti_Parser, ctx);
+        GC_DTOR(resp.parser, hlt_SpicyHilti_Parser, ctx);
+    }
 
-    GC_DTOR(orig.parser, hlt_SpicyHilti_Parser, ctx);
     GC_DTOR(orig.data, hlt_bytes, ctx);
     GC_DTOR(orig.resume, hlt_exception, ctx);
 
-    GC_DTOR(resp.parser, hlt_SpicyHilti_Parser, ctx);
     GC_DTOR(resp.data, hlt_bytes, ctx);
     GC_DTOR(resp.resume, hlt_exception, ctx);
 
-    Init();
+    orig.parser = 0;
+    orig.data = 0;
+    orig.resume = 0;
+
+    resp.parser = 0;
+    resp.data = 0;
+    resp.resume = 0;
+}
+
+void Spicy_Analyzer::Schedule(Job* job)
+{
+    job->analyzer = this;
+    jobs.Schedule(job, "Spicy parsing job");
+}
+
+void Spicy_Analyzer::RunJob(Job* job, hlt_execution_context* ctx)
+{
+    switch ( job->kind ) {
+    case Job::FEED: {
+        int rc = Feed(job->data.size(), (const u_char*)job->data.data(), job->is_orig, job->eod,
+                      ctx);
+
+        if ( rc >= 0 && ! job->eod ) {
+            bool is_orig = job->is_orig;
+            HiltiPlugin.Mgr()->QueueCompletion(
+                [this, is_orig, rc]() { ParsingFinished(is_orig, rc > 0); });
+        }
+
+        break;
+    }
+
+    case Job::RESET:
+        Reset(ctx);
+        break;
+
+    case Job::FLIP: {
+        Endpoint tmp = orig;
+        orig = resp;
+        resp = tmp;
+        break;
+    }
+    }
+}
+
+void Spicy_Analyzer::WaitForJobs()
+{
+    jobs.Wait();
 }
 
 static inline void debug_msg(analyzer::Analyzer* analyzer, const char* msg, int len,
@@ -84,7 +169,22 @@ static inline void debug_msg(analyzer::Analyzer* analyzer, const char* msg, int
 
 int Spicy_Analyzer::FeedChunk(int len, const u_char* data, bool is_orig, bool eod)
 {
-    hlt_execution_context* ctx = hlt_global_execution_context();
+    if ( jobs.Enabled() ) {
+        auto job = new Job;
+        job->kind = Job::FEED;
+        job->data.assign((const char*)data, len);
+        job->is_orig = is_orig;
+        job->eod = eod;
+        Schedule(job);
+        return -1;
+    }
+
+    return Feed(len, data, is_orig, eod, hlt_global_execution_context());
+}
+
+int Spicy_Analyzer::Feed(int len, const u_char* data, bool is_orig, bool eod,
+                         hlt_execution_context* ctx)
+{
     hlt_exception* excpt = 0;
 
     Endpoint* endp = is_orig ? &orig : &resp;
@@ -110,7 +210,8 @@ int Spicy_Analyzer::FeedChunk(int len, const u_char* data, bool is_orig, bool eo
             return 1;
         }
 
-        GC_CCTOR(endp->parser, hlt_SpicyHilti_Parser, ctx);
+        if ( ! jobs.Enabled() )
+            GC_CCTOR(endp->parser, hlt_SpicyHilti_Parser, ctx);
     }
 
     int result = 0;
@@ -179,7 +280,15 @@ int Spicy_Analyzer::FeedChunk(int len, const u_char* data, bool is_orig, bool eo
             hlt_exception* excpt2 = 0;
             char* e = hlt_exception_to_asciiz(excpt, &excpt2, ctx);
             assert(! excpt2);
-            ParseError(e, is_orig);
+
+            if ( jobs.Enabled() ) {
+                string msg = e;
+                HiltiPlugin.Mgr()->QueueCompletion(
+                    [this, msg, is_orig]() { ParseError(msg, is_orig); });
+            }
+            else
+                ParseError(e, is_orig);
+
             hlt_free(e);
             GC_DTOR(excpt, hlt_exception, ctx);
             excpt = 0;
@@ -204,6 +313,13 @@ int Spicy_Analyzer::FeedChunk(int len, const u_char* data, bool is_orig, bool eo
 
 void Spicy_Analyzer::FlipRoles()
 {
+    if ( jobs.Enabled() ) {
+        auto job = new Job;
+        job->kind = Job::FLIP;
+        Schedule(job);
+        return;
+    }
+
     Endpoint tmp = orig;
     orig = resp;
     resp = tmp;
@@ -217,6 +333,10 @@ void Spicy_Analyzer::ParseError(const string& msg, bool is_orig)
     reporter::weird(endp->cookie.protocol_cookie.analyzer->Conn(), s);
 }
 
+void Spicy_Analyzer::ParsingFinished(bool is_orig, bool success)
+{
+}
+
 analyzer::Analyzer* Spicy_TCP_Analyzer::InstantiateAnalyzer(Connection* conn)
 {
     return new Spicy_TCP_Analyzer(conn);
@@ -245,6 +365,8 @@ void Spicy_TCP_Analyzer::Done()
 
     EndOfData(true);
     EndOfData(false);
+
+    WaitForJobs();
 }
 
 void Spicy_TCP_Analyzer::DeliverStream(int len, const u_char* data, bool is_orig)
@@ -262,27 +384,31 @@ void Spicy_TCP_Analyzer::DeliverStream(int len, const u_char* data, bool is_orig
 
     int rc = FeedChunk(len, data, is_orig, false);
 
-    if ( rc >= 0 ) {
-        if ( is_orig ) {
-            debug_msg(this, ::util::fmt("parsing %s, skipping further originator payload",
-                                        (rc > 0 ? "finished" : "failed"))
-                                .c_str(),
-                      0, 0, is_orig);
-            skip_orig = 1;
-        }
-        else {
-            debug_msg(this, ::util::fmt("parsing %s, skipping further responder payload",
-                                        (rc > 0 ? "finished" : "failed"))
-                                .c_str(),
-                      0, 0, is_orig);
-            skip_resp = 1;
-        }
+    if ( rc >= 0 )
+        ParsingFinished(is_orig, rc > 0);
+}
 
-        if ( skip_orig && skip_resp ) {
-            debug_msg(this, "both endpoints finished, skipping all further TCP processing", 0, 0,
-                      is_orig);
-            SetSkip(1);
-        }
+void Spicy_TCP_Analyzer::ParsingFinished(bool is_orig, bool success)
+{
+    if ( is_orig ) {
+        debug_msg(this, ::util::fmt("parsing %s, skipping further originator payload",
+                                    (success ? "finished" : "failed"))
+                            .c_str(),
+                  0, 0, is_orig);
+        skip_orig = 1;
+    }
+    else {
+        debug_msg(this, ::util::fmt("parsing %s, skipping further responder payload",
+                                    (success ? "finished" : "failed"))
+                            .c_str(),
+                  0, 0, is_orig);
+        skip_resp = 1;
+    }
+
+    if ( skip_orig && skip_resp ) {
+        debug_msg(this, "both endpoints finished, skipping all further TCP processing", 0, 0,
+                  is_orig);
+        SetSkip(1);
     }
 }
 
@@ -374,6 +500,7 @@ void Spicy_UDP_Analyzer::Done()
 {
     Analyzer::Done();
     Spicy_Analyzer::Done();
+    WaitForJobs();
 }
 
 void Spicy_UDP_Analyzer::DeliverPacket(int len, const u_char* data, bool is_orig, uint64 seq,
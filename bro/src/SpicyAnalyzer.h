@@ -6,10 +6,12 @@
 #include <analyzer/protocol/udp/UDP.h>
 
 #include "Cookie.h"
+#include "SpicyJobs.h"
 
 struct __spicy_parser;
 struct __hlt_bytes;
 struct __hlt_exception;
+struct __hlt_execution_context;
 
 class Analyzer;
 
@@ -28,13 +30,29 @@ public:
     //    -1: Parsing yielded waiting for more input.
     //     0: Parsing failed, not more input will be accepted.
     //     1: Parsing finished, not more input will be accepted.
+    //
+    // With parallel analysis, the chunk gets parsed asynchronously by a
+    // HILTI worker thread and this always returns -1; the outcome is then
+    // reported through ParsingFinished().
     int FeedChunk(int len, const u_char* data, bool is_orig, bool eod);
 
     void FlipRoles();
 
+    // With parallel analysis, blocks until the worker thread has processed
+    // all input passed in so far, and then runs the completions that this
+    // queued. This must be called before the analyzer goes away. Without
+    // parallel analysis, does nothing.
+    void WaitForJobs();
+
 protected:
     virtual void ParseError(const string& msg, bool is_orig);
 
+    // Called when parsing of one side has terminated, with success
+    // indicating whether that was due to an error. With parallel
+    // analysis, this is called only once the main thread has learned about
+    // it, which may be a number of chunks later.
+    virtual void ParsingFinished(bool is_orig, bool success);
+
 private:
     struct Endpoint {
         __spicy_parser* parser;
@@ -43,8 +61,17 @@ private:
         SpicyCookie cookie;
     };
 
+    struct Job;
+
+    int Feed(int len, const u_char* data, bool is_orig, bool eod, __hlt_execution_context* ctx);
+    void Reset(__hlt_execution_context* ctx);
+    void Schedule(Job* job);
+    void RunJob(Job* job, __hlt_execution_context* ctx);
+
     Endpoint orig;
     Endpoint resp;
+
+    SpicyJobs jobs; // Parsing on a HILTI worker thread, if enabled.
 };
 
 class Spicy_TCP_Analyzer : public Spicy_Analyzer, public analyzer::tcp::TCP_ApplicationAnalyzer {
@@ -70,6 +97,10 @@ public:
 
     static Analyzer* InstantiateAnalyzer(Connection* conn);
 
+protected:
+    // Overriden from Spicy_Analyzer.
+    void ParsingFinished(bool is_orig, bool success) override;
+
 private:
     bool skip_orig;
     bool skip_resp;
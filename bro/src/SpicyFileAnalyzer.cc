@@ -20,6 +20,27 @@ using namespace spicy;
 
 using std::shared_ptr;
 
+// A unit of work for the worker thread parsing a file.
+struct Spicy_FileAnalyzer::Job : public SpicyJobs::Job {
+    enum Kind { FEED, RESET };
+
+    Kind kind;
+    Spicy_FileAnalyzer* analyzer;
+    int8_t* chunk = 0; // For FEED; allocated with hlt_malloc(), owned until fed.
+    int len = 0;       // For FEED.
+    bool eod = false;  // For FEED.
+
+    ~Job()
+    {
+        hlt_free(chunk); // Still set if the job never ran.
+    }
+
+    void Run(hlt_execution_context* ctx) override
+    {
+        analyzer->RunJob(this, ctx);
+    }
+};
+
 static inline void debug_msg(file_analysis::Analyzer* analyzer, const char* msg, int len,
                              const u_char* data)
 {
@@ -64,32 +85,125 @@ void Spicy_FileAnalyzer::Init()
     data = 0;
     resume = 0;
     skip = false;
+
+    if ( HiltiPlugin.Mgr()->ParallelFileAnalysis() && ! jobs.Enabled() ) {
+        // Pin the file to one virtual thread so that its chunks get parsed
+        // in order.
+        jobs.Enable(std::hash<std::string>()(GetFile()->GetID()));
+    }
 }
 
 void Spicy_FileAnalyzer::Done()
 {
     file_analysis::Analyzer::Done();
 
-    hlt_execution_context* ctx = hlt_global_execution_context();
+    skip = true;
+
+    if ( jobs.Enabled() ) {
+        // Bro deletes the analyzer, and possibly the file, right after
+        // we return, while the worker's jobs and the events they raise
+        // still refer to both. So we have to wait here, which stalls the
+        // main thread until the worker has gone through all of the file's
+        // pending chunks. Finishing asynchronously would require keeping
+        // the analyzer and the file alive beyond Done(), which the file
+        // analysis framework doesn't support.
+        auto job = new Job;
+        job->kind = Job::RESET;
+        Schedule(job);
+        jobs.Wait();
+        return;
+    }
+
+    Reset(hlt_global_execution_context());
+}
+
+void Spicy_FileAnalyzer::Reset(hlt_execution_context* ctx)
+{
+    // With parallel analysis, the parser is shared between threads without
+    // holding a reference, as reference counting isn't thread-safe. The
+    // manager keeps it alive.
+    if ( ! jobs.Enabled() )
+        GC_DTOR(parser, hlt_SpicyHilti_Parser, ctx);
 
-    GC_DTOR(parser, hlt_SpicyHilti_Parser, ctx);
     GC_DTOR(data, hlt_bytes, ctx);
     GC_DTOR(resume, hlt_exception, ctx);
+
+    parser = 0;
+    data = 0;
+    resume = 0;
+}
+
+void Spicy_FileAnalyzer::Schedule(Job* job)
+{
+    job->analyzer = this;
+    jobs.Schedule(job, "Spicy file parsing job");
 }
 
-int Spicy_FileAnalyzer::FeedChunk(int len, const u_char* chunk, bool eod)
+void Spicy_FileAnalyzer::RunJob(Job* job, hlt_execution_context* ctx)
 {
-    // TODO: This is very similar to SpicyAnalyzer.cc. Can we factor out common code?
+    switch ( job->kind ) {
+    case Job::FEED: {
+        int rc = Feed(job->len, job->chunk, job->eod, ctx);
+        job->chunk = 0; // Feed() has taken ownership.
+
+        if ( rc >= 0 && ! job->eod ) {
+            HiltiPlugin.Mgr()->QueueCompletion([this, rc]() {
+                debug_msg(this, ::util::fmt("parsing %s, skipping further content",
+                                            (rc > 0 ? "finished" : "failed"))
+                                    .c_str(),
+                          0, 0);
+                skip = true;
+            });
+        }
+
+        break;
+    }
+
+    case Job::RESET:
+        Reset(ctx);
+        break;
+    }
+}
+
+int Spicy_FileAnalyzer::FeedChunk(int len, const u_char* data, bool eod)
+{
+    // This is the one copy we make of the input, as Bro reuses its buffer.
+    // The parser's input then takes ownership of the memory, which with
+    // parallel analysis gets passed to the worker thread as is.
+    int8_t* chunk = 0;
+
+    if ( len ) {
+        chunk = (int8_t*)hlt_malloc_no_init(len);
+        memcpy(chunk, data, len);
+    }
+
+    if ( jobs.Enabled() ) {
+        auto job = new Job;
+        job->kind = Job::FEED;
+        job->chunk = chunk;
+        job->len = len;
+        job->eod = eod;
+        Schedule(job);
+        return -1;
+    }
+
+    return Feed(len, chunk, eod, hlt_global_execution_context());
+}
+
+int Spicy_FileAnalyzer::Feed(int len, int8_t* chunk, bool eod, hlt_execution_context* ctx)
+{
+    // TODO: The parsing itself is still very similar to SpicyAnalyzer.cc.
+    // Can we factor that out as well?
 
-    hlt_execution_context* ctx = hlt_global_execution_context();
     hlt_exception* excpt = 0;
 
     // If parser is set but not data, a previous parsing process has
     // finished. If so, we ignore all further input.
-    if ( parser && ! chunk ) {
+    if ( parser && ! data ) {
         if ( len )
-            debug_msg(this, "further data ignored", len, chunk);
+            debug_msg(this, "further data ignored", len, (const u_char*)chunk);
 
+        hlt_free(chunk);
         return 0;
     }
 
@@ -98,10 +212,12 @@ int Spicy_FileAnalyzer::FeedChunk(int len, const u_char* chunk, bool eod)
 
         if ( ! parser ) {
             debug_msg(this, "no unit specificed for parsing", 0, 0);
+            hlt_free(chunk);
             return 1;
         }
 
-        GC_CCTOR(parser, hlt_SpicyHilti_Parser, ctx);
+        if ( ! jobs.Enabled() )
+            GC_CCTOR(parser, hlt_SpicyHilti_Parser, ctx);
     }
 
     int result = 0;
@@ -110,9 +226,14 @@ int Spicy_FileAnalyzer::FeedChunk(int len, const u_char* chunk, bool eod)
 
     if ( ! data ) {
         // First chunk.
-        debug_msg(this, "initial chunk", len, chunk);
+        debug_msg(this, "initial chunk", len, (const u_char*)chunk);
 
-        data = hlt_bytes_new_from_data_copy((const int8_t*)chunk, len, &excpt, ctx);
+        if ( len )
+            data = hlt_bytes_new_from_data(chunk, len, &excpt, ctx);
+        else
+            data = hlt_bytes_new(&excpt, ctx);
+
+        GC_CCTOR(data, hlt_bytes, ctx);
 
         if ( eod )
             hlt_bytes_freeze(data, 1, &excpt, ctx);
@@ -132,12 +253,12 @@ int Spicy_FileAnalyzer::FeedChunk(int len, const u_char* chunk, bool eod)
 
     else {
         // Resume parsing.
-        debug_msg(this, "resuming with chunk", len, chunk);
+        debug_msg(this, "resuming with chunk", len, (const u_char*)chunk);
 
         assert(data && resume);
 
         if ( len )
-            hlt_bytes_append_raw_copy(data, (int8_t*)chunk, len, &excpt, ctx);
+            hlt_bytes_append_raw(data, chunk, len, &excpt, ctx);
 
         if ( eod )
             hlt_bytes_freeze(data, 1, &excpt, ctx);
@@ -168,7 +289,14 @@ int Spicy_FileAnalyzer::FeedChunk(int len, const u_char* chunk, bool eod)
             hlt_exception* excpt2 = 0;
             char* e = hlt_exception_to_asciiz(excpt, &excpt2, ctx);
             assert(! excpt2);
-            ParseError(e);
+
+            if ( jobs.Enabled() ) {
+                string msg = e;
+                HiltiPlugin.Mgr()->QueueCompletion([this, msg]() { ParseError(msg); });
+            }
+            else
+                ParseError(e);
+
             hlt_free(e);
             GC_DTOR(excpt, hlt_exception, ctx);
             excpt = 0;
@@ -186,7 +314,7 @@ int Spicy_FileAnalyzer::FeedChunk(int len, const u_char* chunk, bool eod)
     // TODO: For now we just stop on error, later we might attempt to
     // restart parsing.
     if ( eod || done || error )
-        data = 0; // Marker that we're done parsing.
+        GC_CLEAR(data, hlt_bytes, ctx); // Marker that we're done parsing.
 
     return result;
 }
@@ -225,7 +353,9 @@ bool Spicy_FileAnalyzer::EndOfFile()
         return true;
 
     int rc = FeedChunk(0, (const u_char*)"", true);
-    return rc > 0;
+
+    // With parallel analysis, we don't know the outcome yet.
+    return jobs.Enabled() ? rc != 0 : rc > 0;
 }
 
 file_analysis::Analyzer* Spicy_FileAnalyzer::InstantiateAnalyzer(RecordVal* args,
@@ -5,10 +5,12 @@
 #include "file_analysis/Manager.h"
 
 #include "Cookie.h"
+#include "SpicyJobs.h"
 
 struct __spicy_parser;
 struct __hlt_bytes;
 struct __hlt_exception;
+struct __hlt_execution_context;
 
 class Analyzer;
 
@@ -33,11 +35,24 @@ protected:
     //    -1: Parsing yielded waiting for more input.
     //     0: Parsing failed, not more input will be accepted.
     //     1: Parsing finished, not more input will be accepted.
+    //
+    // With parallel file analysis, the chunk gets parsed asynchronously by
+    // a HILTI worker thread and this always returns -1; once the main
+    // thread learns that parsing has finished, it sets skip.
     int FeedChunk(int len, const u_char* data, bool eod);
 
     void ParseError(const string& msg);
 
 private:
+    struct Job;
+
+    // Takes ownership of chunk, which must have been allocated with
+    // hlt_malloc().
+    int Feed(int len, int8_t* chunk, bool eod, __hlt_execution_context* ctx);
+    void Reset(__hlt_execution_context* ctx);
+    void Schedule(Job* job);
+    void RunJob(Job* job, __hlt_execution_context* ctx);
+
     RecordVal* args;
     bool skip;
     SpicyCookie cookie;
@@ -45,6 +60,8 @@ private:
     __spicy_parser* parser;
     __hlt_bytes* data;
     __hlt_exception* resume;
+
+    SpicyJobs jobs; // Parsing on a HILTI worker thread, if enabled.
 };
 }
 }
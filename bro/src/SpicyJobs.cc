@@ -0,0 +1,107 @@
+#include <sched.h>
+
+#include <util/util.h>
+
+extern "C" {
+#include <libspicy/libspicy.h>
+}
+
+#undef DBG_LOG
+
+#include "LocalReporter.h"
+#include "Manager.h"
+#include "Plugin.h"
+#include "SpicyJobs.h"
+
+using namespace bro::hilti;
+
+// A callable wrapping a job so that we can schedule it to a virtual thread.
+struct JobCallable {
+    hlt_callable callable;
+    SpicyJobs* jobs;
+    SpicyJobs::Job* job;
+};
+
+SpicyJobs::Job::~Job()
+{
+}
+
+SpicyJobs::SpicyJobs()
+{
+    enabled = false;
+    vid = HLT_VID_MAIN;
+    pending = 0;
+}
+
+void SpicyJobs::Enable(uint64_t hash)
+{
+    auto cfg = hlt_config_get();
+    auto n = cfg->vid_schedule_max - cfg->vid_schedule_min + 1;
+
+    enabled = true;
+    vid = cfg->vid_schedule_min + (hash % n);
+}
+
+bool SpicyJobs::Enabled() const
+{
+    return enabled;
+}
+
+void SpicyJobs::Schedule(Job* job, const char* what)
+{
+    static __hlt_callable_func job_func = {(void*)&SpicyJobs::JobRun, (void*)&SpicyJobs::JobRun,
+                                           &SpicyJobs::JobDtor, nullptr, sizeof(JobCallable)};
+
+    hlt_execution_context* ctx = hlt_global_execution_context();
+    hlt_exception* excpt = 0;
+
+    auto c = (JobCallable*)GC_NEW_CUSTOM_SIZE_REF(hlt_callable, sizeof(JobCallable), ctx);
+    c->callable.__func = &job_func;
+    c->jobs = this;
+    c->job = job;
+
+    ++pending;
+
+    __hlt_thread_mgr_schedule(hlt_global_thread_mgr(), vid, &c->callable, &excpt, ctx);
+
+    if ( excpt ) {
+        char* e = hlt_exception_to_asciiz(excpt, &excpt, ctx);
+        reporter::internal_error(::util::fmt("cannot schedule %s: %s", what, e));
+    }
+}
+
+void SpicyJobs::JobRun(hlt_callable* c, void* target, hlt_exception** excpt,
+                       hlt_execution_context* ctx)
+{
+    auto jc = (JobCallable*)c;
+    auto jobs = jc->jobs;
+
+    // Tag everything the job queues for the main thread, so that Wait()
+    // can find it.
+    HiltiPlugin.Mgr()->SetCompletionOwner(jobs);
+    jc->job->Run(ctx);
+    HiltiPlugin.Mgr()->FlushDeferredEvents();
+    HiltiPlugin.Mgr()->SetCompletionOwner(nullptr);
+
+    // Must come last, the analyzer may go away once this drops to zero.
+    --jobs->pending;
+}
+
+void SpicyJobs::JobDtor(hlt_callable* c, hlt_execution_context* ctx)
+{
+    delete ((JobCallable*)c)->job;
+}
+
+void SpicyJobs::Wait()
+{
+    if ( ! enabled )
+        return;
+
+    // Jobs never wait for the main thread, so they'll finish without us
+    // running any completions meanwhile.
+    while ( pending.load() > 0 )
+        sched_yield();
+
+    // All that the jobs have queued is in place now.
+    HiltiPlugin.Mgr()->RunCompletions(this);
+}
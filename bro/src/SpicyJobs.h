@@ -0,0 +1,93 @@
+// Parsing work that a Spicy analyzer passes on to a HILTI worker thread.
+//
+// With parallel analysis, each analyzer pins its input to one virtual
+// thread so that its chunks get parsed in order. The analyzer wraps each
+// chunk, as well as any other operation on its parsing state, into a job
+// that this class schedules to that thread. Anything a job needs to do on
+// the main thread goes through the manager's completion queue, tagged with
+// the jobs' owner. Before the analyzer goes away, Wait() then makes sure
+// that all of its jobs and their completions have run.
+
+#ifndef BRO_PLUGIN_HILTI_SPICYJOBS_H
+#define BRO_PLUGIN_HILTI_SPICYJOBS_H
+
+#include <atomic>
+#include <cstdint>
+
+struct __hlt_callable;
+struct __hlt_exception;
+struct __hlt_execution_context;
+
+namespace bro {
+namespace hilti {
+
+class SpicyJobs {
+public:
+    /**
+     * Base class for a unit of work. Analyzers derive their own jobs from
+     * this.
+     */
+    struct Job {
+        virtual ~Job();
+
+        /**
+         * Carries out the job on the worker thread.
+         *
+         * @param ctx The worker's execution context.
+         */
+        virtual void Run(__hlt_execution_context* ctx) = 0;
+    };
+
+    /**
+     * Constructor. Jobs are not scheduled to workers until Enable() has
+     * been called.
+     */
+    SpicyJobs();
+
+    /**
+     * Switches to scheduling jobs to a worker thread.
+     *
+     * @param hash Identifies the analyzed input; determines the virtual
+     * thread that all jobs run on.
+     */
+    void Enable(uint64_t hash);
+
+    /**
+     * Returns true if Enable() has been called.
+     */
+    bool Enabled() const;
+
+    /**
+     * Schedules a job to the worker thread. Must be called only from
+     * Bro's main thread.
+     *
+     * @param job The job. Takes ownership.
+     *
+     * @param what Describes the job for error messages.
+     */
+    void Schedule(Job* job, const char* what);
+
+    /**
+     * Blocks until the worker thread has run all jobs scheduled so far,
+     * and then runs the completions they have queued. Completions of other
+     * analyzers aren't touched. Must be called before the owning analyzer
+     * goes away. Does nothing if not enabled.
+     *
+     * Note that this spins until the worker has caught up, so the caller
+     * stalls for as long as the analyzer's backlog of jobs takes to run.
+     */
+    void Wait();
+
+private:
+    static void JobRun(__hlt_callable* c, void* target, __hlt_exception** excpt,
+                       __hlt_execution_context* ctx);
+    static void JobDtor(__hlt_callable* c, __hlt_execution_context* ctx);
+
+    bool enabled;                 // True if running jobs on a HILTI worker thread.
+    int64_t vid;                  // The virtual thread running the jobs.
+    std::atomic<int64_t> pending; // Number of jobs scheduled but not yet finished.
+};
+}
+}
+
+#endif
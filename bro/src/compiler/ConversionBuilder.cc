@@ -10,6 +10,12 @@
 #include "ConversionBuilder.h"
 #include "ModuleBuilder.h"
 
+namespace BifConst {
+namespace Hilti {
+extern int cache_table_conversions;
+}
+}
+
 using namespace bro::hilti::compiler;
 
 ConversionBuilder::ConversionBuilder(class ModuleBuilder* mbuilder) : BuilderBase(mbuilder)
@@ -199,6 +205,61 @@ std::shared_ptr<::hilti::Expression> ConversionBuilder::BuildConversionFunction(
     return tmp;
 }
 
+std::shared_ptr<::hilti::Expression> ConversionBuilder::CacheTableConversion(
+    shared_ptr<::hilti::Expression> val, const ::TableType* type,
+    build_conversion_function_callback cb)
+{
+    if ( ! BifConst::Hilti::cache_table_conversions )
+        return cb(val, type);
+
+    // Changes to mutable values inside the table wouldn't show in the
+    // map's version, so we can cache only tables with atomic values.
+    if ( ! type->IsSet() ) {
+        switch ( type->YieldType()->Tag() ) {
+        case TYPE_ANY:
+        case TYPE_FILE:
+        case TYPE_OPAQUE:
+        case TYPE_RECORD:
+        case TYPE_TABLE:
+        case TYPE_VECTOR:
+            return cb(val, type);
+
+        default:
+            break;
+        }
+    }
+
+    auto vtype = ::hilti::builder::type::byName("LibBro::BroVal");
+    auto dst = Builder()->addTmp("cached", vtype);
+
+    Builder()->addInstruction(dst, ::hilti::instruction::flow::CallResult,
+                              ::hilti::builder::id::create("LibBro::h2b_table_cache_lookup"),
+                              ::hilti::builder::tuple::create({val}));
+
+    auto b = Builder()->addIfElse(dst);
+    auto cached = std::get<0>(b);
+    auto not_cached = std::get<1>(b);
+    auto done = std::get<2>(b);
+
+    ModuleBuilder()->pushBuilder(not_cached);
+
+    auto conv = cb(val, type);
+    Builder()->addInstruction(dst, ::hilti::instruction::operator_::Assign, conv);
+    Builder()->addInstruction(::hilti::instruction::flow::CallVoid,
+                              ::hilti::builder::id::create("LibBro::h2b_table_cache_insert"),
+                              ::hilti::builder::tuple::create({val, dst}));
+    Builder()->addInstruction(::hilti::instruction::flow::Jump, done->block());
+
+    ModuleBuilder()->popBuilder(not_cached);
+
+    ModuleBuilder()->pushBuilder(cached);
+    Builder()->addInstruction(::hilti::instruction::flow::Jump, done->block());
+    ModuleBuilder()->popBuilder(cached);
+
+    ModuleBuilder()->pushBuilder(done);
+
+    return dst;
+}
 
 void ConversionBuilder::MapType(const ::BroType* from, const ::BroType* to)
 {
@@ -756,6 +817,13 @@ std::shared_ptr<::hilti::Expression> ConversionBuilder::BroToHilti(
 
             Builder()->addInstruction(dst, ::hilti::instruction::vector::New, expr_vectype);
 
+            // Size the vector upfront so that the loop doesn't reallocate.
+            auto size = Builder()->addTmp("size", ::hilti::builder::integer::type(64));
+            Builder()->addInstruction(size, ::hilti::instruction::flow::CallResult,
+                                      ::hilti::builder::id::create("LibBro::bro_vector_size"),
+                                      ::hilti::builder::tuple::create({val}));
+            Builder()->addInstruction(::hilti::instruction::vector::Reserve, dst, size);
+
             auto finished = mbuilder->newBuilder("finished");
             auto loop = mbuilder->pushBuilder("loop");
 
@@ -1242,148 +1310,153 @@ std::shared_ptr<::hilti::Expression> ConversionBuilder::HiltiToBro(
 
     auto vtype = ::hilti::builder::type::byName("LibBro::BroVal");
 
+    build_conversion_function_callback convert;
+
     if ( type->IsSet() ) {
-        return BuildConversionFunction(
-            "h2b", val, 0, vtype, type,
-            [&](shared_ptr<::hilti::Expression> val,
-                const ::BroType* type) -> shared_ptr<::hilti::Expression> {
-                auto mbuilder = ModuleBuilder();
+        convert = [&](shared_ptr<::hilti::Expression> val,
+                      const ::BroType* type) -> shared_ptr<::hilti::Expression> {
+            auto mbuilder = ModuleBuilder();
 
-                auto dsttype = vtype;
-                auto dst = Builder()->addTmp("dst", dsttype);
+            auto dsttype = vtype;
+            auto dst = Builder()->addTmp("dst", dsttype);
 
-                auto rtype = ast::rtti::checkedCast<type::Reference>(HiltiType(type));
-                auto stype = ast::rtti::checkedCast<type::Set>(rtype->argType());
+            auto rtype = ast::rtti::checkedCast<type::Reference>(HiltiType(type));
+            auto stype = ast::rtti::checkedCast<type::Set>(rtype->argType());
 
-                auto cur = mbuilder->addTmp("cur", stype->iterType());
-                auto end = mbuilder->addTmp("end", stype->iterType());
-                auto k = mbuilder->addTmp("k", stype->elementType());
-                auto is_end = mbuilder->addTmp("is_end", ::hilti::builder::boolean::type());
+            auto cur = mbuilder->addTmp("cur", stype->iterType());
+            auto end = mbuilder->addTmp("end", stype->iterType());
+            auto k = mbuilder->addTmp("k", stype->elementType());
+            auto is_end = mbuilder->addTmp("is_end", ::hilti::builder::boolean::type());
 
-                Builder()->addInstruction(dst, ::hilti::instruction::flow::CallResult,
-                                          ::hilti::builder::id::create("LibBro::bro_table_new"),
-                                          ::hilti::builder::tuple::create({CreateBroType(type)}));
+            Builder()->addInstruction(dst, ::hilti::instruction::flow::CallResult,
+                                      ::hilti::builder::id::create("LibBro::bro_table_new"),
+                                      ::hilti::builder::tuple::create({CreateBroType(type)}));
 
-                Builder()->addInstruction(cur, ::hilti::instruction::operator_::Begin, val);
-                Builder()->addInstruction(end, ::hilti::instruction::operator_::End, val);
+            Builder()->addInstruction(cur, ::hilti::instruction::operator_::Begin, val);
+            Builder()->addInstruction(end, ::hilti::instruction::operator_::End, val);
 
-                auto loop = mbuilder->pushBuilder("loop");
+            auto loop = mbuilder->pushBuilder("loop");
 
-                Builder()->addInstruction(is_end, ::hilti::instruction::operator_::Equal, cur, end);
+            Builder()->addInstruction(is_end, ::hilti::instruction::operator_::Equal, cur, end);
 
-                auto blocks = Builder()->addIf(is_end);
-                auto done = std::get<0>(blocks);
-                auto cont = std::get<1>(blocks);
+            auto blocks = Builder()->addIf(is_end);
+            auto done = std::get<0>(blocks);
+            auto cont = std::get<1>(blocks);
 
-                mbuilder->popBuilder(loop);
+            mbuilder->popBuilder(loop);
 
-                mbuilder->pushBuilder(cont);
+            mbuilder->pushBuilder(cont);
 
-                Builder()->addInstruction(k, ::hilti::instruction::operator_::Deref, cur);
+            Builder()->addInstruction(k, ::hilti::instruction::operator_::Deref, cur);
 
-                auto itypes = type->AsTableType()->Indices();
-                const ::BroType* index_type = itypes;
+            auto itypes = type->AsTableType()->Indices();
+            const ::BroType* index_type = itypes;
 
-                if ( itypes->Types()->length() == 1 )
-                    index_type = (*itypes->Types())[0];
+            if ( itypes->Types()->length() == 1 )
+                index_type = (*itypes->Types())[0];
 
-                auto kval = RuntimeHiltiToVal(k, index_type);
+            auto kval = RuntimeHiltiToVal(k, index_type);
 
-                auto null = ::hilti::builder::caddr::create();
+            auto null = ::hilti::builder::caddr::create();
 
-                Builder()->addInstruction(::hilti::instruction::flow::CallVoid,
-                                          ::hilti::builder::id::create("LibBro::bro_table_insert"),
-                                          ::hilti::builder::tuple::create({dst, kval, null}));
+            Builder()->addInstruction(::hilti::instruction::flow::CallVoid,
+                                      ::hilti::builder::id::create("LibBro::bro_table_insert"),
+                                      ::hilti::builder::tuple::create({dst, kval, null}));
 
-                BroUnref(kval);
+            BroUnref(kval);
 
-                Builder()->addInstruction(cur, ::hilti::instruction::operator_::Incr, cur);
+            Builder()->addInstruction(cur, ::hilti::instruction::operator_::Incr, cur);
 
-                Builder()->addInstruction(::hilti::instruction::flow::Jump, loop->block());
+            Builder()->addInstruction(::hilti::instruction::flow::Jump, loop->block());
 
-                mbuilder->popBuilder(cont);
+            mbuilder->popBuilder(cont);
 
-                mbuilder->pushBuilder(done);
+            mbuilder->pushBuilder(done);
 
-                return dst;
-            });
+            return dst;
+        };
     }
 
     else // A table, not a set.
     {
-        return BuildConversionFunction(
-            "h2b", val, 0, vtype, type,
-            [&](shared_ptr<::hilti::Expression> val,
-                const ::BroType* type) -> shared_ptr<::hilti::Expression> {
-                auto mbuilder = ModuleBuilder();
+        convert = [&](shared_ptr<::hilti::Expression> val,
+                      const ::BroType* type) -> shared_ptr<::hilti::Expression> {
+            auto mbuilder = ModuleBuilder();
 
-                auto dsttype = vtype;
-                auto dst = Builder()->addTmp("dst", dsttype);
+            auto dsttype = vtype;
+            auto dst = Builder()->addTmp("dst", dsttype);
 
-                auto rtype = ast::rtti::checkedCast<type::Reference>(HiltiType(type));
-                auto mtype = ast::rtti::checkedCast<type::Map>(rtype->argType());
+            auto rtype = ast::rtti::checkedCast<type::Reference>(HiltiType(type));
+            auto mtype = ast::rtti::checkedCast<type::Map>(rtype->argType());
 
-                auto cur = mbuilder->addTmp("cur", mtype->iterType());
-                auto end = mbuilder->addTmp("end", mtype->iterType());
-                auto t = mbuilder->addTmp("t", mtype->elementType());
-                auto is_end = mbuilder->addTmp("is_end", ::hilti::builder::boolean::type());
+            auto cur = mbuilder->addTmp("cur", mtype->iterType());
+            auto end = mbuilder->addTmp("end", mtype->iterType());
+            auto t = mbuilder->addTmp("t", mtype->elementType());
+            auto is_end = mbuilder->addTmp("is_end", ::hilti::builder::boolean::type());
 
-                Builder()->addInstruction(dst, ::hilti::instruction::flow::CallResult,
-                                          ::hilti::builder::id::create("LibBro::bro_table_new"),
-                                          ::hilti::builder::tuple::create({CreateBroType(type)}));
+            Builder()->addInstruction(dst, ::hilti::instruction::flow::CallResult,
+                                      ::hilti::builder::id::create("LibBro::bro_table_new"),
+                                      ::hilti::builder::tuple::create({CreateBroType(type)}));
 
-                Builder()->addInstruction(cur, ::hilti::instruction::operator_::Begin, val);
-                Builder()->addInstruction(end, ::hilti::instruction::operator_::End, val);
+            Builder()->addInstruction(cur, ::hilti::instruction::operator_::Begin, val);
+            Builder()->addInstruction(end, ::hilti::instruction::operator_::End, val);
 
-                auto loop = mbuilder->pushBuilder("loop");
+            auto loop = mbuilder->pushBuilder("loop");
 
-                Builder()->addInstruction(is_end, ::hilti::instruction::operator_::Equal, cur, end);
+            Builder()->addInstruction(is_end, ::hilti::instruction::operator_::Equal, cur, end);
 
-                auto blocks = Builder()->addIf(is_end);
-                auto done = std::get<0>(blocks);
-                auto cont = std::get<1>(blocks);
+            auto blocks = Builder()->addIf(is_end);
+            auto done = std::get<0>(blocks);
+            auto cont = std::get<1>(blocks);
 
-                mbuilder->popBuilder(loop);
+            mbuilder->popBuilder(loop);
 
-                mbuilder->pushBuilder(cont);
+            mbuilder->pushBuilder(cont);
 
-                Builder()->addInstruction(t, ::hilti::instruction::operator_::Deref, cur);
+            Builder()->addInstruction(t, ::hilti::instruction::operator_::Deref, cur);
 
-                auto k = mbuilder->addTmp("k", mtype->keyType());
-                auto v = mbuilder->addTmp("v", mtype->valueType());
+            auto k = mbuilder->addTmp("k", mtype->keyType());
+            auto v = mbuilder->addTmp("v", mtype->valueType());
 
-                Builder()->addInstruction(k, ::hilti::instruction::tuple::Index, t,
-                                          ::hilti::builder::integer::create(0));
-                Builder()->addInstruction(v, ::hilti::instruction::tuple::Index, t,
-                                          ::hilti::builder::integer::create(1));
+            Builder()->addInstruction(k, ::hilti::instruction::tuple::Index, t,
+                                      ::hilti::builder::integer::create(0));
+            Builder()->addInstruction(v, ::hilti::instruction::tuple::Index, t,
+                                      ::hilti::builder::integer::create(1));
 
-                auto itypes = type->AsTableType()->Indices();
-                const ::BroType* index_type = itypes;
+            auto itypes = type->AsTableType()->Indices();
+            const ::BroType* index_type = itypes;
 
-                if ( itypes->Types()->length() == 1 )
-                    index_type = (*itypes->Types())[0];
+            if ( itypes->Types()->length() == 1 )
+                index_type = (*itypes->Types())[0];
 
-                auto kval = RuntimeHiltiToVal(k, index_type);
-                auto vval = RuntimeHiltiToVal(v, type->AsTableType()->YieldType());
+            auto kval = RuntimeHiltiToVal(k, index_type);
+            auto vval = RuntimeHiltiToVal(v, type->AsTableType()->YieldType());
 
-                Builder()->addInstruction(::hilti::instruction::flow::CallVoid,
-                                          ::hilti::builder::id::create("LibBro::bro_table_insert"),
-                                          ::hilti::builder::tuple::create({dst, kval, vval}));
+            Builder()->addInstruction(::hilti::instruction::flow::CallVoid,
+                                      ::hilti::builder::id::create("LibBro::bro_table_insert"),
+                                      ::hilti::builder::tuple::create({dst, kval, vval}));
 
-                BroUnref(kval);
-                BroUnref(vval);
+            BroUnref(kval);
+            BroUnref(vval);
 
-                Builder()->addInstruction(cur, ::hilti::instruction::operator_::Incr, cur);
+            Builder()->addInstruction(cur, ::hilti::instruction::operator_::Incr, cur);
 
-                Builder()->addInstruction(::hilti::instruction::flow::Jump, loop->block());
+            Builder()->addInstruction(::hilti::instruction::flow::Jump, loop->block());
 
-                mbuilder->popBuilder(cont);
+            mbuilder->popBuilder(cont);
 
-                mbuilder->pushBuilder(done);
+            mbuilder->pushBuilder(done);
 
-                return dst;
-            });
+            return dst;
+        };
     }
+
+    return BuildConversionFunction(
+        "h2b", val, 0, vtype, type,
+        [&](shared_ptr<::hilti::Expression> val,
+            const ::BroType* type) -> shared_ptr<::hilti::Expression> {
+            return CacheTableConversion(val, type->AsTableType(), convert);
+        });
 }
 
 std::shared_ptr<::hilti::Expression> ConversionBuilder::HiltiToBro(
@@ -144,6 +144,10 @@ protected:
         shared_ptr<::hilti::Type> dsttype, const ::BroType* type,
         build_conversion_function_callback cb);
 
+    std::shared_ptr<::hilti::Expression> CacheTableConversion(shared_ptr<::hilti::Expression> val,
+                                                              const ::TableType* type,
+                                                              build_conversion_function_callback cb);
+
     typedef std::function<void(shared_ptr<::hilti::Expression>, const ::BroType* type)>
         build_create_type_callback;
 
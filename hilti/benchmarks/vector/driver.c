@@ -0,0 +1,97 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libhilti.h>
+
+#include "vecbench.tmp.h"
+
+static hlt_execution_context* ctx = 0;
+static hlt_exception* excpt = 0;
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char* name, double start)
+{
+    if ( excpt ) {
+        hlt_exception_print(excpt, ctx);
+        exit(1);
+    }
+
+    fprintf(stdout, "%-20s %.3f\n", name, now() - start);
+}
+
+// Pushes n integers one by one through the C API.
+static void c_push_back(int64_t n)
+{
+    int64_t def = 0;
+    hlt_vector* v = hlt_vector_new(&hlt_type_info_hlt_int_64, &def, 0, &excpt, ctx);
+
+    for ( int64_t i = 0; i < n; i++ )
+        hlt_vector_push_back(v, &hlt_type_info_hlt_int_64, &i, &excpt, ctx);
+
+    GC_DTOR(v, hlt_vector, ctx);
+}
+
+// Pushes n integers in chunks of 1024 through the C API.
+static void c_push_back_many(int64_t n)
+{
+    int64_t def = 0;
+    int64_t chunk[1024];
+    hlt_vector* v = hlt_vector_new(&hlt_type_info_hlt_int_64, &def, 0, &excpt, ctx);
+
+    for ( int64_t i = 0; i < n; i += 1024 ) {
+        for ( int j = 0; j < 1024; j++ )
+            chunk[j] = i + j;
+
+        hlt_vector_push_back_many(v, &hlt_type_info_hlt_int_64, chunk, 1024, &excpt, ctx);
+    }
+
+    GC_DTOR(v, hlt_vector, ctx);
+}
+
+int main(int argc, const char** argv)
+{
+    if ( argc > 2 ) {
+        fprintf(stderr, "usage: %s [<scale>]\n", argv[0]);
+        exit(1);
+    }
+
+    int64_t scale = (argc == 2 ? atoi(argv[1]) : 1);
+
+    hlt_init();
+    ctx = hlt_global_execution_context();
+
+    double t = now();
+    vecbench_fill_small(1000000 * scale, 4, &excpt, ctx);
+    report("small-vectors", t);
+
+    t = now();
+    vecbench_fill_large(10000000 * scale, &excpt, ctx);
+    report("large-vector", t);
+
+    t = now();
+    vecbench_fill_bytes(10000000 * scale, &excpt, ctx);
+    report("large-vector-gc", t);
+
+    t = now();
+    vecbench_append(10000 * scale, &excpt, ctx);
+    report("append", t);
+
+    t = now();
+    c_push_back(10000000 * scale);
+    report("c-push-back", t);
+
+    t = now();
+    c_push_back_many(10000000 * scale);
+    report("c-push-back-many", t);
+
+    return 0;
+}
@@ -1,4 +1,6 @@
 
+#include <atomic>
+
 #include "block.h"
 #include "hilti/autogen/instructions.h"
 
@@ -270,7 +272,7 @@ void BlockBuilder::endTryCatch()
 
 void BlockBuilder::pushCatch(shared_ptr<Type> type, shared_ptr<ID> id)
 {
-    static int cnt = 0;
+    static std::atomic<int> cnt(0);
 
     assert(_mbuilder->_tries.size());
 
@@ -291,7 +293,7 @@ void BlockBuilder::popCatch()
 
 void BlockBuilder::pushCatchAll()
 {
-    static int cnt = 0;
+    static std::atomic<int> cnt(0);
 
     assert(_mbuilder->_tries.size());
 
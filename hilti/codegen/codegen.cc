@@ -1694,6 +1694,22 @@ llvm::Function* CodeGen::llvmFunctionHookRun(shared_ptr<Hook> hook)
     return func;
 }
 
+llvm::Value* CodeGen::llvmHookImplemented(shared_ptr<Hook> hook)
+{
+    // We refer to this through an external placeholder that's specific to
+    // the hook. The linker turns it into a constant once it has seen the
+    // implementations of all modules.
+    auto func = llvmFunctionHookRun(hook);
+    auto name = ::util::fmt("%s.%s", symbols::GlobalHookImplemented, func->getName().str());
+    auto implemented = _module->getGlobalVariable(name);
+
+    if ( ! implemented )
+        implemented = new llvm::GlobalVariable(*_module, llvmTypeInt(1), true,
+                                               llvm::GlobalValue::ExternalLinkage, nullptr, name);
+
+    return builder()->CreateLoad(implemented);
+}
+
 void CodeGen::llvmAddHookMetaData(shared_ptr<Hook> hook, llvm::Value* llvm_func)
 {
     std::vector<llvm::Value*> vals;
@@ -1827,9 +1843,9 @@ void CodeGen::llvmBuildExitBlock()
 
         if ( options().profile >= 1 ) {
             // As this may be run in an exit block where we won't clean up
-            // after us anymore, we do the string's mgt manually here.
-            auto str = llvmStringFromData(string("func/") + name);
-            llvmProfilerStop(str);
+            // after us anymore, we need the string's mgt done manually,
+            // which the string version does.
+            llvmProfilerStop(string("func/") + name);
         }
     }
 
@@ -3350,7 +3366,26 @@ llvm::Value* CodeGen::llvmCallableRun(shared_ptr<type::Callable> cty, llvm::Valu
 llvm::Value* CodeGen::llvmRunHook(shared_ptr<Hook> hook, const expr_list& args, llvm::Value* result,
                                   bool cctor_result)
 {
-    return llvmDoCall(nullptr, hook, hook, hook->type(), args, cctor_result, result, true);
+    // Build the arguments and run the hook only if the linker has found
+    // implementations. If it hasn't, all of this gets optimized away.
+    auto run = newBuilder("hook-run");
+    auto done = newBuilder("hook-done");
+    auto skip_exit = builder()->GetInsertBlock();
+
+    llvmCreateCondBr(llvmHookImplemented(hook), run, done);
+
+    pushBuilder(run);
+    auto stopped = llvmDoCall(nullptr, hook, hook, hook->type(), args, cctor_result, result, true);
+    auto run_exit = builder()->GetInsertBlock();
+    llvmCreateBr(done);
+    popBuilder();
+
+    pushBuilder(done); // Leave on stack.
+
+    auto phi = builder()->CreatePHI(stopped->getType(), 2);
+    phi->addIncoming(stopped, run_exit);
+    phi->addIncoming(llvmConstInt(0, 1), skip_exit);
+    return phi;
 }
 
 llvm::Value* CodeGen::llvmDoCall(llvm::Value* llvm_func, shared_ptr<Function> func,
@@ -4533,6 +4568,12 @@ void CodeGen::llvmProfilerStart(const string& tag, const string& style, int64_t
     if ( options().profile == 0 )
         return;
 
+    if ( options().profile_fast ) {
+        expr_list args = {builder::codegen::create(builder::integer::type(64), llvmProfilerID(tag))};
+        llvmCall("hlt::profiler_fast_start", args, false, false);
+        return;
+    }
+
     auto ltag = llvmStringFromData(tag);
     auto lstyle = style.size() ? llvmEnum(style) : static_cast<llvm::Value*>(nullptr);
     auto lparam = llvmConstInt(param, 64);
@@ -4561,6 +4602,12 @@ void CodeGen::llvmProfilerStop(const string& tag)
     if ( options().profile == 0 )
         return;
 
+    if ( options().profile_fast ) {
+        expr_list args = {builder::codegen::create(builder::integer::type(64), llvmProfilerID(tag))};
+        llvmCall("hlt::profiler_fast_stop", args, false, false);
+        return;
+    }
+
     auto ltag = llvmStringFromData(tag);
     llvmProfilerStop(ltag);
 }
@@ -4584,13 +4631,51 @@ void CodeGen::llvmProfilerUpdate(llvm::Value* tag, llvm::Value* arg)
 }
 
 void CodeGen::llvmProfilerUpdate(const string& tag, int64_t arg)
+{
+    llvmProfilerUpdate(tag, llvmConstInt(arg, 64));
+}
+
+void CodeGen::llvmProfilerUpdate(const string& tag, llvm::Value* arg)
 {
     assert(tag.size());
 
-    auto ltag = llvmString(tag);
-    auto larg = llvmConstInt(arg, 64);
+    if ( options().profile == 0 )
+        return;
+
+    if ( ! arg )
+        arg = llvmConstInt(0, 64);
+
+    if ( options().profile_fast ) {
+        expr_list args = {builder::codegen::create(builder::integer::type(64), llvmProfilerID(tag)),
+                          builder::codegen::create(builder::integer::type(64), arg)};
+        llvmCall("hlt::profiler_fast_update", args, false, false);
+        return;
+    }
+
+    llvmProfilerUpdate(llvmString(tag), arg);
+}
+
+llvm::Value* CodeGen::llvmProfilerID(const string& tag)
+{
+    // We refer to the ID through an external placeholder that's specific
+    // to the tag. The linker turns it into a constant once it has seen the
+    // tags of all modules.
+    auto name = ::util::fmt("%s.%x", symbols::GlobalProfilerID, ::util::hash(tag));
+    auto id = _module->getGlobalVariable(name);
+
+    if ( ! id ) {
+        id = new llvm::GlobalVariable(*_module, llvmTypeInt(64), true,
+                                      llvm::GlobalValue::ExternalLinkage, nullptr, name);
+
+        std::vector<llvm::Metadata*> mds = {
+            util::llvmMetadata(llvmContext(), tag), // Profiler tag
+            util::llvmMetadata(llvmContext(), id)   // Placeholder for its ID
+        };
+
+        util::llvmAddGlobalMetadata(_module.get(), symbols::MetaProfilerTags, mds, true);
+    }
 
-    llvmProfilerUpdate(ltag, larg);
+    return builder()->CreateLoad(id);
 }
 
 string CodeGen::llvmGetModuleIdentifier(llvm::Module* module)
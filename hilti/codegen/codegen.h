@@ -41,7 +41,7 @@ struct TypeInfo;
 /// at the C layer in libhilti.
 namespace hlt {
 /// Fields in %hlt.execution_context.
-enum ExecutionContext { Globals = 13 };
+enum ExecutionContext { Globals = 14 };
 
 /// Fields in %hlt.exception.
 enum Exception { Name = 0 };
@@ -432,6 +432,15 @@ public:
     /// Returns: The function with the corresponding signature.
     llvm::Function* llvmFunctionHookRun(shared_ptr<Hook> hook);
 
+    /// Returns a boolean \c i1 LLVM value indicating whether any module
+    /// implements a hook. The value will be turned into a constant by the
+    /// linker, so that code depending on it can be optimized away.
+    ///
+    /// hook: The hook.
+    ///
+    /// Returns: The value.
+    llvm::Value* llvmHookImplemented(shared_ptr<Hook> hook);
+
     /// Returns the LLVM value for a HILTI expression.
     ///
     /// This method branches out the Loader to do its work.
@@ -1342,7 +1351,8 @@ public:
     ///
     /// hook: The hook.
     ///
-    /// args: The parameters to evaluate and pass to the hook.
+    /// args: The parameters to evaluate and pass to the hook. If the linker
+    /// finds that no module implements the hook, they won't be evaluated.
     ///
     /// result: If the hook as a void result type, this must be null. If not,
     /// it must be \a pointer to an instance of the corresponding LLVM type.
@@ -2291,6 +2301,8 @@ public:
     /// Starts a new profiler. The semantics of this method correspond
     /// directly to that of \c profiler.start, with defaults chosen in the
     /// same way. See the instruction documentation for more information.
+    /// With Options::profile_fast, the profiler is referred to by its ID
+    /// and the style, param, and tmgr are ignored.
     ///
     /// tag: A string value with the profiler's tag.
     ///
@@ -2324,6 +2336,22 @@ public:
     /// arg: The argument for the update.
     void llvmProfilerUpdate(const string& tag, int64_t arg);
 
+    /// Updates a profiler.
+    ///
+    /// tag: A string value with the profiler's tag.
+    ///
+    /// arg: The argument for the update. Must be an int64. If null, zero
+    /// is used.
+    void llvmProfilerUpdate(const string& tag, llvm::Value* arg);
+
+    /// Returns the ID that the fast profiling mode uses for a profiler. The
+    /// linker assigns the IDs across all modules.
+    ///
+    /// tag: The profiler's tag.
+    ///
+    /// Returns: An int64 value with the ID.
+    llvm::Value* llvmProfilerID(const string& tag);
+
     /// XXX
     void prepareCall(shared_ptr<Expression> func, shared_ptr<Expression> args,
                      CodeGen::expr_list* call_params, bool before_call);
@@ -33,6 +33,16 @@ void StatementBuilder::visit(statement::instruction::map::New* i)
     cg()->llvmStore(i, result);
 }
 
+void StatementBuilder::visit(statement::instruction::map::Bytes* i)
+{
+    CodeGen::expr_list args;
+    args.push_back(i->op1());
+
+    auto result = cg()->llvmCall("hlt::map_bytes", args);
+
+    cg()->llvmStore(i, result);
+}
+
 void StatementBuilder::visit(statement::instruction::map::Clear* i)
 {
     CodeGen::expr_list args;
@@ -56,6 +66,24 @@ void StatementBuilder::visit(statement::instruction::map::Default* i)
     cg()->llvmCall("hlt::map_default", args);
 }
 
+void StatementBuilder::visit(statement::instruction::map::EvictCallback* i)
+{
+    CodeGen::expr_list args;
+    args.push_back(i->op1());
+    args.push_back(i->op2());
+    cg()->llvmCall("hlt::map_evict_callable", args);
+}
+
+void StatementBuilder::visit(statement::instruction::map::Evicted* i)
+{
+    CodeGen::expr_list args;
+    args.push_back(i->op1());
+
+    auto result = cg()->llvmCall("hlt::map_evicted", args);
+
+    cg()->llvmStore(i, result);
+}
+
 void StatementBuilder::visit(statement::instruction::map::Exists* i)
 {
     auto ktype = ast::rtti::tryCast<type::Map>(referencedType(i->op1()))->keyType();
@@ -120,6 +148,24 @@ void StatementBuilder::visit(statement::instruction::map::Insert* i)
     cg()->llvmCall("hlt::map_insert", args);
 }
 
+void StatementBuilder::visit(statement::instruction::map::Limit* i)
+{
+    CodeGen::expr_list args;
+    args.push_back(i->op1());
+    args.push_back(i->op2());
+    args.push_back(i->op3());
+    cg()->llvmCall("hlt::map_limit", args);
+}
+
+void StatementBuilder::visit(statement::instruction::map::LimitBytes* i)
+{
+    CodeGen::expr_list args;
+    args.push_back(i->op1());
+    args.push_back(i->op2());
+    args.push_back(i->op3());
+    cg()->llvmCall("hlt::map_limit_bytes", args);
+}
+
 void StatementBuilder::visit(statement::instruction::map::Remove* i)
 {
     auto ktype = ast::rtti::tryCast<type::Map>(referencedType(i->op1()))->keyType();
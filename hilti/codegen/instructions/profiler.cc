@@ -7,8 +7,36 @@
 using namespace hilti;
 using namespace codegen;
 
+// Returns true if the fast profiling mode applies to a tag, which requires
+// it to be constant.
+static bool fastTag(CodeGen* cg, shared_ptr<Expression> op, string* tag)
+{
+    if ( ! cg->options().profile_fast )
+        return false;
+
+    auto cexpr = ast::rtti::tryCast<expression::Constant>(op);
+
+    if ( ! cexpr )
+        return false;
+
+    auto c = ast::rtti::tryCast<constant::String>(cexpr->constant());
+
+    if ( ! c )
+        return false;
+
+    *tag = c->value();
+    return true;
+}
+
 void StatementBuilder::visit(statement::instruction::profiler::Start* i)
 {
+    string ftag;
+
+    if ( fastTag(cg(), i->op1(), &ftag) ) {
+        cg()->llvmProfilerStart(ftag);
+        return;
+    }
+
     llvm::Value* tag = cg()->llvmValue(i->op1());
     llvm::Value* style = nullptr;
     llvm::Value* param = nullptr;
@@ -39,6 +67,13 @@ void StatementBuilder::visit(statement::instruction::profiler::Start* i)
 
 void StatementBuilder::visit(statement::instruction::profiler::Stop* i)
 {
+    string ftag;
+
+    if ( fastTag(cg(), i->op1(), &ftag) ) {
+        cg()->llvmProfilerStop(ftag);
+        return;
+    }
+
     llvm::Value* tag = cg()->llvmValue(i->op1());
 
     cg()->llvmProfilerStop(tag);
@@ -46,11 +81,18 @@ void StatementBuilder::visit(statement::instruction::profiler::Stop* i)
 
 void StatementBuilder::visit(statement::instruction::profiler::Update* i)
 {
-    llvm::Value* tag = cg()->llvmValue(i->op1());
     llvm::Value* arg = nullptr;
 
     if ( i->op2() )
         arg = cg()->llvmValue(i->op2());
 
+    string ftag;
+
+    if ( fastTag(cg(), i->op1(), &ftag) ) {
+        cg()->llvmProfilerUpdate(ftag, arg);
+        return;
+    }
+
+    llvm::Value* tag = cg()->llvmValue(i->op1());
     cg()->llvmProfilerUpdate(tag, arg);
 }
@@ -28,6 +28,16 @@ void StatementBuilder::visit(statement::instruction::set::New* i)
     cg()->llvmStore(i, result);
 }
 
+void StatementBuilder::visit(statement::instruction::set::Bytes* i)
+{
+    CodeGen::expr_list args;
+    args.push_back(i->op1());
+
+    auto result = cg()->llvmCall("hlt::set_bytes", args);
+
+    cg()->llvmStore(i, result);
+}
+
 void StatementBuilder::visit(statement::instruction::set::Clear* i)
 {
     CodeGen::expr_list args;
@@ -35,6 +45,24 @@ void StatementBuilder::visit(statement::instruction::set::Clear* i)
     cg()->llvmCall("hlt::set_clear", args);
 }
 
+void StatementBuilder::visit(statement::instruction::set::EvictCallback* i)
+{
+    CodeGen::expr_list args;
+    args.push_back(i->op1());
+    args.push_back(i->op2());
+    cg()->llvmCall("hlt::set_evict_callable", args);
+}
+
+void StatementBuilder::visit(statement::instruction::set::Evicted* i)
+{
+    CodeGen::expr_list args;
+    args.push_back(i->op1());
+
+    auto result = cg()->llvmCall("hlt::set_evicted", args);
+
+    cg()->llvmStore(i, result);
+}
+
 void StatementBuilder::visit(statement::instruction::set::Exists* i)
 {
     auto etype = ast::rtti::tryCast<type::Set>(referencedType(i->op1()))->argType();
@@ -59,6 +87,24 @@ void StatementBuilder::visit(statement::instruction::set::Insert* i)
     cg()->llvmCall("hlt::set_insert", args);
 }
 
+void StatementBuilder::visit(statement::instruction::set::Limit* i)
+{
+    CodeGen::expr_list args;
+    args.push_back(i->op1());
+    args.push_back(i->op2());
+    args.push_back(i->op3());
+    cg()->llvmCall("hlt::set_limit", args);
+}
+
+void StatementBuilder::visit(statement::instruction::set::LimitBytes* i)
+{
+    CodeGen::expr_list args;
+    args.push_back(i->op1());
+    args.push_back(i->op2());
+    args.push_back(i->op3());
+    cg()->llvmCall("hlt::set_limit_bytes", args);
+}
+
 void StatementBuilder::visit(statement::instruction::set::Remove* i)
 {
     auto etype = ast::rtti::tryCast<type::Set>(referencedType(i->op1()))->argType();
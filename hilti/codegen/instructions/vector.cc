@@ -29,6 +29,14 @@ void StatementBuilder::visit(statement::instruction::vector::New* i)
     cg()->llvmStore(i, result);
 }
 
+void StatementBuilder::visit(statement::instruction::vector::Append* i)
+{
+    CodeGen::expr_list args;
+    args.push_back(i->op1());
+    args.push_back(i->op2());
+    cg()->llvmCall("hlt::vector_append", args);
+}
+
 void StatementBuilder::visit(statement::instruction::vector::Get* i)
 {
     auto etype = ast::rtti::tryCast<type::Vector>(referencedType(i->op1()))->argType();
@@ -74,8 +82,8 @@ void StatementBuilder::visit(statement::instruction::vector::Reserve* i)
 
     CodeGen::expr_list args;
     args.push_back(i->op1());
-    args.push_back(i->op2());
-    cg()->llvmCall("hlt::X", args);
+    args.push_back(op2);
+    cg()->llvmCall("hlt::vector_reserve", args);
 }
 
 void StatementBuilder::visit(statement::instruction::vector::Set* i)
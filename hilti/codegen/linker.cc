@@ -5,6 +5,7 @@
 #include "../context.h"
 #include "../options.h"
 #include "codegen.h"
+#include "partitioner.h"
 #include "util.h"
 
 using namespace hilti;
@@ -250,6 +251,9 @@ std::unique_ptr<llvm::Module> Linker::link(string output,
         if ( isHiltiModule(i.get()) )
             module_names.push_back(name);
 
+        if ( options().thin_link )
+            Partitioner::tag(i.get(), name);
+
         linkInModule(&linker, std::move(i));
 
         if ( options().verify && ! codegen::util::llvmVerifyModule(composite.get()) )
@@ -286,6 +290,9 @@ std::unique_ptr<llvm::Module> Linker::link(string output,
         for ( auto f : to_remove )
             f->removeFromParent();
 
+        if ( options().thin_link )
+            Partitioner::tag(m->get(), ::util::basename(i));
+
         linkInModule(&linker, std::move(*m));
     }
 
@@ -298,6 +305,7 @@ std::unique_ptr<llvm::Module> Linker::link(string output,
         addModuleInfo(composite.get(), module_names);
         addGlobalsInfo(composite.get(), module_names);
         makeHooks(composite.get(), module_names);
+        makeProfilerTags(composite.get());
     }
 
     if ( errors() > 0 )
@@ -408,6 +416,51 @@ static void _debugDumpHooks(Linker* linker, const std::map<string, HookDecl>& ho
     }
 }
 
+// Returns whether a hook group is enabled, as an i1 value computed at the
+// builder's current position.
+static llvm::Value* _hookGroupEnabled(IRBuilder* builder, int64_t group, llvm::Value* ctx)
+{
+    auto module = builder->GetInsertBlock()->getParent()->getParent();
+
+    std::vector<llvm::Type*> params = {builder->getInt64Ty(), builder->getInt8PtrTy(),
+                                       builder->getInt8PtrTy()};
+    auto ftype = llvm::FunctionType::get(builder->getInt8Ty(), params, false);
+    auto func = module->getOrInsertFunction("hlt_hook_group_is_enabled", ftype);
+
+    std::vector<llvm::Value*> args = {builder->getInt64(group),
+                                      llvm::Constant::getNullValue(builder->getInt8PtrTy()),
+                                      builder->CreateBitCast(ctx, builder->getInt8PtrTy())};
+
+    auto enabled = builder->CreateCall(func, args);
+    return builder->CreateICmpNE(enabled, builder->getInt8(0));
+}
+
+// Turns the placeholders through which hook call sites check whether a hook
+// has any implementations into constants. Code running a hook that nobody
+// implements then gets optimized away, including building its arguments.
+static void _resolveHookPlaceholders(Linker* linker, llvm::Module* module,
+                                     const std::set<string>& implemented)
+{
+    string prefix = string(symbols::GlobalHookImplemented) + ".";
+
+    for ( auto& g : module->globals() ) {
+        auto name = g.getName().str();
+
+        if ( name.compare(0, prefix.size(), prefix) != 0 || ! g.isDeclaration() )
+            continue;
+
+        bool have = (implemented.find(name.substr(prefix.size())) != implemented.end());
+
+        linker->debug(1, ::util::fmt("hook %s %s implementations", name.substr(prefix.size()),
+                                     (have ? "has" : "does not have")));
+
+        g.setInitializer(llvm::ConstantInt::get(llvm::Type::getIntNTy(module->getContext(), 1),
+                                                have ? 1 : 0));
+        g.setLinkage(llvm::GlobalValue::InternalLinkage);
+        g.setConstant(true);
+    }
+}
+
 void Linker::makeHooks(llvm::Module* module, const std::list<string>& module_names)
 {
     auto decls = codegen::util::llvmGetGlobalMetadata(module, symbols::MetaHookDecls);
@@ -415,6 +468,7 @@ void Linker::makeHooks(llvm::Module* module, const std::list<string>& module_nam
 
     if ( ! decls ) {
         debug(1, "no hooks declared in any module");
+        _resolveHookPlaceholders(this, module, {});
         return;
     }
 
@@ -483,11 +537,14 @@ void Linker::makeHooks(llvm::Module* module, const std::list<string>& module_nam
 
     _debugDumpHooks(this, hooks);
 
-    // Finally, we can build the functions that call the hook implementations.
+    // Finally, we can build the dispatch functions that call the hook
+    // implementations.
 
     auto true_ = llvm::ConstantInt::get(llvm::Type::getIntNTy(llvmContext(), 1), 1);
     auto false_ = llvm::ConstantInt::get(llvm::Type::getIntNTy(llvmContext(), 1), 0);
 
+    std::set<string> implemented;
+
     for ( auto h : hooks ) {
         auto decl = h.second;
 
@@ -502,13 +559,35 @@ void Linker::makeHooks(llvm::Module* module, const std::list<string>& module_nam
             codegen::util::newBuilder(llvmContext(),
                                       llvm::BasicBlock::Create(llvmContext(), "hook", func));
 
+        if ( decl.impls.size() )
+            implemented.insert(func->getName().str());
+
+        // Check each group the implementations belong to just once upfront,
+        // rather than having each of them do it. The execution context is
+        // the last argument, except for hooks with a result that comes
+        // after it.
+        auto ctx = func->arg_begin();
+        std::advance(ctx, func->arg_size() - (decl.result ? 2 : 1));
+
+        std::map<int64_t, llvm::Value*> groups;
+
+        for ( auto i : decl.impls ) {
+            if ( groups.find(i.group) == groups.end() )
+                groups.insert(std::make_pair(i.group, _hookGroupEnabled(next, i.group, &(*ctx))));
+        }
+
         for ( auto i : decl.impls ) {
             auto ifunc = llvm::cast<llvm::Function>(i.func);
 
-            IRBuilder* current = next;
+            IRBuilder* check = next;
+            IRBuilder* current =
+                codegen::util::newBuilder(llvmContext(),
+                                          llvm::BasicBlock::Create(llvmContext(), "impl", func));
             next = codegen::util::newBuilder(llvmContext(),
                                              llvm::BasicBlock::Create(llvmContext(), "hook", func));
 
+            check->CreateCondBr(groups[i.group], current->GetInsertBlock(), next->GetInsertBlock());
+
             std::vector<llvm::Value*> args;
 
             auto pt = ifunc->arg_begin();
@@ -521,7 +600,6 @@ void Linker::makeHooks(llvm::Module* module, const std::list<string>& module_nam
             auto result =
                 codegen::util::checkedCreateCall(current, "Linker::makeHooks", ifunc, args);
 
-            llvm::ConstantInt::get(llvm::Type::getIntNTy(llvmContext(), 1), 0);
             current->CreateCondBr(result, stopped->GetInsertBlock(), next->GetInsertBlock());
         }
 
@@ -529,6 +607,87 @@ void Linker::makeHooks(llvm::Module* module, const std::list<string>& module_nam
         stopped->CreateRet(true_);
         func->getBasicBlockList().push_back(stopped->GetInsertBlock());
     }
+
+    _resolveHookPlaceholders(this, module, implemented);
+}
+
+void Linker::makeProfilerTags(llvm::Module* module)
+{
+    auto md = codegen::util::llvmGetGlobalMetadata(module, symbols::MetaProfilerTags);
+
+    if ( ! md ) {
+        debug(1, "no profiler IDs used in any module");
+        return;
+    }
+
+    // Assign dense IDs in the order we encounter the tags. Modules using the
+    // same tag share the placeholder, as its name derives from the tag.
+    std::map<string, uint64_t> ids;
+    std::vector<llvm::Constant*> tags;
+
+    auto ty_id = llvm::Type::getIntNTy(llvmContext(), 64);
+    auto ty_tag = llvm::Type::getInt8PtrTy(llvmContext());
+
+    for ( int i = 0; i < md->getNumOperands(); ++i ) {
+        auto entry = codegen::util::llvmMetadataAsTuple(md->getOperand(i));
+        auto tag = codegen::util::llvmMetadataAsString(entry->getOperand(0));
+        auto global = llvm::dyn_cast_or_null<llvm::GlobalVariable>(
+            codegen::util::llvmMetadataAsValue(entry->getOperand(1)));
+
+        if ( ! global || ! global->isDeclaration() )
+            // Already resolved through another entry for the same tag.
+            continue;
+
+        auto t = ids.find(tag);
+        uint64_t id;
+
+        if ( t != ids.end() )
+            id = t->second;
+
+        else {
+            id = tags.size();
+            ids.insert(std::make_pair(tag, id));
+
+            auto data = llvm::ConstantDataArray::getString(llvmContext(), tag);
+            auto str = new llvm::GlobalVariable(*module, data->getType(), true,
+                                                llvm::GlobalValue::PrivateLinkage, data,
+                                                "hlt.profiler.tag");
+            tags.push_back(llvm::ConstantExpr::getPointerCast(str, ty_tag));
+
+            debug(1, ::util::fmt("profiler tag %s has ID %d", tag, id));
+        }
+
+        global->setInitializer(llvm::ConstantInt::get(ty_id, id));
+        global->setLinkage(llvm::GlobalValue::InternalLinkage);
+        global->setConstant(true);
+    }
+
+    // Create the table of tags indexed by ID, terminated by a null pointer.
+    tags.push_back(llvm::Constant::getNullValue(ty_tag));
+    auto ty_table = llvm::ArrayType::get(ty_tag, tags.size());
+    auto table = new llvm::GlobalVariable(*module, ty_table, true,
+                                          llvm::GlobalValue::PrivateLinkage,
+                                          llvm::ConstantArray::get(ty_table, tags),
+                                          "hlt.profiler.tags");
+
+    // If a profiler_tags() function already exists with weak linkage,
+    // replace it.
+    auto old_func = module->getFunction(symbols::FunctionProfilerTags);
+
+    if ( old_func ) {
+        old_func->removeFromParent();
+    }
+
+    auto ftype = llvm::FunctionType::get(llvm::PointerType::get(ty_tag, 0), false);
+    auto func = llvm::Function::Create(ftype, llvm::Function::ExternalLinkage,
+                                       symbols::FunctionProfilerTags, module);
+    func->setCallingConv(llvm::CallingConv::C);
+    auto builder = codegen::util::newBuilder(llvmContext(),
+                                             llvm::BasicBlock::Create(llvmContext(), "", func));
+    builder->CreateRet(llvm::ConstantExpr::getPointerCast(table, ftype->getReturnType()));
+
+    if ( old_func )
+        old_func->replaceAllUsesWith(func);
 }
 
 void Linker::addModuleInfo(llvm::Module* module, const std::list<string>& module_names)
@@ -82,6 +82,7 @@ private:
                        llvm::FunctionType* default_ftype, const std::list<string>& module_names,
                        llvm::Module* module);
     void makeHooks(llvm::Module* module, const std::list<string>& module_names);
+    void makeProfilerTags(llvm::Module* module);
     void fatalError(const string& where, const string& file = "", const string& error = "");
 
     // These following three abort directly on error.
@@ -600,6 +600,12 @@ void Loader::visit(ctor::Vector* c)
 
     auto vecop = builder::codegen::create(c->type(), vec);
 
+    if ( c->elements().size() ) {
+        auto n = builder::integer::create(c->elements().size());
+        CodeGen::expr_list args = {vecop, n};
+        cg()->llvmCall("hlt::vector_reserve", args);
+    }
+
     for ( auto e : c->elements() ) {
         e = e->coerceTo(etype);
         CodeGen::expr_list args = {vecop, e};
@@ -4,8 +4,12 @@
 #include "../options.h"
 #include "codegen.h"
 #include "llvm-common.h"
+#include "profile-data.h"
+#include "symbols.h"
 #include "util.h"
 
+#include <llvm/IR/MDBuilder.h>
+
 using namespace hilti;
 using namespace codegen;
 
@@ -63,6 +67,9 @@ std::unique_ptr<llvm::Module> Optimizer::optimize(std::unique_ptr<llvm::Module>
     auto mb = std::make_unique<llvm::ObjectMemoryBuffer>(std::move(buffer));
     auto nmodule = llvm::parseBitcodeFile((*mb).getMemBufferRef(), module->getContext());
 
+    if ( is_linked && options().pgo_use.size() && ! applyProfile(nmodule->get()) )
+        return nullptr;
+
 #if 1
     // Logic borrowed heavily from opt.
 
@@ -181,3 +188,200 @@ std::unique_ptr<llvm::Module> Optimizer::optimize(std::unique_ptr<llvm::Module>
         return nullptr;
 #endif
 }
+
+bool Optimizer::instrument(llvm::Module* module)
+{
+    auto& ctx = module->getContext();
+    auto i8p = llvm::Type::getInt8PtrTy(ctx);
+    auto i64 = llvm::Type::getInt64Ty(ctx);
+    auto i64p = llvm::PointerType::get(i64, 0);
+    auto zero = llvm::ConstantInt::get(i64, 0);
+
+    // Layout must match __hlt_pgo_function and __hlt_pgo_profile in
+    // libhilti/pgo.h.
+    auto ty_func = llvm::StructType::create(ctx, {i8p, i64, i64, i64p}, "hlt.pgo.function");
+
+    std::vector<llvm::Constant*> records;
+
+    for ( auto& func : *module ) {
+        if ( func.isDeclaration() || func.getName().startswith("__hlt_pgo") )
+            continue;
+
+        auto hash = ProfileData::hash(func);
+        auto nblocks = func.size();
+
+        auto ty_counters = llvm::ArrayType::get(i64, nblocks);
+        auto counters =
+            new llvm::GlobalVariable(*module, ty_counters, false, llvm::GlobalValue::PrivateLinkage,
+                                     llvm::ConstantAggregateZero::get(ty_counters),
+                                     ::util::fmt("hlt.pgo.counters.%s", func.getName().str()));
+
+        int idx = 0;
+
+        for ( auto& block : func ) {
+            llvm::IRBuilder<> builder(&block, block.getFirstInsertionPt());
+            auto addr = builder.CreateConstInBoundsGEP2_64(counters, 0, idx++);
+            auto cnt = builder.CreateLoad(addr);
+            builder.CreateStore(builder.CreateAdd(cnt, llvm::ConstantInt::get(i64, 1)), addr);
+        }
+
+        auto name = llvm::ConstantDataArray::getString(ctx, func.getName());
+        auto gname = new llvm::GlobalVariable(*module, name->getType(), true,
+                                              llvm::GlobalValue::PrivateLinkage, name,
+                                              ::util::fmt("hlt.pgo.name.%s", func.getName().str()));
+
+        std::vector<llvm::Constant*> fields = {
+            llvm::ConstantExpr::getBitCast(gname, i8p), llvm::ConstantInt::get(i64, hash),
+            llvm::ConstantInt::get(i64, nblocks),
+            llvm::ConstantExpr::getInBoundsGetElementPtr(ty_counters, counters,
+                                                         llvm::ArrayRef<llvm::Constant*>(
+                                                             {zero, zero}))};
+
+        records.push_back(llvm::ConstantStruct::get(ty_func, fields));
+    }
+
+    auto ty_records = llvm::ArrayType::get(ty_func, records.size());
+    auto grecords =
+        new llvm::GlobalVariable(*module, ty_records, true, llvm::GlobalValue::PrivateLinkage,
+                                 llvm::ConstantArray::get(ty_records, records), "hlt.pgo.functions");
+
+    auto ty_profile = llvm::StructType::create(ctx, {i64, llvm::PointerType::get(ty_func, 0)},
+                                               "hlt.pgo.profile");
+    std::vector<llvm::Constant*> pfields = {
+        llvm::ConstantInt::get(i64, records.size()),
+        llvm::ConstantExpr::getInBoundsGetElementPtr(ty_records, grecords,
+                                                     llvm::ArrayRef<llvm::Constant*>(
+                                                         {zero, zero}))};
+    auto gprofile = new llvm::GlobalVariable(*module, ty_profile, true,
+                                             llvm::GlobalValue::PrivateLinkage,
+                                             llvm::ConstantStruct::get(ty_profile, pfields),
+                                             "hlt.pgo.profile");
+
+    // If a weak __hlt_pgo_data() function already exists from libhilti,
+    // replace it.
+    auto old_func = module->getFunction(symbols::FunctionPGOData);
+
+    if ( old_func ) {
+        old_func->removeFromParent();
+    }
+
+    auto ftype = (old_func ? old_func->getFunctionType() : llvm::FunctionType::get(i8p, false));
+    auto nfunc = llvm::Function::Create(ftype, llvm::Function::ExternalLinkage,
+                                        symbols::FunctionPGOData, module);
+    nfunc->setCallingConv(llvm::CallingConv::C);
+
+    llvm::IRBuilder<> builder(llvm::BasicBlock::Create(ctx, "", nfunc));
+    builder.CreateRet(llvm::ConstantExpr::getBitCast(gprofile, ftype->getReturnType()));
+
+    if ( old_func )
+        old_func->replaceAllUsesWith(nfunc);
+
+    if ( options().cgDebugging("context") )
+        std::cerr << ::util::fmt("Instrumented %d functions for profiling", records.size())
+                  << std::endl;
+
+    return true;
+}
+
+bool Optimizer::applyProfile(llvm::Module* module)
+{
+    ProfileData profile;
+    string err;
+
+    if ( ! profile.read(options().pgo_use, &err) ) {
+        error(::util::fmt("cannot read profile: %s", err));
+        return false;
+    }
+
+    auto& ctx = module->getContext();
+    llvm::MDBuilder mdb(ctx);
+    llvm::Triple triple(module->getTargetTriple());
+
+    auto max = profile.maxEntryCount();
+    auto hot = std::max(max / 100, (uint64_t)1);
+
+    int matched = 0;
+    int stale = 0;
+
+    for ( auto& func : *module ) {
+        if ( func.isDeclaration() )
+            continue;
+
+        auto i = profile.functions().find(func.getName());
+
+        if ( i == profile.functions().end() )
+            continue;
+
+        const auto& counts = i->second.counts;
+        auto entry = counts.size() ? counts.front() : 0;
+
+        func.setEntryCount(entry);
+
+        if ( entry == 0 ) {
+            // Never executed, keep it out of the way of the hot code.
+            func.addFnAttr(llvm::Attribute::Cold);
+
+            if ( triple.isOSBinFormatELF() && ! func.hasSection() )
+                func.setSection(".text.unlikely");
+        }
+
+        else if ( entry >= hot && ! func.hasFnAttribute(llvm::Attribute::NoInline) )
+            func.addFnAttr(llvm::Attribute::InlineHint);
+
+        if ( i->second.hash != ProfileData::hash(func) || counts.size() != func.size() ) {
+            // The function has changed since the profile was recorded, so
+            // the block counts no longer apply.
+            ++stale;
+            continue;
+        }
+
+        ++matched;
+
+        std::map<const llvm::BasicBlock*, uint64_t> block_counts;
+
+        int idx = 0;
+
+        for ( auto& block : func )
+            block_counts[&block] = counts[idx++];
+
+        for ( auto& block : func ) {
+            auto term = block.getTerminator();
+
+            if ( ! term || term->getNumSuccessors() < 2 )
+                continue;
+
+            if ( ! (llvm::isa<llvm::BranchInst>(term) || llvm::isa<llvm::SwitchInst>(term)) )
+                continue;
+
+            std::vector<uint64_t> succ_counts;
+            uint64_t succ_max = 0;
+
+            for ( unsigned int j = 0; j < term->getNumSuccessors(); j++ ) {
+                auto c = block_counts[term->getSuccessor(j)];
+                succ_counts.push_back(c);
+                succ_max = std::max(succ_max, c);
+            }
+
+            // Branch weights are 32-bit; scale down if necessary. We add one
+            // so that no edge ends up with a weight of zero.
+            uint64_t scale = succ_max / UINT32_MAX + 1;
+
+            std::vector<uint32_t> weights;
+
+            for ( auto c : succ_counts )
+                weights.push_back(c / scale + 1);
+
+            term->setMetadata(llvm::LLVMContext::MD_prof, mdb.createBranchWeights(weights));
+        }
+    }
+
+    if ( stale )
+        warning(::util::fmt("profile is out of date for %d function(s), ignoring their branch "
+                            "counts",
+                            stale));
+
+    if ( options().cgDebugging("context") )
+        std::cerr << ::util::fmt("Applied profile to %d functions", matched) << std::endl;
+
+    return true;
+}
@@ -37,6 +37,27 @@ public:
     /// Returns: A new, optmized module, or null on error.
     std::unique_ptr<llvm::Module> optimize(std::unique_ptr<llvm::Module> module, bool is_linked);
 
+    /// Instruments a linked module for collecting a profile that can later
+    /// be fed back via Options::pgo_use. The instrumentation counts how
+    /// often each basic block executes, and makes the counters available
+    /// to the runtime through \c __hlt_pgo_data(), which writes them out
+    /// at termination.
+    ///
+    /// module: The module to instrument in place.
+    ///
+    /// Returns: True on success.
+    bool instrument(llvm::Module* module);
+
+    /// Annotates a linked module with the execution counts recorded in the
+    /// profile that Options::pgo_use specifies. This attaches entry counts
+    /// and branch weights, marks hot functions for inlining, and moves
+    /// functions never executed into a separate cold section.
+    ///
+    /// module: The module to annotate in place.
+    ///
+    /// Returns: True on success.
+    bool applyProfile(llvm::Module* module);
+
 private:
     CompilerContext* _ctx;
 };
@@ -0,0 +1,205 @@
+
+#include "partitioner.h"
+#include "../context.h"
+#include "../options.h"
+#include "symbols.h"
+#include "util.h"
+
+#include <llvm/Transforms/Utils/Cloning.h>
+
+using namespace hilti;
+using namespace codegen;
+
+// Functions with up to this many instructions get imported into other
+// partitions calling them.
+static const unsigned int ImportInstructionLimit = 100;
+
+// Partitions for anything not originating from a specific module.
+static const char* PartitionLinker = "<linker>";
+static const char* PartitionGlobals = "<globals>";
+
+Partitioner::Partitioner(CompilerContext* ctx) : ast::Logger("codegen::Partitioner")
+{
+    _ctx = ctx;
+}
+
+CompilerContext* Partitioner::context() const
+{
+    return _ctx;
+}
+
+const Options& Partitioner::options() const
+{
+    return _ctx->options();
+}
+
+void Partitioner::tag(llvm::Module* module, const string& name)
+{
+    for ( auto& func : *module ) {
+        if ( func.isDeclaration() || func.hasFnAttribute(symbols::AttrPartition) )
+            continue;
+
+        func.addFnAttr(symbols::AttrPartition, name);
+    }
+}
+
+void Partitioner::_externalize(llvm::Module* module)
+{
+    int cnt = 0;
+
+    auto externalize = [&](llvm::GlobalValue& gv) {
+        if ( gv.isDeclaration() || gv.getName().startswith("llvm.") )
+            return;
+
+        if ( gv.hasLocalLinkage() ) {
+            // Local symbols may be referenced from other partitions now.
+            if ( ! gv.hasName() )
+                gv.setName(::util::fmt("hlt.local.%d", ++cnt));
+
+            gv.setLinkage(llvm::GlobalValue::ExternalLinkage);
+            gv.setVisibility(llvm::GlobalValue::HiddenVisibility);
+        }
+
+        else if ( gv.hasLinkOnceODRLinkage() )
+            // Don't let the optimizer drop them if unused in their own partition.
+            gv.setLinkage(llvm::GlobalValue::WeakODRLinkage);
+
+        else if ( gv.hasLinkOnceLinkage() )
+            gv.setLinkage(llvm::GlobalValue::WeakAnyLinkage);
+    };
+
+    for ( auto& func : module->functions() )
+        externalize(func);
+
+    for ( auto& global : module->globals() )
+        externalize(global);
+
+    for ( auto& alias : module->aliases() )
+        externalize(alias);
+}
+
+Partitioner::partition_list Partitioner::split(llvm::Module* module)
+{
+    _externalize(module);
+
+    // Build the summary: which partition each definition goes into, and how
+    // large functions are.
+    std::map<string, std::set<const llvm::GlobalValue*>> members;
+    std::map<const llvm::GlobalValue*, unsigned int> sizes;
+
+    for ( auto& func : *module ) {
+        if ( func.isDeclaration() )
+            continue;
+
+        auto attr = func.getFnAttribute(symbols::AttrPartition);
+        auto name = attr.isStringAttribute() ? attr.getValueAsString().str() : PartitionLinker;
+        members[name].insert(&func);
+
+        unsigned int size = 0;
+
+        for ( auto& block : func )
+            size += block.size();
+
+        sizes[&func] = size;
+    }
+
+    for ( auto& global : module->globals() ) {
+        if ( ! global.isDeclaration() )
+            members[PartitionGlobals].insert(&global);
+    }
+
+    for ( auto& alias : module->aliases() )
+        members[PartitionGlobals].insert(&alias);
+
+    partition_list partitions;
+
+    for ( auto& m : members ) {
+        const auto& defs = m.second;
+
+        // Import small functions this partition calls directly, as well as
+        // constants it references so that they can be folded.
+        std::set<const llvm::GlobalValue*> imports;
+
+        auto import = [&](const llvm::GlobalValue* gv) {
+            if ( ! gv || gv->isDeclaration() || ! gv->hasExternalLinkage() ||
+                 defs.find(gv) != defs.end() )
+                return;
+
+            if ( auto func = llvm::dyn_cast<llvm::Function>(gv) ) {
+                if ( sizes[func] <= ImportInstructionLimit &&
+                     ! func->hasFnAttribute(llvm::Attribute::NoInline) )
+                    imports.insert(gv);
+            }
+
+            else if ( auto global = llvm::dyn_cast<llvm::GlobalVariable>(gv) ) {
+                if ( global->isConstant() )
+                    imports.insert(gv);
+            }
+        };
+
+        for ( auto gv : defs ) {
+            auto func = llvm::dyn_cast<llvm::Function>(gv);
+
+            if ( ! func )
+                continue;
+
+            for ( auto& block : *func ) {
+                for ( auto& i : block ) {
+                    if ( auto call = llvm::dyn_cast<llvm::CallInst>(&i) )
+                        import(call->getCalledFunction());
+
+                    else if ( auto invoke = llvm::dyn_cast<llvm::InvokeInst>(&i) )
+                        import(invoke->getCalledFunction());
+
+                    for ( auto& op : i.operands() )
+                        import(llvm::dyn_cast<llvm::GlobalVariable>(op.get()));
+                }
+            }
+        }
+
+        llvm::ValueToValueMapTy vmap;
+        auto clone = llvm::CloneModule(module, vmap, [&](const llvm::GlobalValue* gv) {
+            return defs.find(gv) != defs.end() || imports.find(gv) != imports.end();
+        });
+
+        clone->setModuleIdentifier(m.first);
+
+        // The optimizer may inline these, but we don't emit code for them.
+        for ( auto gv : imports ) {
+            auto ngv = llvm::cast<llvm::GlobalObject>(vmap[gv]);
+            ngv->setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+            ngv->setVisibility(llvm::GlobalValue::DefaultVisibility);
+            ngv->setComdat(nullptr);
+        }
+
+        // Remove declarations of special globals defined by another
+        // partition, such as llvm.global_ctors.
+        std::list<llvm::GlobalVariable*> special;
+
+        for ( auto& global : clone->globals() ) {
+            if ( global.isDeclaration() && global.getName().startswith("llvm.") )
+                special.push_back(&global);
+        }
+
+        for ( auto global : special )
+            global->eraseFromParent();
+
+        if ( options().verify && ! codegen::util::llvmVerifyModule(clone.get()) ) {
+            error(::util::fmt("verification of partition %s failed", m.first));
+            partitions.clear();
+            return partitions;
+        }
+
+        if ( options().cgDebugging("context") )
+            std::cerr << ::util::fmt("Partition %s: %d definitions, %d imported", m.first,
+                                     defs.size(), imports.size())
+                      << std::endl;
+
+        Partition p;
+        p.name = m.first;
+        p.module = std::move(clone);
+        partitions.push_back(std::move(p));
+    }
+
+    return partitions;
+}
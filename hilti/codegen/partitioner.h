@@ -0,0 +1,78 @@
+#ifndef HILTI_CODEGEN_PARTITIONER_H
+#define HILTI_CODEGEN_PARTITIONER_H
+
+#include "common.h"
+
+namespace hilti {
+
+class CompilerContext;
+class Options;
+
+namespace codegen {
+
+/// Splits a linked module back into partitions that can be optimized
+/// independently of each other, one per module that the linker combined.
+/// The linker tags each function with the name of the module it came from
+/// (see symbols::AttrPartition); code the linker generates itself ends up in
+/// a separate partition, as do all global variables.
+///
+/// A partition contains the definitions of its own functions, plus
+/// declarations for everything else it references. To still allow for
+/// cross-module inlining, the partitioner records a summary of each
+/// function's size, and based on that imports small callees defined
+/// elsewhere with \c available_externally linkage. The optimizer can inline
+/// these but doesn't emit code for them. Linking the optimized partitions
+/// back together then yields the final module.
+///
+/// As long as a module doesn't change, neither does its partition, so its
+/// optimized version can be cached across runs.
+class Partitioner : public ast::Logger {
+public:
+    /// A single partition.
+    struct Partition {
+        string name;                         /// The name of the module the partition is for.
+        std::unique_ptr<llvm::Module> module; /// The partition's code.
+    };
+
+    typedef std::list<Partition> partition_list;
+
+    /// Constructor.
+    ///
+    /// ctx: The compiler context to use.
+    Partitioner(CompilerContext* ctx);
+
+    /// Returns the compiler context the partitioner is used with.
+    CompilerContext* context() const;
+
+    /// Returns the options in effecty for code generation. This is a
+    /// convienience method that just forwards to the current context.
+    const Options& options() const;
+
+    /// Splits a linked module into partitions.
+    ///
+    /// module: The module to split. Note that the function adapts the
+    /// linkage of its symbols so that they remain accessible across
+    /// partitions.
+    ///
+    /// Returns: The partitions, which together define all symbols that
+    /// *module* defines.
+    partition_list split(llvm::Module* module);
+
+    /// Tags all functions defined by a module as belonging to a partition.
+    ///
+    /// module: The module.
+    ///
+    /// name: The partition's name.
+    static void tag(llvm::Module* module, const string& name);
+
+private:
+    // Adapts linkage so that symbols can be referenced from other
+    // partitions and won't get dropped while optimizing their own.
+    void _externalize(llvm::Module* module);
+
+    CompilerContext* _ctx;
+};
+}
+}
+
+#endif
@@ -0,0 +1,134 @@
+#include <fstream>
+#include <sstream>
+
+#include "../../libhilti/pgo.h"
+#include "profile-data.h"
+
+using namespace hilti;
+using namespace codegen;
+
+bool ProfileData::read(const string& path, string* error)
+{
+    std::ifstream in(path);
+
+    if ( ! in ) {
+        *error = ::util::fmt("cannot open %s", path);
+        return false;
+    }
+
+    string line;
+    int lineno = 0;
+
+    while ( std::getline(in, line) ) {
+        ++lineno;
+
+        if ( line.empty() )
+            continue;
+
+        if ( line[0] == '#' ) {
+            if ( lineno == 1 && line != ::util::fmt("# hilti-pgo %d", HLT_PGO_VERSION) ) {
+                *error = ::util::fmt("%s: unsupported profile version", path);
+                return false;
+            }
+
+            continue;
+        }
+
+        std::istringstream fields(line);
+
+        string name;
+        uint64_t nblocks = 0;
+        Function f;
+
+        fields >> name >> f.hash >> nblocks;
+
+        for ( uint64_t i = 0; i < nblocks; i++ ) {
+            uint64_t c = 0;
+            fields >> c;
+            f.counts.push_back(c);
+        }
+
+        if ( fields.fail() || nblocks == 0 ) {
+            *error = ::util::fmt("%s:%d: malformed line", path, lineno);
+            return false;
+        }
+
+        auto i = _functions.find(name);
+
+        if ( i == _functions.end() ) {
+            _functions.insert(std::make_pair(name, f));
+            continue;
+        }
+
+        auto& have = i->second;
+
+        if ( have.hash == f.hash && have.counts.size() == f.counts.size() ) {
+            for ( size_t j = 0; j < f.counts.size(); j++ )
+                have.counts[j] += f.counts[j];
+        }
+
+        else if ( f.counts.front() > have.counts.front() )
+            have = f;
+    }
+
+    return true;
+}
+
+void ProfileData::write(std::ostream& out) const
+{
+    out << "# hilti-pgo " << HLT_PGO_VERSION << std::endl;
+
+    for ( auto f : _functions ) {
+        out << f.first << " " << f.second.hash << " " << f.second.counts.size();
+
+        for ( auto c : f.second.counts )
+            out << " " << c;
+
+        out << std::endl;
+    }
+}
+
+const ProfileData::function_map& ProfileData::functions() const
+{
+    return _functions;
+}
+
+uint64_t ProfileData::maxEntryCount() const
+{
+    uint64_t max = 0;
+
+    for ( auto f : _functions )
+        max = std::max(max, f.second.counts.front());
+
+    return max;
+}
+
+uint64_t ProfileData::hash(const llvm::Function& func)
+{
+    // The shape of the graph is what matters: the number of blocks and
+    // where each of them branches to.
+    std::map<const llvm::BasicBlock*, int> index;
+
+    for ( auto& b : func )
+        index.insert(std::make_pair(&b, index.size()));
+
+    std::list<string> succs;
+
+    for ( auto& b : func ) {
+        auto term = b.getTerminator();
+
+        if ( ! term ) {
+            succs.push_back("-");
+            continue;
+        }
+
+        std::list<string> s;
+
+        for ( unsigned int i = 0; i < term->getNumSuccessors(); i++ )
+            s.push_back(std::to_string(index[term->getSuccessor(i)]));
+
+        succs.push_back(::util::strjoin(s, ","));
+    }
+
+    return ::util::hash(::util::strjoin(succs, ";"));
+}
@@ -0,0 +1,64 @@
+#ifndef HILTI_CODEGEN_PROFILE_DATA_H
+#define HILTI_CODEGEN_PROFILE_DATA_H
+
+#include <map>
+#include <vector>
+
+#include "common.h"
+
+namespace hilti {
+namespace codegen {
+
+/// Execution counts for profile-guided optimization, as written by
+/// instrumented code into hlt.pgo.*.dat files. The file format is textual,
+/// with one line per function listing its name, the hash of its control
+/// flow graph, the number of basic blocks, and then the blocks' counts.
+/// Merged profiles use the same format.
+class ProfileData {
+public:
+    /// The counts recorded for a single function.
+    struct Function {
+        uint64_t hash = 0;            /// Hash of the function's control flow graph.
+        std::vector<uint64_t> counts; /// Execution counts of the basic blocks; the first is the
+                                      /// function's entry count.
+    };
+
+    typedef std::map<string, Function> function_map;
+
+    /// Reads a profile from a file, merging it into the current data. Counts
+    /// of functions already known are summed up as long as the hash of
+    /// their control flow graph matches. Otherwise, the function with the
+    /// higher entry count wins.
+    ///
+    /// path: The file to read.
+    ///
+    /// error: Set to an error message if reading fails.
+    ///
+    /// Returns: True on success.
+    bool read(const string& path, string* error);
+
+    /// Writes the profile out in the same format that read() expects.
+    ///
+    /// out: The stream to write to.
+    void write(std::ostream& out) const;
+
+    /// Returns the counts for all functions, indexed by their LLVM-level
+    /// name.
+    const function_map& functions() const;
+
+    /// Returns the highest entry count of all functions.
+    uint64_t maxEntryCount() const;
+
+    /// Computes the hash of a function's control flow graph that is used to
+    /// check whether counts still apply to it.
+    ///
+    /// func: The function.
+    static uint64_t hash(const llvm::Function& func);
+
+private:
+    function_map _functions;
+};
+}
+}
+
+#endif
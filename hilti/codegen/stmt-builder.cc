@@ -292,6 +292,17 @@ void StatementBuilder::visit(declaration::Function* f)
     auto name =
         ::util::fmt("%s::%s", cg()->hiltiModule()->id()->name().c_str(), f->id()->name().c_str());
 
+    if ( cg()->options().perf_map || cg()->options().perf_jitdump ) {
+        // Record the HILTI-level name for external profilers.
+        auto sname = name;
+
+        if ( hook_decl )
+            sname = "hook " + (f->id()->isScoped() ? f->id()->pathAsString() : name);
+
+        llvm_func->addFnAttr(symbols::AttrName, sname);
+        llvm_func->addFnAttr(symbols::AttrLocation, string(f->location()));
+    }
+
     if ( cg()->options().debug )
         cg()->llvmDebugPrint("hilti-flow", string("entering ") + name);
 
@@ -327,21 +338,9 @@ void StatementBuilder::visit(declaration::Function* f)
         cg()->llvmReturn(0, cg()->llvmConstInt(0, 1)); // Return false.
         cg()->popBuilder();
 
-        cg()->pushBuilder(cont);
-
-        // Check whether the hook's group is enabled.
-        CodeGen::expr_list args{
-            builder::integer::create(ftype->attributes().getAsInt(attribute::GROUP, 0))};
-        auto cont2 = cg()->llvmCall("hlt::hook_group_is_enabled", args, false, false);
-
-        auto disabled = cg()->pushBuilder("disabled");
-        cg()->llvmReturn(0, cg()->llvmConstInt(0, 1)); // Return false.
-        cg()->popBuilder();
-
-        auto enabled = cg()->newBuilder("enabled");
-        cg()->llvmCreateCondBr(cont2, enabled, disabled);
-
-        cg()->pushBuilder(enabled); // Leave on stack.
+        // Note that the linker checks whether the hook's group is enabled
+        // before calling us.
+        cg()->pushBuilder(cont); // Leave on stack.
     }
 
     auto body = cg()->newBuilder("body");
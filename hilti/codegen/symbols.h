@@ -20,10 +20,18 @@ static const char* MetaGlobalsInit = "hlt.globals.init";
 static const char* MetaGlobalsDtor = "hlt.globals.dtor";
 static const char* MetaHookDecls = "hlt.hook.decls";
 static const char* MetaHookImpls = "hlt.hook.impls";
+static const char* MetaProfilerTags = "hlt.profiler.tags";
 
 static const char* TypeGlobals = "hlt.globals.type";
 static const char* FuncGlobalsBase = "hlt.globals.base";
 
+// Prefix for the placeholders that the linker sets to a profiler tag's ID.
+static const char* GlobalProfilerID = "hlt.profiler.id";
+
+// Prefix for the placeholders that the linker sets to whether a hook has any
+// implementations.
+static const char* GlobalHookImplemented = "hlt.hook.implemented";
+
 // Indices of fields in MetaModule.
 static const int MetaModuleVersion = 0;
 static const int MetaModuleID = 1;
@@ -35,6 +43,18 @@ static const char* FunctionGlobalsInit = "__hlt_globals_init";
 static const char* FunctionGlobalsDtor = "__hlt_globals_dtor";
 static const char* FunctionModulesInit = "__hlt_modules_init";
 static const char* FunctionGlobalsSize = "__hlt_globals_size";
+static const char* FunctionProfilerTags = "__hlt_profiler_tags";
+
+// Symbols created by the optimizer for access by libhilti.
+static const char* FunctionPGOData = "__hlt_pgo_data";
+
+// Function attribute recording the module a function was linked in from.
+static const char* AttrPartition = "hlt.partition";
+
+// Function attributes recording HILTI-level symbol information for external
+// profilers.
+static const char* AttrName = "hlt.name";
+static const char* AttrLocation = "hlt.location";
 
 // Names for argument added internally for our calling conventions.
 static const char* ArgExecutionContext = "__ctx";
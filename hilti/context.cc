@@ -1,5 +1,11 @@
 
+#include <errno.h>
 #include <fstream>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <util/thread-pool.h>
 #include <util/util.h>
 
 // LLVM redefines the DEBUG macro. Sigh.
@@ -17,6 +23,8 @@
 
 #include "codegen/asm-annotater.h"
 #include "codegen/optimizer.h"
+#include "codegen/partitioner.h"
+#include "codegen/util.h"
 #include "hilti-intern.h"
 #include "hilti/autogen/hilti-config.h"
 #include "jit.h"
@@ -534,9 +542,7 @@ std::list<std::unique_ptr<llvm::Module>> CompilerContext::checkCache(
     const ::util::cache::FileCache::Key& key)
 {
     std::list<std::unique_ptr<llvm::Module>> outputs;
-    return outputs;
 
-#if 0
     if ( ! _cache )
         return outputs;
 
@@ -544,58 +550,52 @@ std::list<std::unique_ptr<llvm::Module>> CompilerContext::checkCache(
 
     int idx = 0;
 
-    for ( auto d : data ) {
+    for ( auto& d : data ) {
         _beginPass(key.name, "LoadFromCache");
 
-        auto mb = llvm::MemoryBuffer::getMemBuffer(d);
-        assert(mb);
+        auto mb = llvm::MemoryBuffer::getMemBuffer(d, "", false);
+        auto mod = llvm::parseBitcodeFile(mb->getMemBufferRef(), llvmContext());
 
-        string err;
-        llvm::LLVMContext llvm_context;
+        _endPass();
 
-        if ( auto mod = llvm::parseBitcodeFile(mb->getMemBufferRef(), llvm_context) ) {
+        if ( ! mod ) {
+            // Treat a partially unusable entry as a miss altogether.
             if ( options().cgDebugging("cache") )
-                std::cerr << util::fmt("Reusing cached module for %s.%s (%d/%d)", key.name,
+                std::cerr << util::fmt("Cached module for %s.%s (%d/%d) did not load", key.name,
                                        key.scope, ++idx, data.size())
                           << std::endl;
 
-            _endPass();
-            outputs.push_back(mod->get());
+            outputs.clear();
+            return outputs;
         }
-        else {
-            _endPass();
 
-            if ( options().cgDebugging("cache") )
-                std::cerr << util::fmt("Cached module for %s.%s (%d/%d) did not compile", key.name,
-                                       key.scope, ++idx, data.size())
-                          << std::endl;
-        }
+        if ( options().cgDebugging("cache") )
+            std::cerr << util::fmt("Reusing cached module for %s.%s (%d/%d)", key.name,
+                                   key.scope, ++idx, data.size())
+                      << std::endl;
+
+        outputs.push_back(std::move(mod.get()));
     }
 
     if ( options().cgDebugging("cache") && ! outputs.size() )
         std::cerr << util::fmt("No cached module for %s.%s", key.name, key.scope) << std::endl;
 
     return outputs;
-#endif
 }
 
 void CompilerContext::updateCache(const ::util::cache::FileCache::Key& key,
-                                  std::unique_ptr<llvm::Module> module)
+                                  const llvm::Module* module)
 {
-#if 0
-    return updateCache(key, {module});
-#endif
+    std::list<const llvm::Module*> modules = {module};
+    updateCache(key, modules);
 }
 
 void CompilerContext::updateCache(const ::util::cache::FileCache::Key& key,
-                                  std::list<std::unique_ptr<llvm::Module>> modules)
+                                  const std::list<const llvm::Module*>& modules)
 {
     if ( ! _cache )
         return;
 
-    return;
-
-#if 0
     std::list<string> outputs;
 
     for ( auto m : modules ) {
@@ -606,17 +606,63 @@ void CompilerContext::updateCache(const ::util::cache::FileCache::Key& key,
         string out;
         llvm::raw_string_ostream llvm_out(out);
         llvm::WriteBitcodeToFile(m, llvm_out);
-        outputs.push_back(string(llvm_out.str()));
+        outputs.push_back(llvm_out.str());
     }
 
     _cache->store(key, outputs);
-#endif
+}
+
+::util::cache::FileCache::Key CompilerContext::cacheKey(const string& scope, const string& name)
+{
+    ::util::cache::FileCache::Key key;
+    key.scope = scope;
+    key.name = util::toIdentifier(name);
+    options().toCacheKey(&key);
+
+    // Output of different compiler versions must never mix.
+    key.hashes.insert(::util::cache::hash(configuration().version));
+
+    return key;
+}
+
+// Returns the IDs that a source file imports. We scan the source textually
+// rather than parsing it so that we can determine dependencies without
+// building an AST.
+static std::list<string> _importsOf(const string& path)
+{
+    std::list<string> imports;
+    std::ifstream in(path);
+    string line;
+
+    while ( std::getline(in, line) ) {
+        auto m = util::strsplit(util::strtrim(line));
+
+        if ( m.size() < 2 || m.front() != "import" )
+            continue;
+
+        auto id = *(++m.begin());
+
+        if ( util::endsWith(id, ";") )
+            id = id.substr(0, id.size() - 1);
+
+        imports.push_back(id);
+    }
+
+    return imports;
+}
+
+static void _addFileToCacheKey(const string& path, ::util::cache::FileCache::Key* key)
+{
+    key->files.insert(path);
+
+    std::ifstream in(path);
+    key->hashes.insert(::util::cache::hash(in));
 }
 
 void CompilerContext::toCacheKey(shared_ptr<Module> module, ::util::cache::FileCache::Key* key)
 {
     if ( module->path() != "-" )
-        key->files.insert(module->path());
+        _addFileToCacheKey(module->path(), key);
 
     else {
         std::ostringstream s;
@@ -626,7 +672,7 @@ void CompilerContext::toCacheKey(shared_ptr<Module> module, ::util::cache::FileC
     }
 
     for ( auto d : dependencies(module) )
-        key->files.insert(d);
+        _addFileToCacheKey(d, key);
 }
 
 void CompilerContext::toCacheKey(const llvm::Module* module, ::util::cache::FileCache::Key* key)
@@ -635,17 +681,61 @@ void CompilerContext::toCacheKey(const llvm::Module* module, ::util::cache::File
     llvm::raw_string_ostream llvm_out(out);
     llvm::WriteBitcodeToFile(module, llvm_out);
 
-    // We take the size as hash. That's not ideal but (1) the output of
-    // neither bitcode nor assemly writer is stable, (2) writing the whole
-    // module is also pretty slow.
-    auto hash = util::cache::hash(llvm_out.str().size());
+    // The bitcode writer's output is deterministic for a given module and
+    // LLVM version, which is all we need as the latter is part of the key
+    // through our own version.
+    auto hash = util::cache::hash(llvm_out.str());
     key->hashes.insert(hash);
 }
 
+string CompilerContext::_findModule(const string& id)
+{
+    auto p = util::strtolower(id);
+
+    if ( ! util::endsWith(p, ".hlt") )
+        p += ".hlt";
+
+    auto full_path = util::findInPaths(p, options().libdirs_hlt);
+
+    if ( full_path.empty() )
+        return "";
+
+    char buf[PATH_MAX];
+    if ( ! realpath(full_path.c_str(), buf) )
+        return "";
+
+    return buf;
+}
+
+void CompilerContext::_dependencies(const std::list<string>& imports, std::set<string>* deps)
+{
+    for ( auto i : imports ) {
+        auto path = _findModule(i);
+
+        // Unknown imports will fail compilation later, so we can just skip
+        // them here.
+        if ( path.empty() || deps->find(path) != deps->end() )
+            continue;
+
+        deps->insert(path);
+        _dependencies(_importsOf(path), deps);
+    }
+}
+
 std::list<string> CompilerContext::dependencies(shared_ptr<Module> module)
 {
-    // TODO: Not implementated.
-    return std::list<string>();
+    std::list<string> imports;
+
+    for ( auto i : module->importedIDs() )
+        imports.push_back(i->pathAsString());
+
+    std::set<string> deps;
+    _dependencies(imports, &deps);
+
+    if ( module->path() != "-" )
+        deps.erase(module->path());
+
+    return std::list<string>(deps.begin(), deps.end());
 }
 
 std::string CompilerContext::llvmGetModuleIdentifier(llvm::Module* module)
@@ -653,7 +743,162 @@ std::string CompilerContext::llvmGetModuleIdentifier(llvm::Module* module)
     return codegen::CodeGen::llvmGetModuleIdentifier(module);
 }
 
+std::unique_ptr<llvm::Module> CompilerContext::compile(const string& path)
+{
+    char buf[PATH_MAX];
+    if ( ! realpath(path.c_str(), buf) ) {
+        error(util::fmt("error reading %s: %s", path, strerror(errno)));
+        return nullptr;
+    }
+
+    auto key = cacheKey("hlt", util::basename(buf));
+
+    if ( _cache ) {
+        // Determine the key without parsing so that a cache hit skips
+        // everything but loading the bitcode.
+        std::set<string> deps;
+        _dependencies(_importsOf(buf), &deps);
+        deps.erase(buf);
+
+        _addFileToCacheKey(buf, &key);
+
+        for ( auto d : deps )
+            _addFileToCacheKey(d, &key);
+
+        auto cached = checkCache(key);
+
+        if ( cached.size() == 1 )
+            return std::move(cached.front());
+    }
+
+    auto module = loadModule(buf);
+
+    if ( ! module )
+        return nullptr;
+
+    return compile(module, key);
+}
+
+std::list<std::unique_ptr<llvm::Module>> CompilerContext::compile(const std::list<string>& paths,
+                                                                  unsigned int threads)
+{
+    std::list<compile_job> jobs;
+
+    for ( auto p : paths )
+        jobs.push_back([p](CompilerContext* ctx) { return ctx->compile(p); });
+
+    return _compileConcurrently(jobs, threads);
+}
+
+std::list<std::unique_ptr<llvm::Module>> CompilerContext::compile(
+    const std::list<shared_ptr<Module>>& modules, unsigned int threads)
+{
+    std::list<compile_job> jobs;
+
+    // The code generator takes the LLVM context from the compiler context
+    // it's running in, not the module's.
+    for ( auto m : modules )
+        jobs.push_back([m](CompilerContext* ctx) { return ctx->compile(m); });
+
+    return _compileConcurrently(jobs, threads);
+}
+
+std::list<std::unique_ptr<llvm::Module>> CompilerContext::_compileConcurrently(
+    const std::list<compile_job>& jobs, unsigned int threads)
+{
+    std::list<std::unique_ptr<llvm::Module>> outputs;
+
+    // Contexts are set up here in the main thread as that touches global
+    // state.
+    std::vector<shared_ptr<CompilerContext>> contexts;
+    std::vector<string> bitcode(jobs.size());
+
+    for ( unsigned int i = 0; i < jobs.size(); i++ )
+        contexts.push_back(std::make_shared<CompilerContext>(_options));
+
+    if ( options().cgDebugging("context") )
+        std::cerr << util::fmt("Compiling %d modules concurrently ...", jobs.size()) << std::endl;
+
+    _beginPass("<concurrent>", "CodeGen");
+
+    {
+        ::util::ThreadPool pool(threads);
+
+        int idx = 0;
+
+        for ( auto& job : jobs ) {
+            auto ctx = contexts[idx];
+            auto out = &bitcode[idx++];
+
+            pool.schedule([job, ctx, out]() {
+                auto compiled = job(ctx.get());
+
+                if ( ! compiled )
+                    return;
+
+                // Serialize the module so that it can be read back into the
+                // target LLVM context.
+                llvm::raw_string_ostream llvm_out(*out);
+                llvm::WriteBitcodeToFile(compiled.get(), llvm_out);
+                llvm_out.flush();
+            });
+        }
+
+        pool.wait();
+    }
+
+    _endPass();
+
+    for ( auto& b : bitcode ) {
+        if ( b.empty() ) {
+            error("concurrent compilation failed");
+            outputs.clear();
+            return outputs;
+        }
+
+        auto mb = llvm::MemoryBuffer::getMemBuffer(b, "", false);
+        auto mod = llvm::parseBitcodeFile(mb->getMemBufferRef(), llvmContext());
+
+        if ( ! mod ) {
+            error(util::fmt("cannot read compiled module: %s", mod.getError().message()));
+            outputs.clear();
+            return outputs;
+        }
+
+        outputs.push_back(std::move(mod.get()));
+    }
+
+    return outputs;
+}
+
 std::unique_ptr<llvm::Module> CompilerContext::compile(shared_ptr<Module> module)
+{
+    if ( ! _cache )
+        return _compile(module);
+
+    auto key = cacheKey("hlt", module->id()->name());
+    toCacheKey(module, &key);
+
+    auto cached = checkCache(key);
+
+    if ( cached.size() == 1 )
+        return std::move(cached.front());
+
+    return compile(module, key);
+}
+
+std::unique_ptr<llvm::Module> CompilerContext::compile(shared_ptr<Module> module,
+                                                       const ::util::cache::FileCache::Key& key)
+{
+    auto compiled = _compile(module);
+
+    if ( compiled )
+        updateCache(key, compiled.get());
+
+    return compiled;
+}
+
+std::unique_ptr<llvm::Module> CompilerContext::_compile(shared_ptr<Module> module)
 {
     // module->dump(std::cerr);
 
@@ -718,6 +963,118 @@ bool CompilerContext::writeBitcode(llvm::Module* module, std::ostream& out)
     return true;
 }
 
+// Runs a program with the given arguments, without going through the shell.
+// Returns its exit status, or -1 if it couldn't be run, and leaves what it
+// wrote to stdout and stderr in output.
+static int _runProgram(const std::list<string>& args, string* output)
+{
+    int fds[2];
+
+    if ( ::pipe(fds) < 0 ) {
+        *output = "cannot create pipe";
+        return -1;
+    }
+
+    std::vector<char*> argv;
+
+    for ( auto& a : args )
+        argv.push_back(const_cast<char*>(a.c_str()));
+
+    argv.push_back(nullptr);
+
+    auto pid = ::fork();
+
+    if ( pid < 0 ) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        *output = "cannot fork";
+        return -1;
+    }
+
+    if ( pid == 0 ) {
+        ::dup2(fds[1], 1);
+        ::dup2(fds[1], 2);
+        ::close(fds[0]);
+        ::close(fds[1]);
+        ::execvp(argv[0], argv.data());
+        ::fprintf(stderr, "cannot execute %s: %s\n", argv[0], strerror(errno));
+        ::_exit(127);
+    }
+
+    ::close(fds[1]);
+
+    char buffer[4096];
+    ssize_t n;
+
+    while ( (n = ::read(fds[0], buffer, sizeof(buffer))) != 0 ) {
+        if ( n < 0 ) {
+            if ( errno == EINTR )
+                continue;
+
+            break;
+        }
+
+        output->append(buffer, n);
+    }
+
+    ::close(fds[0]);
+
+    int status;
+
+    while ( ::waitpid(pid, &status, 0) < 0 ) {
+        if ( errno != EINTR )
+            return -1;
+    }
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+bool CompilerContext::buildSharedLibrary(llvm::Module* module, const string& path)
+{
+    auto bc = path + ".tmp.bc";
+
+    std::ofstream out(bc);
+
+    if ( ! out ) {
+        error(util::fmt("cannot open %s for writing", bc));
+        return false;
+    }
+
+    writeBitcode(module, out);
+    out.close();
+
+    // With -Bsymbolic, the library keeps using its own copy of the runtime,
+    // just like JITed code does. The host then connects that to its own
+    // state through __hlt_runtime_state_set().
+    std::list<string> args = {configuration().path_clang, "-shared", "-fPIC", "-Wl,-Bsymbolic",
+                              "-o", path, bc};
+
+    if ( options().optimize )
+        args.push_back("-O2");
+
+    for ( auto f : configuration().runtime_ldflags )
+        args.push_back(f);
+
+    for ( auto l : configuration().runtime_shared_libraries )
+        args.push_back("-l" + l);
+
+    if ( options().cgDebugging("context") )
+        std::cerr << "Building shared library: " << util::strjoin(args, " ") << std::endl;
+
+    string output;
+    auto rc = _runProgram(args, &output);
+    ::unlink(bc.c_str());
+
+    if ( rc != 0 ) {
+        auto status = (rc < 0 ? string("could not run compiler") : util::fmt("exit status %d", rc));
+        error(util::fmt("building shared library %s failed (%s)%s%s", path, status,
+                        output.size() ? ":\n" : "", output));
+        return false;
+    }
+
+    return true;
+}
+
 std::unique_ptr<llvm::Module> CompilerContext::linkModules(
     string output, std::list<std::unique_ptr<llvm::Module>>& modules, std::list<string> libs,
     path_list bcas, path_list dylds, bool add_stdlibs, bool add_sharedlibs)
@@ -813,6 +1170,32 @@ std::unique_ptr<llvm::Module> CompilerContext::linkModules(
                   << std::endl;
     }
 
+    // The linked module is cached after optimization, keyed by the content
+    // of all inputs.
+    auto key = cacheKey("linked", util::basename(output));
+
+    if ( _cache ) {
+        for ( auto& m : modules )
+            toCacheKey(m.get(), &key);
+
+        for ( auto l : libs )
+            key.hashes.insert(::util::cache::hash(l));
+
+        for ( auto b : bcas )
+            key.files.insert(b);
+
+        if ( add_stdlibs )
+            key.files.insert(options().debug ? configuration().runtime_library_bca_dbg :
+                                               configuration().runtime_library_bca);
+
+        auto cached = checkCache(key);
+
+        if ( cached.size() == 1 ) {
+            modules.clear();
+            return std::move(cached.front());
+        }
+    }
+
     _beginPass(output, linker);
 
     auto linked = linker.link(output, modules);
@@ -822,15 +1205,43 @@ std::unique_ptr<llvm::Module> CompilerContext::linkModules(
 
     _endPass();
 
-    return _optimize(std::move(linked), true);
+    auto optimized = _optimize(std::move(linked), true);
+
+    if ( optimized )
+        updateCache(key, optimized.get());
+
+    return optimized;
 }
 
 std::unique_ptr<llvm::Module> CompilerContext::_optimize(std::unique_ptr<llvm::Module> module,
                                                          bool is_linked)
 {
+    if ( is_linked && options().frame_pointers ) {
+        // Keep the frame pointers so that the runtime's sampling profiler
+        // can walk the stack.
+        for ( auto& f : module->functions() ) {
+            if ( ! f.isDeclaration() )
+                f.addFnAttr("no-frame-pointer-elim", "true");
+        }
+    }
+
+    if ( is_linked && options().pgo_generate ) {
+        codegen::Optimizer optimizer(this);
+
+        _beginPass(module->getModuleIdentifier(), "PGO instrumentation");
+
+        if ( ! optimizer.instrument(module.get()) )
+            return nullptr;
+
+        _endPass();
+    }
+
     if ( ! options().optimize )
         return module;
 
+    if ( is_linked && options().thin_link )
+        return _optimizeThin(std::move(module));
+
     if ( options().cgDebugging("context") )
         std::cerr << "Optimizing final linked module ... " << std::endl;
 
@@ -845,6 +1256,140 @@ std::unique_ptr<llvm::Module> CompilerContext::_optimize(std::unique_ptr<llvm::M
     return nmodule;
 }
 
+std::unique_ptr<llvm::Module> CompilerContext::_optimizeThin(std::unique_ptr<llvm::Module> module)
+{
+    if ( options().cgDebugging("context") )
+        std::cerr << "Optimizing final linked module by partition ... " << std::endl;
+
+    codegen::Partitioner partitioner(this);
+
+    _beginPass(module->getModuleIdentifier(), partitioner);
+    auto partitions = partitioner.split(module.get());
+    _endPass();
+
+    if ( partitions.empty() )
+        return nullptr;
+
+    // Optimize the partitions concurrently, each in a separate context as
+    // with compilation. Partitions that haven't changed since last time
+    // come out of the cache.
+    std::vector<::util::cache::FileCache::Key> keys;
+    std::vector<std::unique_ptr<llvm::Module>> optimized(partitions.size());
+    std::vector<string> bitcode(partitions.size());
+    std::vector<bool> cached(partitions.size());
+
+    int idx = 0;
+
+    for ( auto& p : partitions ) {
+        llvm::raw_string_ostream llvm_out(bitcode[idx]);
+        llvm::WriteBitcodeToFile(p.module.get(), llvm_out);
+        llvm_out.flush();
+
+        auto key = cacheKey("partition", p.name);
+        key.hashes.insert(::util::cache::hash(bitcode[idx]));
+        keys.push_back(key);
+
+        auto hit = checkCache(key);
+
+        if ( hit.size() == 1 ) {
+            optimized[idx] = std::move(hit.front());
+            bitcode[idx].clear();
+            cached[idx] = true;
+        }
+
+        ++idx;
+    }
+
+    partitions.clear();
+
+    std::vector<shared_ptr<CompilerContext>> contexts;
+
+    for ( unsigned int i = 0; i < bitcode.size(); i++ )
+        contexts.push_back(cached[i] ? nullptr : std::make_shared<CompilerContext>(_options));
+
+    _beginPass("<concurrent>", "Optimizer");
+
+    {
+        ::util::ThreadPool pool(options().thin_link_threads);
+
+        for ( unsigned int i = 0; i < bitcode.size(); i++ ) {
+            if ( cached[i] )
+                continue;
+
+            auto ctx = contexts[i];
+            auto bc = &bitcode[i];
+
+            pool.schedule([ctx, bc]() {
+                auto mb = llvm::MemoryBuffer::getMemBuffer(*bc, "", false);
+                auto mod = llvm::parseBitcodeFile(mb->getMemBufferRef(), ctx->llvmContext());
+
+                bc->clear();
+
+                if ( ! mod )
+                    return;
+
+                codegen::Optimizer optimizer(ctx.get());
+                auto nmodule = optimizer.optimize(std::move(mod.get()), true);
+
+                if ( ! nmodule )
+                    return;
+
+                llvm::raw_string_ostream llvm_out(*bc);
+                llvm::WriteBitcodeToFile(nmodule.get(), llvm_out);
+                llvm_out.flush();
+            });
+        }
+
+        pool.wait();
+    }
+
+    _endPass();
+
+    for ( unsigned int i = 0; i < bitcode.size(); i++ ) {
+        if ( cached[i] )
+            continue;
+
+        if ( bitcode[i].empty() ) {
+            error(util::fmt("optimizing partition %s failed", keys[i].name));
+            return nullptr;
+        }
+
+        auto mb = llvm::MemoryBuffer::getMemBuffer(bitcode[i], "", false);
+        auto mod = llvm::parseBitcodeFile(mb->getMemBufferRef(), llvmContext());
+
+        if ( ! mod ) {
+            error(util::fmt("cannot read optimized partition: %s", mod.getError().message()));
+            return nullptr;
+        }
+
+        optimized[i] = std::move(mod.get());
+        updateCache(keys[i], optimized[i].get());
+    }
+
+    // Link the optimized partitions back together. They don't need any of
+    // our custom linker's processing anymore.
+    auto linked = std::make_unique<llvm::Module>(module->getModuleIdentifier(), llvmContext());
+    linked->setDataLayout(module->getDataLayout());
+    linked->setTargetTriple(module->getTargetTriple());
+
+    llvm::Linker linker(*linked);
+
+    for ( auto& m : optimized ) {
+        // Sic. This returns true on error ...
+        if ( linker.linkInModule(std::move(m)) ) {
+            error("linking optimized partitions failed");
+            return nullptr;
+        }
+    }
+
+    if ( options().verify && ! codegen::util::llvmVerifyModule(linked.get()) ) {
+        error("verification of optimized module failed");
+        return nullptr;
+    }
+
+    return linked;
+}
+
 bool CompilerContext::_jit(std::unique_ptr<llvm::Module> module, JIT* jit)
 {
     if ( ! options().jit ) {
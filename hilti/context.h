@@ -1,6 +1,8 @@
 #ifndef HILTI_CONTEXT_H
 #define HILTI_CONTEXT_H
 
+#include <functional>
+
 #include <ast/logger.h>
 #include <util/file-cache.h>
 
@@ -135,10 +137,56 @@ public:
     ///
     /// key: The cache key to store the compiled module under.
     ///
-    /// Returns: The HILTI module, or null if errors are encountered. Passes
+    /// Returns: The LLVM module, or null if errors are encountered. Passes
+    /// ownership to the caller.
+    std::unique_ptr<llvm::Module> compile(shared_ptr<Module> module,
+                                          const ::util::cache::FileCache::Key& key);
+
+    /// Compiles a HILTI source file into a LLVM module. This is a
+    /// combination of loadModule() and compile(). If caching is enabled, it
+    /// first determines the file's dependencies without parsing it, and
+    /// returns a cached copy if neither the file nor any of its dependencies
+    /// has changed. After compilation, the module needs to be linked with
+    /// linkModules().
+    ///
+    /// path: The path of the source file.
+    ///
+    /// Returns: The LLVM module, or null if errors are encountered. Passes
     /// ownership to the caller.
-    std::unique_ptr<Module> compile(shared_ptr<Module> module,
-                                    const ::util::cache::FileCache::Key& key);
+    std::unique_ptr<llvm::Module> compile(const string& path);
+
+    /// Compiles a set of HILTI source files concurrently. Each file is
+    /// loaded and compiled in a separate context with its own LLVM context
+    /// on a pool of threads; the results are then moved over into this
+    /// context for linking with linkModules(). The cache is used as with
+    /// compile(const string&).
+    ///
+    /// paths: The paths of the source files.
+    ///
+    /// threads: The number of threads to use; zero selects the number of
+    /// hardware threads available.
+    ///
+    /// Returns: The LLVM modules in the same order as *paths*, or an empty
+    /// list if errors are encountered with any of them. Passes ownership to
+    /// the caller.
+    std::list<std::unique_ptr<llvm::Module>> compile(const std::list<string>& paths,
+                                                     unsigned int threads);
+
+    /// Compiles a set of finalized ASTs into LLVM modules concurrently.
+    /// This works like compile(const std::list<string>&, unsigned int) but
+    /// takes already finalized modules, which must not be modified while
+    /// compilation is in progress.
+    ///
+    /// modules: The modules to compile.
+    ///
+    /// threads: The number of threads to use; zero selects the number of
+    /// hardware threads available.
+    ///
+    /// Returns: The LLVM modules in the same order as *modules*, or an empty
+    /// list if errors are encountered with any of them. Passes ownership to
+    /// the caller.
+    std::list<std::unique_ptr<llvm::Module>> compile(const std::list<shared_ptr<Module>>& modules,
+                                                     unsigned int threads);
 
     /// Renders an AST back into HILTI source code.
     ///
@@ -177,6 +225,19 @@ public:
     /// out: The stream to print LLVM bitcode to.
     bool writeBitcode(llvm::Module* module, std::ostream& out);
 
+    /// Compiles an LLVM module returned by linkModules() into a native
+    /// shared library. This runs the system's compiler driver on the
+    /// module's bitcode, linking against the libraries that the runtime
+    /// needs. A host application can then load the library with dlopen()
+    /// instead of JITing the module.
+    ///
+    /// module: The LLVM module to compile.
+    ///
+    /// path: The path of the shared library to write.
+    ///
+    /// Returns: True if no errors were encountered.
+    bool buildSharedLibrary(llvm::Module* module, const string& path);
+
     /// Links a set of modules with HILTI's custom linker. All modules produced
     /// by compileModule() must be linked (and all together that will run as one
     /// executable). A module must not be linked more than once.
@@ -238,29 +299,39 @@ public:
     ///
     /// Returns: The cached modules if available, or an empty list if not.
     /// The latter will always be the case if the context is not using
-    /// caching.
-    ///
-    /// TODO: Disabled. Always returns an empty list current.
+    /// caching. Modules are loaded into the context's LLVM context.
     std::list<std::unique_ptr<llvm::Module>> checkCache(const ::util::cache::FileCache::Key& key);
 
-    /// TODO: Disabled. Always returns an empty list current.
+    /// Stores/updates cached versions of a set of LLVM modules.
+    ///
+    /// The method is a no-op if the context doesn't use caching.
+    ///
+    /// key: The key to associate with the modules.
+    ///
+    /// modules: The modules to cache under \a key.
     void updateCache(const ::util::cache::FileCache::Key& key,
-                     std::list<std::unique_ptr<llvm::Module>> module);
+                     const std::list<const llvm::Module*>& modules);
 
     /// Stores/updates cached version of a single LLVM module.
     ///
+    /// The method is a no-op if the context doesn't use caching.
+    ///
     /// key: The key to associate with the module.
     ///
-    /// module: THe module to cache under \a key.
+    /// module: The module to cache under \a key.
+    void updateCache(const ::util::cache::FileCache::Key& key, const llvm::Module* module);
+
+    /// Returns a new cache key for a given scope and name, prepopulated
+    /// with the context's options and the compiler version.
     ///
-    /// TODO: Disabled. Always returns an empty list current.
-    void updateCache(const ::util::cache::FileCache::Key& key,
-                     std::unique_ptr<llvm::Module> module);
+    /// scope: The key's scope.
+    ///
+    /// name: The key's name. This will be turned into a valid identifier.
+    ::util::cache::FileCache::Key cacheKey(const string& scope, const string& name);
 
     /// Augments the cache key with values suitable to check if a HILTI
-    /// module (or any of its dependencies) has changed.
-    ///
-    /// \todo Dependencies aren't tracked yet.
+    /// module (or any of its dependencies) has changed. This adds the
+    /// content hashes of all files involved.
     ///
     /// module: The module to update the key for.
     ///
@@ -275,10 +346,8 @@ public:
     /// key: The key to update.
     void toCacheKey(const llvm::Module* module, ::util::cache::FileCache::Key* key);
 
-    /// Returns a list of path names that this module depends on.
-    ///
-    /// \todo This is actually not yet implemented and always returns an
-    /// empty list currently.
+    /// Returns a list of path names that this module depends on. This
+    /// follows imports transitively.
     std::list<string> dependencies(shared_ptr<Module> module);
 
     /// Returns the name of an LLVM module. This first looks for
@@ -294,6 +363,25 @@ protected:
     bool _jit(std::unique_ptr<llvm::Module> module, JIT* jit);
 
 private:
+    typedef std::function<std::unique_ptr<llvm::Module>(CompilerContext* ctx)> compile_job;
+
+    /// Compiles an AST into a LLVM module without consulting the cache.
+    std::unique_ptr<llvm::Module> _compile(shared_ptr<Module> module);
+
+    /// Runs a set of compile jobs on a thread pool, each with a separate
+    /// context, and moves the results over into this context.
+    std::list<std::unique_ptr<llvm::Module>> _compileConcurrently(
+        const std::list<compile_job>& jobs, unsigned int threads);
+
+    /// Searches a module by its ID along the library path, without
+    /// reporting an error if not found. Returns the full path, or an empty
+    /// string if not found.
+    string _findModule(const string& id);
+
+    /// Recursively resolves a list of imported IDs into the paths of all
+    /// modules they depend on, adding them to *deps*.
+    void _dependencies(const std::list<string>& imports, std::set<string>* deps);
+
     /// Optimizes an LLVM module according to the CompilerContext's options
     /// (including not at all if the options don't request optimization).
     ///
@@ -305,6 +393,10 @@ private:
     /// Returns: A new optimized module if successful.
     std::unique_ptr<llvm::Module> _optimize(std::unique_ptr<llvm::Module> module, bool is_linked);
 
+    /// Optimizes the final linked module per partition, as selected by
+    /// Options::thin_link. Returns a new optimized module if successful.
+    std::unique_ptr<llvm::Module> _optimizeThin(std::unique_ptr<llvm::Module> module);
+
     // Backend for finalize().
     bool _finalize(shared_ptr<Module> module, bool verify);
 
@@ -121,6 +121,23 @@ iBegin(map::New, "new")
 iEnd
 
 
+iBegin(map::Bytes, "map.bytes")
+    iTarget(optype::int64);
+    iOp1(optype::refMap, true);
+
+    iValidate
+    {
+    }
+
+    iDoc(R"(
+        Returns the approximate number of bytes the entries of map *op1*
+        occupy. This includes the map's per-entry overhead, but not any
+        memory that the entries reference. *map.limit_bytes* bounds this
+        value.
+    )")
+
+iEnd
+
 iBegin(map::Clear, "map.clear")
     iOp1(optype::refMap, false);
 
@@ -164,6 +181,50 @@ iBegin(map::Default, "map.default")
 
 iEnd
 
+iBegin(map::EvictCallback, "map.evict_callback")
+    iOp1(optype::refMap, true);
+    iOp2(optype::refCallable, true);
+
+    iValidate
+    {
+        auto ctype = ast::rtti::checkedCast<type::Callable>(referencedType(op2));
+        auto params = ctype->Function::parameters();
+
+        if ( params.size() != 2 )
+            error(op1, "evict function must receive exactly two parameters");
+        else {
+            equalTypes(params.front()->type(), mapKeyType(referencedType(op1)));
+            equalTypes(params.back()->type(), mapValueType(referencedType(op1)));
+        }
+
+        if ( ! ast::rtti::isA<type::Void>(ctype->result()->type()) )
+            error(op2, "evict function must not return a value");
+    }
+
+    iDoc(R"(
+        Sets a callable *op2* receiving each evicted entry's key and value
+        from map *op1* because of a bound set by *map.limit* or
+        *map.limit_bytes*. The callable runs right before the entry is
+        removed, and must not modify the map.
+    )")
+
+iEnd
+
+iBegin(map::Evicted, "map.evicted")
+    iTarget(optype::int64);
+    iOp1(optype::refMap, true);
+
+    iValidate
+    {
+    }
+
+    iDoc(R"(
+        Returns the number of entries evicted from map *op1* so far because
+        of a bound set by *map.limit* or *map.limit_bytes*.
+    )")
+
+iEnd
+
 iBegin(map::Exists, "map.exists")
     iTarget(optype::boolean);
     iOp1(optype::refMap, true);
@@ -240,6 +301,50 @@ iBegin(map::Insert, "map.insert")
 
 iEnd
 
+iBegin(map::Limit, "map.limit")
+    iOp1(optype::refMap, true);
+    iOp2(optype::enum_, true);
+    iOp3(optype::int64, true);
+
+    iValidate
+    {
+        auto ty_op2 = ast::rtti::checkedCast<type::Enum>(op2->type());
+
+        // TODO: Check the enum.
+    }
+
+    iDoc(R"(
+        Bounds map *op1* to at most *op3* entries; zero removes the bound.
+        When an insert exceeds the bound, entries are evicted until it's met
+        again, using strategy *op2*: *EvictStrategy::LRU* removes the least
+        recently inserted or accessed entry first; *EvictStrategy::Clock*
+        approximates that at lower cost by giving recently accessed entries a
+        second chance; and *EvictStrategy::Random* removes arbitrary entries.
+        The entry being inserted is never evicted. Throws ValueError if *op3*
+        is negative.
+    )")
+
+iEnd
+
+iBegin(map::LimitBytes, "map.limit_bytes")
+    iOp1(optype::refMap, true);
+    iOp2(optype::enum_, true);
+    iOp3(optype::int64, true);
+
+    iValidate
+    {
+        auto ty_op2 = ast::rtti::checkedCast<type::Enum>(op2->type());
+
+        // TODO: Check the enum.
+    }
+
+    iDoc(R"(
+        Like *map.limit*, but bounds the number of bytes reported by
+        *map.bytes* to *op3* instead of the number of entries.
+    )")
+
+iEnd
+
 iBegin(map::Remove, "map.remove")
     iOp1(optype::refMap, false);
     iOp2(optype::any, true);
@@ -116,6 +116,23 @@ iBegin(set::New, "new")
 iEnd
 
 
+iBegin(set::Bytes, "set.bytes")
+    iTarget(optype::int64);
+    iOp1(optype::refSet, true);
+
+    iValidate
+    {
+    }
+
+    iDoc(R"(
+        Returns the approximate number of bytes the entries of set *op1*
+        occupy. This includes the set's per-entry overhead, but not any
+        memory that the entries reference. *set.limit_bytes* bounds this
+        value.
+    )")
+
+iEnd
+
 iBegin(set::Clear, "set.clear")
     iOp1(optype::refSet, false);
 
@@ -129,6 +146,48 @@ iBegin(set::Clear, "set.clear")
 
 iEnd
 
+iBegin(set::EvictCallback, "set.evict_callback")
+    iOp1(optype::refSet, true);
+    iOp2(optype::refCallable, true);
+
+    iValidate
+    {
+        auto ctype = ast::rtti::checkedCast<type::Callable>(referencedType(op2));
+        auto params = ctype->Function::parameters();
+
+        if ( params.size() != 1 )
+            error(op1, "evict function must receive exactly one parameter");
+        else
+            equalTypes(params.front()->type(), elementType(referencedType(op1)));
+
+        if ( ! ast::rtti::isA<type::Void>(ctype->result()->type()) )
+            error(op2, "evict function must not return a value");
+    }
+
+    iDoc(R"(
+        Sets a callable *op2* receiving each evicted element
+        from set *op1* because of a bound set by *set.limit* or
+        *set.limit_bytes*. The callable runs right before the entry is
+        removed, and must not modify the set.
+    )")
+
+iEnd
+
+iBegin(set::Evicted, "set.evicted")
+    iTarget(optype::int64);
+    iOp1(optype::refSet, true);
+
+    iValidate
+    {
+    }
+
+    iDoc(R"(
+        Returns the number of entries evicted from set *op1* so far because
+        of a bound set by *set.limit* or *set.limit_bytes*.
+    )")
+
+iEnd
+
 iBegin(set::Exists, "set.exists")
     iTarget(optype::boolean);
     iOp1(optype::refSet, true);
@@ -162,6 +221,50 @@ iBegin(set::Insert, "set.insert")
 
 iEnd
 
+iBegin(set::Limit, "set.limit")
+    iOp1(optype::refSet, true);
+    iOp2(optype::enum_, true);
+    iOp3(optype::int64, true);
+
+    iValidate
+    {
+        auto ty_op2 = ast::rtti::checkedCast<type::Enum>(op2->type());
+
+        // TODO: Check the enum.
+    }
+
+    iDoc(R"(
+        Bounds set *op1* to at most *op3* entries; zero removes the bound.
+        When an insert exceeds the bound, entries are evicted until it's met
+        again, using strategy *op2*: *EvictStrategy::LRU* removes the least
+        recently inserted or accessed entry first; *EvictStrategy::Clock*
+        approximates that at lower cost by giving recently accessed entries a
+        second chance; and *EvictStrategy::Random* removes arbitrary entries.
+        The entry being inserted is never evicted. Throws ValueError if *op3*
+        is negative.
+    )")
+
+iEnd
+
+iBegin(set::LimitBytes, "set.limit_bytes")
+    iOp1(optype::refSet, true);
+    iOp2(optype::enum_, true);
+    iOp3(optype::int64, true);
+
+    iValidate
+    {
+        auto ty_op2 = ast::rtti::checkedCast<type::Enum>(op2->type());
+
+        // TODO: Check the enum.
+    }
+
+    iDoc(R"(
+        Like *set.limit*, but bounds the number of bytes reported by
+        *set.bytes* to *op3* instead of the number of entries.
+    )")
+
+iEnd
+
 iBegin(set::Remove, "set.remove")
     iOp1(optype::refSet, false);
     iOp2(optype::any, true);
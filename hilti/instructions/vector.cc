@@ -118,6 +118,23 @@ iBegin(vector::New, "new")
 
 iEnd
 
+iBegin(vector::Append, "vector.append")
+    iOp1(optype::refVector, false);
+    iOp2(optype::refVector, true);
+
+    iValidate
+    {
+        equalTypes(referencedType(op1), referencedType(op2));
+    }
+
+    iDoc(R"(
+        Appends all elements of vector *op2* to vector *op1*. This is
+        equivalent to pushing them back one by one, but more efficient. *op2*
+        may be the same vector as *op1*.
+    )")
+
+iEnd
+
 iBegin(vector::Get, "vector.get")
     iTarget(optype::any);
     iOp1(optype::refVector, true);
@@ -6,6 +6,7 @@
 #endif
 
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 #include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
 #include "llvm/ExecutionEngine/Orc/LambdaResolver.h"
@@ -21,10 +22,14 @@
 #endif
 
 #include "codegen/common.h"
+#include "codegen/symbols.h"
+#include "context.h"
 #include "jit.h"
 #include "options.h"
+#include "perf-map.h"
 
 #include <dlfcn.h>
+#include <fnmatch.h>
 
 extern "C" {
 #include <libhilti/globals.h>
@@ -33,6 +38,72 @@ extern "C" {
 
 using namespace hilti;
 
+namespace hilti {
+
+// Object cache for the compile layer that keeps machine code in the compiler
+// context's file cache. JIT::jit() sets the key before adding a module, as
+// it has the bitcode at hand already.
+class JITObjectCache : public llvm::ObjectCache {
+public:
+    JITObjectCache(CompilerContext* ctx)
+    {
+        _ctx = ctx;
+    }
+
+    void setKey(const ::util::cache::FileCache::Key& key)
+    {
+        _key = key;
+        _have_key = true;
+    }
+
+    // Disables caching until the next setKey(). Used for code that the
+    // lazy layer compiles on demand, which isn't worth caching.
+    void clearKey()
+    {
+        _have_key = false;
+    }
+
+    void notifyObjectCompiled(const llvm::Module* module, llvm::MemoryBufferRef obj) override
+    {
+        if ( ! _have_key )
+            return;
+
+        if ( _ctx->options().cgDebugging("cache") )
+            std::cerr << "Updating cache for object code of " << module->getModuleIdentifier()
+                      << std::endl;
+
+        _ctx->fileCache()->store(_key, obj.getBufferStart(), obj.getBufferSize());
+    }
+
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* module) override
+    {
+        if ( ! _have_key )
+            return nullptr;
+
+        auto data = _ctx->fileCache()->lookup(_key);
+
+        if ( data.size() != 1 ) {
+            if ( _ctx->options().cgDebugging("cache") )
+                std::cerr << "No cached object code for " << module->getModuleIdentifier()
+                          << std::endl;
+
+            return nullptr;
+        }
+
+        if ( _ctx->options().cgDebugging("cache") )
+            std::cerr << "Reusing cached object code for " << module->getModuleIdentifier()
+                      << std::endl;
+
+        return llvm::MemoryBuffer::getMemBufferCopy(data.front(), module->getModuleIdentifier());
+    }
+
+private:
+    CompilerContext* _ctx;
+    ::util::cache::FileCache::Key _key;
+    bool _have_key = false;
+};
+}
+
 JIT::JIT(CompilerContext* ctx)
 {
     _ctx = ctx;
@@ -44,11 +115,51 @@ JIT::JIT(CompilerContext* ctx)
     auto target = llvm::EngineBuilder().selectTarget();
     _target_machine.reset(target);
 
+    _llvm_context = std::make_unique<llvm::LLVMContext>();
     _data_layout = std::make_unique<llvm::DataLayout>(_target_machine->createDataLayout());
-    _object_layer = std::make_unique<ObjectLayer>();
+
+    ObjectLoadedNotifier notifier;
+
+    if ( ctx->options().perf_map || ctx->options().perf_jitdump ) {
+        _perf_map = std::make_unique<PerfMap>(ctx->options().perf_map, ctx->options().perf_jitdump);
+        notifier.perf_map = _perf_map.get();
+    }
+
+    _object_layer = std::make_unique<ObjectLayer>(notifier, [this](ObjectLayer::ObjSetHandleT) {
+        // Code is final now.
+        if ( _perf_map )
+            _perf_map->flush();
+    });
+
     auto compiler = llvm::orc::SimpleCompiler(*_target_machine);
     _compile_layer = std::make_unique<CompileLayer>(*_object_layer, compiler);
 
+    if ( ctx->fileCache() ) {
+        _object_cache = std::make_unique<JITObjectCache>(ctx);
+        _compile_layer->setObjectCache(_object_cache.get());
+    }
+
+    if ( ctx->options().jit_lazy ) {
+        auto triple = _target_machine->getTargetTriple();
+        _callback_mgr = llvm::orc::createLocalCompileCallbackManager(triple, 0);
+
+        if ( _callback_mgr ) {
+            auto partition = [this](llvm::Function& f) {
+                if ( _ctx->options().cgDebugging("jit") )
+                    std::cerr << "Compiling " << f.getName().str() << " on demand" << std::endl;
+
+                return std::set<llvm::Function*>({&f});
+            };
+            auto stubs = llvm::orc::createLocalIndirectStubsManagerBuilder(triple);
+            _lazy_layer =
+                std::make_unique<LazyLayer>(*_compile_layer, partition, *_callback_mgr, stubs);
+        }
+
+        else
+            warning(::util::fmt("lazy JIT compilation not supported for %s, compiling eagerly",
+                                triple.str()));
+    }
+
     llvm::sys::DynamicLibrary::LoadLibraryPermanently(nullptr);
 }
 
@@ -79,32 +190,92 @@ bool JIT::jit(std::unique_ptr<llvm::Module> module)
     llvm::raw_svector_ostream os(buffer);
     WriteBitcodeToFile(module.get(), os);
 
-    llvm::LLVMContext jit_context;
+    if ( _object_cache ) {
+        // Machine code depends on the exact host target, too.
+        auto key = _ctx->cacheKey("o", module->getModuleIdentifier());
+        key.hashes.insert(::util::cache::hash(buffer.data(), buffer.size()));
+        key.hashes.insert(::util::cache::hash(_target_machine->getTargetTriple().str()));
+        key.hashes.insert(::util::cache::hash(_target_machine->getTargetCPU().str()));
+        key.hashes.insert(::util::cache::hash(_target_machine->getTargetFeatureString().str()));
+
+        if ( _lazy_layer )
+            // We cache only the warm-up code then.
+            key.hashes.insert(
+                ::util::cache::hash("lazy:" + ::util::strjoin(_ctx->options().jit_warm_up, ",")));
+
+        _object_cache->setKey(key);
+    }
+
     llvm::ObjectMemoryBuffer omb(std::move(buffer));
-    auto module_clone = llvm::parseBitcodeFile(omb, jit_context);
-
-    auto resolver = llvm::orc::createLambdaResolver(
-        [&](const std::string& name) {
-            // Symbol lookup inside the compiled code (is that right???)
-            if ( auto sym = _compile_layer->findSymbol(name, false) )
-                return sym.toRuntimeDyldSymbol();
-            else
-                return llvm::RuntimeDyld::SymbolInfo(nullptr);
-        },
-
-        [](const std::string& name) {
-            // Symbol lookup inside the process.
-            if ( auto symaddr = llvm::RTDyldMemoryManager::getSymbolAddressInProcess(name) )
-                return llvm::RuntimeDyld::SymbolInfo(symaddr, llvm::JITSymbolFlags::Exported);
-            else
-                return llvm::RuntimeDyld::SymbolInfo(nullptr);
-        });
-
-    std::vector<std::unique_ptr<llvm::Module>> ms;
-    ms.push_back(std::move(module_clone.get()));
-
-    auto mm = std::make_unique<llvm::SectionMemoryManager>();
-    _compile_layer->addModuleSet(std::move(ms), std::move(mm), std::move(resolver));
+    auto module_clone = llvm::parseBitcodeFile(omb, *_llvm_context);
+
+    auto make_resolver = [this]() {
+        return llvm::orc::createLambdaResolver(
+            [this](const std::string& name) {
+                // Symbol lookup inside the compiled code.
+                if ( auto sym = _findSymbol(name, false) )
+                    return sym.toRuntimeDyldSymbol();
+                else
+                    return llvm::RuntimeDyld::SymbolInfo(nullptr);
+            },
+
+            [](const std::string& name) {
+                // Symbol lookup inside the process.
+                if ( auto symaddr = llvm::RTDyldMemoryManager::getSymbolAddressInProcess(name) )
+                    return llvm::RuntimeDyld::SymbolInfo(symaddr, llvm::JITSymbolFlags::Exported);
+                else
+                    return llvm::RuntimeDyld::SymbolInfo(nullptr);
+            });
+    };
+
+    if ( _perf_map ) {
+        // Tell the perf map about the HILTI-level names the code generator
+        // recorded.
+        for ( auto& f : (*module_clone)->functions() ) {
+            auto name = f.getFnAttribute(codegen::symbols::AttrName);
+            auto location = f.getFnAttribute(codegen::symbols::AttrLocation);
+
+            if ( f.isDeclaration() || ! name.isStringAttribute() )
+                continue;
+
+            std::string mangled;
+            llvm::raw_string_ostream mangled_stream(mangled);
+            llvm::Mangler::getNameWithPrefix(mangled_stream, f.getName(), *_data_layout);
+
+            _perf_map->addFunction(mangled_stream.str(), name.getValueAsString(),
+                                   location.isStringAttribute() ? location.getValueAsString() :
+                                                                  "");
+        }
+    }
+
+    std::unique_ptr<llvm::Module> cold = std::move(module_clone.get());
+    std::unique_ptr<llvm::Module> hot = nullptr;
+
+    if ( _lazy_layer )
+        hot = _splitWarmUp(cold.get());
+    else {
+        hot = std::move(cold);
+        cold = nullptr;
+    }
+
+    if ( hot ) {
+        std::vector<std::unique_ptr<llvm::Module>> ms;
+        ms.push_back(std::move(hot));
+
+        auto mm = std::make_unique<llvm::SectionMemoryManager>();
+        _compile_layer->addModuleSet(std::move(ms), std::move(mm), make_resolver());
+    }
+
+    if ( cold ) {
+        if ( _object_cache )
+            _object_cache->clearKey();
+
+        std::vector<std::unique_ptr<llvm::Module>> ms;
+        ms.push_back(std::move(cold));
+
+        auto mm = std::make_unique<llvm::SectionMemoryManager>();
+        _lazy_layer->addModuleSet(std::move(ms), std::move(mm), make_resolver());
+    }
 
     // TODO: Looks like ORC doesn't have any error reporting yet.
     // https://llvm.org/bugs/show_bug.cgi?id=22612
@@ -131,6 +302,12 @@ JIT::~JIT()
 {
     auto jit_hlt_done = (void (*)())nativeFunction("__hlt_done");
     (*jit_hlt_done)();
+
+    // Write out what's pending while the JITed code is still mapped.
+    if ( _perf_map ) {
+        _perf_map->flush();
+        _perf_map.reset();
+    }
 }
 
 void* JIT::nativeFunction(const string& function, bool must_exist)
@@ -139,7 +316,7 @@ void* JIT::nativeFunction(const string& function, bool must_exist)
     llvm::raw_string_ostream mangled_stream(mangled);
     llvm::Mangler::getNameWithPrefix(mangled_stream, function, *_data_layout);
 
-    if ( auto symbol = _compile_layer->findSymbol(mangled_stream.str(), true) )
+    if ( auto symbol = _findSymbol(mangled_stream.str(), true) )
         return (void*)symbol.getAddress();
 
     if ( ! must_exist )
@@ -151,3 +328,64 @@ void* JIT::nativeFunction(const string& function, bool must_exist)
 void JIT::_jit_init()
 {
 }
+
+template <typename ObjSetT, typename LoadResult>
+void JIT::ObjectLoadedNotifier::operator()(llvm::orc::ObjectLinkingLayerBase::ObjSetHandleT,
+                                           const ObjSetT& objs, const LoadResult& infos)
+{
+    if ( ! perf_map )
+        return;
+
+    auto info = infos.begin();
+
+    for ( auto& obj : objs )
+        perf_map->addObject(*obj->getBinary(), **info++);
+}
+
+llvm::orc::JITSymbol JIT::_findSymbol(const std::string& name, bool exported_only)
+{
+    // With lazy compilation, the lazy layer returns the stub that triggers
+    // compilation on first call.
+    if ( _lazy_layer ) {
+        if ( auto sym = _lazy_layer->findSymbol(name, exported_only) )
+            return sym;
+    }
+
+    return _compile_layer->findSymbol(name, exported_only);
+}
+
+std::unique_ptr<llvm::Module> JIT::_splitWarmUp(llvm::Module* module)
+{
+    std::set<const llvm::GlobalValue*> hot;
+
+    for ( auto& f : module->functions() ) {
+        if ( f.isDeclaration() )
+            continue;
+
+        for ( auto p : _ctx->options().jit_warm_up ) {
+            if ( fnmatch(p.c_str(), f.getName().str().c_str(), 0) == 0 ) {
+                hot.insert(&f);
+                break;
+            }
+        }
+    }
+
+    if ( hot.empty() )
+        return nullptr;
+
+    if ( _ctx->options().cgDebugging("jit") )
+        std::cerr << "Compiling " << hot.size() << " warm-up functions of "
+                  << module->getModuleIdentifier() << " upfront" << std::endl;
+
+    // The two halves need to see each other's symbols.
+    llvm::orc::makeAllSymbolsExternallyAccessible(*module);
+
+    llvm::ValueToValueMapTy vmap;
+    auto is_hot = [&](const llvm::GlobalValue* gv) { return hot.find(gv) != hot.end(); };
+    auto warm_up = llvm::CloneModule(module, vmap, is_hot);
+
+    for ( auto gv : hot )
+        const_cast<llvm::GlobalValue*>(gv)->deleteBody();
+
+    return warm_up;
+}
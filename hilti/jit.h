@@ -10,7 +10,9 @@
 #undef DEBUG
 #endif
 
+#include "llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h"
 #include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
+#include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
 #include "llvm/ExecutionEngine/Orc/ObjectLinkingLayer.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/Target/TargetMachine.h"
@@ -23,6 +25,8 @@
 namespace hilti {
 
 class CompilerContext;
+class JITObjectCache;
+class PerfMap;
 
 // Central JIT engine.
 class JIT : public ast::Logger {
@@ -40,6 +44,15 @@ public:
     /// To set runtime options, the host application can use
     /// hlt_config_get/set() before calling this method.
     ///
+    /// If the compiler context has caching enabled, the machine code is
+    /// taken from the cache if the module has been compiled before.
+    ///
+    /// If the options set \a jit_lazy, functions are compiled only once
+    /// first called, except for those matching \a jit_warm_up. That
+    /// compilation happens in whichever thread calls the function first,
+    /// and isn't thread-safe; hosts must not enable \a jit_lazy if
+    /// libhilti runs worker threads.
+    ///
     /// module: The module. The function takes ownership.
     ///
     /// Returns: True if JITing succeeded. If *main_run* is true, it will
@@ -64,15 +77,43 @@ protected:
     virtual void _jit_init();
 
 private:
-    CompilerContext* _ctx;
+    // Passes object code on to the perf map once loaded.
+    struct ObjectLoadedNotifier {
+        PerfMap* perf_map = nullptr;
 
-    typedef llvm::orc::ObjectLinkingLayer<> ObjectLayer;
+        template <typename ObjSetT, typename LoadResult>
+        void operator()(llvm::orc::ObjectLinkingLayerBase::ObjSetHandleT, const ObjSetT& objs,
+                        const LoadResult& infos);
+    };
+
+    typedef llvm::orc::ObjectLinkingLayer<ObjectLoadedNotifier> ObjectLayer;
     typedef llvm::orc::IRCompileLayer<ObjectLayer> CompileLayer;
+    typedef llvm::orc::CompileOnDemandLayer<CompileLayer> LazyLayer;
+
+    // Looks up a symbol in all layers.
+    llvm::orc::JITSymbol _findSymbol(const std::string& name, bool exported_only);
+
+    // Moves all functions matching the warm-up patterns out of a module
+    // into a new one. Returns null if there aren't any.
+    std::unique_ptr<llvm::Module> _splitWarmUp(llvm::Module* module);
+
+    CompilerContext* _ctx;
+
+    // The context that JITed modules live in. With lazy compilation, they
+    // must stay around.
+    std::unique_ptr<llvm::LLVMContext> _llvm_context;
 
     std::unique_ptr<llvm::DataLayout> _data_layout;
     std::unique_ptr<llvm::TargetMachine> _target_machine;
     std::unique_ptr<ObjectLayer> _object_layer;
     std::unique_ptr<CompileLayer> _compile_layer;
+    std::unique_ptr<JITObjectCache> _object_cache;
+    std::unique_ptr<llvm::orc::JITCompileCallbackManager> _callback_mgr;
+    std::unique_ptr<LazyLayer> _lazy_layer;
+
+    // Pending entries point into code owned by the layers, so this must
+    // go away before they do.
+    std::unique_ptr<PerfMap> _perf_map;
 };
 }
 
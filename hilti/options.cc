@@ -27,8 +27,8 @@ bool Options::cgDebugging(const string& label) const
 
 Options::string_set Options::cgDebugLabels() const
 {
-    return {"codegen",  "linker",    "parser",   "scanner", "scopes", "context",
-            "dump-ast", "print-ast", "visitors", "cache",   "time",   "liveness"};
+    return {"codegen",  "linker",    "parser",   "scanner", "scopes",   "context", "dump-ast",
+            "print-ast", "visitors", "cache",   "time",    "liveness", "jit"};
 }
 
 Options::string_set Options::optimizationLabels() const
@@ -41,7 +41,15 @@ void Options::toCacheKey(::util::cache::FileCache::Key* key) const
     key->options += (debug ? "D" : "d");
     key->options += (optimize ? "O" : "o");
     key->options += (profile ? ::util::fmt("P%d", profile) : "p");
+    key->options += (profile_fast ? "Q" : "q");
+    key->options += (frame_pointers ? "R" : "r");
     key->options += (verify ? "V" : "v");
+    key->options += (pgo_generate ? "G" : "g");
+    key->options += (thin_link ? "T" : "t");
+    key->options += (perf_map || perf_jitdump ? "S" : "s");
+
+    if ( pgo_use.size() )
+        key->files.insert(pgo_use);
 
     for ( auto d : libdirs_hlt )
         key->dirs.insert(d);
@@ -35,11 +35,43 @@ public:
     /// Optimization level when optimize is true.
     int opt_level = 2;
 
+    /// If true, optimize the final linked code separately for each of the
+    /// modules it combines, rather than as a whole. Small functions still
+    /// get imported across modules for inlining. This keeps the time for
+    /// optimization proportional to the changes if the cache is used as
+    /// well, and allows for doing it in parallel.
+    bool thin_link = false;
+
+    /// With thin_link, the number of threads to optimize with; zero
+    /// selects the number of hardware threads available.
+    unsigned int thin_link_threads = 1;
+
     /// If >0, include instrumentation for runtime profiling into generated
     /// code. For larger values, more fine-granular profiling may be
     /// included. Enabling profiling has a significant performance impact.
     unsigned int profile = 0;
 
+    /// If true, profiling instrumentation with a constant tag refers to its
+    /// profiler by an integer ID that the linker assigns, rather than
+    /// looking it up by name at runtime. The runtime then aggregates
+    /// counters in per-thread arrays that it writes out periodically. This
+    /// mode ignores snapshot styles.
+    bool profile_fast = false;
+
+    /// If true, the final linked code keeps frame pointers, which the
+    /// runtime's sampling profiler needs for walking the stack.
+    bool frame_pointers = false;
+
+    /// If true, instrument the final linked code to count how often each
+    /// basic block executes. At termination, the runtime writes the counts
+    /// to hlt.pgo.p<pid>.dat for use with pgo_use.
+    bool pgo_generate = false;
+
+    /// If non-empty, the path of a profile written by instrumented code
+    /// (or merged by hilti-pgo) that guides optimization of the final
+    /// linked code.
+    string pgo_use;
+
     /// If true, all generated code is verified for correctness. Disabling
     /// this is primarily for debugging purposes.
     bool verify = true;
@@ -49,6 +81,26 @@ public:
     /// aborts if it's not set.
     bool jit = false;
 
+    /// If true, the JIT compiles functions into machine code only once they
+    /// are first called, rather than all upfront. This must not be used
+    /// with libhilti worker threads, as compilation isn't thread-safe.
+    bool jit_lazy = false;
+
+    /// With jit_lazy, a list of shell-style patterns for functions that the
+    /// JIT compiles upfront nevertheless, as they are known to be needed
+    /// right away.
+    string_list jit_warm_up;
+
+    /// If true, the JIT writes the addresses of compiled functions to a
+    /// perf map in /tmp/perf-<pid>.map, so that Linux' perf can symbolize
+    /// them by their HILTI-level names.
+    bool perf_map = false;
+
+    /// If true, the JIT writes compiled functions to a jitdump file
+    /// jit-<pid>.dump, including source locations, for merging into a
+    /// perf recording with ``perf inject --jit``.
+    bool perf_jitdump = false;
+
     /// List of directories to search for imports and other \c *.hlt library
     /// files. The current directory will always be tried first. By default,
     /// this set is set to the current directory plus the installation-wide
@@ -55,8 +55,6 @@ BlockFlattener::BlockFlattener() : Pass<>("hilti::codegen::BlockFlattener", true
 {
 }
 
-static shared_ptr<hilti::Node> _module;
-
 bool BlockFlattener::run(shared_ptr<hilti::Node> module)
 {
     _module = module;
@@ -23,6 +23,9 @@ protected:
 
     void visit(declaration::Function* d) override;
     void visit(Module* m) override;
+
+private:
+    shared_ptr<hilti::Node> _module;
 };
 }
 }
@@ -10,7 +10,7 @@
 using namespace hilti;
 using namespace passes;
 
-int OptimizeCtors::_id_counter = 0;
+std::atomic<int> OptimizeCtors::_id_counter(0);
 
 OptimizeCtors::OptimizeCtors() : Pass<>("hilti::OptimizeCtors", true)
 {
@@ -2,6 +2,8 @@
 #ifndef HILTI_PASSES_OPTIMIZE_CTORS_H
 #define HILTI_PASSES_OPTIMIZE_CTORS_H
 
+#include <atomic>
+
 #include "../pass.h"
 
 namespace hilti {
@@ -20,7 +22,7 @@ protected:
 
 private:
     shared_ptr<Module> _module;
-    static int _id_counter;
+    static std::atomic<int> _id_counter;
 };
 }
 }
@@ -0,0 +1,360 @@
+// LLVM redefines the DEBUG macro. Sigh.
+#ifdef DEBUG
+#define __SAVE_DEBUG DEBUG
+#undef DEBUG
+#endif
+
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/Object/SymbolSize.h"
+
+#undef DEBUG
+#ifdef __SAVE_DEBUG
+#define DEBUG __SAVE_DEBUG
+#endif
+
+#include "perf-map.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <elf.h>
+#endif
+
+#include <util/util.h>
+
+using namespace hilti;
+
+// Records of the jitdump format as defined by perf's
+// Documentation/jitdump-specification.txt.
+namespace {
+
+static const uint32_t JITDumpMagic = 0x4A695444;
+static const uint32_t JITDumpVersion = 1;
+
+enum JITDumpRecordType { JIT_CODE_LOAD = 0, JIT_CODE_DEBUG_INFO = 2, JIT_CODE_CLOSE = 3 };
+
+struct JITDumpHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;
+    uint32_t elf_mach;
+    uint32_t pad1;
+    uint32_t pid;
+    uint64_t timestamp;
+    uint64_t flags;
+};
+
+struct JITDumpRecord {
+    uint32_t id;
+    uint32_t total_size;
+    uint64_t timestamp;
+};
+
+struct JITDumpCodeLoad {
+    JITDumpRecord record;
+    uint32_t pid;
+    uint32_t tid;
+    uint64_t vma;
+    uint64_t code_addr;
+    uint64_t code_size;
+    uint64_t code_index;
+    // Followed by the name and the code.
+};
+
+struct JITDumpDebugInfo {
+    JITDumpRecord record;
+    uint64_t code_addr;
+    uint64_t nr_entry;
+    // Followed by the entries.
+};
+
+struct JITDumpDebugEntry {
+    uint64_t addr;
+    uint32_t lineno;
+    uint32_t discrim;
+    // Followed by the file name.
+};
+}
+
+// Must match what perf uses for its own timestamps with "perf record -k 1".
+static uint64_t timestamp()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint32_t elfMachine()
+{
+#if defined(__linux__) && defined(__x86_64__)
+    return EM_X86_64;
+#elif defined(__linux__) && defined(__aarch64__)
+    return EM_AARCH64;
+#elif defined(__linux__) && defined(__i386__)
+    return EM_386;
+#else
+    return 0;
+#endif
+}
+
+// Splits a location of the form "file:line" or "file:from-to".
+static void splitLocation(const string& location, string* file, uint32_t* line)
+{
+    auto i = location.rfind(':');
+
+    if ( i == string::npos ) {
+        *file = location;
+        *line = 0;
+        return;
+    }
+
+    *file = location.substr(0, i);
+    *line = strtoul(location.c_str() + i + 1, nullptr, 10);
+}
+
+PerfMap::PerfMap(bool map, bool jitdump) : ast::Logger("PerfMap")
+{
+    if ( map ) {
+        auto path = ::util::fmt("/tmp/perf-%d.map", getpid());
+
+        // Append, as there may be more than one JIT in the process.
+        _map = fopen(path.c_str(), "a");
+
+        if ( ! _map )
+            warning(::util::fmt("cannot open %s: %s", path, strerror(errno)));
+    }
+
+    if ( jitdump )
+        _openJITDump();
+}
+
+PerfMap::~PerfMap()
+{
+    flush();
+
+    if ( _map )
+        fclose(_map);
+
+    _closeJITDump();
+}
+
+void PerfMap::addFunction(const string& symbol, const string& name, const string& location)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    Function f;
+    f.name = name;
+
+    if ( location.size() ) {
+        splitLocation(location, &f.file, &f.line);
+        f.name += " [" + location + "]";
+    }
+
+    _functions[symbol] = f;
+}
+
+void PerfMap::addObject(const llvm::object::ObjectFile& obj,
+                        const llvm::RuntimeDyld::LoadedObjectInfo& info)
+{
+    // The debug object has all sections relocated to where the JIT loaded
+    // them.
+    auto debug_obj = info.getObjectForDebug(obj);
+    auto dobj = debug_obj.getBinary();
+
+    if ( ! dobj )
+        return;
+
+    llvm::DWARFContextInMemory dwarf(*dobj);
+
+    llvm::DILineInfoSpecifier spec(
+        llvm::DILineInfoSpecifier::FileLineInfoKind::AbsoluteFilePath,
+        llvm::DILineInfoSpecifier::FunctionNameKind::None);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for ( const auto& p : llvm::object::computeSymbolSizes(*dobj) ) {
+        auto sym = p.first;
+        auto type = sym.getType();
+
+        if ( ! type ) {
+            llvm::consumeError(type.takeError());
+            continue;
+        }
+
+        if ( *type != llvm::object::SymbolRef::ST_Function )
+            continue;
+
+        auto name = sym.getName();
+        auto addr = sym.getAddress();
+
+        if ( ! name || ! addr ) {
+            if ( ! name )
+                llvm::consumeError(name.takeError());
+
+            if ( ! addr )
+                llvm::consumeError(addr.takeError());
+
+            continue;
+        }
+
+        Code code;
+        code.addr = *addr;
+        code.size = p.second;
+        code.name = *name;
+
+        if ( ! code.size )
+            continue;
+
+        auto f = _functions.find(code.name);
+
+        if ( f != _functions.end() )
+            code.name = f->second.name;
+
+        // Runtime code comes with DWARF line information. For HILTI code we
+        // only know where the function starts.
+        for ( auto l : dwarf.getLineInfoForAddressRange(code.addr, code.size, spec) )
+            code.lines.push_back(Line{l.first, l.second.FileName, l.second.Line});
+
+        if ( code.lines.empty() && f != _functions.end() && f->second.line )
+            code.lines.push_back(Line{code.addr, f->second.file, f->second.line});
+
+        _pending.push_back(code);
+    }
+}
+
+void PerfMap::flush()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for ( const auto& code : _pending ) {
+        if ( _map )
+            _writeMap(code);
+
+        if ( _jitdump )
+            _writeJITDump(code);
+    }
+
+    if ( _map )
+        fflush(_map);
+
+    if ( _jitdump )
+        fflush(_jitdump);
+
+    _pending.clear();
+}
+
+void PerfMap::_writeMap(const Code& code)
+{
+    fprintf(_map, "%" PRIx64 " %" PRIx64 " %s\n", code.addr, code.size, code.name.c_str());
+}
+
+void PerfMap::_writeJITDump(const Code& code)
+{
+    if ( code.lines.size() ) {
+        // Must come before the code it describes.
+        uint32_t size = sizeof(JITDumpDebugInfo);
+
+        for ( const auto& l : code.lines )
+            size += sizeof(JITDumpDebugEntry) + l.file.size() + 1;
+
+        JITDumpDebugInfo info;
+        info.record.id = JIT_CODE_DEBUG_INFO;
+        info.record.total_size = size;
+        info.record.timestamp = timestamp();
+        info.code_addr = code.addr;
+        info.nr_entry = code.lines.size();
+        fwrite(&info, sizeof(info), 1, _jitdump);
+
+        for ( const auto& l : code.lines ) {
+            JITDumpDebugEntry entry;
+            entry.addr = l.addr;
+            entry.lineno = l.line;
+            entry.discrim = 0;
+            fwrite(&entry, sizeof(entry), 1, _jitdump);
+            fwrite(l.file.c_str(), l.file.size() + 1, 1, _jitdump);
+        }
+    }
+
+    JITDumpCodeLoad load;
+    load.record.id = JIT_CODE_LOAD;
+    load.record.total_size = sizeof(load) + code.name.size() + 1 + code.size;
+    load.record.timestamp = timestamp();
+    load.pid = getpid();
+#ifdef __linux__
+    load.tid = syscall(SYS_gettid);
+#else
+    load.tid = 0;
+#endif
+    load.vma = code.addr;
+    load.code_addr = code.addr;
+    load.code_size = code.size;
+    load.code_index = _code_index++;
+
+    fwrite(&load, sizeof(load), 1, _jitdump);
+    fwrite(code.name.c_str(), code.name.size() + 1, 1, _jitdump);
+    fwrite((const void*)code.addr, code.size, 1, _jitdump);
+}
+
+void PerfMap::_openJITDump()
+{
+#ifdef __linux__
+    auto path = ::util::fmt("jit-%d.dump", getpid());
+    int fd = open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0666);
+
+    if ( fd < 0 ) {
+        warning(::util::fmt("cannot open %s: %s", path, strerror(errno)));
+        return;
+    }
+
+    // perf finds the file through this mapping showing up in its recording.
+    _jitdump_marker =
+        mmap(nullptr, sysconf(_SC_PAGESIZE), PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0);
+
+    if ( _jitdump_marker == MAP_FAILED ) {
+        warning(::util::fmt("cannot map %s: %s", path, strerror(errno)));
+        _jitdump_marker = nullptr;
+        close(fd);
+        return;
+    }
+
+    _jitdump = fdopen(fd, "w+");
+
+    JITDumpHeader hdr;
+    hdr.magic = JITDumpMagic;
+    hdr.version = JITDumpVersion;
+    hdr.total_size = sizeof(hdr);
+    hdr.elf_mach = elfMachine();
+    hdr.pad1 = 0;
+    hdr.pid = getpid();
+    hdr.timestamp = timestamp();
+    hdr.flags = 0;
+    fwrite(&hdr, sizeof(hdr), 1, _jitdump);
+#else
+    warning("jitdump output is supported only on Linux");
+#endif
+}
+
+void PerfMap::_closeJITDump()
+{
+    if ( ! _jitdump )
+        return;
+
+    JITDumpRecord close;
+    close.id = JIT_CODE_CLOSE;
+    close.total_size = sizeof(close);
+    close.timestamp = timestamp();
+    fwrite(&close, sizeof(close), 1, _jitdump);
+
+    fclose(_jitdump);
+    _jitdump = nullptr;
+
+    if ( _jitdump_marker )
+        munmap(_jitdump_marker, sysconf(_SC_PAGESIZE));
+
+    _jitdump_marker = nullptr;
+}
@@ -0,0 +1,110 @@
+#ifndef HILTI_PERF_MAP_H
+#define HILTI_PERF_MAP_H
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <ast/logger.h>
+
+// LLVM redefines the DEBUG macro. Sigh.
+#ifdef DEBUG
+#define __SAVE_DEBUG DEBUG
+#undef DEBUG
+#endif
+
+#include "llvm/ExecutionEngine/RuntimeDyld.h"
+#include "llvm/Object/ObjectFile.h"
+
+#undef DEBUG
+#ifdef __SAVE_DEBUG
+#define DEBUG __SAVE_DEBUG
+#endif
+
+namespace hilti {
+
+/// Makes JIT-compiled code known to Linux' perf profiler, which otherwise
+/// cannot symbolize it. There are two mechanisms: a perf map in
+/// /tmp/perf-<pid>.map, which perf picks up automatically; and a jitdump
+/// file jit-<pid>.dump in the current directory, which additionally
+/// carries the machine code and source locations, and gets merged into a
+/// recording with ``perf inject --jit``.
+///
+/// Functions are reported by their HILTI-level names where the code
+/// generator recorded them (see symbols::AttrName), and by their LLVM-level
+/// names otherwise.
+class PerfMap : public ast::Logger {
+public:
+    /// Constructor. Opens the output files.
+    ///
+    /// map: True to write a perf map.
+    ///
+    /// jitdump: True to write a jitdump file.
+    PerfMap(bool map, bool jitdump);
+
+    /// Destructor. Closes the output files. The perf map remains in place
+    /// for perf to read it after the process has terminated.
+    ~PerfMap();
+
+    /// Records the source-level name and location of a function for when
+    /// its code gets loaded.
+    ///
+    /// symbol: The function's name in the object code.
+    ///
+    /// name: The name to report the function under.
+    ///
+    /// location: The function's location in the form ``file:line``, or
+    /// empty if unknown.
+    void addFunction(const string& symbol, const string& name, const string& location);
+
+    /// Records all functions of an object file that the JIT has loaded into
+    /// memory. They are reported only once flush() is called, after the
+    /// JIT has finished relocating them.
+    ///
+    /// obj: The object file.
+    ///
+    /// info: Information about where the JIT has loaded the object.
+    void addObject(const llvm::object::ObjectFile& obj,
+                   const llvm::RuntimeDyld::LoadedObjectInfo& info);
+
+    /// Reports all functions recorded through addObject() since the last
+    /// call.
+    void flush();
+
+private:
+    struct Line {
+        uint64_t addr;
+        string file;
+        uint32_t line;
+    };
+
+    struct Code {
+        uint64_t addr;
+        uint64_t size;
+        string name;
+        std::vector<Line> lines;
+    };
+
+    struct Function {
+        string name;
+        string file;
+        uint32_t line = 0;
+    };
+
+    void _writeMap(const Code& code);
+    void _writeJITDump(const Code& code);
+    void _openJITDump();
+    void _closeJITDump();
+
+    std::mutex _mutex;
+    std::map<string, Function> _functions;
+    std::vector<Code> _pending;
+
+    FILE* _map = nullptr;
+    FILE* _jitdump = nullptr;
+    void* _jitdump_marker = nullptr;
+    uint64_t _code_index = 0;
+};
+}
+
+#endif
@@ -11,7 +11,7 @@
 
 using namespace hilti;
 
-uint64_t Statement::_counter = 0;
+std::atomic<uint64_t> Statement::_counter(0);
 
 static void _addExpressionToVariables(Statement::variable_set* vars, shared_ptr<Expression> expr)
 {
@@ -2,6 +2,8 @@
 #ifndef HILTI_STATEMENT_H
 #define HILTI_STATEMENT_H
 
+#include <atomic>
+
 #include <ast/statement.h>
 
 #include "common.h"
@@ -70,7 +72,7 @@ private:
     shared_ptr<Statement> _successor = 0; // Not a node ptr, we don't add it as a child.
     uint64_t _number;
 
-    static uint64_t _counter;
+    static std::atomic<uint64_t> _counter;
 };
 
 namespace statement {
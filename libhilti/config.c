@@ -33,9 +33,12 @@ hlt_config* __hlt_default_config()
     cfg->debug_out = "hlt-debug.log";
     cfg->debug_streams = dbg;
     cfg->profiling = (profile && *profile);
+    cfg->sampling = 0;
     cfg->vid_schedule_min = 1;
     cfg->vid_schedule_max = 101;
     cfg->core_affinity = "DEFAULT";
+    cfg->regexp_max_dfa_states = 10000;
+    cfg->max_inflated_size = 1024 * 1024 * 1024;
 
     return cfg;
 }
@@ -78,7 +81,10 @@ void hlt_config_dump(FILE* f)
     fprintf(f, "debug_out:           %s\n", cfg->debug_out);
     fprintf(f, "debug_streams:       %s\n", cfg->debug_streams);
     fprintf(f, "profiling:           %s\n", (cfg->profiling ? "yes" : "no"));
+    fprintf(f, "sampling:            %" PRIu32 "\n", cfg->sampling);
     fprintf(f, "vid_schedule_min:    %" PRId64 "\n", cfg->vid_schedule_min);
     fprintf(f, "vid_schedule_max:    %" PRId64 " \n", cfg->vid_schedule_max);
     fprintf(f, "core_affinity:       %s\n", cfg->core_affinity);
+    fprintf(f, "regexp_max_dfa_states: %" PRIu32 "\n", cfg->regexp_max_dfa_states);
+    fprintf(f, "max_inflated_size:   %" PRIu64 "\n", cfg->max_inflated_size);
 }
@@ -38,6 +38,11 @@ struct __hlt_config {
     /// 1 if profiling is enabled, 0 otherwise. Default is off.
     int8_t profiling;
 
+    /// If non-zero, the number of times per second of CPU time to sample
+    /// the stacks of running code. At termination, the aggregated samples
+    /// are written to hlt.prof.p<pid>.samples.dat. Default is off.
+    uint32_t sampling;
+
     /// The smallest virtual thread number to use when hashing a thread
     /// context into the set of virtual threads. Default is 1.
     hlt_vthread_id vid_schedule_min;
@@ -52,6 +57,16 @@ struct __hlt_config {
     /// is the magic string "DEFAULT" which let's HILTI determine a pinning
     /// itself.
     const char* core_affinity;
+
+    /// Maximum number of DFA states each regular expression keeps computed
+    /// at any time. Once reached, all states get flushed and are computed
+    /// again on demand. Zero means no limit. Default is 10000.
+    uint32_t regexp_max_dfa_states;
+
+    /// Maximum number of bytes that a single decompression filter may
+    /// produce in total before it aborts with an error, protecting against
+    /// decompression bombs. Zero means no limit. Default is 1GB.
+    uint64_t max_inflated_size;
 };
 
 /// Returns the current configuration. The returned value cannot be directly
@@ -6,6 +6,7 @@
 #include "exceptions.h"
 #include "globals.h"
 #include "linker.h"
+#include "list.h"
 #include "memory_.h"
 #include "profiler.h"
 #include "rtti.h"
@@ -21,6 +22,7 @@ hlt_execution_context* __hlt_execution_context_new_ref(hlt_vthread_id vid, int8_
     ctx->excpt = 0;
     ctx->fiber = 0;
     ctx->fiber_pool = __hlt_fiber_pool_new();
+    ctx->list_pool = __hlt_list_pool_new();
     ctx->worker = 0;
     ctx->tcontext = 0;
     ctx->tcontext_type = 0;
@@ -67,6 +69,9 @@ void hlt_execution_context_delete(hlt_execution_context* ctx)
     if ( ctx->nullbuffer )
         __hlt_memory_nullbuffer_delete(ctx->nullbuffer, ctx);
 
+    // Do this last, deleting objects above may still return chunks.
+    __hlt_list_pool_delete(ctx->list_pool);
+
     hlt_free(ctx);
 }
 
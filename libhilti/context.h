@@ -34,6 +34,7 @@ struct __hlt_execution_context {
     __hlt_thread_mgr_blockable* blockable; /// A blockable set to go along with the next yield.
     hlt_timer_mgr* tmgr;                   /// The context's timer manager.
     __hlt_memory_nullbuffer* nullbuffer;   /// Null-buffer for delayed reference counting.
+    __hlt_list_pool* list_pool;            /// Pool of free chunks for list storage.
 
     // TODO: We should not compile this in non-profiling mode.
     __hlt_profiler_state* pstate; /// State for ongoing profiling, or 0 if none.
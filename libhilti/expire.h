@@ -0,0 +1,169 @@
+///
+/// \addtogroup expire
+/// @{
+/// Helpers for expiring container entries.
+///
+/// Containers with a timeout keep all entries subject to expiration in an
+/// intrusive, doubly-linked list ordered by expiration time: new entries are
+/// appended at the tail, and with the ``Access`` strategy an access moves the
+/// entry to the tail as well. As all entries of a container share the same
+/// timeout, the head of the list is always the entry expiring next.
+///
+/// Instead of a timer per entry, the container then schedules only a single
+/// timer with its timer manager, set to the head's expiration time. When it
+/// fires, the container removes all entries from the head that have expired,
+/// and reschedules the timer for the new head if there's one left. Touching
+/// an entry thus never touches the timer manager's priority queue.
+///
+/// Note that changing a container's timeout while it has expiring entries
+/// breaks the ordering invariant; in that case entries may expire later than
+/// scheduled but never earlier.
+///
+/// Bounded containers reuse the same list type to keep their entries in
+/// eviction order, ignoring the time field.
+/// @}
+
+#ifndef LIBHILTI_EXPIRE_H
+#define LIBHILTI_EXPIRE_H
+
+#include "time_.h"
+#include "timer.h"
+
+typedef struct __hlt_expire_node __hlt_expire_node;
+
+/// Link embedded into each container entry that is subject to expiration.
+struct __hlt_expire_node {
+    __hlt_expire_node* prev; // Entry expiring before this one.
+    __hlt_expire_node* next; // Entry expiring after this one.
+    hlt_time time;           // The entry's expiration time.
+};
+
+/// List of all entries of a container that are subject to expiration.
+typedef struct {
+    __hlt_expire_node* head;   // Entry expiring next, or null if none.
+    __hlt_expire_node* tail;   // Entry expiring last, or null if none.
+    hlt_timer* timer;          // The container's timer, or null if not scheduled. Not memory-managed
+                               // to avoid cycles.
+} __hlt_expire_list;
+
+/// Appends a node to the tail of an expiration list.
+///
+/// l: The list.
+///
+/// n: The node, which must not be linked into any list yet.
+///
+/// t: The node's expiration time.
+static inline void __hlt_expire_list_append(__hlt_expire_list* l, __hlt_expire_node* n, hlt_time t)
+{
+    n->time = t;
+    n->next = 0;
+    n->prev = l->tail;
+
+    if ( l->tail )
+        l->tail->next = n;
+    else
+        l->head = n;
+
+    l->tail = n;
+}
+
+/// Removes a node from an expiration list.
+///
+/// l: The list.
+///
+/// n: The node, which must be currently linked into *l*.
+static inline void __hlt_expire_list_unlink(__hlt_expire_list* l, __hlt_expire_node* n)
+{
+    if ( n->prev )
+        n->prev->next = n->next;
+    else
+        l->head = n->next;
+
+    if ( n->next )
+        n->next->prev = n->prev;
+    else
+        l->tail = n->prev;
+
+    n->prev = n->next = 0;
+}
+
+/// Records an access to a node, moving it to the tail of its expiration
+/// list with a new expiration time.
+///
+/// l: The list.
+///
+/// n: The node, which must be currently linked into *l*.
+///
+/// t: The node's new expiration time.
+static inline void __hlt_expire_list_touch(__hlt_expire_list* l, __hlt_expire_node* n, hlt_time t)
+{
+    if ( l->tail == n ) {
+        n->time = t;
+        return;
+    }
+
+    __hlt_expire_list_unlink(l, n);
+    __hlt_expire_list_append(l, n, t);
+}
+
+/// Returns true if a node is currently linked into an expiration list.
+///
+/// l: The list.
+///
+/// n: The node, which must not be linked into any other list.
+static inline int8_t __hlt_expire_list_contains(__hlt_expire_list* l, __hlt_expire_node* n)
+{
+    return n->prev || l->head == n;
+}
+
+/// Returns the node at the head of an expiration list if it has expired
+/// by a given time, or null otherwise.
+///
+/// l: The list.
+///
+/// now: The current time.
+static inline __hlt_expire_node* __hlt_expire_list_expired(__hlt_expire_list* l, hlt_time now)
+{
+    return (l->head && l->head->time <= now) ? l->head : 0;
+}
+
+/// Schedules a container's new timer for the entry at the head of its
+/// expiration list. The list must not be empty and not have a timer
+/// scheduled yet.
+///
+/// l: The list.
+///
+/// tmgr: The timer manager to schedule the timer with.
+///
+/// t: The new timer. The function takes ownership.
+///
+/// excpt: &
+static inline void __hlt_expire_list_schedule(__hlt_expire_list* l, hlt_timer_mgr* tmgr,
+                                              hlt_timer* t, hlt_exception** excpt,
+                                              hlt_execution_context* ctx)
+{
+    assert(l->head && ! l->timer);
+
+    l->timer = t;
+    hlt_timer_mgr_schedule(tmgr, l->head->time, t, excpt, ctx);
+    GC_DTOR(t, hlt_timer, ctx); // Not memory-managed on our end.
+}
+
+/// Returns the time up to which entries are considered expired when a
+/// container's timer fires. That's normally the manager's current time, but
+/// when a manager expires all its timers, we go by the timer's own time so
+/// that we eventually make progress.
+///
+/// l: The list.
+///
+/// tmgr: The timer manager the list's timer is scheduled with.
+///
+/// excpt: &
+static inline hlt_time __hlt_expire_list_now(__hlt_expire_list* l, hlt_timer_mgr* tmgr,
+                                             hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    hlt_time now = hlt_timer_mgr_current(tmgr, excpt, ctx);
+    return (l->timer && l->timer->time > now) ? l->timer->time : now;
+}
+
+#endif
@@ -36,6 +36,12 @@ struct __hlt_fiber_pool {
     size_t size;
 };
 
+// Key for the fiber currently running on a native thread. We maintain that
+// only if the sampling profiler asks for it. (We don't use __thread, as the
+// JIT can't relocate thread-local variables.)
+static pthread_key_t _current_key;
+static int8_t _track_current = 0;
+
 static void _fiber_trampoline(unsigned int y, unsigned int x)
 {
     hlt_fiber* fiber;
@@ -294,6 +300,13 @@ int8_t hlt_fiber_start(hlt_fiber* fiber, hlt_execution_context* ctx)
 
     __hlt_context_set_fiber(fiber->context, fiber);
 
+    hlt_fiber* parent = 0;
+
+    if ( _track_current ) {
+        parent = pthread_getspecific(_current_key);
+        pthread_setspecific(_current_key, fiber);
+    }
+
     if ( ! _setjmp(fiber->parent) ) {
         fiber->state = RUNNING;
 
@@ -305,6 +318,9 @@ int8_t hlt_fiber_start(hlt_fiber* fiber, hlt_execution_context* ctx)
         abort();
     }
 
+    if ( _track_current )
+        pthread_setspecific(_current_key, parent);
+
     switch ( fiber->state ) {
     case YIELDED:
         __hlt_memory_safepoint(fiber->context, "fiber_start/yield");
@@ -356,6 +372,28 @@ extern hlt_execution_context* hlt_fiber_context(hlt_fiber* fiber)
     return fiber->context;
 }
 
+void __hlt_fiber_track_current()
+{
+    if ( _track_current )
+        return;
+
+    if ( pthread_key_create(&_current_key, 0) != 0 )
+        fatal_error("cannot create key for current fiber");
+
+    _track_current = 1;
+}
+
+hlt_fiber* __hlt_fiber_current()
+{
+    return _track_current ? pthread_getspecific(_current_key) : 0;
+}
+
+void __hlt_fiber_stack(hlt_fiber* fiber, void** base, size_t* size)
+{
+    *base = fiber->uctx.uc_stack.ss_sp;
+    *size = fiber->uctx.uc_stack.ss_size;
+}
+
 void __hlt_fiber_init()
 {
     if ( ! hlt_is_multi_threaded() ) {
@@ -89,6 +89,27 @@ extern __hlt_fiber_pool* __hlt_fiber_pool_new();
 /// Internal function to delete a pool of available fibers.
 extern void __hlt_fiber_pool_delete(__hlt_fiber_pool* pool);
 
+/// Internal function to start keeping track of the fiber running on each
+/// native thread, as returned by __hlt_fiber_current().
+extern void __hlt_fiber_track_current();
+
+/// Internal function returning the fiber currently running on the calling
+/// native thread, or null if none or not tracked. The sampling profiler calls
+/// this from its signal handler. POSIX doesn't guarantee pthread_getspecific()
+/// to be async-signal-safe, but with glibc and on Darwin, it is once the key
+/// exists, as it just reads the thread's key table.
+extern hlt_fiber* __hlt_fiber_current();
+
+/// Internal function returning the memory range of a fiber's stack. This
+/// may be called from a signal handler.
+///
+/// fiber: The fiber.
+///
+/// base: Set to the lowest address of the stack.
+///
+/// size: Set to the size of the stack.
+extern void __hlt_fiber_stack(hlt_fiber* fiber, void** base, size_t* size);
+
 void __hlt_fiber_init();
 void __hlt_fiber_done();
 
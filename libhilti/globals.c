@@ -11,7 +11,9 @@
 #include "globals.h"
 #include "linker.h"
 #include "memory.h"
+#include "pgo.h"
 #include "profiler.h"
+#include "sampler.h"
 #include "stackmap.h"
 #include "threading.h"
 
@@ -53,6 +55,7 @@ int __hlt_global_state_init()
     __hlt_hooks_init();
     __hlt_threading_init();
     __hlt_profiler_init();
+    __hlt_sampler_init();
     __hlt_stackmap_init();
 
     return 1;
@@ -71,6 +74,8 @@ int __hlt_global_state_done()
     __hlt_stackmap_done();
     __hlt_threading_done(&excpt);
     __hlt_profiler_done(); // Must come after threading is done.
+    __hlt_pgo_done();      // Likewise.
+    __hlt_sampler_done();  // Likewise.
 
     if ( excpt ) {
         hlt_exception_print_uncaught(excpt, __globals->context);
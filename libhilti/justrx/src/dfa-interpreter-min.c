@@ -56,15 +56,15 @@ int jrx_match_state_advance_min(jrx_match_state* ms, jrx_char cp, jrx_assertion
 
         ++ms->offset;
 
-        // Found transition.
-        jrx_dfa_state_id succ_id = trans.succ;
-        jrx_dfa_state* succ_state = dfa_get_state(ms->dfa, succ_id);
-
-        ms->state = succ_id;
+        // Found transition. Move on before we look up the successor, as
+        // computing that may flush the DFA and renumber its states.
+        ms->state = trans.succ;
         ms->previous = cp;
 
+        jrx_dfa_state* succ_state = dfa_get_state(ms->dfa, ms->state);
+
         if ( ms->dfa->options & JRX_OPTION_DEBUG )
-            fprintf(stderr, "-> found transition, new state is #%d", succ_id);
+            fprintf(stderr, "-> found transition, new state is #%d", ms->state);
 
         if ( succ_state->accepts ) {
             jrx_accept_id aid = vec_dfa_accept_get(succ_state->accepts, 0).aid;
@@ -191,6 +191,8 @@ jrx_match_state* jrx_match_state_init(const jrx_regex_t* preg, jrx_offset begin,
     ms->tags1_size = 0;
     ms->tags2_size = 0;
 
+    dfa_match_state_register(dfa, ms);
+
     if ( (dfa->options & JRX_OPTION_STD_MATCHER) ) {
         ms->accepts = set_match_accept_create(0);
 
@@ -208,6 +210,8 @@ jrx_match_state* jrx_match_state_init(const jrx_regex_t* preg, jrx_offset begin,
 
 void jrx_match_state_done(jrx_match_state* ms)
 {
+    dfa_match_state_unregister(ms->dfa, ms);
+
     if ( ms->dfa->options & JRX_OPTION_NO_CAPTURE )
         return;
 
@@ -258,18 +262,18 @@ int jrx_match_state_advance(jrx_match_state* ms, jrx_char cp, jrx_assertion asse
             // Doesn't match.
             continue;
 
-        // Found transition.
-        jrx_dfa_state_id succ_id = trans.succ;
-        jrx_dfa_state* succ_state = dfa_get_state(ms->dfa, succ_id);
-        vec_tag_op* tops = trans.tops;
-
-        ms->state = succ_id;
+        // Found transition. Apply the tag operations before we look up the
+        // successor, as computing that may flush the DFA, including the
+        // current state, and renumber its states.
+        ms->state = trans.succ;
         ms->previous = cp;
 
-        _update_tags(ms, tops);
+        _update_tags(ms, trans.tops);
 
         ++ms->offset;
 
+        jrx_dfa_state* succ_state = dfa_get_state(ms->dfa, ms->state);
+
         _update_accepts(ms, succ_state, cp, assertions);
 
         if ( ms->dfa->options & JRX_OPTION_DEBUG ) {
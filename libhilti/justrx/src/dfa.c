@@ -1,5 +1,7 @@
 // $Id$
 
+#include <inttypes.h>
+
 #include "dfa.h"
 #include "jrx-intern.h"
 
@@ -20,6 +22,9 @@ static jrx_dfa* _dfa_create()
     dfa->max_capture = -1;
     dfa->max_tag = -1;
     dfa->nfa = 0;
+    dfa->max_states = 0;
+    memset(&dfa->stats, 0, sizeof(dfa->stats));
+    dfa->match_states = 0;
 
     return dfa;
 }
@@ -76,6 +81,7 @@ static jrx_dfa_state_id reserve_dfastate_id(jrx_dfa* dfa, set_dfa_state_elem* ds
         kh_del(dfa_state_elem, dfa->hstates, k);
 
     kh_value(dfa->hstates, k) = id;
+    ++dfa->stats.sets;
     return id;
 }
 
@@ -292,6 +298,7 @@ int dfa_state_compute(jrx_nfa_context* ctx, jrx_dfa* dfa, jrx_dfa_state_id id,
     dfastate->accepts = accepts;
 
     vec_dfa_state_set(dfa->states, id, dfastate);
+    ++dfa->stats.states;
     return 1;
 }
 
@@ -299,11 +306,30 @@ jrx_dfa_state* dfa_get_state(jrx_dfa* dfa, jrx_dfa_state_id id)
 {
     jrx_dfa_state* state = vec_dfa_state_get(dfa->states, id);
 
-    if ( state )
+    if ( state ) {
+        ++dfa->stats.hits;
         return state;
+    }
 
-    set_dfa_state_elem* dstate = vec_dfa_state_elem_get(dfa->state_elems, id);
-    assert(dstate);
+    set_dfa_state_elem* dstate = (id == dfa->initial ? dfa->initial_dstate :
+                                                       vec_dfa_state_elem_get(dfa->state_elems, id));
+
+    if ( ! dstate )
+        // Not a state we know, e.g., a jammed matcher.
+        return 0;
+
+    ++dfa->stats.misses;
+
+    // Like RE2, we simply start over once we have reached our budget. That
+    // keeps the memory bounded and the bookkeeping trivial; states still in
+    // use get recomputed on their next access. Note that this invalidates
+    // all state pointers that callers may still hold, and renumbers the
+    // states.
+    if ( dfa->max_states && dfa->stats.states >= dfa->max_states ) {
+        id = dfa_flush(dfa, id);
+        dstate = (id == dfa->initial ? dfa->initial_dstate :
+                                       vec_dfa_state_elem_get(dfa->state_elems, id));
+    }
 
     dfa_state_compute(dfa->nfa->ctx, dfa, id, dstate, 0);
 
@@ -312,6 +338,110 @@ jrx_dfa_state* dfa_get_state(jrx_dfa* dfa, jrx_dfa_state_id id)
     return state;
 }
 
+// Returns the ID that an old state has after a flush, giving it a new one
+// if necessary.
+static jrx_dfa_state_id _dfa_carry_over(jrx_dfa* dfa, vec_dfa_state_elem* old_state_elems,
+                                        jrx_dfa_state_id old_initial, jrx_dfa_state_id id)
+{
+    if ( id == old_initial )
+        return dfa->initial;
+
+    set_dfa_state_elem* dstate = vec_dfa_state_elem_get(old_state_elems, id);
+
+    if ( ! dstate )
+        // Not a state we know, e.g., a jammed matcher.
+        return id;
+
+    khiter_t k = kh_get(dfa_state_elem, dfa->hstates, *dstate);
+    if ( k != kh_end(dfa->hstates) )
+        return kh_value(dfa->hstates, k);
+
+    dstate = set_dfa_state_elem_copy(dstate);
+    jrx_dfa_state_id nid = reserve_dfastate_id(dfa, dstate);
+    vec_dfa_state_elem_set(dfa->state_elems, nid, dstate);
+    return nid;
+}
+
+jrx_dfa_state_id dfa_flush(jrx_dfa* dfa, jrx_dfa_state_id keep)
+{
+    // We can recompute states only if we have recorded their NFA state
+    // sets, which we do just when building the DFA lazily.
+    if ( ! (dfa->options & JRX_OPTION_LAZY) )
+        return keep;
+
+    // We throw away all states and their sets, and start over with just
+    // the initial state. Match states in use get a fresh ID for the set
+    // they are currently in, as does the state the caller is about to
+    // compute.
+    vec_dfa_state* old_states = dfa->states;
+    vec_dfa_state_elem* old_state_elems = dfa->state_elems;
+    hash_dfa_state* old_hstates = dfa->hstates;
+    jrx_dfa_state_id old_initial = dfa->initial;
+
+    dfa->states = vec_dfa_state_create(0);
+    dfa->state_elems = vec_dfa_state_elem_create(0);
+    dfa->hstates = kh_init(dfa_state_elem);
+    dfa->stats.states = 0;
+    dfa->stats.sets = 0;
+    dfa->initial = reserve_dfastate_id(dfa, dfa->initial_dstate);
+
+    for ( jrx_match_state* ms = dfa->match_states; ms; ms = ms->next )
+        ms->state = _dfa_carry_over(dfa, old_state_elems, old_initial, ms->state);
+
+    keep = _dfa_carry_over(dfa, old_state_elems, old_initial, keep);
+
+    vec_for_each(dfa_state, old_states, old_state)
+    {
+        if ( old_state )
+            _dfa_state_delete(old_state);
+    }
+
+    vec_for_each(dfa_state_elem, old_state_elems, old_state_elem)
+    {
+        if ( old_state_elem )
+            set_dfa_state_elem_delete(old_state_elem);
+    }
+
+    vec_dfa_state_delete(old_states);
+    vec_dfa_state_elem_delete(old_state_elems);
+    kh_destroy(dfa_state_elem, old_hstates);
+
+    ++dfa->stats.flushes;
+
+    if ( dfa->options & JRX_OPTION_DEBUG )
+        fprintf(stderr, "> flushed DFA states (%" PRIu64 " flushes so far)\n", dfa->stats.flushes);
+
+    return keep;
+}
+
+void dfa_match_state_register(jrx_dfa* dfa, jrx_match_state* ms)
+{
+    ms->prev = 0;
+    ms->next = dfa->match_states;
+
+    if ( dfa->match_states )
+        dfa->match_states->prev = ms;
+
+    dfa->match_states = ms;
+}
+
+void dfa_match_state_unregister(jrx_dfa* dfa, jrx_match_state* ms)
+{
+    if ( ms->prev )
+        ms->prev->next = ms->next;
+    else if ( dfa->match_states == ms )
+        dfa->match_states = ms->next;
+    else
+        // Not registered (anymore).
+        return;
+
+    if ( ms->next )
+        ms->next->prev = ms->prev;
+
+    ms->prev = 0;
+    ms->next = 0;
+}
+
 jrx_dfa* dfa_from_nfa(jrx_nfa* nfa)
 {
     jrx_dfa* dfa = _dfa_create();
@@ -89,6 +89,9 @@ typedef struct jrx_dfa {
     hash_dfa_state* hstates;            // Hash of states indexed by set of NFA states.
     jrx_ccl_group* ccls;                // CCLs for the DFA.
     jrx_nfa* nfa;                       // The underlying NFA.
+    uint32_t max_states;                // Max. number of states to keep computed; 0 for no limit.
+    jrx_dfa_stats stats;                // Statistics about the lazily computed states.
+    jrx_match_state* match_states;      // Match states currently using the DFA.
 } jrx_dfa;
 
 
@@ -98,6 +101,9 @@ extern jrx_dfa* dfa_from_nfa(jrx_nfa* nfa);
 extern int dfa_state_compute(jrx_nfa_context* ctx, jrx_dfa* dfa, jrx_dfa_state_id id,
                              set_dfa_state_elem* dstate, int recurse);
 extern jrx_dfa_state* dfa_get_state(jrx_dfa* dfa, jrx_dfa_state_id id);
+extern jrx_dfa_state_id dfa_flush(jrx_dfa* dfa, jrx_dfa_state_id keep);
+extern void dfa_match_state_register(jrx_dfa* dfa, jrx_match_state* ms);
+extern void dfa_match_state_unregister(jrx_dfa* dfa, jrx_match_state* ms);
 extern void dfa_delete(jrx_dfa* dfa);
 extern void dfa_print(jrx_dfa* dfa, FILE* file);
 
@@ -171,6 +171,7 @@ void jrx_regset_init(jrx_regex_t* preg, int nmatch, int cflags)
     preg->nfa = 0;
     preg->dfa = 0;
     preg->errmsg = 0;
+    preg->max_states = 0;
 }
 
 int jrx_regset_add(jrx_regex_t* preg, const char* pattern, unsigned int len)
@@ -198,11 +199,28 @@ int jrx_regset_finalize(jrx_regex_t* preg)
         return REG_EMEM;
 
     preg->dfa = dfa;
+    preg->dfa->max_states = preg->max_states;
     preg->re_nsub = dfa->max_capture;
 
     return REG_OK;
 }
 
+void jrx_regset_set_max_states(jrx_regex_t* preg, uint32_t max_states)
+{
+    preg->max_states = max_states;
+
+    if ( preg->dfa )
+        preg->dfa->max_states = max_states;
+}
+
+void jrx_regstats(const jrx_regex_t* preg, jrx_dfa_stats* stats)
+{
+    if ( preg->dfa )
+        *stats = preg->dfa->stats;
+    else
+        memset(stats, 0, sizeof(*stats));
+}
+
 int jrx_regcomp(jrx_regex_t* preg, const char* pattern, int cflags)
 {
     jrx_regset_init(preg, -1, cflags);
@@ -345,7 +363,7 @@ int jrx_num_groups(jrx_regex_t* preg)
 
 int jrx_can_transition(jrx_match_state* ms)
 {
-    jrx_dfa_state* state = vec_dfa_state_get(ms->dfa->states, ms->state);
+    jrx_dfa_state* state = dfa_get_state(ms->dfa, ms->state);
 
     if ( ! state ) {
         if ( ms->dfa->options & JRX_OPTION_DEBUG )
@@ -373,6 +391,6 @@ int jrx_current_accept(jrx_match_state* ms)
 
     else {
         jrx_dfa_state* state = dfa_get_state(ms->dfa, ms->state);
-        return state->accepts ? vec_dfa_accept_get(state->accepts, 0).aid : 0;
+        return state && state->accepts ? vec_dfa_accept_get(state->accepts, 0).aid : 0;
     }
 }
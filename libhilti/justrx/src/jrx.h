@@ -52,8 +52,22 @@ struct jrx_match_state {
 
     // The following are only used with the minimal matcher.
     jrx_accept_id acc;
+
+    // Links the DFA's match states in use, so that a flush can carry them over.
+    struct jrx_match_state* prev;
+    struct jrx_match_state* next;
 };
 
+/// Statistics about the cache of states that a DFA compiled with REG_LAZY
+/// builds incrementally.
+typedef struct {
+    uint64_t hits;    ///< Number of lookups finding the state already computed.
+    uint64_t misses;  ///< Number of lookups that had to compute the state.
+    uint64_t flushes; ///< Number of times the cache was flushed for exceeding its budget.
+    uint32_t states;  ///< Number of states currently computed.
+    uint32_t sets;    ///< Number of NFA state sets currently kept, computed or not.
+} jrx_dfa_stats;
+
 typedef struct {
     size_t re_nsub; ///< Number of capture expressions in regular expression (POSIX).
 
@@ -61,6 +75,7 @@ typedef struct {
     int nmatch;          // Max. number of subexpression caller is interested in; -1 for all.
     struct jrx_nfa* nfa; // Compiled NFA, or NULL.
     struct jrx_dfa* dfa; // Compiled DFA, or NULL.
+    uint32_t max_states; // Max. number of DFA states to keep computed with REG_LAZY; 0 for no limit.
     const char* errmsg;  // Most recent error message, or NULL if none.
 } jrx_regex_t;
 
@@ -146,6 +161,8 @@ extern int jrx_reggroups(const jrx_regex_t* preg, jrx_match_state* ms, size_t nm
 extern int jrx_num_groups(jrx_regex_t* preg);
 extern int jrx_can_transition(jrx_match_state* ms);
 extern int jrx_current_accept(jrx_match_state* ms);
+extern void jrx_regset_set_max_states(jrx_regex_t* preg, uint32_t max_states);
+extern void jrx_regstats(const jrx_regex_t* preg, jrx_dfa_stats* stats);
 extern jrx_match_state* jrx_match_state_init(const jrx_regex_t* preg, jrx_offset begin,
                                              jrx_match_state* ms);
 extern void jrx_match_state_done(jrx_match_state* ms);
@@ -1,6 +1,7 @@
 // $Id$
 
 #include <ctype.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,7 +15,17 @@ static void print_error(int rc, regex_t* re, const char* prefix)
     printf("%s, %s\n", prefix, buffer);
 }
 
-static void do_match(char** argv, int argc, int opt, int options, char* data)
+static void print_stats(regex_t* re)
+{
+    jrx_dfa_stats stats;
+    jrx_regstats(re, &stats);
+    printf("  dfa cache: %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64
+           " flushes, %u states, %u sets\n",
+           stats.hits, stats.misses, stats.flushes, stats.states, stats.sets);
+}
+
+static void do_match(char** argv, int argc, int opt, int options, uint32_t max_states,
+                     char* data)
 {
     const int max_captures = 20;
 
@@ -41,8 +52,13 @@ static void do_match(char** argv, int argc, int opt, int options, char* data)
         return;
     }
 
+    jrx_regset_set_max_states(&re, max_states);
+
     rc = regexec(&re, data, max_captures, pmatch, 0);
 
+    if ( max_states )
+        print_stats(&re);
+
     if ( rc != 0 ) {
         print_error(rc, &re, "pattern not found");
         return;
@@ -93,6 +109,7 @@ int main(int argc, char** argv)
     int opt = 1;
     int debug = 0;
     int lazy = 0;
+    uint32_t max_states = 0;
 
     int i;
     char* d;
@@ -104,6 +121,12 @@ int main(int argc, char** argv)
         else if ( strcmp(argv[opt], "-l") == 0 )
             lazy = REG_LAZY;
 
+        else if ( strcmp(argv[opt], "-m") == 0 && argc > opt + 1 ) {
+            // Limiting the number of states requires building lazily.
+            lazy = REG_LAZY;
+            max_states = atoi(argv[++opt]);
+        }
+
         else
             break;
 
@@ -111,7 +134,7 @@ int main(int argc, char** argv)
     }
 
     if ( (argc - opt) < 1 ) {
-        fprintf(stderr, "usage: echo 'data' | retest [-d] [-l] <patterns>\n");
+        fprintf(stderr, "usage: echo 'data' | retest [-d] [-l] [-m <max-states>] <patterns>\n");
         return 1;
     }
 
@@ -132,13 +155,14 @@ int main(int argc, char** argv)
     fputs("\n", stderr);
 
     fprintf(stderr, "\n=== Standard matcher with subgroups\n");
-    do_match(argv, argc, opt, debug | lazy, data);
+    do_match(argv, argc, opt, debug | lazy, max_states, data);
 
     fprintf(stderr, "\n=== Standard matcher without subgroups\n");
-    do_match(argv, argc, opt, debug | lazy | REG_NOSUB | REG_STD_MATCHER, data);
+    do_match(argv, argc, opt, debug | lazy | REG_NOSUB | REG_STD_MATCHER, max_states,
+             data);
 
     fprintf(stderr, "\n=== Minimal matcher\n");
-    do_match(argv, argc, opt, debug | lazy | REG_NOSUB, data);
+    do_match(argv, argc, opt, debug | lazy | REG_NOSUB, max_states, data);
 
     exit(0);
 }
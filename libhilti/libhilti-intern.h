@@ -49,6 +49,7 @@
 #include "port.h"
 #include "profiler.h"
 #include "regexp.h"
+#include "sampler.h"
 #include "string_.h"
 #include "struct.h"
 #include "threading.h"
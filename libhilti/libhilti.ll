@@ -25,6 +25,7 @@
     %hlt.blockable*,              ; blockable
     i8*,                          ; tmgr
     i8*,
+    i8*,                          ; list_pool
     i8*,                          ; profiling state
     i64,                          ; debug_indent
     i8*  ;; Start of globals (right here, pointer content isn't used.)
@@ -24,3 +24,17 @@ __attribute__((weak)) uint64_t __hlt_globals_size()
 {
     return 0;
 }
+
+// This one does execute if the code hasn't been instrumented for
+// profile-guided optimization.
+__attribute__((weak)) const __hlt_pgo_profile* __hlt_pgo_data()
+{
+    return 0;
+}
+
+// This one does execute if the code doesn't use any profiler IDs.
+__attribute__((weak)) const char** __hlt_profiler_tags()
+{
+    static const char* tags[] = {0};
+    return tags;
+}
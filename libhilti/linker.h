@@ -7,9 +7,13 @@
 
 #include <stdint.h>
 
+#include "pgo.h"
+
 extern void __hlt_modules_init(void* ctx);
 extern void __hlt_globals_init(void* ctx);
 extern void __hlt_globals_dtor(void* ctx);
 extern uint64_t __hlt_globals_size() __attribute__((weak));
+extern const __hlt_pgo_profile* __hlt_pgo_data();
+extern const char** __hlt_profiler_tags();
 
 #endif
@@ -1,71 +1,309 @@
 //
-// The list implementation is pretty much a standard double-linked list.
+// The list is a double-linked list, yet elements aren't allocated
+// individually. Instead the list carves them out of larger chunks holding
+// several element slots each, and keeps unused slots around for reuse.
+// Slots never move once allocated, so iterators remain stable across
+// insertions and removals of other elements.
 //
-// NOTE: Unlike the old libhilti list implementation, there's no free list
-// because that doesn't work well with ref'cnt. If we get a problem with too
-// many small allocations, we could let the list do its own mem mgt though.
-
+// As list elements aren't separate objects, they aren't ref-counted either.
+// Iterators instead pin the slot they point to: an erased slot stays marked
+// as such until the last iterator referencing it goes away, and only then
+// becomes available for reuse. Chunks that become entirely unused are
+// returned to a per-context pool, from where any list with the same slot
+// size can pick them up again.
+
+#include <stddef.h>
 #include <string.h>
 
 #include "autogen/hilti-hlt.h"
+#include "context.h"
 #include "enum.h"
+#include "expire.h"
 #include "interval.h"
 #include "list.h"
 #include "timer.h"
 
+// Number of element slots per chunk.
+#define CHUNK_SLOTS 8
+
+// Slot sizes are rounded up to multiples of this.
+#define SLOT_ALIGN 8
+
+// Number of slot size classes the per-context pool tracks. Chunks for
+// element types larger than that are never pooled.
+#define POOL_CLASSES 32
+
+// Maximum number of free chunks the per-context pool keeps per size class.
+#define POOL_MAX_CHUNKS 64
+
+// States of a slot.
+#define SLOT_FREE 0   // Unused, and on the list's free list.
+#define SLOT_LIVE 1   // Holds a list element.
+#define SLOT_ERASED 2 // Element has been removed, but iterators still pin the slot.
+
+typedef struct __hlt_list_chunk __hlt_list_chunk;
+
 struct __hlt_list_node {
-    __hlt_gchdr __gchdr;   // Header for memory management.
-    __hlt_list_node* next; // Successor node. Memory-managed.
-    __hlt_list_node* prev; // Predecessor node. Not memory-managed to avoid cycles.
-    hlt_timer*
-        timer; // The entry's timer, or null if none is set. Not memory-managed to avoid cycles.
-    const hlt_type_info* type; // FIXME: Do we get around storing this with each node?
-    int64_t invalid;           // True if node has been invalidated.
-                               // FIXME: int64_t to align the data; how else to do that?
-    char data[];               // Node data starts here, with size determined by elem type.
+    __hlt_list_node* next;    // Successor element; or next free slot if unused.
+    __hlt_list_node* prev;    // Predecessor element; or previous free slot if unused.
+    __hlt_expire_node expire; // Link into the list's expiration list.
+    uint32_t pins;            // Number of iterators referencing the slot.
+    uint16_t index;           // Index of the slot inside its chunk.
+    uint16_t state;           // One of SLOT_*. Also pads the header so that data is aligned.
+    char data[];              // Element data starts here, with size determined by elem type.
+};
+
+struct __hlt_list_chunk {
+    __hlt_list_chunk* next; // Next chunk owned by the same list, or next chunk in the pool.
+    __hlt_list_chunk* prev; // Previous chunk owned by the same list.
+    int64_t used;           // Number of slots that aren't on the free list.
+    int64_t slot_size;      // Size of each slot in bytes.
+    char slots[];           // The slots start here.
+};
+
+struct __hlt_list_pool {
+    __hlt_list_chunk* chunks[POOL_CLASSES]; // Free chunks, indexed by slot size class.
+    int64_t size[POOL_CLASSES];             // Number of chunks in each class.
 };
 
 struct __hlt_list {
     __hlt_gchdr __gchdr;       // Header for memory management.
-    __hlt_list_node* head;     // First list element. Memory-managed.
-    __hlt_list_node* tail;     // Last list element. Not memory-managed to avoid cycles.
+    __hlt_list_node* head;     // First list element.
+    __hlt_list_node* tail;     // Last list element.
+    __hlt_list_node* free;     // Unused slots across all of the list's chunks.
+    __hlt_list_chunk* chunks;  // All chunks owned by the list.
     int64_t size;              // Current list size.
+    int64_t slot_size;         // Size of the element slots in bytes.
     const hlt_type_info* type; // Element type.
     hlt_timer_mgr* tmgr;       // The timer manager, or null if not used.
     hlt_interval timeout;      // The timeout value, or 0 if disabled.
     hlt_enum strategy;         // Expiration strategy if set; zero otherwise.
+    __hlt_expire_list expire;  // Elements subject to expiration.
 };
 
-__HLT_RTTI_GC_TYPE(__hlt_list_node, HLT_TYPE_LIST_NODE);
+static inline int64_t _slot_size(const hlt_type_info* type)
+{
+    int64_t size = sizeof(__hlt_list_node) + type->size;
+    return (size + SLOT_ALIGN - 1) & ~(int64_t)(SLOT_ALIGN - 1);
+}
+
+// Returns the pool's size class for a slot size, or -1 if not pooled.
+static inline int _pool_class(int64_t slot_size)
+{
+    int64_t c = (slot_size - sizeof(__hlt_list_node)) / SLOT_ALIGN;
+    return c < POOL_CLASSES ? (int)c : -1;
+}
 
-void __hlt_list_node_dtor(hlt_type_info* ti, __hlt_list_node* n, hlt_execution_context* ctx)
+static inline __hlt_list_node* _slot(__hlt_list_chunk* c, int64_t idx)
 {
-    GC_DTOR(n->next, __hlt_list_node, ctx);
-    GC_DTOR_GENERIC(&n->data, n->type, ctx);
-    n->next = 0;
+    return (__hlt_list_node*)(c->slots + idx * c->slot_size);
+}
+
+static inline __hlt_list_chunk* _chunk(hlt_list* l, __hlt_list_node* n)
+{
+    return (__hlt_list_chunk*)((char*)n - n->index * l->slot_size -
+                               offsetof(__hlt_list_chunk, slots));
+}
+
+static inline __hlt_list_node* _expire_node(__hlt_expire_node* e)
+{
+    return (__hlt_list_node*)((char*)e - offsetof(__hlt_list_node, expire));
+}
+
+__hlt_list_pool* __hlt_list_pool_new()
+{
+    return hlt_malloc(sizeof(__hlt_list_pool));
+}
+
+void __hlt_list_pool_delete(__hlt_list_pool* pool)
+{
+    if ( ! pool )
+        return;
+
+    for ( int i = 0; i < POOL_CLASSES; i++ ) {
+        __hlt_list_chunk* c = pool->chunks[i];
+
+        while ( c ) {
+            __hlt_list_chunk* next = c->next;
+            hlt_free(c);
+            c = next;
+        }
+    }
+
+    hlt_free(pool);
+}
+
+// Returns an uninitialized chunk, taken from the context's pool if
+// possible.
+static __hlt_list_chunk* _chunk_alloc(int64_t slot_size, hlt_execution_context* ctx)
+{
+    int cls = _pool_class(slot_size);
+    __hlt_list_pool* pool = ctx ? ctx->list_pool : 0;
+
+    if ( pool && cls >= 0 && pool->chunks[cls] ) {
+        __hlt_list_chunk* c = pool->chunks[cls];
+        pool->chunks[cls] = c->next;
+        --pool->size[cls];
+        return c;
+    }
+
+    return hlt_malloc(sizeof(__hlt_list_chunk) + CHUNK_SLOTS * slot_size);
+}
+
+// Returns a chunk to the context's pool, or releases it if the pool is full.
+static void _chunk_free(__hlt_list_chunk* c, hlt_execution_context* ctx)
+{
+    int cls = _pool_class(c->slot_size);
+    __hlt_list_pool* pool = ctx ? ctx->list_pool : 0;
+
+    if ( ! pool || cls < 0 || pool->size[cls] >= POOL_MAX_CHUNKS ) {
+        hlt_free(c);
+        return;
+    }
+
+    c->next = pool->chunks[cls];
+    c->prev = 0;
+    pool->chunks[cls] = c;
+    ++pool->size[cls];
+}
+
+static inline void _free_push(hlt_list* l, __hlt_list_node* n)
+{
+    n->state = SLOT_FREE;
+    n->prev = 0;
+    n->next = l->free;
+
+    if ( l->free )
+        l->free->prev = n;
+
+    l->free = n;
+}
+
+static inline void _free_remove(hlt_list* l, __hlt_list_node* n)
+{
+    if ( n->prev )
+        n->prev->next = n->next;
+    else
+        l->free = n->next;
+
+    if ( n->next )
+        n->next->prev = n->prev;
+
+    n->next = n->prev = 0;
+}
+
+// Adds a new chunk to the list, putting all its slots on the free list.
+static void _add_chunk(hlt_list* l, hlt_execution_context* ctx)
+{
+    __hlt_list_chunk* c = _chunk_alloc(l->slot_size, ctx);
+    c->slot_size = l->slot_size;
+    c->used = 0;
+    c->prev = 0;
+    c->next = l->chunks;
+
+    if ( l->chunks )
+        l->chunks->prev = c;
+
+    l->chunks = c;
+
+    for ( int64_t i = CHUNK_SLOTS - 1; i >= 0; i-- ) {
+        __hlt_list_node* n = _slot(c, i);
+        n->index = i;
+        n->pins = 0;
+        _free_push(l, n);
+    }
+}
+
+// Returns an unused slot, with its data not yet initialized.
+static __hlt_list_node* _alloc_slot(hlt_list* l, hlt_execution_context* ctx)
+{
+    if ( ! l->free )
+        _add_chunk(l, ctx);
+
+    __hlt_list_node* n = l->free;
+    _free_remove(l, n);
+    ++_chunk(l, n)->used;
+
+    n->state = SLOT_LIVE;
+    n->expire.prev = n->expire.next = 0;
+    return n;
+}
+
+// Puts a slot back on the free list. If that leaves its chunk entirely
+// unused, returns the chunk to the pool unless it's the list's only one.
+static void _release_slot(hlt_list* l, __hlt_list_node* n, hlt_execution_context* ctx)
+{
+    assert(! n->pins);
+
+    __hlt_list_chunk* c = _chunk(l, n);
+    _free_push(l, n);
+
+    if ( --c->used || ! (c->next || c->prev) )
+        return;
+
+    for ( int64_t i = 0; i < CHUNK_SLOTS; i++ )
+        _free_remove(l, _slot(c, i));
+
+    if ( c->prev )
+        c->prev->next = c->next;
+    else
+        l->chunks = c->next;
+
+    if ( c->next )
+        c->next->prev = c->prev;
+
+    _chunk_free(c, ctx);
 }
 
 void hlt_list_dtor(hlt_type_info* ti, hlt_list* l, hlt_execution_context* ctx)
 {
-    GC_DTOR(l->head, __hlt_list_node, ctx);
+    if ( l->expire.timer ) {
+        hlt_exception* excpt = 0;
+        hlt_timer_cancel(l->expire.timer, &excpt, ctx);
+    }
+
+    for ( __hlt_list_node* n = l->head; n; n = n->next )
+        GC_DTOR_GENERIC(&n->data, l->type, ctx);
+
+    __hlt_list_chunk* c = l->chunks;
+
+    while ( c ) {
+        __hlt_list_chunk* next = c->next;
+        _chunk_free(c, ctx);
+        c = next;
+    }
+
     GC_DTOR(l->tmgr, hlt_timer_mgr, ctx);
 }
 
 void hlt_iterator_list_cctor(hlt_type_info* ti, hlt_iterator_list* i, hlt_execution_context* ctx)
 {
     GC_CCTOR(i->list, hlt_list, ctx);
-    GC_CCTOR(i->node, __hlt_list_node, ctx);
+
+    if ( i->node )
+        ++i->node->pins;
 }
 
 void hlt_iterator_list_dtor(hlt_type_info* ti, hlt_iterator_list* i, hlt_execution_context* ctx)
 {
+    if ( i->node && --i->node->pins == 0 && i->node->state == SLOT_ERASED )
+        _release_slot(i->list, i->node, ctx);
+
     GC_DTOR(i->list, hlt_list, ctx);
-    GC_DTOR(i->node, __hlt_list_node, ctx);
 }
 
-// Inserts n after node pos. If pos is null, inserts at front. n must be all
-// zero-initialized and already ref'ed.
-static void _link(hlt_list* l, __hlt_list_node* n, __hlt_list_node* pos, hlt_execution_context* ctx)
+// Schedules the list's timer if it has expiring elements but no timer yet.
+static inline void _schedule_list(hlt_list* l, hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    if ( l->expire.timer || ! l->expire.head )
+        return;
+
+    hlt_timer* t = __hlt_timer_new_list(l, excpt, ctx);
+    __hlt_expire_list_schedule(&l->expire, l->tmgr, t, excpt, ctx);
+}
+
+// Inserts n after node pos. If pos is null, inserts at front.
+static void _link(hlt_list* l, __hlt_list_node* n, __hlt_list_node* pos)
 {
     if ( pos ) {
         if ( pos->next )
@@ -73,97 +311,79 @@ static void _link(hlt_list* l, __hlt_list_node* n, __hlt_list_node* pos, hlt_exe
         else
             l->tail = n;
 
-        GC_ASSIGN(n->next, pos->next, __hlt_list_node, ctx);
-        GC_ASSIGN_REFED(pos->next, n, __hlt_list_node, ctx);
+        n->next = pos->next;
         n->prev = pos;
+        pos->next = n;
     }
 
     else {
         // Insert at head.
-        GC_ASSIGN(n->next, l->head, __hlt_list_node, ctx);
+        n->next = l->head;
+        n->prev = 0;
 
         if ( l->head )
             l->head->prev = n;
         else
             l->tail = n;
 
-        GC_ASSIGN_REFED(l->head, n, __hlt_list_node, ctx);
+        l->head = n;
     }
 
     ++l->size;
 }
 
-// Unlinks the node from the list and invalidates it, including stopping its
-// timer.
-static void _unlink(hlt_list* l, __hlt_list_node* n, hlt_exception** excpt,
-                    hlt_execution_context* ctx)
+// Unlinks the node from the list and invalidates it, including removing it
+// from the expiration list. The slot becomes available for reuse once no
+// iterator refers to it anymore.
+static void _unlink(hlt_list* l, __hlt_list_node* n, hlt_execution_context* ctx)
 {
     if ( n->next )
         n->next->prev = n->prev;
     else
         l->tail = n->prev;
 
-    // We don't ref/unref n->next here as we just move ownership. But we
-    // ref/unref n once to avoid potentially deleting it while we move
-    // pointers around.
-
-    GC_CCTOR(n, __hlt_list_node, ctx);
-
-    if ( n->prev ) {
-        GC_ASSIGN_REFED(n->prev->next, n->next, __hlt_list_node, ctx);
-    }
-    else {
-        GC_ASSIGN_REFED(l->head, n->next, __hlt_list_node, ctx);
-    }
+    if ( n->prev )
+        n->prev->next = n->next;
+    else
+        l->head = n->next;
 
     n->next = 0;
     n->prev = 0;
-    n->invalid = 1;
     --l->size;
 
-    if ( n->timer && ctx )
-        hlt_timer_cancel(n->timer, excpt, ctx);
+    if ( __hlt_expire_list_contains(&l->expire, &n->expire) )
+        __hlt_expire_list_unlink(&l->expire, &n->expire);
 
-    n->timer = 0;
+    GC_DTOR_GENERIC(&n->data, l->type, ctx);
 
-    GC_DTOR(n, __hlt_list_node, ctx);
+    if ( n->pins )
+        n->state = SLOT_ERASED;
+    else
+        _release_slot(l, n, ctx);
 }
 
-// Returns a ref'ed node. Val not yet ref'ed.
+// Returns a new node holding a copy of val. Val not yet ref'ed.
 static __hlt_list_node* _make_node(hlt_list* l, void* val, hlt_exception** excpt,
                                    hlt_execution_context* ctx)
 {
-    __hlt_list_node* n =
-        GC_NEW_CUSTOM_SIZE_REF(__hlt_list_node, sizeof(__hlt_list_node) + l->type->size, ctx);
-    n->type = l->type;
-
-    // Other fields are null initialized.
+    __hlt_list_node* n = _alloc_slot(l, ctx);
 
     memcpy(&n->data, val, l->type->size);
     GC_CCTOR_GENERIC(&n->data, l->type, ctx);
 
-    hlt_time t =
-        (l->tmgr && l->timeout) ? hlt_timer_mgr_current(l->tmgr, excpt, ctx) + l->timeout : 0;
-
-    if ( t ) {
-        assert(l->tmgr);
-        __hlt_list_timer_cookie cookie = {l, n};
-        GC_CCTOR(cookie, hlt_iterator_list, ctx);
-        n->timer = __hlt_timer_new_list(cookie, excpt, ctx);
-        hlt_timer_mgr_schedule(l->tmgr, t, n->timer, excpt, ctx);
-        GC_DTOR(n->timer, hlt_timer, ctx); // Not memory-managed on our end.
+    if ( l->tmgr && l->timeout ) {
+        hlt_time t = hlt_timer_mgr_current(l->tmgr, excpt, ctx) + l->timeout;
+        __hlt_expire_list_append(&l->expire, &n->expire, t);
+        _schedule_list(l, excpt, ctx);
     }
 
-    else
-        n->timer = 0;
-
     return n;
 }
 
 // Returns true if the node has been marked invalid.
-static int _invalid_node(__hlt_list_node* n)
+static inline int _invalid_node(__hlt_list_node* n)
 {
-    return n->invalid;
+    return n->state != SLOT_LIVE;
 }
 
 static inline void _access(hlt_list* l, __hlt_list_node* n, hlt_exception** excpt,
@@ -173,22 +393,28 @@ static inline void _access(hlt_list* l, __hlt_list_node* n, hlt_exception** excp
          l->timeout == 0 )
         return;
 
-    if ( ! n->timer )
+    if ( ! __hlt_expire_list_contains(&l->expire, &n->expire) )
         return;
 
+    // No need to update the timer. If it fires too early now, we'll
+    // reschedule it.
     hlt_time t = hlt_timer_mgr_current(l->tmgr, excpt, ctx) + l->timeout;
-    hlt_timer_update(n->timer, t, excpt, ctx);
+    __hlt_expire_list_touch(&l->expire, &n->expire, t);
 }
 
 static inline void _hlt_list_init(hlt_list* l, const hlt_type_info* elemtype, hlt_timer_mgr* tmgr,
                                   hlt_exception** excpt, hlt_execution_context* ctx)
 {
     GC_INIT(l->tmgr, tmgr, hlt_timer_mgr, ctx);
-    l->head = l->tail = 0;
+    l->head = l->tail = l->free = 0;
+    l->chunks = 0;
     l->size = 0;
     l->type = elemtype;
+    l->slot_size = _slot_size(elemtype);
     l->timeout = 0.0;
     l->strategy = hlt_enum_unset(excpt, ctx);
+    l->expire.head = l->expire.tail = 0;
+    l->expire.timer = 0;
 }
 
 hlt_list* hlt_list_new(const hlt_type_info* elemtype, hlt_timer_mgr* tmgr, hlt_exception** excpt,
@@ -207,15 +433,34 @@ static void _clone_init_in_thread(const hlt_type_info* ti, void* dstp, hlt_excep
     // If we arrive here, it can't be a custom timer mgr but only the
     // thread-wide one.
     dst->tmgr = ctx->tmgr;
-    GC_DTOR(dst->tmgr, hlt_timer_mgr, ctx);
+    GC_CCTOR(dst->tmgr, hlt_timer_mgr, ctx);
 
-    for ( __hlt_list_node* n = dst->head; n; n = n->next ) {
-        if ( ! n->timer )
-            continue;
+    _schedule_list(dst, excpt, ctx);
+}
+
+// Adds a node to the expiration list, keeping the list ordered by time.
+// Used when cloning, where we can't rely on appending in order.
+static void _expire_insert_ordered(hlt_list* l, __hlt_list_node* n, hlt_time t)
+{
+    __hlt_expire_node* pos = l->expire.tail;
+
+    while ( pos && pos->time > t )
+        pos = pos->prev;
 
-        hlt_timer_mgr_schedule(dst->tmgr, n->timer->time, n->timer, excpt, ctx);
-        GC_DTOR(n->timer, hlt_timer, ctx); // Not memory-managed on our end.
+    if ( pos == l->expire.tail ) {
+        __hlt_expire_list_append(&l->expire, &n->expire, t);
+        return;
     }
+
+    n->expire.time = t;
+    n->expire.prev = pos;
+    n->expire.next = pos ? pos->next : l->expire.head;
+    n->expire.next->prev = &n->expire;
+
+    if ( pos )
+        pos->next = &n->expire;
+    else
+        l->expire.head = &n->expire;
 }
 
 void* hlt_list_clone_alloc(const hlt_type_info* ti, void* srcp, __hlt_clone_state* cstate,
@@ -237,32 +482,18 @@ void hlt_list_clone_init(void* dstp, const hlt_type_info* ti, void* srcp, __hlt_
         return;
     }
 
-    dst->head = dst->tail = 0;
-    dst->size = 0;
-    dst->type = src->type;
+    _hlt_list_init(dst, src->type, 0, excpt, ctx); // tmgr set by init_in_thread().
     dst->timeout = src->timeout;
     dst->strategy = src->strategy;
-    dst->tmgr = 0; // Set by init_in_thread().
 
     for ( __hlt_list_node* ns = src->head; ns; ns = ns->next ) {
-        __hlt_list_node* nd =
-            GC_NEW_CUSTOM_SIZE_REF(__hlt_list_node, sizeof(__hlt_list_node) + dst->type->size, ctx);
-        nd->type = ns->type;
-
-        __hlt_clone(&nd->data, nd->type, &ns->data, cstate, excpt, ctx);
-
-        if ( ns->timer ) {
-            __hlt_list_timer_cookie cookie = {dst, nd};
-            GC_CCTOR(cookie, hlt_iterator_list, ctx);
-            hlt_timer* t = __hlt_timer_new_list(cookie, excpt, ctx);
-            t->time = ns->timer->time;
-            nd->timer = t;
-        }
+        __hlt_list_node* nd = _alloc_slot(dst, ctx);
+        __hlt_clone(&nd->data, dst->type, &ns->data, cstate, excpt, ctx);
 
-        else
-            nd->timer = 0;
+        if ( __hlt_expire_list_contains(&src->expire, &ns->expire) )
+            _expire_insert_ordered(dst, nd, ns->expire.time);
 
-        _link(dst, nd, dst->tail, ctx);
+        _link(dst, nd, dst->tail);
     }
 
     if ( src->tmgr )
@@ -285,35 +516,27 @@ void hlt_list_push_front(hlt_list* l, const hlt_type_info* type, void* val, hlt_
     assert(__hlt_type_equal(l->type, type));
 
     __hlt_list_node* n = _make_node(l, val, excpt, ctx);
-    if ( ! n ) {
-        hlt_set_exception(excpt, &hlt_exception_out_of_memory, 0, ctx);
-        return;
-    }
-
-    _link(l, n, 0, ctx);
+    _link(l, n, 0);
 }
 
 void hlt_list_push_back(hlt_list* l, const hlt_type_info* type, void* val, hlt_exception** excpt,
                         hlt_execution_context* ctx)
 {
-    // fprintf(stderr, "%s|%s\n", l->type->tag, type->tag);
-
     assert(__hlt_type_equal(l->type, type));
 
     __hlt_list_node* n = _make_node(l, val, excpt, ctx);
-    if ( ! n ) {
-        hlt_set_exception(excpt, &hlt_exception_out_of_memory, 0, ctx);
-        return;
-    }
-
-    _link(l, n, l->tail, ctx);
+    _link(l, n, l->tail);
 }
 
 void hlt_list_append(hlt_list* l1, hlt_list* l2, hlt_exception** excpt, hlt_execution_context* ctx)
 {
     assert(__hlt_type_equal(l1->type, l2->type));
 
-    for ( __hlt_list_node* n = l2->head; n; n = n->next )
+    // Go by size so that appending a list to itself terminates.
+    int64_t size = l2->size;
+    __hlt_list_node* n = l2->head;
+
+    for ( int64_t i = 0; i < size; i++, n = n->next )
         hlt_list_push_back(l1, l2->type, &n->data, excpt, ctx);
 }
 
@@ -324,7 +547,7 @@ void hlt_list_pop_front(hlt_list* l, hlt_exception** excpt, hlt_execution_contex
         return;
     }
 
-    _unlink(l, l->head, excpt, ctx);
+    _unlink(l, l->head, ctx);
 }
 
 void hlt_list_pop_back(hlt_list* l, hlt_exception** excpt, hlt_execution_context* ctx)
@@ -334,7 +557,7 @@ void hlt_list_pop_back(hlt_list* l, hlt_exception** excpt, hlt_execution_context
         return;
     }
 
-    _unlink(l, l->tail, excpt, ctx);
+    _unlink(l, l->tail, ctx);
 }
 
 void* hlt_list_front(hlt_list* l, hlt_exception** excpt, hlt_execution_context* ctx)
@@ -378,13 +601,22 @@ void hlt_list_erase(hlt_iterator_list i, hlt_exception** excpt, hlt_execution_co
         return;
     }
 
-    _unlink(i.list, i.node, excpt, ctx);
+    _unlink(i.list, i.node, ctx);
 }
 
-void hlt_list_expire(__hlt_list_timer_cookie cookie, hlt_exception** excpt,
-                     hlt_execution_context* ctx)
+void hlt_list_expire(__hlt_list_timer_cookie l, hlt_exception** excpt, hlt_execution_context* ctx)
 {
-    _unlink(cookie.list, cookie.node, 0, 0); // don't pass context on
+    hlt_time now = __hlt_expire_list_now(&l->expire, l->tmgr, excpt, ctx);
+
+    // The timer manager deletes the timer once we return.
+    l->expire.timer = 0;
+
+    __hlt_expire_node* n;
+
+    while ( (n = __hlt_expire_list_expired(&l->expire, now)) )
+        _unlink(l, _expire_node(n), ctx);
+
+    _schedule_list(l, excpt, ctx);
 }
 
 void hlt_list_insert(const hlt_type_info* type, void* val, hlt_iterator_list i,
@@ -398,16 +630,12 @@ void hlt_list_insert(const hlt_type_info* type, void* val, hlt_iterator_list i,
     assert(__hlt_type_equal(i.list->type, type));
 
     __hlt_list_node* n = _make_node(i.list, val, excpt, ctx);
-    if ( ! n ) {
-        hlt_set_exception(excpt, &hlt_exception_out_of_memory, 0, ctx);
-        return;
-    }
 
     if ( ! i.node )
         // Insert at end.
-        _link(i.list, n, i.list->tail, ctx);
+        _link(i.list, n, i.list->tail);
     else
-        _link(i.list, n, i.node->prev, ctx);
+        _link(i.list, n, i.node->prev);
 }
 
 hlt_iterator_list hlt_list_begin(hlt_list* l, hlt_exception** excpt, hlt_execution_context* ctx)
@@ -15,8 +15,9 @@ struct __hlt_iterator_list {
 
 struct __hlt_timer_mgr;
 
-/// Cookie for entry expiration timers.
-typedef struct __hlt_iterator_list __hlt_list_timer_cookie;
+/// Cookie for entry expiration timers. The timer fires for the list as a
+/// whole, which then removes all entries that are due.
+typedef hlt_list* __hlt_list_timer_cookie;
 
 // Creates a new list.
 extern hlt_list* hlt_list_new(const hlt_type_info* elemtype, struct __hlt_timer_mgr* tmgr,
@@ -102,10 +103,18 @@ extern const hlt_type_info* hlt_list_element_type(const hlt_type_info* type, hlt
 extern const hlt_type_info* hlt_list_element_type_from_list(hlt_list* l, hlt_exception** excpt,
                                                             hlt_execution_context* ctx);
 
-/// Called by an expiring timer to remove an element from the list.
+/// Called by an expiring timer to remove all due elements from the list.
 ///
-/// cookie: The cookie identifying the element to be removed.
+/// cookie: The cookie identifying the list.
 extern void hlt_list_expire(__hlt_list_timer_cookie cookie, hlt_exception** excpt,
                             hlt_execution_context* ctx);
 
+/// Internal function to create a new, initially empty pool of storage
+/// chunks for lists to reuse.
+extern __hlt_list_pool* __hlt_list_pool_new();
+
+/// Internal function to delete a pool of list storage chunks, releasing all
+/// the memory it holds.
+extern void __hlt_list_pool_delete(__hlt_list_pool* pool);
+
 #endif
@@ -17,6 +17,7 @@
 
 static struct option long_options[] = {{"threads", required_argument, 0, 't'},
                                        {"profile", no_argument, 0, 'P'},
+                                       {"sample", required_argument, 0, 'S'},
                                        {0, 0, 0, 0}};
 
 static void usage(const char* prog)
@@ -27,6 +28,7 @@ static void usage(const char* prog)
         "  -h | --help                 Show usage information.\n"
         "  -t | --threads <num>        Number of worker threads; zero disables. [Default: 2.]\n"
         "  -P | --profile              Activate profiling support.\n"
+        "  -S | --sample <hz>          Sample stacks <hz> times per second of CPU time.\n"
         "  -Z | --dump-libhilti-state Dump global libhilti state to stderr for debugging.\n"
         "\n",
         prog);
@@ -51,7 +53,7 @@ __attribute__((weak)) int main(int argc, char** argv)
     hlt_config cfg = *hlt_config_get();
 
     while ( 1 ) {
-        char c = getopt_long(argc, argv, "ht:PZ", long_options, 0);
+        char c = getopt_long(argc, argv, "ht:PS:Z", long_options, 0);
 
         if ( c == -1 )
             break;
@@ -65,6 +67,10 @@ __attribute__((weak)) int main(int argc, char** argv)
             cfg.profiling = 1;
             break;
 
+        case 'S':
+            cfg.sampling = atoi(optarg);
+            break;
+
         case 'Z':
             dump_libhilti_state = 1;
             break;
@@ -2,26 +2,54 @@
 #include "map_set.h"
 #include "autogen/hilti-hlt.h"
 #include "enum.h"
+#include "expire.h"
 #include "interval.h"
 #include "timer.h"
 
+#include <stddef.h>
 #include <string.h>
 
 typedef hlt_hash khint_t;
 typedef void* __val_t;
 
+// Per-entry bookkeeping for entries that expire or may be evicted. We
+// allocate it together with the entry's key, with the key following
+// directly after the header. As keys don't move when khash resizes, that
+// gives us stable list nodes without further allocations, and we can get
+// back from a node to its hash entry through the key.
 typedef struct {
-    __val_t val; // The value stored in the map.
-    hlt_timer*
-        timer; // The entry's timer, or null if none is set. Not memory-managed to avoid cycles.
+    __hlt_expire_node expire; // Link into the container's expiration list.
+    __hlt_expire_node evict;  // Link into the container's eviction list.
+    int64_t referenced;       // Reference bit for CLOCK eviction. int64_t to keep the key aligned.
+} __hlt_entry_hdr;
+
+typedef struct {
+    __val_t val;          // The value stored in the map.
+    __hlt_entry_hdr* hdr; // The entry's header, or null if it doesn't have one.
 } __khval_map_t;
 
-typedef hlt_timer* __khval_set_t; // The value stored for sets. Not memory-managed to avoid cycles.
+typedef __hlt_entry_hdr* __khval_set_t; // The value stored for sets; the entry's header, or null
+                                        // if it doesn't have one.
 
 #include "3rdparty/khash/khash.h"
 
 enum MapDefaultType { HLT_MAP_DEFAULT_NONE, HLT_MAP_DEFAULT_VALUE, HLT_MAP_DEFAULT_FUNCTION };
 
+// Internal version of Hilti::EvictStrategy.
+enum EvictStrategy { HLT_EVICT_NONE, HLT_EVICT_LRU, HLT_EVICT_CLOCK, HLT_EVICT_RANDOM };
+
+// State for bounding the size of a map or set.
+typedef struct {
+    enum EvictStrategy strategy; // Eviction strategy; NONE if not bounded.
+    int64_t max_entries;         // Maximum number of entries, or 0 for no limit.
+    int64_t max_bytes;           // Maximum approximate size in bytes, or 0 for no limit.
+    int64_t bytes;               // Approximate size of all entries in bytes.
+    int64_t evicted;             // Number of entries evicted so far.
+    uint64_t rand;               // State of the PRNG for random eviction.
+    hlt_callable* function;      // Function to call for evicted entries, or null.
+    __hlt_expire_list list;      // Entries in eviction order for LRU and CLOCK.
+} __hlt_limit;
+
 typedef struct __hlt_map {
     __hlt_gchdr __gchdr;              // Header for memory management.
     const hlt_type_info* tkey;        // Key type.
@@ -29,6 +57,8 @@ typedef struct __hlt_map {
     hlt_timer_mgr* tmgr;              // The timer manager, or null if not used.
     hlt_interval timeout;             // The timeout value, or 0 if disabled
     hlt_enum strategy;                // Expiration strategy if set; zero otherwise.
+    __hlt_expire_list expire;         // Entries subject to expiration.
+    __hlt_limit limit;                // Size bound.
     enum MapDefaultType default_type; // Type of the map's default.
     union {
         __val_t value;          // Default value for HLT_MAP_DEFAULT_VALUE
@@ -37,6 +67,7 @@ typedef struct __hlt_map {
 
     void* cache_result;  // Cache for deref's result tuple.
     void* cache_default; // Cache for DEFAULT_FUNCTION's result value.
+    uint64_t version;    // Incremented each time the map's content changes.
 
     // These are used by khash and copied from there (see README.HILTI).
     khint_t n_buckets, size, n_occupied, upper_bound;
@@ -51,6 +82,9 @@ typedef struct __hlt_set {
     hlt_timer_mgr* tmgr;       // The timer manager, or null if not used.
     hlt_interval timeout;      // The timeout value, or 0 if disabled
     hlt_enum strategy;         // Expiration strategy if set; zero otherwise.
+    __hlt_expire_list expire;  // Entries subject to expiration.
+    __hlt_limit limit;         // Size bound.
+    uint64_t version;          // Incremented each time the set's content changes.
 
     // These are used by khash and copied from there (see README.HILTI).
     khint_t n_buckets, size, n_occupied, upper_bound;
@@ -72,6 +106,47 @@ static inline int8_t _kh_hash_equal(const void* obj1, const void* obj2, const hl
 KHASH_INIT(map, __khkey_t, __khval_map_t, 1, _kh_hash_func, _kh_hash_equal)
 KHASH_INIT(set, __khkey_t, __khval_set_t, 1, _kh_hash_func, _kh_hash_equal)
 
+// Returns the key stored behind an entry header.
+static inline void* _hdr_key(__hlt_entry_hdr* h)
+{
+    return (char*)h + sizeof(__hlt_entry_hdr);
+}
+
+// Allocates storage for a key, preceded by an entry header if requested.
+static inline void* _key_alloc(const hlt_type_info* type, int8_t hdr)
+{
+    if ( ! hdr )
+        return hlt_malloc(type->size);
+
+    __hlt_entry_hdr* h = hlt_malloc(sizeof(__hlt_entry_hdr) + type->size);
+    return _hdr_key(h);
+}
+
+// Returns the header allocated along with a key. Must only be called for
+// keys allocated with _key_alloc(..., 1).
+static inline __hlt_entry_hdr* _key_hdr(void* key)
+{
+    return (__hlt_entry_hdr*)((char*)key - sizeof(__hlt_entry_hdr));
+}
+
+// Releases a key allocated with _key_alloc(), along with its header if any.
+static inline void _key_free(void* key, __hlt_entry_hdr* h)
+{
+    hlt_free(h ? (void*)h : key);
+}
+
+// Returns the header that an expiration list node belongs to.
+static inline __hlt_entry_hdr* _expire_hdr(__hlt_expire_node* n)
+{
+    return (__hlt_entry_hdr*)((char*)n - offsetof(__hlt_entry_hdr, expire));
+}
+
+// Returns the header that an eviction list node belongs to.
+static inline __hlt_entry_hdr* _evict_hdr(__hlt_expire_node* n)
+{
+    return (__hlt_entry_hdr*)((char*)n - offsetof(__hlt_entry_hdr, evict));
+}
+
 static inline void _map_clear_default(hlt_map* m, hlt_execution_context* ctx)
 {
     switch ( m->default_type ) {
@@ -94,16 +169,16 @@ static inline void _map_clear_default(hlt_map* m, hlt_execution_context* ctx)
 
 void hlt_map_dtor(hlt_type_info* ti, hlt_map* m, hlt_execution_context* ctx)
 {
+    if ( m->expire.timer ) {
+        hlt_exception* excpt = 0;
+        hlt_timer_cancel(m->expire.timer, &excpt, ctx);
+    }
+
     for ( khiter_t i = kh_begin(m); i != kh_end(m); i++ ) {
         if ( kh_exist(m, i) ) {
-            if ( kh_value(m, i).timer ) {
-                hlt_exception* excpt = 0;
-                hlt_timer_cancel(kh_value(m, i).timer, &excpt, ctx);
-            }
-
             GC_DTOR_GENERIC(kh_key(m, i), m->tkey, ctx);
             GC_DTOR_GENERIC(kh_value(m, i).val, m->tvalue, ctx);
-            hlt_free(kh_key(m, i));
+            _key_free(kh_key(m, i), kh_value(m, i).hdr);
             hlt_free(kh_value(m, i).val);
         }
     }
@@ -111,6 +186,7 @@ void hlt_map_dtor(hlt_type_info* ti, hlt_map* m, hlt_execution_context* ctx)
     _map_clear_default(m, ctx);
 
     GC_DTOR(m->tmgr, hlt_timer_mgr, ctx);
+    GC_DTOR(m->limit.function, hlt_callable, ctx);
     hlt_free(m->cache_result);
     hlt_free(m->cache_default);
 
@@ -127,12 +203,6 @@ void hlt_iterator_map_dtor(hlt_type_info* ti, hlt_iterator_map* i, hlt_execution
     GC_DTOR(i->map, hlt_map, ctx);
 }
 
-void __hlt_map_timer_cookie_dtor(hlt_type_info* ti, __hlt_map_timer_cookie* c,
-                                 hlt_execution_context* ctx)
-{
-    GC_DTOR(c->map, hlt_map, ctx);
-}
-
 const hlt_type_info* hlt_map_key_type(const hlt_type_info* type, hlt_exception** excpt,
                                       hlt_execution_context* ctx)
 {
@@ -147,19 +217,20 @@ const hlt_type_info* hlt_map_value_type(const hlt_type_info* type, hlt_exception
 
 void hlt_set_dtor(hlt_type_info* ti, hlt_set* s, hlt_execution_context* ctx)
 {
+    if ( s->expire.timer ) {
+        hlt_exception* excpt = 0;
+        hlt_timer_cancel(s->expire.timer, &excpt, ctx);
+    }
+
     for ( khiter_t i = kh_begin(s); i != kh_end(s); i++ ) {
         if ( kh_exist(s, i) ) {
-            if ( kh_value(s, i) ) {
-                hlt_exception* excpt = 0;
-                hlt_timer_cancel(kh_value(s, i), &excpt, ctx);
-            }
-
             GC_DTOR_GENERIC(kh_key(s, i), s->tkey, ctx);
-            hlt_free(kh_key(s, i));
+            _key_free(kh_key(s, i), kh_value(s, i));
         }
     }
 
     GC_DTOR(s->tmgr, hlt_timer_mgr, ctx);
+    GC_DTOR(s->limit.function, hlt_callable, ctx);
     kh_destroy_set(s);
 }
 
@@ -181,36 +252,304 @@ static inline void* _to_voidp(const hlt_type_info* type, void* data)
     return z;
 }
 
+//////////// Expiration and eviction, shared by maps and sets.
+
+// Records an access to an entry for expiration purposes.
+static inline void _access_expire(__hlt_expire_list* l, hlt_timer_mgr* tmgr, hlt_enum strategy,
+                                  hlt_interval timeout, __hlt_entry_hdr* h, hlt_exception** excpt,
+                                  hlt_execution_context* ctx)
+{
+    if ( ! tmgr || timeout == 0 || ! __hlt_expire_list_contains(l, &h->expire) )
+        return;
+
+    if ( ! hlt_enum_equal(strategy, Hilti_ExpireStrategy_Access, excpt, ctx) )
+        return;
+
+    // No need to update the timer. If it fires too early now, we'll
+    // reschedule it at that point.
+    hlt_time t = hlt_timer_mgr_current(tmgr, excpt, ctx) + timeout;
+    __hlt_expire_list_touch(l, &h->expire, t);
+}
+
+// Records an access to an entry for eviction purposes.
+static inline void _access_evict(__hlt_limit* l, __hlt_entry_hdr* h)
+{
+    switch ( l->strategy ) {
+    case HLT_EVICT_LRU:
+        if ( __hlt_expire_list_contains(&l->list, &h->evict) )
+            __hlt_expire_list_touch(&l->list, &h->evict, 0);
+        break;
+
+    case HLT_EVICT_CLOCK:
+        h->referenced = 1;
+        break;
+
+    default:
+        break;
+    }
+}
+
+// Returns true if entries of a container with the given limit need a
+// header for eviction.
+static inline int8_t _limit_needs_hdr(__hlt_limit* l)
+{
+    return l->strategy == HLT_EVICT_LRU || l->strategy == HLT_EVICT_CLOCK;
+}
+
+// Returns true if a container with the given limit and number of entries
+// exceeds its bounds.
+static inline int8_t _limit_exceeded(__hlt_limit* l, int64_t size)
+{
+    return (l->max_entries && size > l->max_entries) || (l->max_bytes && l->bytes > l->max_bytes);
+}
+
+// Returns the next value from the limit's PRNG (xorshift64*).
+static inline uint64_t _limit_rand(__hlt_limit* l)
+{
+    uint64_t x = l->rand;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    l->rand = x;
+    return x * 2685821657736338717ULL;
+}
+
+// Initializes a limit to not bound the container.
+static inline void _limit_init(__hlt_limit* l, void* seed)
+{
+    memset(l, 0, sizeof(*l));
+    l->strategy = HLT_EVICT_NONE;
+    l->rand = (uint64_t)(uintptr_t)seed | 1;
+}
+
+// Unlinks all entries from the limit's eviction list.
+static void _limit_clear_list(__hlt_limit* l)
+{
+    while ( l->list.head )
+        __hlt_expire_list_unlink(&l->list, l->list.head);
+}
+
+// Updates one of a limit's bounds. Returns false if the arguments are
+// invalid, with an exception set.
+static int8_t _limit_set(__hlt_limit* l, hlt_enum strategy, int64_t* bound, int64_t max,
+                         hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    if ( max < 0 ) {
+        hlt_set_exception(excpt, &hlt_exception_value_error, 0, ctx);
+        return 0;
+    }
+
+    enum EvictStrategy s;
+
+    if ( hlt_enum_equal(strategy, Hilti_EvictStrategy_LRU, excpt, ctx) )
+        s = HLT_EVICT_LRU;
+
+    else if ( hlt_enum_equal(strategy, Hilti_EvictStrategy_Clock, excpt, ctx) )
+        s = HLT_EVICT_CLOCK;
+
+    else if ( hlt_enum_equal(strategy, Hilti_EvictStrategy_Random, excpt, ctx) )
+        s = HLT_EVICT_RANDOM;
+
+    else {
+        hlt_set_exception(excpt, &hlt_exception_value_error, 0, ctx);
+        return 0;
+    }
+
+    *bound = max;
+
+    if ( ! (l->max_entries || l->max_bytes) )
+        s = HLT_EVICT_NONE;
+
+    if ( s != l->strategy ) {
+        // Entries already linked don't carry meaningful state for the new
+        // strategy. Existing entries will be evicted randomly.
+        _limit_clear_list(l);
+        l->strategy = s;
+    }
+
+    return 1;
+}
+
+// Selects the next entry to evict from the eviction list, skipping the one
+// to spare. Returns null if there's none.
+static __hlt_entry_hdr* _limit_victim(__hlt_limit* l, __hlt_entry_hdr* spare)
+{
+    __hlt_expire_list* list = &l->list;
+
+    // For CLOCK, this gives each entry a second chance by clearing its
+    // reference bit, and thus terminates after two rounds at most.
+    while ( list->head ) {
+        __hlt_entry_hdr* h = _evict_hdr(list->head);
+
+        if ( h == spare ) {
+            if ( list->head == list->tail )
+                return 0;
+
+            __hlt_expire_list_touch(list, &h->evict, 0);
+            continue;
+        }
+
+        if ( l->strategy == HLT_EVICT_CLOCK && h->referenced ) {
+            h->referenced = 0;
+            __hlt_expire_list_touch(list, &h->evict, 0);
+            continue;
+        }
+
+        return h;
+    }
+
+    return 0;
+}
+
+// Links a new entry into the containers lists as needed.
+static inline void _link_entry(__hlt_expire_list* expire, __hlt_limit* l, hlt_timer_mgr* tmgr,
+                               hlt_interval timeout, __hlt_entry_hdr* h, hlt_exception** excpt,
+                               hlt_execution_context* ctx)
+{
+    if ( tmgr && timeout ) {
+        hlt_time t = hlt_timer_mgr_current(tmgr, excpt, ctx) + timeout;
+        __hlt_expire_list_append(expire, &h->expire, t);
+    }
+
+    if ( _limit_needs_hdr(l) )
+        __hlt_expire_list_append(&l->list, &h->evict, 0);
+}
+
+// Unlinks an entry that's going away from the containers lists.
+static inline void _unlink_entry(__hlt_expire_list* expire, __hlt_limit* l, __hlt_entry_hdr* h)
+{
+    if ( __hlt_expire_list_contains(expire, &h->expire) )
+        __hlt_expire_list_unlink(expire, &h->expire);
+
+    if ( __hlt_expire_list_contains(&l->list, &h->evict) )
+        __hlt_expire_list_unlink(&l->list, &h->evict);
+}
+
 static inline void _access_map(hlt_map* m, khiter_t i, hlt_exception** excpt,
                                hlt_execution_context* ctx)
 {
-    if ( ! m->tmgr || ! hlt_enum_equal(m->strategy, Hilti_ExpireStrategy_Access, excpt, ctx) ||
-         m->timeout == 0 )
-        return;
+    __hlt_entry_hdr* h = kh_value(m, i).hdr;
 
-    if ( ! kh_value(m, i).timer )
+    if ( ! h )
         return;
 
-    hlt_time t = hlt_timer_mgr_current(m->tmgr, excpt, ctx) + m->timeout;
-    hlt_timer_update(kh_value(m, i).timer, t, excpt, ctx);
+    _access_evict(&m->limit, h);
+    _access_expire(&m->expire, m->tmgr, m->strategy, m->timeout, h, excpt, ctx);
 }
 
 static inline void _access_set(hlt_set* m, khiter_t i, hlt_exception** excpt,
                                hlt_execution_context* ctx)
 {
-    if ( ! m->tmgr || ! hlt_enum_equal(m->strategy, Hilti_ExpireStrategy_Access, excpt, ctx) ||
-         m->timeout == 0 )
-        return;
+    __hlt_entry_hdr* h = kh_value(m, i);
 
-    if ( ! kh_value(m, i) )
+    if ( ! h )
         return;
 
-    hlt_time t = hlt_timer_mgr_current(m->tmgr, excpt, ctx) + m->timeout;
-    hlt_timer_update(kh_value(m, i), t, excpt, ctx);
+    _access_evict(&m->limit, h);
+    _access_expire(&m->expire, m->tmgr, m->strategy, m->timeout, h, excpt, ctx);
 }
 
 //////////// Maps.
 
+// Returns true if a new map entry needs a header.
+static inline int8_t _map_needs_hdr(hlt_map* m)
+{
+    return (m->tmgr && m->timeout) || _limit_needs_hdr(&m->limit);
+}
+
+// Returns the approximate number of bytes an entry occupies: its key and
+// value, its header if any, and its slot in the hash table. This doesn't
+// include any memory that the key or value reference.
+static inline int64_t _map_entry_bytes(hlt_map* m, __hlt_entry_hdr* h)
+{
+    return m->tkey->size + m->tvalue->size + (h ? sizeof(__hlt_entry_hdr) : 0) +
+           sizeof(__khkey_t) + sizeof(__khval_map_t);
+}
+
+// Schedules the map's timer if it has expiring entries but no timer yet.
+static inline void _schedule_map(hlt_map* m, hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    if ( m->expire.timer || ! m->expire.head )
+        return;
+
+    hlt_timer* t = __hlt_timer_new_map(m, excpt, ctx);
+    __hlt_expire_list_schedule(&m->expire, m->tmgr, t, excpt, ctx);
+}
+
+// Deletes the entry at the given position.
+static inline void _map_delete(hlt_map* m, khiter_t i, hlt_execution_context* ctx)
+{
+    __hlt_entry_hdr* h = kh_value(m, i).hdr;
+
+    if ( h )
+        _unlink_entry(&m->expire, &m->limit, h);
+
+    m->limit.bytes -= _map_entry_bytes(m, h);
+
+    void* key = kh_key(m, i);
+    GC_DTOR_GENERIC(key, m->tkey, ctx);
+    _key_free(key, h);
+
+    void* val = kh_value(m, i).val;
+    GC_DTOR_GENERIC(val, m->tvalue, ctx);
+    hlt_free(val);
+
+    kh_del_map(m, i);
+    ++m->version;
+}
+
+// Picks a random entry other than the one with key *spare*. Returns
+// kh_end() if there's none.
+static khiter_t _map_random_victim(hlt_map* m, void* spare)
+{
+    if ( ! kh_size(m) )
+        return kh_end(m);
+
+    khint_t start = _limit_rand(&m->limit) % kh_end(m);
+
+    for ( khint_t j = 0; j < kh_end(m); j++ ) {
+        khiter_t i = (start + j) % kh_end(m);
+
+        if ( kh_exist(m, i) && kh_key(m, i) != spare )
+            return i;
+    }
+
+    return kh_end(m);
+}
+
+// Evicts entries until the map is back within its bounds. The entry with
+// key *spare* and header *spare_hdr* (if not null) is never evicted.
+static void _map_enforce_limit(hlt_map* m, void* spare, __hlt_entry_hdr* spare_hdr,
+                               hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    __hlt_limit* l = &m->limit;
+
+    while ( _limit_exceeded(l, kh_size(m)) ) {
+        khiter_t i = kh_end(m);
+        __hlt_entry_hdr* h = _limit_victim(l, spare_hdr);
+
+        if ( h )
+            i = kh_get_map(m, _hdr_key(h), m->tkey);
+        else
+            // Random eviction, or entries predating the limit.
+            i = _map_random_victim(m, spare);
+
+        if ( i == kh_end(m) )
+            break;
+
+        ++l->evicted;
+
+        if ( l->function )
+            HLT_CALLABLE_RUN(l->function, 0, Hilti_MapEvictFunction, kh_key(m, i),
+                             kh_value(m, i).val, excpt, ctx);
+
+        _map_delete(m, i, ctx);
+
+        if ( hlt_check_exception(excpt) )
+            break;
+    }
+}
+
 static inline void _hlt_map_init(hlt_map* m, const hlt_type_info* key, const hlt_type_info* value,
                                  hlt_timer_mgr* tmgr, hlt_exception** excpt,
                                  hlt_execution_context* ctx)
@@ -222,7 +561,9 @@ static inline void _hlt_map_init(hlt_map* m, const hlt_type_info* key, const hlt
     m->strategy = hlt_enum_unset(excpt, ctx);
     m->cache_result = 0;
     m->cache_default = 0;
+    m->version = 0;
 
+    _limit_init(&m->limit, m);
     _map_clear_default(m, ctx);
 }
 
@@ -246,18 +587,7 @@ static void _clone_init_in_thread_map(const hlt_type_info* ti, void* dstp, hlt_e
     dst->tmgr = ctx->tmgr;
     GC_CCTOR(dst->tmgr, hlt_timer_mgr, ctx);
 
-    for ( khiter_t i = kh_begin(dst); i != kh_end(dst); i++ ) {
-        if ( ! kh_exist(dst, i) )
-            continue;
-
-        hlt_timer* t = kh_value(dst, i).timer;
-
-        if ( ! t )
-            continue;
-
-        hlt_timer_mgr_schedule(dst->tmgr, t->time, t, excpt, ctx);
-        GC_DTOR(t, hlt_timer, ctx); // Not memory-managed on our end.
-    }
+    _schedule_map(dst, excpt, ctx);
 }
 
 void* hlt_map_clone_alloc(const hlt_type_info* ti, void* srcp, __hlt_clone_state* cstate,
@@ -284,9 +614,12 @@ void hlt_map_clone_init(void* dstp, const hlt_type_info* ti, void* srcp, __hlt_c
     dst->tvalue = src->tvalue;
     dst->timeout = src->timeout;
     dst->strategy = src->strategy;
+    dst->expire.head = dst->expire.tail = 0;
+    dst->expire.timer = 0; // Scheduled by init_in_thread().
     dst->default_type = src->default_type;
     dst->cache_result = 0;
     dst->cache_default = 0;
+    dst->version = 0;
 
     switch ( src->default_type ) {
     case HLT_MAP_DEFAULT_NONE:
@@ -304,32 +637,48 @@ void hlt_map_clone_init(void* dstp, const hlt_type_info* ti, void* srcp, __hlt_c
         break;
     }
 
+    dst->limit = src->limit;
+    dst->limit.function = 0;
+    dst->limit.list.head = dst->limit.list.tail = 0;
+
+    if ( src->limit.function )
+        __hlt_clone(&dst->limit.function, &hlt_type_info_hlt_callable, &src->limit.function,
+                    cstate, excpt, ctx);
+
     for ( khiter_t i = kh_begin(src); i != kh_end(src); i++ ) {
         if ( ! kh_exist(src, i) )
             continue;
 
-        void* key = hlt_malloc(src->tkey->size);
+        __hlt_entry_hdr* h = kh_value(src, i).hdr;
+        void* key = _key_alloc(src->tkey, h != 0);
         void* val = hlt_malloc(src->tvalue->size);
 
         __hlt_clone(key, src->tkey, kh_key(src, i), cstate, excpt, ctx);
         __hlt_clone(val, src->tvalue, kh_value(src, i).val, cstate, excpt, ctx);
 
         int ret;
-        khiter_t i = kh_put_map(dst, key, &ret, src->tkey);
+        khiter_t j = kh_put_map(dst, key, &ret, src->tkey);
         assert(ret); // Cannot exist yet.
 
-        if ( src->tmgr && src->timeout ) {
-            GC_CCTOR(dst, hlt_map, ctx);
-            __hlt_map_timer_cookie cookie = {dst, key};
-            hlt_timer* t = __hlt_timer_new_map(cookie, excpt, ctx);
-            t->time = kh_value(src, i).timer->time;
-            kh_value(dst, i).timer = t;
-        }
+        kh_value(dst, j).hdr = h ? _key_hdr(key) : 0;
+        kh_value(dst, j).val = val;
 
-        else
-            kh_value(dst, i).timer = 0;
+        if ( h )
+            _key_hdr(key)->referenced = h->referenced;
+    }
+
+    // Rebuild the lists in the same order as the source's.
 
-        kh_value(dst, i).val = val;
+    for ( __hlt_expire_node* n = src->expire.head; n; n = n->next ) {
+        khiter_t j = kh_get_map(dst, _hdr_key(_expire_hdr(n)), src->tkey);
+        assert(j != kh_end(dst));
+        __hlt_expire_list_append(&dst->expire, &kh_value(dst, j).hdr->expire, n->time);
+    }
+
+    for ( __hlt_expire_node* n = src->limit.list.head; n; n = n->next ) {
+        khiter_t j = kh_get_map(dst, _hdr_key(_evict_hdr(n)), src->tkey);
+        assert(j != kh_end(dst));
+        __hlt_expire_list_append(&dst->limit.list, &kh_value(dst, j).hdr->evict, 0);
     }
 
     if ( src->tmgr )
@@ -405,45 +754,53 @@ void hlt_map_insert(hlt_map* m, const hlt_type_info* tkey, void* key, const hlt_
         return;
     }
 
-    void* keytmp = _to_voidp(tkey, key);
+    int8_t hdr = _map_needs_hdr(m);
+
+    void* keytmp = _key_alloc(tkey, hdr);
+    memcpy(keytmp, key, tkey->size);
     void* valtmp = _to_voidp(tval, value);
 
     int ret;
     khiter_t i = kh_put_map(m, keytmp, &ret, tkey);
 
+    ++m->version;
+
     if ( ! ret ) {
         // Entry already exists.
 
         // The hash table keeps the old key, so we don't need the new one.
-        hlt_free(keytmp);
+        _key_free(keytmp, hdr ? _key_hdr(keytmp) : 0);
 
         // Delete the old value.
         void* val = kh_value(m, i).val;
         GC_DTOR_GENERIC(val, m->tvalue, ctx);
         hlt_free(val);
 
-        // Update timer.
+        kh_value(m, i).val = valtmp;
+        GC_CCTOR_GENERIC(valtmp, m->tvalue, ctx);
+
+        // Update timer and eviction order.
         _access_map(m, i, excpt, ctx);
+        return;
     }
 
-    else {
-        // New entry.
-        if ( m->tmgr && m->timeout ) {
-            // Create timer.
-            __hlt_map_timer_cookie cookie = {m, keytmp};
-            kh_value(m, i).timer = __hlt_timer_new_map(cookie, excpt, ctx);
-            hlt_time t = hlt_timer_mgr_current(m->tmgr, excpt, ctx) + m->timeout;
-            hlt_timer_mgr_schedule(m->tmgr, t, kh_value(m, i).timer, excpt, ctx);
-            GC_DTOR(kh_value(m, i).timer, hlt_timer, ctx); // Not memory-managed on our end.
-        }
-        else
-            kh_value(m, i).timer = 0;
-
-        GC_CCTOR_GENERIC(keytmp, m->tkey, ctx);
-    }
+    // New entry.
+    GC_CCTOR_GENERIC(keytmp, m->tkey, ctx);
 
+    __hlt_entry_hdr* h = hdr ? _key_hdr(keytmp) : 0;
+    kh_value(m, i).hdr = h;
     kh_value(m, i).val = valtmp;
     GC_CCTOR_GENERIC(valtmp, m->tvalue, ctx);
+
+    m->limit.bytes += _map_entry_bytes(m, h);
+
+    if ( h ) {
+        _link_entry(&m->expire, &m->limit, m->tmgr, m->timeout, h, excpt, ctx);
+        _schedule_map(m, excpt, ctx);
+    }
+
+    if ( _limit_exceeded(&m->limit, kh_size(m)) )
+        _map_enforce_limit(m, keytmp, h, excpt, ctx);
 }
 
 int8_t hlt_map_exists(hlt_map* m, const hlt_type_info* type, void* key, hlt_exception** excpt,
@@ -472,46 +829,28 @@ void hlt_map_remove(hlt_map* m, const hlt_type_info* type, void* key, hlt_except
 
     khiter_t i = kh_get_map(m, key, type);
 
-    if ( i != kh_end(m) ) {
-        if ( kh_value(m, i).timer ) {
-            hlt_timer_cancel(kh_value(m, i).timer, excpt, ctx);
-            kh_value(m, i).timer = 0;
-        }
-
-        void* key = kh_key(m, i);
-        GC_DTOR_GENERIC(key, m->tkey, ctx);
-        hlt_free(key);
-
-        void* val = kh_value(m, i).val;
-        GC_DTOR_GENERIC(val, m->tvalue, ctx);
-        hlt_free(val);
-
-        kh_del_map(m, i);
-    }
+    if ( i != kh_end(m) )
+        // We leave the timer alone even if this was the next entry to
+        // expire. It will reschedule itself when it fires.
+        _map_delete(m, i, ctx);
 }
 
-void hlt_map_expire(__hlt_map_timer_cookie cookie, hlt_exception** excpt,
-                    hlt_execution_context* ctx)
+void hlt_map_expire(__hlt_map_timer_cookie m, hlt_exception** excpt, hlt_execution_context* ctx)
 {
-    khiter_t i = kh_get_map(cookie.map, cookie.key, cookie.map->tkey);
-
-    if ( i == kh_end(cookie.map) )
-        // Removed in the mean-time, nothing to do.
-        return;
+    hlt_time now = __hlt_expire_list_now(&m->expire, m->tmgr, excpt, ctx);
 
-    // Don't need to cancel the timer, as it has already expired anyway when
-    // this method runs.
-    kh_value(cookie.map, i).timer = 0;
+    // The timer manager deletes the timer once we return.
+    m->expire.timer = 0;
 
-    void* key = kh_key(cookie.map, i);
-    GC_DTOR_GENERIC(key, cookie.map->tkey, ctx);
-    hlt_free(key);
+    __hlt_expire_node* n;
 
-    void* val = kh_value(cookie.map, i).val;
-    GC_DTOR_GENERIC(val, cookie.map->tvalue, ctx);
-    hlt_free(val);
+    while ( (n = __hlt_expire_list_expired(&m->expire, now)) ) {
+        khiter_t i = kh_get_map(m, _hdr_key(_expire_hdr(n)), m->tkey);
+        assert(i != kh_end(m));
+        _map_delete(m, i, ctx);
+    }
 
-    kh_del_map(cookie.map, i);
+    _schedule_map(m, excpt, ctx);
 }
 
 int64_t hlt_map_size(hlt_map* m, hlt_exception** excpt, hlt_execution_context* ctx)
@@ -531,19 +870,25 @@ void hlt_map_clear(hlt_map* m, hlt_exception** excpt, hlt_execution_context* ctx
         return;
     }
 
+    if ( m->expire.timer ) {
+        hlt_timer_cancel(m->expire.timer, excpt, ctx);
+        m->expire.timer = 0;
+    }
+
     for ( khiter_t i = kh_begin(m); i != kh_end(m); i++ ) {
         if ( kh_exist(m, i) ) {
-            if ( kh_value(m, i).timer )
-                hlt_timer_cancel(kh_value(m, i).timer, excpt, ctx);
-
             GC_DTOR_GENERIC(kh_key(m, i), m->tkey, ctx);
             GC_DTOR_GENERIC(kh_value(m, i).val, m->tvalue, ctx);
-            hlt_free(kh_key(m, i));
+            _key_free(kh_key(m, i), kh_value(m, i).hdr);
             hlt_free(kh_value(m, i).val);
         }
     }
 
+    m->expire.head = m->expire.tail = 0;
+    m->limit.list.head = m->limit.list.tail = 0;
+    m->limit.bytes = 0;
     kh_clear_map(m);
+    ++m->version;
 }
 
 void hlt_map_default(hlt_map* m, const hlt_type_info* tdef, void* def, hlt_exception** excpt,
@@ -584,6 +929,71 @@ void hlt_map_timeout(hlt_map* m, hlt_enum strategy, hlt_interval timeout, hlt_ex
         GC_ASSIGN(m->tmgr, ctx->tmgr, hlt_timer_mgr, ctx);
 }
 
+void hlt_map_limit(hlt_map* m, hlt_enum strategy, int64_t max, hlt_exception** excpt,
+                   hlt_execution_context* ctx)
+{
+    if ( ! m ) {
+        hlt_set_exception(excpt, &hlt_exception_null_reference, 0, ctx);
+        return;
+    }
+
+    if ( _limit_set(&m->limit, strategy, &m->limit.max_entries, max, excpt, ctx) )
+        _map_enforce_limit(m, 0, 0, excpt, ctx);
+}
+
+void hlt_map_limit_bytes(hlt_map* m, hlt_enum strategy, int64_t max, hlt_exception** excpt,
+                         hlt_execution_context* ctx)
+{
+    if ( ! m ) {
+        hlt_set_exception(excpt, &hlt_exception_null_reference, 0, ctx);
+        return;
+    }
+
+    if ( _limit_set(&m->limit, strategy, &m->limit.max_bytes, max, excpt, ctx) )
+        _map_enforce_limit(m, 0, 0, excpt, ctx);
+}
+
+void hlt_map_evict_callable(hlt_map* m, hlt_callable* func, hlt_exception** excpt,
+                            hlt_execution_context* ctx)
+{
+    if ( ! m ) {
+        hlt_set_exception(excpt, &hlt_exception_null_reference, 0, ctx);
+        return;
+    }
+
+    GC_ASSIGN(m->limit.function, func, hlt_callable, ctx);
+}
+
+int64_t hlt_map_evicted(hlt_map* m, hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    if ( ! m ) {
+        hlt_set_exception(excpt, &hlt_exception_null_reference, 0, ctx);
+        return 0;
+    }
+
+    return m->limit.evicted;
+}
+
+int64_t hlt_map_bytes(hlt_map* m, hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    if ( ! m ) {
+        hlt_set_exception(excpt, &hlt_exception_null_reference, 0, ctx);
+        return 0;
+    }
+
+    return m->limit.bytes;
+}
+
+uint64_t hlt_map_version(hlt_map* m, hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    if ( ! m ) {
+        hlt_set_exception(excpt, &hlt_exception_null_reference, 0, ctx);
+        return 0;
+    }
+
+    return m->version;
+}
+
 hlt_iterator_map hlt_map_begin(hlt_map* m, hlt_exception** excpt, hlt_execution_context* ctx)
 {
     if ( ! m ) {
@@ -728,6 +1138,98 @@ hlt_string hlt_map_to_string(const hlt_type_info* type, const void* obj, int32_t
 
 //////////// Sets.
 
+// Returns true if a new set entry needs a header.
+static inline int8_t _set_needs_hdr(hlt_set* m)
+{
+    return (m->tmgr && m->timeout) || _limit_needs_hdr(&m->limit);
+}
+
+// Returns the approximate number of bytes an entry occupies; see
+// _map_entry_bytes().
+static inline int64_t _set_entry_bytes(hlt_set* m, __hlt_entry_hdr* h)
+{
+    return m->tkey->size + (h ? sizeof(__hlt_entry_hdr) : 0) + sizeof(__khkey_t) +
+           sizeof(__khval_set_t);
+}
+
+// Schedules the set's timer if it has expiring entries but no timer yet.
+static inline void _schedule_set(hlt_set* m, hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    if ( m->expire.timer || ! m->expire.head )
+        return;
+
+    hlt_timer* t = __hlt_timer_new_set(m, excpt, ctx);
+    __hlt_expire_list_schedule(&m->expire, m->tmgr, t, excpt, ctx);
+}
+
+// Deletes the entry at the given position.
+static inline void _set_delete(hlt_set* m, khiter_t i, hlt_execution_context* ctx)
+{
+    __hlt_entry_hdr* h = kh_value(m, i);
+
+    if ( h )
+        _unlink_entry(&m->expire, &m->limit, h);
+
+    m->limit.bytes -= _set_entry_bytes(m, h);
+
+    void* key = kh_key(m, i);
+    GC_DTOR_GENERIC(key, m->tkey, ctx);
+    _key_free(key, h);
+
+    kh_del_set(m, i);
+    ++m->version;
+}
+
+// Picks a random entry other than the one with key *spare*. Returns
+// kh_end() if there's none.
+static khiter_t _set_random_victim(hlt_set* m, void* spare)
+{
+    if ( ! kh_size(m) )
+        return kh_end(m);
+
+    khint_t start = _limit_rand(&m->limit) % kh_end(m);
+
+    for ( khint_t j = 0; j < kh_end(m); j++ ) {
+        khiter_t i = (start + j) % kh_end(m);
+
+        if ( kh_exist(m, i) && kh_key(m, i) != spare )
+            return i;
+    }
+
+    return kh_end(m);
+}
+
+// Evicts entries until the set is back within its bounds. See
+// _map_enforce_limit().
+static void _set_enforce_limit(hlt_set* m, void* spare, __hlt_entry_hdr* spare_hdr,
+                               hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    __hlt_limit* l = &m->limit;
+
+    while ( _limit_exceeded(l, kh_size(m)) ) {
+        khiter_t i = kh_end(m);
+        __hlt_entry_hdr* h = _limit_victim(l, spare_hdr);
+
+        if ( h )
+            i = kh_get_set(m, _hdr_key(h), m->tkey);
+        else
+            i = _set_random_victim(m, spare);
+
+        if ( i == kh_end(m) )
+            break;
+
+        ++l->evicted;
+
+        if ( l->function )
+            HLT_CALLABLE_RUN(l->function, 0, Hilti_SetEvictFunction, kh_key(m, i), excpt, ctx);
+
+        _set_delete(m, i, ctx);
+
+        if ( hlt_check_exception(excpt) )
+            break;
+    }
+}
+
 static inline void _hlt_set_init(hlt_set* m, const hlt_type_info* key, hlt_timer_mgr* tmgr,
                                  hlt_exception** excpt, hlt_execution_context* ctx)
 {
@@ -735,6 +1237,8 @@ static inline void _hlt_set_init(hlt_set* m, const hlt_type_info* key, hlt_timer
     m->tkey = key;
     m->timeout = 0.0;
     m->strategy = hlt_enum_unset(excpt, ctx);
+    m->version = 0;
+    _limit_init(&m->limit, m);
 }
 
 hlt_set* hlt_set_new(const hlt_type_info* key, hlt_timer_mgr* tmgr, hlt_exception** excpt,
@@ -757,18 +1261,7 @@ static void _clone_init_in_thread_set(const hlt_type_info* ti, void* dstp, hlt_e
     dst->tmgr = ctx->tmgr;
     GC_CCTOR(dst->tmgr, hlt_timer_mgr, ctx);
 
-    for ( khiter_t i = kh_begin(dst); i != kh_end(dst); i++ ) {
-        if ( ! kh_exist(dst, i) )
-            continue;
-
-        hlt_timer* t = kh_value(dst, i);
-
-        if ( ! t )
-            continue;
-
-        hlt_timer_mgr_schedule(dst->tmgr, t->time, t, excpt, ctx);
-        GC_DTOR(t, hlt_timer, ctx); // Not memory-managed on our end.
-    }
+    _schedule_set(dst, excpt, ctx);
 }
 
 void* hlt_set_clone_alloc(const hlt_type_info* ti, void* srcp, __hlt_clone_state* cstate,
@@ -794,28 +1287,48 @@ void hlt_set_clone_init(void* dstp, const hlt_type_info* ti, void* srcp, __hlt_c
     dst->tkey = src->tkey;
     dst->timeout = src->timeout;
     dst->strategy = src->strategy;
+    dst->expire.head = dst->expire.tail = 0;
+    dst->expire.timer = 0; // Scheduled by init_in_thread().
+    dst->limit = src->limit;
+    dst->limit.function = 0;
+    dst->limit.list.head = dst->limit.list.tail = 0;
+    dst->version = 0;
+
+    if ( src->limit.function )
+        __hlt_clone(&dst->limit.function, &hlt_type_info_hlt_callable, &src->limit.function,
+                    cstate, excpt, ctx);
+
+    // See hlt_map_clone_init() for the ordering.
 
     for ( khiter_t i = kh_begin(src); i != kh_end(src); i++ ) {
         if ( ! kh_exist(src, i) )
             continue;
 
-        void* key = hlt_malloc(src->tkey->size);
+        __hlt_entry_hdr* h = kh_value(src, i);
+        void* key = _key_alloc(src->tkey, h != 0);
 
         __hlt_clone(key, src->tkey, kh_key(src, i), cstate, excpt, ctx);
 
         int ret;
-        khiter_t i = kh_put_set(dst, key, &ret, src->tkey);
+        khiter_t j = kh_put_set(dst, key, &ret, src->tkey);
         assert(ret); // Cannot exist yet.
 
-        if ( src->tmgr && src->timeout ) {
-            __hlt_set_timer_cookie cookie = {dst, key};
-            hlt_timer* t = __hlt_timer_new_set(cookie, excpt, ctx);
-            t->time = kh_value(src, i)->time;
-            kh_value(dst, i) = t;
-        }
+        kh_value(dst, j) = h ? _key_hdr(key) : 0;
 
-        else
-            kh_value(dst, i) = 0;
+        if ( h )
+            _key_hdr(key)->referenced = h->referenced;
+    }
+
+    for ( __hlt_expire_node* n = src->expire.head; n; n = n->next ) {
+        khiter_t j = kh_get_set(dst, _hdr_key(_expire_hdr(n)), src->tkey);
+        assert(j != kh_end(dst));
+        __hlt_expire_list_append(&dst->expire, &kh_value(dst, j)->expire, n->time);
+    }
+
+    for ( __hlt_expire_node* n = src->limit.list.head; n; n = n->next ) {
+        khiter_t j = kh_get_set(dst, _hdr_key(_evict_hdr(n)), src->tkey);
+        assert(j != kh_end(dst));
+        __hlt_expire_list_append(&dst->limit.list, &kh_value(dst, j)->evict, 0);
     }
 
     if ( src->tmgr )
@@ -830,33 +1343,39 @@ void hlt_set_insert(hlt_set* m, const hlt_type_info* tkey, void* key, hlt_except
         return;
     }
 
-    void* keytmp = _to_voidp(tkey, key);
+    int8_t hdr = _set_needs_hdr(m);
+
+    void* keytmp = _key_alloc(tkey, hdr);
+    memcpy(keytmp, key, tkey->size);
 
     int ret;
     khiter_t i = kh_put_set(m, keytmp, &ret, tkey);
+
+    ++m->version;
     if ( ! ret ) {
         // The hash table keeps the old key, so we don't need the new one.
-        hlt_free(keytmp);
+        _key_free(keytmp, hdr ? _key_hdr(keytmp) : 0);
 
-        // Already exists, update timer.
+        // Already exists, update timer and eviction order.
         _access_set(m, i, excpt, ctx);
+        return;
     }
 
-    else {
-        // New entry.
-        if ( m->tmgr && m->timeout ) {
-            // Create timer.
-            __hlt_set_timer_cookie cookie = {m, keytmp};
-            kh_value(m, i) = __hlt_timer_new_set(cookie, excpt, ctx);
-            hlt_interval t = hlt_timer_mgr_current(m->tmgr, excpt, ctx) + m->timeout;
-            hlt_timer_mgr_schedule(m->tmgr, t, kh_value(m, i), excpt, ctx);
-            GC_DTOR(kh_value(m, i), hlt_timer, ctx); // Not memory-managed on our end.
-        }
-        else
-            kh_value(m, i) = 0;
+    // New entry.
+    GC_CCTOR_GENERIC(keytmp, m->tkey, ctx);
+
+    __hlt_entry_hdr* h = hdr ? _key_hdr(keytmp) : 0;
+    kh_value(m, i) = h;
 
-        GC_CCTOR_GENERIC(keytmp, m->tkey, ctx);
+    m->limit.bytes += _set_entry_bytes(m, h);
+
+    if ( h ) {
+        _link_entry(&m->expire, &m->limit, m->tmgr, m->timeout, h, excpt, ctx);
+        _schedule_set(m, excpt, ctx);
     }
+
+    if ( _limit_exceeded(&m->limit, kh_size(m)) )
+        _set_enforce_limit(m, keytmp, h, excpt, ctx);
 }
 
 int8_t hlt_set_exists(hlt_set* m, const hlt_type_info* type, void* key, hlt_exception** excpt,
@@ -885,38 +1404,27 @@ void hlt_set_remove(hlt_set* m, const hlt_type_info* type, void* key, hlt_except
 
     khiter_t i = kh_get_set(m, key, type);
 
-    if ( i != kh_end(m) ) {
-        if ( kh_value(m, i) ) {
-            hlt_timer_cancel(kh_value(m, i), excpt, ctx);
-            kh_value(m, i) = 0;
-        }
-
-        void* key = kh_key(m, i);
-        GC_DTOR_GENERIC(key, m->tkey, ctx);
-        hlt_free(key);
-
-        kh_del_set(m, i);
-    }
+    if ( i != kh_end(m) )
+        // We leave the timer alone, see hlt_map_remove().
+        _set_delete(m, i, ctx);
 }
 
-void hlt_set_expire(__hlt_set_timer_cookie cookie, hlt_exception** excpt,
-                    hlt_execution_context* ctx)
+void hlt_set_expire(__hlt_set_timer_cookie m, hlt_exception** excpt, hlt_execution_context* ctx)
 {
-    khiter_t i = kh_get_set(cookie.set, cookie.key, cookie.set->tkey);
+    hlt_time now = __hlt_expire_list_now(&m->expire, m->tmgr, excpt, ctx);
 
-    if ( i == kh_end(cookie.set) )
-        // Removed in the mean-time, nothing to do.
-        return;
+    // The timer manager deletes the timer once we return.
+    m->expire.timer = 0;
 
-    // Don't need to cancel the timer, as it has already expired anyway when
-    // this method runs.
-    kh_value(cookie.set, i) = 0;
+    __hlt_expire_node* n;
 
-    void* key = kh_key(cookie.set, i);
-    GC_DTOR_GENERIC(key, cookie.set->tkey, ctx);
-    hlt_free(key);
+    while ( (n = __hlt_expire_list_expired(&m->expire, now)) ) {
+        khiter_t i = kh_get_set(m, _hdr_key(_expire_hdr(n)), m->tkey);
+        assert(i != kh_end(m));
+        _set_delete(m, i, ctx);
+    }
 
-    kh_del_set(cookie.set, i);
+    _schedule_set(m, excpt, ctx);
 }
 
 int64_t hlt_set_size(hlt_set* m, hlt_exception** excpt, hlt_execution_context* ctx)
@@ -936,17 +1444,23 @@ void hlt_set_clear(hlt_set* m, hlt_exception** excpt, hlt_execution_context* ctx
         return;
     }
 
+    if ( m->expire.timer ) {
+        hlt_timer_cancel(m->expire.timer, excpt, ctx);
+        m->expire.timer = 0;
+    }
+
     for ( khiter_t i = kh_begin(m); i != kh_end(m); i++ ) {
         if ( kh_exist(m, i) ) {
-            if ( kh_value(m, i) )
-                hlt_timer_cancel(kh_value(m, i), excpt, ctx);
-
             GC_DTOR_GENERIC(kh_key(m, i), m->tkey, ctx);
-            hlt_free(kh_key(m, i));
+            _key_free(kh_key(m, i), kh_value(m, i));
         }
     }
 
+    m->expire.head = m->expire.tail = 0;
+    m->limit.list.head = m->limit.list.tail = 0;
+    m->limit.bytes = 0;
     kh_clear_set(m);
+    ++m->version;
 }
 
 void hlt_set_timeout(hlt_set* m, hlt_enum strategy, hlt_interval timeout, hlt_exception** excpt,
@@ -959,6 +1473,71 @@ void hlt_set_timeout(hlt_set* m, hlt_enum strategy, hlt_interval timeout, hlt_ex
         GC_ASSIGN(m->tmgr, ctx->tmgr, hlt_timer_mgr, ctx);
 }
 
+void hlt_set_limit(hlt_set* m, hlt_enum strategy, int64_t max, hlt_exception** excpt,
+                   hlt_execution_context* ctx)
+{
+    if ( ! m ) {
+        hlt_set_exception(excpt, &hlt_exception_null_reference, 0, ctx);
+        return;
+    }
+
+    if ( _limit_set(&m->limit, strategy, &m->limit.max_entries, max, excpt, ctx) )
+        _set_enforce_limit(m, 0, 0, excpt, ctx);
+}
+
+void hlt_set_limit_bytes(hlt_set* m, hlt_enum strategy, int64_t max, hlt_exception** excpt,
+                         hlt_execution_context* ctx)
+{
+    if ( ! m ) {
+        hlt_set_exception(excpt, &hlt_exception_null_reference, 0, ctx);
+        return;
+    }
+
+    if ( _limit_set(&m->limit, strategy, &m->limit.max_bytes, max, excpt, ctx) )
+        _set_enforce_limit(m, 0, 0, excpt, ctx);
+}
+
+void hlt_set_evict_callable(hlt_set* m, hlt_callable* func, hlt_exception** excpt,
+                            hlt_execution_context* ctx)
+{
+    if ( ! m ) {
+        hlt_set_exception(excpt, &hlt_exception_null_reference, 0, ctx);
+        return;
+    }
+
+    GC_ASSIGN(m->limit.function, func, hlt_callable, ctx);
+}
+
+int64_t hlt_set_evicted(hlt_set* m, hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    if ( ! m ) {
+        hlt_set_exception(excpt, &hlt_exception_null_reference, 0, ctx);
+        return 0;
+    }
+
+    return m->limit.evicted;
+}
+
+int64_t hlt_set_bytes(hlt_set* m, hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    if ( ! m ) {
+        hlt_set_exception(excpt, &hlt_exception_null_reference, 0, ctx);
+        return 0;
+    }
+
+    return m->limit.bytes;
+}
+
+uint64_t hlt_set_version(hlt_set* m, hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    if ( ! m ) {
+        hlt_set_exception(excpt, &hlt_exception_null_reference, 0, ctx);
+        return 0;
+    }
+
+    return m->version;
+}
+
 hlt_iterator_set hlt_set_begin(hlt_set* m, hlt_exception** excpt, hlt_execution_context* ctx)
 {
     if ( ! m ) {
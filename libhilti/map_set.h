@@ -32,17 +32,13 @@ struct __hlt_iterator_set {
 };
 
 
-/// Cookie for map entry expiration timers.
-typedef struct {
-    hlt_map* map;
-    __khkey_t key;
-} __hlt_map_timer_cookie;
-
-/// Cookie for set entry expiration timers.
-typedef struct {
-    hlt_set* set;
-    __khkey_t key;
-} __hlt_set_timer_cookie;
+/// Cookie for map expiration timers. Each map has at most one timer, which
+/// expires all its entries due at the time it fires. Not memory-managed.
+typedef hlt_map* __hlt_map_timer_cookie;
+
+/// Cookie for set expiration timers. Each set has at most one timer, which
+/// expires all its entries due at the time it fires. Not memory-managed.
+typedef hlt_set* __hlt_set_timer_cookie;
 
 struct __hlt_timer_mgr;
 
@@ -130,9 +126,11 @@ extern int8_t hlt_map_exists(hlt_map* m, const hlt_type_info* type, void* key,
 extern void hlt_map_remove(hlt_map* m, const hlt_type_info* type, void* key, hlt_exception** excpt,
                            hlt_execution_context* ctx);
 
-/// Called by an expiring timer to remove an element from the map.
+/// Called by the map's expiration timer to remove all elements that have
+/// expired. Reschedules the timer if further elements remain subject to
+/// expiration.
 ///
-/// cookie: The cookie identifying the element to be removed.
+/// cookie: The cookie identifying the map.
 extern void hlt_map_expire(__hlt_map_timer_cookie cookie, hlt_exception** excpt,
                            hlt_execution_context* ctx);
 
@@ -191,6 +189,86 @@ extern void hlt_map_default_callable(hlt_map* m, hlt_callable* func, hlt_excepti
 extern void hlt_map_timeout(hlt_map* m, hlt_enum strategy, hlt_interval timeout,
                             hlt_exception** excpt, hlt_execution_context* ctx);
 
+/// Bounds the number of entries a map may hold. Once the map grows beyond
+/// the bound, entries are evicted according to the given strategy until
+/// it's back within bounds; the entry just inserted is never evicted. With
+/// ``LRU``, the least recently inserted or accessed entry goes first;
+/// ``Clock`` approximates that with a reference bit per entry; and
+/// ``Random`` picks an arbitrary entry. Entries inserted before the map
+/// became bounded are evicted randomly.
+///
+/// m: The map.
+///
+/// strategy: The eviction strategy, of type ``Hilti::EvictStrategy``.
+///
+/// max: The maximum number of entries. If zero, the number is not bounded.
+///
+/// excpt: &
+///
+/// Raises: ValueError if *max* is negative or the strategy is unknown.
+extern void hlt_map_limit(hlt_map* m, hlt_enum strategy, int64_t max, hlt_exception** excpt,
+                          hlt_execution_context* ctx);
+
+/// Bounds the memory a map may occupy. This works like hlt_map_limit()
+/// but limits the value returned by hlt_map_bytes() instead. Both bounds
+/// can be active at the same time, using the strategy set last.
+///
+/// m: The map.
+///
+/// strategy: The eviction strategy, of type ``Hilti::EvictStrategy``.
+///
+/// max: The maximum size in bytes. If zero, the size is not bounded.
+///
+/// excpt: &
+///
+/// Raises: ValueError if *max* is negative or the strategy is unknown.
+extern void hlt_map_limit_bytes(hlt_map* m, hlt_enum strategy, int64_t max, hlt_exception** excpt,
+                                hlt_execution_context* ctx);
+
+/// Sets a callable to execute for each entry evicted because of a bound.
+/// It's called right before the entry is removed, and must not modify the
+/// map.
+///
+/// m: The map.
+///
+/// func: The callable. It must accept two parameters of the map's key
+/// and value types, respectively, and return nothing.
+///
+/// excpt: &
+extern void hlt_map_evict_callable(hlt_map* m, hlt_callable* func, hlt_exception** excpt,
+                                   hlt_execution_context* ctx);
+
+/// Returns the number of entries evicted from a map because of a bound.
+///
+/// m: The map.
+///
+/// excpt: &
+///
+/// Returns: The number of entries evicted so far.
+extern int64_t hlt_map_evicted(hlt_map* m, hlt_exception** excpt, hlt_execution_context* ctx);
+
+/// Returns the approximate memory a map's entries occupy. That covers the
+/// keys and values themselves along with the map's per-entry
+/// overhead, but not any further memory they reference.
+///
+/// m: The map.
+///
+/// excpt: &
+///
+/// Returns: The size in bytes.
+extern int64_t hlt_map_bytes(hlt_map* m, hlt_exception** excpt, hlt_execution_context* ctx);
+
+/// Returns a counter that changes each time the map's content changes.
+/// Comparing two values returned for the same map tells whether the map
+/// has been modified in between.
+///
+/// m: The map.
+///
+/// excpt: &
+///
+/// Returns: The current version.
+extern uint64_t hlt_map_version(hlt_map* m, hlt_exception** excpt, hlt_execution_context* ctx);
+
 /// Returns an iterator pointing the first map element.
 ///
 /// m: The map.
@@ -353,9 +431,11 @@ extern int8_t hlt_set_exists(hlt_set* m, const hlt_type_info* type, void* key,
 extern void hlt_set_remove(hlt_set* m, const hlt_type_info* type, void* key, hlt_exception** excpt,
                            hlt_execution_context* ctx);
 
-/// Called by an expiring timer to remove an element from the set.
+/// Called by the set's expiration timer to remove all elements that have
+/// expired. Reschedules the timer if further elements remain subject to
+/// expiration.
 ///
-/// cookie: The cookie identifying the element to be removed.
+/// cookie: The cookie identifying the set.
 extern void hlt_set_expire(__hlt_set_timer_cookie cookie, hlt_exception** excpt,
                            hlt_execution_context* ctx);
 
@@ -390,6 +470,86 @@ extern void hlt_set_clear(hlt_set* m, hlt_exception** excpt, hlt_execution_conte
 extern void hlt_set_timeout(hlt_set* m, hlt_enum strategy, hlt_interval timeout,
                             hlt_exception** excpt, hlt_execution_context* ctx);
 
+/// Bounds the number of entries a set may hold. Once the set grows beyond
+/// the bound, entries are evicted according to the given strategy until
+/// it's back within bounds; the entry just inserted is never evicted. With
+/// ``LRU``, the least recently inserted or accessed entry goes first;
+/// ``Clock`` approximates that with a reference bit per entry; and
+/// ``Random`` picks an arbitrary entry. Entries inserted before the set
+/// became bounded are evicted randomly.
+///
+/// m: The set.
+///
+/// strategy: The eviction strategy, of type ``Hilti::EvictStrategy``.
+///
+/// max: The maximum number of entries. If zero, the number is not bounded.
+///
+/// excpt: &
+///
+/// Raises: ValueError if *max* is negative or the strategy is unknown.
+extern void hlt_set_limit(hlt_set* m, hlt_enum strategy, int64_t max, hlt_exception** excpt,
+                          hlt_execution_context* ctx);
+
+/// Bounds the memory a set may occupy. This works like hlt_set_limit()
+/// but limits the value returned by hlt_set_bytes() instead. Both bounds
+/// can be active at the same time, using the strategy set last.
+///
+/// m: The set.
+///
+/// strategy: The eviction strategy, of type ``Hilti::EvictStrategy``.
+///
+/// max: The maximum size in bytes. If zero, the size is not bounded.
+///
+/// excpt: &
+///
+/// Raises: ValueError if *max* is negative or the strategy is unknown.
+extern void hlt_set_limit_bytes(hlt_set* m, hlt_enum strategy, int64_t max, hlt_exception** excpt,
+                                hlt_execution_context* ctx);
+
+/// Sets a callable to execute for each entry evicted because of a bound.
+/// It's called right before the entry is removed, and must not modify the
+/// set.
+///
+/// m: The set.
+///
+/// func: The callable. It must accept one parameter of the set's element
+/// type and return nothing.
+///
+/// excpt: &
+extern void hlt_set_evict_callable(hlt_set* m, hlt_callable* func, hlt_exception** excpt,
+                                   hlt_execution_context* ctx);
+
+/// Returns the number of entries evicted from a set because of a bound.
+///
+/// m: The set.
+///
+/// excpt: &
+///
+/// Returns: The number of entries evicted so far.
+extern int64_t hlt_set_evicted(hlt_set* m, hlt_exception** excpt, hlt_execution_context* ctx);
+
+/// Returns the approximate memory a set's entries occupy. That covers the
+/// keys themselves along with the set's per-entry
+/// overhead, but not any further memory they reference.
+///
+/// m: The set.
+///
+/// excpt: &
+///
+/// Returns: The size in bytes.
+extern int64_t hlt_set_bytes(hlt_set* m, hlt_exception** excpt, hlt_execution_context* ctx);
+
+/// Returns a counter that changes each time the set's content changes.
+/// Comparing two values returned for the same set tells whether the set
+/// has been modified in between.
+///
+/// m: The set.
+///
+/// excpt: &
+///
+/// Returns: The current version.
+extern uint64_t hlt_set_version(hlt_set* m, hlt_exception** excpt, hlt_execution_context* ctx);
+
 /// Returns an iterator pointing the first set element.
 ///
 /// m: The set.
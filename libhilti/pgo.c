@@ -0,0 +1,41 @@
+// Writes out the counters of code instrumented for profile-guided optimization.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "linker.h"
+#include "pgo.h"
+
+void __hlt_pgo_done()
+{
+    const __hlt_pgo_profile* profile = __hlt_pgo_data();
+
+    if ( ! profile )
+        return;
+
+    char fname[128];
+    snprintf(fname, sizeof(fname), "hlt.pgo.p%d.dat", getpid());
+
+    FILE* out = fopen(fname, "w");
+
+    if ( ! out ) {
+        fprintf(stderr, "libhilti: cannot write profile to %s\n", fname);
+        return;
+    }
+
+    fprintf(out, "# hilti-pgo %d\n", HLT_PGO_VERSION);
+
+    for ( uint64_t i = 0; i < profile->num_functions; i++ ) {
+        const __hlt_pgo_function* f = &profile->functions[i];
+
+        fprintf(out, "%s %" PRIu64 " %" PRIu64, f->name, f->hash, f->nblocks);
+
+        for ( uint64_t j = 0; j < f->nblocks; j++ )
+            fprintf(out, " %" PRIu64, f->counters[j]);
+
+        fputc('\n', out);
+    }
+
+    fclose(out);
+}
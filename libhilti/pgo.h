@@ -0,0 +1,35 @@
+// Run-time support for profile-guided optimization.
+//
+// When compiling with profile instrumentation, the HILTI optimizer adds a
+// counter for each basic block of the final linked code, and replaces
+// __hlt_pgo_data() with a version returning the table describing them. At
+// termination, we write all counts out into hlt.pgo.p<pid>.dat, from where
+// hilti-pgo merges them for use in the next compilation.
+
+#ifndef LIBHILTI_PGO_H
+#define LIBHILTI_PGO_H
+
+#include <stdint.h>
+
+static const int HLT_PGO_VERSION = 1; // File format version.
+
+// The counters of one instrumented function. Must match the layout the
+// optimizer generates.
+typedef struct {
+    const char* name;   // The function's LLVM-level name.
+    uint64_t hash;      // Hash of the function's control flow graph.
+    uint64_t nblocks;   // Number of basic blocks, and hence counters.
+    uint64_t* counters; // Execution counts of the blocks; the first is the entry count.
+} __hlt_pgo_function;
+
+// The table of all instrumented functions.
+typedef struct {
+    uint64_t num_functions;
+    __hlt_pgo_function* functions;
+} __hlt_pgo_profile;
+
+/// Writes out the counters if the code has been instrumented. Does nothing
+/// otherwise.
+extern void __hlt_pgo_done();
+
+#endif
@@ -21,6 +21,7 @@
 #include "debug.h"
 #include "globals.h"
 #include "hutil.h"
+#include "linker.h"
 #include "profiler.h"
 #include "string_.h"
 #include "timer.h"
@@ -36,8 +37,15 @@ typedef hlt_hash khint_t;
 
 #endif
 
-typedef struct {
+#ifndef __has_builtin
+#define __has_builtin(x) 0
+#endif
+
+typedef struct __hlt_profiler __hlt_profiler;
+
+struct __hlt_profiler {
     hlt_string tag;      // The hash tag.
+    __hlt_profiler* parent; // Profiler active when this one started, or null. Not owned.
     hlt_timer_mgr* tmgr; // Timer manager attached.
     hlt_timer* timer; // Snapshot timer if installed, or NULL. Not memory-managed to avoid cycles.
     hlt_enum style;   // The profile style.
@@ -51,7 +59,7 @@ typedef struct {
     uint64_t cache;   // Cache state at beginning.
     uint64_t heap;    // Heap size at beginning.
     uint64_t user;    // Value of user counter currently.
-} __hlt_profiler;
+};
 
 typedef struct __kh_table_t {
     // These are used by khash and copied from there (see README.HILTI).
@@ -61,11 +69,33 @@ typedef struct __kh_table_t {
     __hlt_profiler** vals;
 } kh_table_t;
 
+// Counters of one profiler in fast mode. We align them to a cache line so
+// that updating one doesn't touch its neighbours'.
+typedef struct {
+    uint64_t level;   // Depth of nested calls currently.
+    uint64_t start;   // Cycle counter at beginning of outermost call.
+    uint64_t count;   // Number of completed outermost calls.
+    uint64_t cycles;  // Cycles spent inside completed calls.
+    uint64_t updates; // Number of update calls so far.
+    uint64_t user;    // Value of user counter currently.
+    uint64_t parent;  // ID + 1 of the profiler this one first started inside, or zero.
+    uint64_t prev;    // ID + 1 of the profiler active when this one started, or zero.
+} __attribute__((aligned(64))) __hlt_profiler_fast;
+
 struct __hlt_profiler_state {
-    kh_table_t* profilers; // Active profilers.
-    int fd;                // Output file.
+    kh_table_t* profilers;     // Active profilers.
+    __hlt_profiler* current;   // Innermost active profiler, or null if none.
+    int fd;                    // Output file.
+    __hlt_profiler_fast* fast; // Fast mode counters indexed by ID, or null if not yet used.
+    uint64_t fast_size;        // Number of profiler IDs.
+    uint64_t fast_flushed;     // Cycle counter at last flush of the fast mode counters.
+    uint64_t fast_current;     // ID + 1 of the innermost active profiler in fast mode, or zero.
+    int fast_fd;               // Output file for fast mode.
 };
 
+// Minimum number of cycles between flushes of the fast mode counters.
+static const uint64_t FAST_FLUSH_CYCLES = ((uint64_t)1) << 31;
+
 typedef struct kh_hlt_profiler_table_t kh_hlt_profiler_table_t;
 
 static inline hlt_hash __kh_string_hash_func(hlt_string tag, const hlt_type_info* type)
@@ -167,28 +197,37 @@ error:
 
 #endif
 
-inline static void _safe_write(int8_t* data, int len, hlt_exception** excpt,
-                               hlt_execution_context* ctx)
+// Returns -1 on error, with errno set.
+inline static int _write_all(int fd, int8_t* data, int len)
 {
-    assert(ctx->pstate->fd >= 0);
-
     while ( len ) {
-        int written = write(ctx->pstate->fd, data, len);
+        int written = write(fd, data, len);
 
         if ( written < 0 ) {
             if ( errno == EAGAIN || errno == EINTR )
                 continue;
 
-            char buffer[128];
-            strerror_r(errno, buffer, sizeof(buffer));
-            hlt_string err = hlt_string_from_asciiz(buffer, excpt, ctx);
-            hlt_set_exception(excpt, &hlt_exception_io_error, err, ctx);
-            return;
+            return -1;
         }
 
         data += written;
         len -= written;
     }
+
+    return 0;
+}
+
+inline static void _safe_write(int8_t* data, int len, hlt_exception** excpt,
+                               hlt_execution_context* ctx)
+{
+    assert(ctx->pstate->fd >= 0);
+
+    if ( _write_all(ctx->pstate->fd, data, len) < 0 ) {
+        char buffer[128];
+        strerror_r(errno, buffer, sizeof(buffer));
+        hlt_string err = hlt_string_from_asciiz(buffer, excpt, ctx);
+        hlt_set_exception(excpt, &hlt_exception_io_error, err, ctx);
+    }
 }
 
 inline static int _safe_read(int fd, int8_t* data, int len)
@@ -215,20 +254,29 @@ inline static int _safe_read(int fd, int8_t* data, int len)
 
 inline static void write_tag(hlt_string str, hlt_exception** excpt, hlt_execution_context* ctx)
 {
-    int8_t len = str->len;
-    _safe_write(&len, sizeof(len), excpt, ctx);
+    uint8_t len = str ? str->len : 0;
+    _safe_write((int8_t*)&len, sizeof(len), excpt, ctx);
+
+    if ( ! len )
+        return;
+
     // We write this out in UTF8, and decode when reading.
     _safe_write(str->bytes, len, excpt, ctx);
 }
 
 inline static int read_tag(int fd, char* tag)
 {
-    int8_t len = 0;
+    uint8_t len = 0;
 
-    int ret = _safe_read(fd, &len, sizeof(len));
+    int ret = _safe_read(fd, (int8_t*)&len, sizeof(len));
     if ( ret <= 0 )
         return ret;
 
+    if ( ! len ) {
+        *tag = '\0';
+        return 1;
+    }
+
     int8_t buffer[len];
 
     if ( _safe_read(fd, buffer, len) <= 0 )
@@ -256,6 +304,8 @@ inline static int read_tag(int fd, char* tag)
 }
 
 static const char* MAGIC = "HLTPROF";
+static const char* FAST_MAGIC = "HLTPRID";
+static const char* SAMPLER_MAGIC = "HLTSMPL";
 
 static void write_header(hlt_exception** excpt, hlt_execution_context* ctx)
 {
@@ -332,16 +382,20 @@ static void write_record(int8_t rtype, __hlt_profiler* p, hlt_exception** excpt,
     rec.type = rtype;
 
     write_tag(p->tag, excpt, ctx);
+    write_tag(p->parent ? p->parent->tag : 0, excpt, ctx);
     _safe_write((int8_t*)&rec, sizeof(rec), excpt, ctx);
 }
 
-static int read_record(int fd, char* tag, hlt_profiler_record* rec)
+static int read_record(int fd, char* tag, char* parent, hlt_profiler_record* rec)
 {
     int ret = read_tag(fd, tag);
 
     if ( ret <= 0 )
         return ret;
 
+    if ( read_tag(fd, parent) <= 0 )
+        return -1; // Eof is an error here.
+
     if ( _safe_read(fd, (int8_t*)rec, sizeof(hlt_profiler_record)) <= 0 )
         return -1; // Eof is an error here.
 
@@ -403,8 +457,188 @@ static void install_timer(__hlt_profiler* p, hlt_exception** excpt, hlt_executio
     GC_DTOR(p->timer, hlt_timer, ctx); // Not memory-managed on our end.
 }
 
+static inline uint64_t _fast_cycles()
+{
+#if __has_builtin(__builtin_readcyclecounter)
+    return __builtin_readcyclecounter();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static void _fast_write_error(__hlt_profiler_state* state)
+{
+    fprintf(stderr, "HILTI profiling: cannot write profile, %s\n", strerror(errno));
+    close(state->fast_fd);
+    state->fast_fd = -1;
+}
+
+// Writes the counters of all profilers used so far as a snapshot. We
+// assemble it in memory first so that it takes a single write().
+static void _fast_flush(__hlt_profiler_state* state, uint64_t now)
+{
+    state->fast_flushed = now;
+
+    if ( state->fast_fd < 0 )
+        return;
+
+    uint64_t num = 0;
+
+    for ( uint64_t i = 0; i < state->fast_size; i++ ) {
+        __hlt_profiler_fast* p = &state->fast[i];
+        if ( p->count || p->updates || p->level )
+            ++num;
+    }
+
+    int len = sizeof(hlt_profiler_snapshot) + num * sizeof(hlt_profiler_counters);
+    int8_t* buffer = hlt_malloc(len);
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    hlt_profiler_snapshot* snapshot = (hlt_profiler_snapshot*)buffer;
+    snapshot->cwall = hlt_hton64((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+    snapshot->cycles = hlt_hton64(now);
+    snapshot->num = hlt_hton64(num);
+
+    hlt_profiler_counters* c = (hlt_profiler_counters*)(buffer + sizeof(hlt_profiler_snapshot));
+
+    for ( uint64_t i = 0; i < state->fast_size; i++ ) {
+        __hlt_profiler_fast* p = &state->fast[i];
+
+        if ( ! (p->count || p->updates || p->level) )
+            continue;
+
+        c->id = hlt_hton64(i);
+        c->count = hlt_hton64(p->count);
+        c->cycles = hlt_hton64(p->cycles);
+        c->updates = hlt_hton64(p->updates);
+        c->user = hlt_hton64(p->user);
+        c->parent = hlt_hton64(p->parent);
+        ++c;
+    }
+
+    if ( _write_all(state->fast_fd, buffer, len) < 0 )
+        _fast_write_error(state);
+
+    hlt_free(buffer);
+}
+
+static void _fast_init(__hlt_profiler_state* state, hlt_exception** excpt,
+                       hlt_execution_context* ctx)
+{
+    // The linker generates the table of tags, with the ID being the index.
+    const char** tags = __hlt_profiler_tags();
+
+    uint64_t n = 0;
+
+    while ( tags[n] )
+        ++n;
+
+    // We don't go through hlt_malloc() here because we need the alignment.
+    void* fast = 0;
+
+    if ( posix_memalign(&fast, 64, (n ? n : 1) * sizeof(__hlt_profiler_fast)) != 0 ) {
+        hlt_set_exception(excpt, &hlt_exception_out_of_memory, 0, ctx);
+        return;
+    }
+
+    memset(fast, 0, (n ? n : 1) * sizeof(__hlt_profiler_fast));
+
+    state->fast = fast;
+    state->fast_size = n;
+    state->fast_flushed = _fast_cycles();
+
+    char buffer[128];
+    if ( ctx->vid >= 0 )
+        snprintf(buffer, sizeof(buffer), "hlt.prof.p%d.t%" PRId64 ".fast.dat", getpid(), ctx->vid);
+    else
+        snprintf(buffer, sizeof(buffer), "hlt.prof.p%d.fast.dat", getpid());
+
+    state->fast_fd = open(buffer, O_WRONLY | O_CREAT | O_TRUNC, 0770);
+
+    if ( state->fast_fd < 0 ) {
+        strerror_r(errno, buffer, sizeof(buffer));
+        hlt_string err = hlt_string_from_asciiz(buffer, excpt, ctx);
+        hlt_set_exception(excpt, &hlt_exception_io_error, err, ctx);
+        return;
+    }
+
+    // Header, followed by the tags.
+    uint64_t version = hlt_hton64(HLT_PROFILER_FAST_VERSION);
+    uint64_t secs = hlt_hton64(time(0));
+    uint64_t num_tags = hlt_hton64(n);
+
+    if ( _write_all(state->fast_fd, (int8_t*)FAST_MAGIC, sizeof(FAST_MAGIC) - 1) < 0 ||
+         _write_all(state->fast_fd, (int8_t*)&version, sizeof(version)) < 0 ||
+         _write_all(state->fast_fd, (int8_t*)&secs, sizeof(secs)) < 0 ||
+         _write_all(state->fast_fd, (int8_t*)&num_tags, sizeof(num_tags)) < 0 ) {
+        _fast_write_error(state);
+        return;
+    }
+
+    for ( uint64_t i = 0; i < n; i++ ) {
+        size_t len = strlen(tags[i]);
+        uint8_t len8 = len < HLT_PROFILER_MAX_TAG_LENGTH ? len : HLT_PROFILER_MAX_TAG_LENGTH - 1;
+
+        if ( _write_all(state->fast_fd, (int8_t*)&len8, sizeof(len8)) < 0 ||
+             _write_all(state->fast_fd, (int8_t*)tags[i], len8) < 0 ) {
+            _fast_write_error(state);
+            return;
+        }
+    }
+}
+
+static __hlt_profiler_state* _state(hlt_execution_context* ctx)
+{
+    if ( ! ctx->pstate ) {
+        ctx->pstate = hlt_malloc(sizeof(__hlt_profiler_state));
+        ctx->pstate->profilers = kh_init(table);
+        ctx->pstate->current = 0;
+        ctx->pstate->fd = -1;
+        ctx->pstate->fast = 0;
+        ctx->pstate->fast_size = 0;
+        ctx->pstate->fast_flushed = 0;
+        ctx->pstate->fast_current = 0;
+        ctx->pstate->fast_fd = -1;
+    }
+
+    return ctx->pstate;
+}
+
+static inline __hlt_profiler_fast* _fast_profiler(uint64_t id, hlt_exception** excpt,
+                                                  hlt_execution_context* ctx)
+{
+    __hlt_profiler_state* state = _state(ctx);
+
+    if ( ! state->fast ) {
+        _fast_init(state, excpt, ctx);
+
+        if ( ! state->fast )
+            return 0;
+    }
+
+    if ( id >= state->fast_size ) {
+        // Code hasn't gone through the HILTI linker.
+        hlt_set_exception(excpt, &hlt_exception_value_error, 0, ctx);
+        return 0;
+    }
+
+    return &state->fast[id];
+}
+
 void __hlt_profiler_state_delete(__hlt_profiler_state* state)
 {
+    if ( state->fast ) {
+        _fast_flush(state, _fast_cycles());
+        free(state->fast);
+    }
+
+    if ( state->fast_fd >= 0 )
+        close(state->fast_fd);
+
     for ( khiter_t i = kh_begin(state->profilers); i != kh_end(state->profilers); i++ ) {
         if ( kh_exist(state->profilers, i) )
             hlt_free(kh_value(state->profilers, i));
@@ -455,11 +689,7 @@ void hlt_profiler_start(hlt_string tag, hlt_enum style, uint64_t param, hlt_time
     if ( ! __hlt_globals()->profiling_enabled )
         return;
 
-    if ( ! ctx->pstate ) {
-        ctx->pstate = hlt_malloc(sizeof(__hlt_profiler_state));
-        ctx->pstate->profilers = kh_init(table);
-        ctx->pstate->fd = -1;
-    }
+    _state(ctx);
 
     __hlt_profiler* p = 0;
 
@@ -480,6 +710,8 @@ void hlt_profiler_start(hlt_string tag, hlt_enum style, uint64_t param, hlt_time
         __hlt_profiler* p = hlt_calloc(1, sizeof(__hlt_profiler));
         p->tag = tag;
         GC_CCTOR(p->tag, hlt_string, ctx);
+        p->parent = ctx->pstate->current;
+        ctx->pstate->current = p;
         p->tmgr = tmgr ? tmgr : ctx->tmgr;
         GC_CCTOR(p->tmgr, hlt_timer_mgr, ctx);
         p->timer = 0;
@@ -623,6 +855,18 @@ void hlt_profiler_stop(hlt_string tag, hlt_exception** excpt, hlt_execution_cont
             p->timer = 0;
         }
 
+        // Take the profiler out of the nesting. Normally it's the innermost
+        // one, but the instrumentation doesn't guarantee that.
+        if ( ctx->pstate->current == p )
+            ctx->pstate->current = p->parent;
+
+        for ( khiter_t j = kh_begin(ctx->pstate->profilers); j != kh_end(ctx->pstate->profilers);
+              j++ ) {
+            if ( kh_exist(ctx->pstate->profilers, j) &&
+                 kh_value(ctx->pstate->profilers, j)->parent == p )
+                kh_value(ctx->pstate->profilers, j)->parent = p->parent;
+        }
+
         GC_DTOR(p->tag, hlt_string, ctx);
         GC_DTOR(p->tmgr, hlt_timer_mgr, ctx);
         hlt_free(p);
@@ -630,6 +874,70 @@ void hlt_profiler_stop(hlt_string tag, hlt_exception** excpt, hlt_execution_cont
     }
 }
 
+void hlt_profiler_fast_start(uint64_t id, hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    if ( ! __hlt_globals()->profiling_enabled )
+        return;
+
+    __hlt_profiler_fast* p = _fast_profiler(id, excpt, ctx);
+
+    if ( ! p || p->level++ )
+        return;
+
+    __hlt_profiler_state* state = ctx->pstate;
+
+    if ( ! p->parent && state->fast_current != id + 1 )
+        p->parent = state->fast_current;
+
+    p->prev = state->fast_current;
+    state->fast_current = id + 1;
+    p->start = _fast_cycles();
+}
+
+void hlt_profiler_fast_update(uint64_t id, uint64_t user_delta, hlt_exception** excpt,
+                              hlt_execution_context* ctx)
+{
+    if ( ! __hlt_globals()->profiling_enabled )
+        return;
+
+    __hlt_profiler_fast* p = _fast_profiler(id, excpt, ctx);
+
+    if ( ! p )
+        return;
+
+    ++p->updates;
+    p->user += user_delta;
+}
+
+void hlt_profiler_fast_stop(uint64_t id, hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    if ( ! __hlt_globals()->profiling_enabled )
+        return;
+
+    __hlt_profiler_fast* p = _fast_profiler(id, excpt, ctx);
+
+    if ( ! p )
+        return;
+
+    if ( ! p->level ) {
+        hlt_set_exception(excpt, &hlt_exception_profiler_unknown, 0, ctx);
+        return;
+    }
+
+    if ( --p->level )
+        return;
+
+    uint64_t now = _fast_cycles();
+    p->cycles += now - p->start;
+    ++p->count;
+
+    if ( ctx->pstate->fast_current == id + 1 )
+        ctx->pstate->fast_current = p->prev;
+
+    if ( now - ctx->pstate->fast_flushed >= FAST_FLUSH_CYCLES )
+        _fast_flush(ctx->pstate, now);
+}
+
 int hlt_profiler_file_open(const char* fname, time_t* t)
 {
     int fd = open(fname, O_RDONLY);
@@ -642,12 +950,152 @@ int hlt_profiler_file_open(const char* fname, time_t* t)
     return fd;
 }
 
-int hlt_profiler_file_read(int fd, char* tag, hlt_profiler_record* record)
+int hlt_profiler_file_read(int fd, char* tag, char* parent, hlt_profiler_record* record)
 {
-    return read_record(fd, tag, record);
+    return read_record(fd, tag, parent, record);
 }
 
 void hlt_profiler_file_close(int fd)
 {
     close(fd);
 }
+
+int hlt_profiler_fast_file_open(const char* fname, time_t* t, uint64_t* num_tags)
+{
+    int fd = open(fname, O_RDONLY);
+    if ( fd < 0 )
+        return -1;
+
+    int8_t buffer[sizeof(FAST_MAGIC) - 1];
+
+    if ( _safe_read(fd, buffer, sizeof(FAST_MAGIC) - 1) <= 0 ||
+         memcmp(FAST_MAGIC, buffer, sizeof(FAST_MAGIC) - 1) != 0 ) {
+        close(fd);
+        return -2;
+    }
+
+    uint64_t version = 0;
+    uint64_t secs = 0;
+    uint64_t num = 0;
+
+    if ( _safe_read(fd, (int8_t*)&version, sizeof(version)) <= 0 ||
+         _safe_read(fd, (int8_t*)&secs, sizeof(secs)) <= 0 ||
+         _safe_read(fd, (int8_t*)&num, sizeof(num)) <= 0 ) {
+        close(fd);
+        return -1; // Eof is an error here.
+    }
+
+    if ( hlt_ntoh64(version) != HLT_PROFILER_FAST_VERSION ) {
+        fprintf(stderr, "HILTI profiling: wrong version when reading profile\n");
+        close(fd);
+        return -1;
+    }
+
+    if ( t )
+        *t = hlt_ntoh64(secs);
+
+    if ( num_tags )
+        *num_tags = hlt_ntoh64(num);
+
+    return fd;
+}
+
+int hlt_profiler_fast_file_read_tag(int fd, char* tag)
+{
+    return read_tag(fd, tag) > 0 ? 1 : -1; // Eof is an error here.
+}
+
+int hlt_profiler_fast_file_read_snapshot(int fd, hlt_profiler_snapshot* snapshot)
+{
+    int ret = _safe_read(fd, (int8_t*)snapshot, sizeof(hlt_profiler_snapshot));
+
+    if ( ret <= 0 )
+        return ret;
+
+    snapshot->cwall = hlt_ntoh64(snapshot->cwall);
+    snapshot->cycles = hlt_ntoh64(snapshot->cycles);
+    snapshot->num = hlt_ntoh64(snapshot->num);
+
+    return 1;
+}
+
+int hlt_profiler_fast_file_read_counters(int fd, hlt_profiler_counters* counters)
+{
+    if ( _safe_read(fd, (int8_t*)counters, sizeof(hlt_profiler_counters)) <= 0 )
+        return -1; // Eof is an error here.
+
+    counters->id = hlt_ntoh64(counters->id);
+    counters->count = hlt_ntoh64(counters->count);
+    counters->cycles = hlt_ntoh64(counters->cycles);
+    counters->updates = hlt_ntoh64(counters->updates);
+    counters->user = hlt_ntoh64(counters->user);
+    counters->parent = hlt_ntoh64(counters->parent);
+
+    return 1;
+}
+
+int hlt_sampler_file_open(const char* fname, time_t* t, uint64_t* hz)
+{
+    int fd = open(fname, O_RDONLY);
+    if ( fd < 0 )
+        return -1;
+
+    int8_t buffer[sizeof(SAMPLER_MAGIC) - 1];
+
+    if ( _safe_read(fd, buffer, sizeof(SAMPLER_MAGIC) - 1) <= 0 ||
+         memcmp(SAMPLER_MAGIC, buffer, sizeof(SAMPLER_MAGIC) - 1) != 0 ) {
+        close(fd);
+        return -2;
+    }
+
+    uint64_t version = 0;
+    uint64_t secs = 0;
+    uint64_t rate = 0;
+
+    if ( _safe_read(fd, (int8_t*)&version, sizeof(version)) <= 0 ||
+         _safe_read(fd, (int8_t*)&secs, sizeof(secs)) <= 0 ||
+         _safe_read(fd, (int8_t*)&rate, sizeof(rate)) <= 0 ) {
+        close(fd);
+        return -1; // Eof is an error here.
+    }
+
+    if ( hlt_ntoh64(version) != HLT_SAMPLER_VERSION ) {
+        fprintf(stderr, "HILTI profiling: wrong version when reading samples\n");
+        close(fd);
+        return -1;
+    }
+
+    if ( t )
+        *t = hlt_ntoh64(secs);
+
+    if ( hz )
+        *hz = hlt_ntoh64(rate);
+
+    return fd;
+}
+
+int hlt_sampler_file_read(int fd, hlt_sampler_record* record,
+                          char (*frames)[HLT_PROFILER_MAX_TAG_LENGTH])
+{
+    int ret = _safe_read(fd, (int8_t*)record, sizeof(hlt_sampler_record));
+
+    if ( ret <= 0 )
+        return ret;
+
+    record->vid = (int64_t)hlt_ntoh64(record->vid);
+    record->fiber = hlt_ntoh64(record->fiber);
+    record->count = hlt_ntoh64(record->count);
+    record->depth = hlt_ntoh64(record->depth);
+
+    if ( record->depth > HLT_SAMPLER_MAX_DEPTH ) {
+        fprintf(stderr, "HILTI profiling: corrupt stack when reading samples\n");
+        return -1;
+    }
+
+    for ( uint64_t i = 0; i < record->depth; i++ ) {
+        if ( read_tag(fd, frames[i]) <= 0 )
+            return -1; // Eof is an error here.
+    }
+
+    return 1;
+}
@@ -16,6 +16,14 @@ extern void hlt_profiler_update(hlt_string tag, uint64_t user_delta, hlt_excepti
                                 hlt_execution_context* ctx);
 extern void hlt_profiler_stop(hlt_string tag, hlt_exception** excpt, hlt_execution_context* ctx);
 
+// Versions of the above for profilers that the HILTI linker has assigned an
+// ID. These aggregate the counters in memory, and write them out only
+// periodically.
+extern void hlt_profiler_fast_start(uint64_t id, hlt_exception** excpt, hlt_execution_context* ctx);
+extern void hlt_profiler_fast_update(uint64_t id, uint64_t user_delta, hlt_exception** excpt,
+                                     hlt_execution_context* ctx);
+extern void hlt_profiler_fast_stop(uint64_t id, hlt_exception** excpt, hlt_execution_context* ctx);
+
 extern void __hlt_profiler_state_delete(__hlt_profiler_state* state);
 
 extern void __hlt_profiler_init();
@@ -30,7 +38,7 @@ extern void hlt_profiler_timer_expire(hlt_string tag, hlt_exception** excpt,
 
 ////// Support for reading the profiling output.
 
-static const uint64_t HLT_PROFILER_VERSION = 1; // File format version.
+static const uint64_t HLT_PROFILER_VERSION = 2; // File format version.
 
 static const uint8_t HLT_PROFILER_START = 1;    // profiler.start
 static const uint8_t HLT_PROFILER_UPDATE = 2;   // profiler.update
@@ -55,8 +63,62 @@ typedef struct {
 static const int HLT_PROFILER_MAX_TAG_LENGTH = 256;
 
 extern int hlt_profiler_file_open(const char* fname, time_t* t);
-extern int hlt_profiler_file_read(int fd, char* tag,
-                                  hlt_profiler_record* record); // This returns ASCII.
+// This returns ASCII. The parent is the tag of the profiler that was active
+// when this one started, or empty if none.
+extern int hlt_profiler_file_read(int fd, char* tag, char* parent, hlt_profiler_record* record);
 extern void hlt_profiler_file_close(int fd);
 
+////// Support for reading the output of the fast mode. A file starts with
+////// the tags indexed by ID, followed by a series of snapshots.
+
+static const uint64_t HLT_PROFILER_FAST_VERSION = 2; // File format version.
+
+// Header of one snapshot.
+typedef struct {
+    uint64_t cwall;  // Current wall time (nsecs since epoch).
+    uint64_t cycles; // Current cycle counter.
+    uint64_t num;    // Number of hlt_profiler_counters following.
+} __attribute__((__packed__)) hlt_profiler_snapshot;
+
+// Counters of one profiler in a snapshot, accumulated since the beginning.
+typedef struct {
+    uint64_t id;      // The profiler's ID, indexing the tags.
+    uint64_t count;   // Number of completed outermost calls.
+    uint64_t cycles;  // Cycles spent inside completed calls.
+    uint64_t updates; // Number of update calls.
+    uint64_t user;    // Value of user's counter.
+    uint64_t parent;  // ID + 1 of the profiler this one first started inside, or zero.
+} __attribute__((__packed__)) hlt_profiler_counters;
+
+// Returns -2 if the file isn't in the fast mode's format.
+extern int hlt_profiler_fast_file_open(const char* fname, time_t* t, uint64_t* num_tags);
+extern int hlt_profiler_fast_file_read_tag(int fd, char* tag); // Call num_tags times first.
+extern int hlt_profiler_fast_file_read_snapshot(int fd, hlt_profiler_snapshot* snapshot);
+extern int hlt_profiler_fast_file_read_counters(int fd, hlt_profiler_counters* counters);
+
+////// Support for reading the output of the sampling profiler. A file is a
+////// series of stacks, each a record followed by the record's number of
+////// frames as tags, innermost first.
+
+static const uint64_t HLT_SAMPLER_VERSION = 1; // File format version.
+
+// Maximum number of frames recorded per sample.
+#define HLT_SAMPLER_MAX_DEPTH 32
+
+// Virtual thread recorded for samples taken outside of any fiber.
+#define HLT_SAMPLER_NO_VID INT64_MIN
+
+// One aggregated stack.
+typedef struct {
+    int64_t vid;    // Virtual thread of the sampled fiber, or HLT_SAMPLER_NO_VID if none.
+    uint64_t fiber; // Address of the sampled fiber, or zero if none.
+    uint64_t count; // Number of samples with this stack.
+    uint64_t depth; // Number of frames following.
+} __attribute__((__packed__)) hlt_sampler_record;
+
+// Returns -2 if the file isn't in the sampler's format.
+extern int hlt_sampler_file_open(const char* fname, time_t* t, uint64_t* hz);
+extern int hlt_sampler_file_read(int fd, hlt_sampler_record* record,
+                                 char (*frames)[HLT_PROFILER_MAX_TAG_LENGTH]);
+
 #endif
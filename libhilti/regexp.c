@@ -3,6 +3,7 @@
 #include <string.h>
 
 #include "autogen/hilti-hlt.h"
+#include "config.h"
 #include "justrx/src/jrx.h"
 #include "memory_.h"
 #include "regexp.h"
@@ -43,6 +44,12 @@ static inline int _cflags(hlt_regexp_flags flags)
     return cflags | ((cflags & REG_NOSUB) ? REG_ANCHOR : 0);
 }
 
+static inline void _regset_init(hlt_regexp* re)
+{
+    jrx_regset_init(&re->regexp, -1, _cflags(re->flags));
+    jrx_regset_set_max_states(&re->regexp, hlt_config_get()->regexp_max_dfa_states);
+}
+
 // patter not net ref'ed.
 static void _compile_one(hlt_regexp* re, hlt_string pattern, int idx, int re_refed,
                          hlt_exception** excpt, hlt_execution_context* ctx)
@@ -129,7 +136,7 @@ void hlt_regexp_clone_init(void* dstp, const hlt_type_info* ti, void* srcp,
     // TODO: Figure out a way to reuse the compiled regexp. Need to make that
     // thread-safe though.
 
-    jrx_regset_init(&dst->regexp, -1, _cflags(dst->flags));
+    _regset_init(dst);
 
     for ( int idx = 0; idx < dst->num; idx++ ) {
         hlt_string pattern = dst->patterns[idx];
@@ -145,7 +152,7 @@ static void _hlt_regexp_new_from_regexp_init(hlt_regexp* dst, hlt_regexp* other,
     dst->flags = other->flags;
     dst->num = other->num;
     dst->patterns = hlt_malloc(dst->num * sizeof(hlt_string));
-    jrx_regset_init(&dst->regexp, -1, _cflags(dst->flags));
+    _regset_init(dst);
 
     for ( int idx = 0; idx < other->num; idx++ ) {
         hlt_string pattern = other->patterns[idx];
@@ -176,7 +183,7 @@ void hlt_regexp_compile(hlt_regexp* re, const hlt_string pattern, hlt_exception*
 
     re->num = 1;
     re->patterns = hlt_malloc(sizeof(hlt_string));
-    jrx_regset_init(&re->regexp, -1, _cflags(re->flags));
+    _regset_init(re);
     _compile_one(re, pattern, 0, 0, excpt, ctx);
 
     if ( hlt_check_exception(excpt) )
@@ -195,7 +202,7 @@ void hlt_regexp_compile_set(hlt_regexp* re, hlt_list* patterns, hlt_exception**
 
     re->num = hlt_list_size(patterns, excpt, ctx);
     re->patterns = hlt_malloc(re->num * sizeof(hlt_string));
-    jrx_regset_init(&re->regexp, -1, _cflags(re->flags));
+    _regset_init(re);
 
     hlt_iterator_list i = hlt_list_begin(patterns, excpt, ctx);
     hlt_iterator_list end = hlt_list_end(patterns, excpt, ctx);
@@ -215,6 +222,21 @@ void hlt_regexp_compile_set(hlt_regexp* re, hlt_list* patterns, hlt_exception**
     jrx_regset_finalize(&re->regexp);
 }
 
+hlt_regexp_dfa_stats hlt_regexp_dfa_stats_get(hlt_regexp* re, hlt_exception** excpt,
+                                              hlt_execution_context* ctx)
+{
+    jrx_dfa_stats jstats;
+    jrx_regstats(&re->regexp, &jstats);
+
+    hlt_regexp_dfa_stats stats;
+    stats.hits = jstats.hits;
+    stats.misses = jstats.misses;
+    stats.flushes = jstats.flushes;
+    stats.states = jstats.states;
+    stats.sets = jstats.sets;
+    return stats;
+}
+
 hlt_string hlt_regexp_to_string(const hlt_type_info* type, const void* obj, int32_t options,
                                 __hlt_pointer_stack* seen, hlt_exception** excpt,
                                 hlt_execution_context* ctx)
@@ -37,6 +37,15 @@ typedef struct {
     hlt_iterator_bytes end;
 } hlt_regexp_match_token;
 
+/// Type for the result of ~~hlt_regexp_dfa_stats.
+typedef struct {
+    uint64_t hits;    /// Number of DFA state lookups finding the state already computed.
+    uint64_t misses;  /// Number of DFA state lookups that had to compute the state.
+    uint64_t flushes; /// Number of times the computed states were flushed for exceeding the budget.
+    uint64_t states;  /// Number of DFA states currently computed.
+    uint64_t sets;    /// Number of NFA state sets currently kept for computing DFA states.
+} hlt_regexp_dfa_stats;
+
 /// Instantiates a new Regexp instance.
 ///
 /// flags: The compilation flags for the regexp.
@@ -208,6 +217,18 @@ hlt_string hlt_regexp_to_string(const hlt_type_info* type, const void* obj, int3
 /// the caller, who needs to call hlt_free() once done.
 char* hlt_regexp_to_asciiz(hlt_regexp* re, hlt_exception** excpt, hlt_execution_context* ctx);
 
+/// Returns statistics about the DFA states a regexp computes incrementally
+/// during matching. The number of states kept computed is bounded by the
+/// ``regexp_max_dfa_states`` configuration setting.
+///
+/// re: The regexp to return the statistics for.
+///
+/// \hlt_c.
+///
+/// Returns: The statistics.
+extern hlt_regexp_dfa_stats hlt_regexp_dfa_stats_get(hlt_regexp* re, hlt_exception** excpt,
+                                                     hlt_execution_context* ctx);
+
 /// TODO: Document.
 extern hlt_regexp_match_token hlt_regexp_bytes_match_token(hlt_regexp* re,
                                                            const hlt_iterator_bytes begin,
@@ -0,0 +1,444 @@
+// In-process sampling profiler. See sampler.h.
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // For REG_* and dladdr().
+#endif
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "context.h"
+#include "fiber.h"
+#include "hutil.h"
+#include "profiler.h"
+#include "sampler.h"
+
+// Number of samples the signal handler can queue before the collector
+// thread has aggregated them. Must be a power of two.
+#define QUEUE_SIZE 4096
+
+// How often the collector thread aggregates the queue, in milliseconds.
+#define COLLECT_INTERVAL 100
+
+static const char* MAGIC = "HLTSMPL";
+
+// One sample as queued by the signal handler.
+typedef struct {
+    uint64_t seq;    // Sequence number coordinating producers and the consumer.
+    int64_t vid;     // Virtual thread of the fiber, or HLT_SAMPLER_NO_VID.
+    uintptr_t fiber; // The fiber running, or 0 if none.
+    uint64_t depth;  // Number of valid frames.
+    uintptr_t frames[HLT_SAMPLER_MAX_DEPTH]; // Return addresses, innermost first.
+} __hlt_sample;
+
+// One aggregated stack. Unused slots have a count of zero.
+typedef struct {
+    uint64_t hash;
+    int64_t vid;
+    uintptr_t fiber;
+    uint64_t depth;
+    uint64_t count;
+    uintptr_t frames[HLT_SAMPLER_MAX_DEPTH];
+} __hlt_sample_stack;
+
+static struct {
+    int8_t enabled;
+    __hlt_sample* queue;        // Ring buffer filled by the signal handler.
+    uint64_t head;              // Next slot for producers; updated atomically.
+    uint64_t tail;              // Next slot for the consumer.
+    uint64_t dropped;           // Samples dropped because the queue was full; updated atomically.
+    __hlt_sample_stack* stacks; // Open-addressing table of the aggregated stacks.
+    uint64_t stacks_size;       // Number of slots in the table, a power of two.
+    uint64_t stacks_used;       // Number of slots in use.
+    pthread_t collector;        // Thread aggregating the queue.
+    int8_t stop;                // Set to stop the collector; updated atomically.
+    struct sigaction old_action; // Handler we replaced.
+} _sampler;
+
+// Walks the frame pointer chain starting at the given frame. Must be
+// async-signal-safe.
+static uint64_t _walk(uintptr_t pc, uintptr_t fp, uintptr_t lo, uintptr_t hi, uintptr_t* frames)
+{
+    uint64_t depth = 0;
+    frames[depth++] = pc;
+
+    while ( depth < HLT_SAMPLER_MAX_DEPTH ) {
+        if ( fp < lo || fp + 2 * sizeof(uintptr_t) > hi || (fp & (sizeof(uintptr_t) - 1)) )
+            break;
+
+        uintptr_t next = ((uintptr_t*)fp)[0];
+        uintptr_t ret = ((uintptr_t*)fp)[1];
+
+        if ( ! ret )
+            break;
+
+        frames[depth++] = ret;
+
+        // The stack grows downwards, so the caller's frame must be above.
+        if ( next <= fp )
+            break;
+
+        fp = next;
+    }
+
+    return depth;
+}
+
+// SIGPROF handler. Everything it does is async-signal-safe except for
+// __hlt_fiber_current(), which relies on pthread_getspecific() being safe to
+// call from a signal handler. That holds for glibc and Darwin, but POSIX
+// doesn't promise it.
+static void _handler(int sig, siginfo_t* info, void* arg)
+{
+    int saved_errno = errno;
+
+    ucontext_t* uctx = (ucontext_t*)arg;
+    uintptr_t pc = 0;
+    uintptr_t fp = 0;
+
+#if defined(__x86_64__) && defined(DARWIN)
+    pc = uctx->uc_mcontext->__ss.__rip;
+    fp = uctx->uc_mcontext->__ss.__rbp;
+#elif defined(__x86_64__)
+    pc = uctx->uc_mcontext.gregs[REG_RIP];
+    fp = uctx->uc_mcontext.gregs[REG_RBP];
+#elif defined(__i386__)
+    pc = uctx->uc_mcontext.gregs[REG_EIP];
+    fp = uctx->uc_mcontext.gregs[REG_EBP];
+#endif
+
+    if ( ! pc )
+        goto done;
+
+    // Claim a slot in the queue.
+    uint64_t pos = __atomic_load_n(&_sampler.head, __ATOMIC_RELAXED);
+    __hlt_sample* s = 0;
+
+    while ( 1 ) {
+        s = &_sampler.queue[pos & (QUEUE_SIZE - 1)];
+        uint64_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+
+        if ( seq == pos ) {
+            if ( __atomic_compare_exchange_n(&_sampler.head, &pos, pos + 1, 1, __ATOMIC_RELAXED,
+                                             __ATOMIC_RELAXED) )
+                break;
+        }
+
+        else if ( seq < pos ) {
+            // Full.
+            __atomic_fetch_add(&_sampler.dropped, 1, __ATOMIC_RELAXED);
+            goto done;
+        }
+
+        else
+            pos = __atomic_load_n(&_sampler.head, __ATOMIC_RELAXED);
+    }
+
+    hlt_fiber* fiber = __hlt_fiber_current();
+
+    if ( fiber ) {
+        void* base;
+        size_t size;
+        __hlt_fiber_stack(fiber, &base, &size);
+
+        hlt_execution_context* ctx = hlt_fiber_context(fiber);
+
+        s->vid = ctx ? ctx->vid : HLT_SAMPLER_NO_VID;
+        s->fiber = (uintptr_t)fiber;
+        s->depth = _walk(pc, fp, (uintptr_t)base, (uintptr_t)base + size, s->frames);
+    }
+
+    else {
+        // We don't know the bounds of this stack, so we can't safely follow
+        // the frame pointers.
+        s->vid = HLT_SAMPLER_NO_VID;
+        s->fiber = 0;
+        s->depth = _walk(pc, fp, 0, 0, s->frames);
+    }
+
+    __atomic_store_n(&s->seq, pos + 1, __ATOMIC_RELEASE);
+
+done:
+    errno = saved_errno;
+}
+
+static uint64_t _hash(const __hlt_sample* s)
+{
+    // FNV-1a over the words.
+    uint64_t h = 14695981039346656037ULL;
+
+    h = (h ^ (uint64_t)s->vid) * 1099511628211ULL;
+    h = (h ^ (uint64_t)s->fiber) * 1099511628211ULL;
+
+    for ( uint64_t i = 0; i < s->depth; i++ )
+        h = (h ^ (uint64_t)s->frames[i]) * 1099511628211ULL;
+
+    return h;
+}
+
+static __hlt_sample_stack* _lookup(__hlt_sample_stack* stacks, uint64_t size, uint64_t hash,
+                                   int64_t vid, uintptr_t fiber, uint64_t depth,
+                                   const uintptr_t* frames)
+{
+    uint64_t i = hash & (size - 1);
+
+    while ( stacks[i].count ) {
+        __hlt_sample_stack* t = &stacks[i];
+
+        if ( t->hash == hash && t->vid == vid && t->fiber == fiber && t->depth == depth &&
+             memcmp(t->frames, frames, depth * sizeof(uintptr_t)) == 0 )
+            return t;
+
+        i = (i + 1) & (size - 1);
+    }
+
+    return &stacks[i];
+}
+
+static void _aggregate(const __hlt_sample* s)
+{
+    if ( (_sampler.stacks_used + 1) * 2 > _sampler.stacks_size ) {
+        uint64_t size = _sampler.stacks_size ? _sampler.stacks_size * 2 : 1024;
+        __hlt_sample_stack* stacks = hlt_calloc(size, sizeof(__hlt_sample_stack));
+
+        for ( uint64_t i = 0; i < _sampler.stacks_size; i++ ) {
+            __hlt_sample_stack* t = &_sampler.stacks[i];
+
+            if ( t->count )
+                *_lookup(stacks, size, t->hash, t->vid, t->fiber, t->depth, t->frames) = *t;
+        }
+
+        hlt_free(_sampler.stacks);
+        _sampler.stacks = stacks;
+        _sampler.stacks_size = size;
+    }
+
+    uint64_t hash = _hash(s);
+    __hlt_sample_stack* t = _lookup(_sampler.stacks, _sampler.stacks_size, hash, s->vid, s->fiber,
+                                    s->depth, s->frames);
+
+    if ( ! t->count ) {
+        t->hash = hash;
+        t->vid = s->vid;
+        t->fiber = s->fiber;
+        t->depth = s->depth;
+        memcpy(t->frames, s->frames, s->depth * sizeof(uintptr_t));
+        ++_sampler.stacks_used;
+    }
+
+    ++t->count;
+}
+
+// Moves all samples from the queue into the table. Only one thread may call
+// this at a time.
+static void _collect()
+{
+    while ( 1 ) {
+        __hlt_sample* s = &_sampler.queue[_sampler.tail & (QUEUE_SIZE - 1)];
+
+        if ( __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) != _sampler.tail + 1 )
+            break;
+
+        _aggregate(s);
+
+        __atomic_store_n(&s->seq, _sampler.tail + QUEUE_SIZE, __ATOMIC_RELEASE);
+        ++_sampler.tail;
+    }
+}
+
+static void* _collector(void* arg)
+{
+    // We don't want to sample ourselves.
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPROF);
+    pthread_sigmask(SIG_BLOCK, &set, 0);
+
+    while ( ! __atomic_load_n(&_sampler.stop, __ATOMIC_RELAXED) ) {
+        struct timespec ts = {0, COLLECT_INTERVAL * 1000000};
+        nanosleep(&ts, 0);
+        _collect();
+    }
+
+    return 0;
+}
+
+static void _write_frame(FILE* out, uintptr_t addr, int innermost)
+{
+    char buffer[HLT_PROFILER_MAX_TAG_LENGTH];
+
+    // Return addresses point to the instruction after the call, which may
+    // already belong to the next function.
+    uintptr_t lookup = innermost ? addr : addr - 1;
+
+    Dl_info info;
+
+    if ( dladdr((void*)lookup, &info) && info.dli_sname )
+        snprintf(buffer, sizeof(buffer), "%s", info.dli_sname);
+
+    else if ( dladdr((void*)lookup, &info) && info.dli_fname )
+        snprintf(buffer, sizeof(buffer), "%s+0x%" PRIxPTR, info.dli_fname,
+                 lookup - (uintptr_t)info.dli_fbase);
+
+    else
+        snprintf(buffer, sizeof(buffer), "0x%" PRIxPTR, lookup);
+
+    uint8_t len = strlen(buffer);
+    fwrite(&len, sizeof(len), 1, out);
+    fwrite(buffer, len, 1, out);
+}
+
+static void _write()
+{
+    char fname[128];
+    snprintf(fname, sizeof(fname), "hlt.prof.p%d.samples.dat", getpid());
+
+    FILE* out = fopen(fname, "w");
+
+    if ( ! out ) {
+        fprintf(stderr, "libhilti: cannot write samples to %s\n", fname);
+        return;
+    }
+
+    uint64_t version = hlt_hton64(HLT_SAMPLER_VERSION);
+    uint64_t secs = hlt_hton64(time(0));
+    uint64_t hz = hlt_hton64(hlt_config_get()->sampling);
+
+    fwrite(MAGIC, strlen(MAGIC), 1, out);
+    fwrite(&version, sizeof(version), 1, out);
+    fwrite(&secs, sizeof(secs), 1, out);
+    fwrite(&hz, sizeof(hz), 1, out);
+
+    for ( uint64_t i = 0; i < _sampler.stacks_size; i++ ) {
+        __hlt_sample_stack* t = &_sampler.stacks[i];
+
+        if ( ! t->count )
+            continue;
+
+        hlt_sampler_record rec;
+        rec.vid = hlt_hton64(t->vid);
+        rec.fiber = hlt_hton64(t->fiber);
+        rec.count = hlt_hton64(t->count);
+        rec.depth = hlt_hton64(t->depth);
+        fwrite(&rec, sizeof(rec), 1, out);
+
+        for ( uint64_t j = 0; j < t->depth; j++ )
+            _write_frame(out, t->frames[j], j == 0);
+    }
+
+    if ( ferror(out) )
+        fprintf(stderr, "libhilti: cannot write samples to %s\n", fname);
+
+    fclose(out);
+}
+
+// Uninstalls our SIGPROF handler.
+static void _restore_handler()
+{
+    // Don't fall back to the default action of terminating the process
+    // for a signal still pending.
+    if ( _sampler.old_action.sa_handler == SIG_DFL )
+        signal(SIGPROF, SIG_IGN);
+    else
+        sigaction(SIGPROF, &_sampler.old_action, 0);
+}
+
+// Stops the collector thread and waits for it to finish.
+static void _stop_collector()
+{
+    __atomic_store_n(&_sampler.stop, 1, __ATOMIC_RELAXED);
+    pthread_join(_sampler.collector, 0);
+}
+
+void __hlt_sampler_init()
+{
+    uint32_t hz = hlt_config_get()->sampling;
+
+    if ( ! hz )
+        return;
+
+    _sampler.queue = hlt_calloc(QUEUE_SIZE, sizeof(__hlt_sample));
+
+    for ( uint64_t i = 0; i < QUEUE_SIZE; i++ )
+        _sampler.queue[i].seq = i;
+
+    _sampler.head = 0;
+    _sampler.tail = 0;
+    _sampler.dropped = 0;
+    _sampler.stacks = 0;
+    _sampler.stacks_size = 0;
+    _sampler.stacks_used = 0;
+    _sampler.stop = 0;
+
+    __hlt_fiber_track_current();
+
+    // Each step undoes the previous ones if it fails, so that a failure
+    // leaves nothing running that __hlt_sampler_done() won't stop.
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = _handler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if ( sigaction(SIGPROF, &action, &_sampler.old_action) != 0 ) {
+        fprintf(stderr, "libhilti: cannot install sampling signal handler\n");
+        return;
+    }
+
+    if ( pthread_create(&_sampler.collector, 0, _collector, 0) != 0 ) {
+        fprintf(stderr, "libhilti: cannot start sampling thread\n");
+        _restore_handler();
+        return;
+    }
+
+    // Rates above 1MHz get the timer's finest resolution.
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 1 / hz;
+    timer.it_interval.tv_usec = hz < 1000000 ? (1000000 / hz) % 1000000 : 1;
+    timer.it_value = timer.it_interval;
+
+    if ( setitimer(ITIMER_PROF, &timer, 0) != 0 ) {
+        fprintf(stderr, "libhilti: cannot start sampling timer\n");
+        _stop_collector();
+        _restore_handler();
+        return;
+    }
+
+    _sampler.enabled = 1;
+}
+
+void __hlt_sampler_done()
+{
+    if ( ! _sampler.enabled )
+        return;
+
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, 0);
+
+    _restore_handler();
+    _stop_collector();
+    _collect();
+    _write();
+
+    if ( _sampler.dropped )
+        fprintf(stderr, "libhilti: dropped %" PRIu64 " samples\n", _sampler.dropped);
+
+    // We leave the queue in place in case a handler is still running on
+    // another thread.
+    hlt_free(_sampler.stacks);
+    _sampler.stacks = 0;
+    _sampler.stacks_size = 0;
+    _sampler.stacks_used = 0;
+    _sampler.enabled = 0;
+}
@@ -0,0 +1,23 @@
+// In-process sampling profiler.
+//
+// If hlt_config::sampling is set, a profiling timer interrupts the running
+// threads at the given rate of CPU time. The signal handler walks the stack
+// of the code it interrupted through the frame pointers, which requires
+// compiling with hilti::Options::frame_pointers. It can only trust those
+// inside a fiber, where it knows the stack's bounds; outside of fibers, it
+// records just the current function. Each sample is attributed to the
+// fiber running and the virtual thread that fiber belongs to.
+//
+// The handler queues the samples in a lock-free ring buffer, from which a
+// separate thread aggregates them. At termination, we symbolize the
+// aggregated stacks as far as the dynamic linker knows the addresses, and
+// write them to hlt.prof.p<pid>.samples.dat. ``hilti-prof`` reads that
+// file, and can resolve the addresses of JIT code through a perf map.
+
+#ifndef LIBHILTI_SAMPLER_H
+#define LIBHILTI_SAMPLER_H
+
+extern void __hlt_sampler_init();
+extern void __hlt_sampler_done();
+
+#endif
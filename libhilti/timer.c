@@ -31,7 +31,7 @@ void hlt_timer_dtor(hlt_type_info* ti, hlt_timer* timer, hlt_execution_context*
         break;
 
     case HLT_TIMER_LIST:
-        GC_DTOR(timer->cookie.list, hlt_iterator_list, ctx);
+        // Nothing to do.
         break;
 
     case HLT_TIMER_MAP:
@@ -43,7 +43,7 @@ void hlt_timer_dtor(hlt_type_info* ti, hlt_timer* timer, hlt_execution_context*
         break;
 
     case HLT_TIMER_VECTOR:
-        GC_DTOR(timer->cookie.vector, hlt_iterator_vector, ctx);
+        // Nothing to do.
         break;
 
     case HLT_TIMER_PROFILER:
@@ -209,11 +209,11 @@ extern int64_t hlt_timer_mgr_to_int64(const hlt_type_info* type, const void* obj
 extern hlt_timer* __hlt_timer_new_function(hlt_callable* func, hlt_exception** excpt,
                                            hlt_execution_context* ctx);
 
-/// Instantiates a new timer object that will expire a list entry when it
-/// fires.
+/// Instantiates a new timer object that will expire all due list entries
+/// when it fires.
 ///
-/// cookie: A list-specific cookie to identify the item to be expired. The
-/// function takes ownership (i.e., it must have been ref'ed already.)
+/// cookie: A list-specific cookie to identify the list. The timer does not
+/// hold a reference to it; the list cancels the timer when it goes away.
 ///
 /// excpt: &
 ///
@@ -221,11 +221,11 @@ extern hlt_timer* __hlt_timer_new_function(hlt_callable* func, hlt_exception** e
 extern hlt_timer* __hlt_timer_new_list(__hlt_list_timer_cookie cookie, hlt_exception** excpt,
                                        hlt_execution_context* ctx);
 
-/// Instantiates a new timer object that will expire a map entry when it
-/// fires.
+/// Instantiates a new timer object that will expire all due map entries
+/// when it fires.
 ///
-/// cookie: A map-specific cookie to identify the item to be expired. The
-/// function takes ownership (i.e., it must have been ref'ed already.)
+/// cookie: A map-specific cookie to identify the map. The timer does not
+/// hold a reference to it; the map cancels the timer when it goes away.
 ///
 /// excpt: &
 ///
@@ -233,11 +233,12 @@ extern hlt_timer* __hlt_timer_new_list(__hlt_list_timer_cookie cookie, hlt_excep
 extern hlt_timer* __hlt_timer_new_map(__hlt_map_timer_cookie cookie, hlt_exception** excpt,
                                       hlt_execution_context* ctx);
 
-/// Instantiates a new timer object that will expire a vector entry when it
-/// fires.
+/// Instantiates a new timer object that will expire all due vector
+/// elements when it fires.
 ///
-/// cookie: A vector-specific cookie to identify the item to be expired. The
-/// function takes ownership (i.e., it must have been ref'ed already.)
+/// cookie: A vector-specific cookie to identify the vector. The timer does
+/// not hold a reference to it; the vector cancels the timer when it goes
+/// away.
 ///
 /// excpt: &
 ///
@@ -245,11 +246,11 @@ extern hlt_timer* __hlt_timer_new_map(__hlt_map_timer_cookie cookie, hlt_excepti
 extern hlt_timer* __hlt_timer_new_vector(__hlt_vector_timer_cookie cookie, hlt_exception** excpt,
                                          hlt_execution_context* ctx);
 
-/// Instantiates a new timer object that will expire a set entry when it
-/// fires.
+/// Instantiates a new timer object that will expire all due set entries
+/// when it fires.
 ///
-/// cookie: A set-specific cookie to identify the item to be expired. The
-/// function takes ownership (i.e., it must have been ref'ed already.)
+/// cookie: A set-specific cookie to identify the set. The timer does not
+/// hold a reference to it; the set cancels the timer when it goes away.
 ///
 /// excpt: &
 ///
@@ -24,6 +24,7 @@ typedef struct __hlt_pointer_stack __hlt_pointer_stack;
 typedef struct __hlt_pointer_map __hlt_pointer_map;
 typedef struct __hlt_clone_state __hlt_clone_state;
 typedef struct __hlt_fiber_pool __hlt_fiber_pool;
+typedef struct __hlt_list_pool __hlt_list_pool;
 typedef struct __hlt_memory_nullbuffer __hlt_memory_nullbuffer;
 
 /// Type for hash values.
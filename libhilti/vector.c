@@ -7,6 +7,7 @@
 
 #include "autogen/hilti-hlt.h"
 #include "enum.h"
+#include "expire.h"
 #include "int.h"
 #include "interval.h"
 #include "timer.h"
@@ -15,33 +16,67 @@
 
 #include <string.h>
 
-// Factor by which to growth array on reallocation.
-static const float GrowthFactor = 1.5;
+// Factor by which to grow the element array on reallocation.
+static const hlt_vector_idx GrowthFactor = 2;
 
-// Initial allocation size for a new vector
-static const hlt_vector_idx InitialCapacity = 1;
+// Capacity to allocate once a vector receives its first element. We don't
+// allocate any storage for empty vectors.
+static const hlt_vector_idx InitialCapacity = 8;
+
+// Number of elements tracked per word of the occupancy bitmap.
+#define OCCUPIED_BITS 64
 
 struct __hlt_vector {
-    __hlt_gchdr __gchdr; // Header for memory management.
-    void* elems;         // Pointer to the element array.
-    int8_t* occupied; // Array recording if fields have been set. TODO: Should convert to using bits
-                      // instead of bytes.
-    hlt_timer**
-        timers; // Array of timers, with entries 0 if not set. Not memory-managed to avoid cycles.
-    hlt_vector_idx last;       // Largest valid index.
-    hlt_vector_idx capacity;   // Number of element we have physically allocated in elems.
-    const hlt_type_info* type; // Type information for our elements.
-    void* def;                 // Default element for not yet initialized fields.
-    hlt_timer_mgr* tmgr;       // The timer manager, or null if not used.
-    hlt_interval timeout;      // The timeout value, or 0 if disabled.
-    hlt_enum strategy;         // Expiration strategy if set; zero otherwise.
+    __hlt_gchdr __gchdr;             // Header for memory management.
+    void* elems;                     // Pointer to the element array.
+    uint64_t* occupied;              // Bitmap recording which elements have been set.
+    __hlt_expire_node* expire_nodes; // Expiration links, one per element; null until needed.
+    __hlt_expire_list expire;        // Elements subject to expiration.
+    hlt_vector_idx last;             // Largest valid index.
+    hlt_vector_idx capacity;         // Number of element we have physically allocated in elems.
+    const hlt_type_info* type;       // Type information for our elements.
+    void* def;                       // Default element for not yet initialized fields.
+    hlt_timer_mgr* tmgr;             // The timer manager, or null if not used.
+    hlt_interval timeout;            // The timeout value, or 0 if disabled.
+    hlt_enum strategy;               // Expiration strategy if set; zero otherwise.
 };
 
+// Returns the number of bitmap words needed for n elements.
+static inline hlt_vector_idx _occupied_words(hlt_vector_idx n)
+{
+    return (n + OCCUPIED_BITS - 1) / OCCUPIED_BITS;
+}
+
+static inline int8_t _is_occupied(hlt_vector* v, hlt_vector_idx i)
+{
+    return (v->occupied[i / OCCUPIED_BITS] >> (i % OCCUPIED_BITS)) & 1;
+}
+
+static inline void _set_occupied(hlt_vector* v, hlt_vector_idx i)
+{
+    v->occupied[i / OCCUPIED_BITS] |= (UINT64_C(1) << (i % OCCUPIED_BITS));
+}
+
+static inline void _clear_occupied(hlt_vector* v, hlt_vector_idx i)
+{
+    v->occupied[i / OCCUPIED_BITS] &= ~(UINT64_C(1) << (i % OCCUPIED_BITS));
+}
+
+static inline char* _elem(hlt_vector* v, hlt_vector_idx i)
+{
+    return (char*)v->elems + i * v->type->size;
+}
+
 void hlt_vector_dtor(hlt_type_info* ti, hlt_vector* v, hlt_execution_context* ctx)
 {
-    char* end = (char*)v->elems + v->last * v->type->size;
-    for ( char* elem = v->elems; elem <= end; elem += v->type->size ) {
-        GC_DTOR_GENERIC(elem, v->type, ctx);
+    if ( v->expire.timer ) {
+        hlt_exception* excpt = 0;
+        hlt_timer_cancel(v->expire.timer, &excpt, ctx);
+    }
+
+    if ( ! v->type->atomic ) {
+        for ( hlt_vector_idx i = 0; i <= v->last; i++ )
+            GC_DTOR_GENERIC(_elem(v, i), v->type, ctx);
     }
 
     GC_DTOR_GENERIC(v->def, v->type, ctx);
@@ -49,7 +84,7 @@ void hlt_vector_dtor(hlt_type_info* ti, hlt_vector* v, hlt_execution_context* ct
 
     hlt_free(v->elems);
     hlt_free(v->occupied);
-    hlt_free(v->timers);
+    hlt_free(v->expire_nodes);
     hlt_free(v->def);
 }
 
@@ -64,31 +99,92 @@ void hlt_iterator_vector_dtor(hlt_type_info* ti, hlt_iterator_vector* i, hlt_exe
     GC_DTOR(i->vec, hlt_vector, ctx);
 }
 
+// Moves the expiration links into an array for n elements. As the links
+// point to each other, we can't just realloc.
+static void _resize_expire_nodes(hlt_vector* v, hlt_vector_idx n)
+{
+    __hlt_expire_node* old = v->expire_nodes;
+    __hlt_expire_node* nodes = hlt_malloc(sizeof(__hlt_expire_node) * n);
+
+    if ( old ) {
+        for ( hlt_vector_idx i = 0; i < v->capacity; i++ ) {
+            nodes[i].prev = old[i].prev ? nodes + (old[i].prev - old) : 0;
+            nodes[i].next = old[i].next ? nodes + (old[i].next - old) : 0;
+            nodes[i].time = old[i].time;
+        }
+
+        v->expire.head = v->expire.head ? nodes + (v->expire.head - old) : 0;
+        v->expire.tail = v->expire.tail ? nodes + (v->expire.tail - old) : 0;
+        hlt_free(old);
+    }
+
+    v->expire_nodes = nodes;
+}
+
+// Schedules the vector's timer if it has expiring elements but no timer yet.
+static inline void _schedule_vector(hlt_vector* v, hlt_exception** excpt,
+                                    hlt_execution_context* ctx)
+{
+    if ( v->expire.timer || ! v->expire.head )
+        return;
+
+    hlt_timer* t = __hlt_timer_new_vector(v, excpt, ctx);
+    __hlt_expire_list_schedule(&v->expire, v->tmgr, t, excpt, ctx);
+}
+
 static inline void _access_entry(hlt_vector* v, hlt_vector_idx i, hlt_exception** excpt,
                                  hlt_execution_context* ctx)
 {
+    if ( ! v->expire_nodes || ! __hlt_expire_list_contains(&v->expire, &v->expire_nodes[i]) )
+        return;
+
     if ( ! v->tmgr || ! hlt_enum_equal(v->strategy, Hilti_ExpireStrategy_Access, excpt, ctx) ||
          v->timeout == 0 )
         return;
 
-    if ( ! v->timers[i] )
+    // No need to update the timer. If it fires too early now, we'll
+    // reschedule it at that point.
+    hlt_time t = hlt_timer_mgr_current(v->tmgr, excpt, ctx) + v->timeout;
+    __hlt_expire_list_touch(&v->expire, &v->expire_nodes[i], t);
+}
+
+// Initializes the elements from index *from* up to and including *to* with
+// the vector's default.
+static inline void _init_entries(hlt_vector* v, hlt_vector_idx from, hlt_vector_idx to,
+                                 hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    if ( v->type->atomic ) {
+        for ( hlt_vector_idx j = from; j <= to; j++ )
+            memcpy(_elem(v, j), v->def, v->type->size);
+
         return;
+    }
 
-    hlt_time t = hlt_timer_mgr_current(v->tmgr, excpt, ctx) + v->timeout;
-    hlt_timer_update(v->timers[i], t, excpt, ctx);
+    for ( hlt_vector_idx j = from; j <= to; j++ )
+        hlt_clone_deep(_elem(v, j), v->type, v->def, excpt, ctx);
+}
+
+// Ensures that the vector can store an element at index i, growing it
+// geometrically if necessary.
+static inline void _make_room(hlt_vector* v, hlt_vector_idx i, hlt_exception** excpt,
+                              hlt_execution_context* ctx)
+{
+    if ( i < v->capacity )
+        return;
+
+    hlt_vector_idx c = (v->capacity ? v->capacity : InitialCapacity);
+
+    while ( i >= c )
+        c *= GrowthFactor;
+
+    hlt_vector_reserve(v, c, excpt, ctx);
 }
 
 // Val is not yet ref'ed.
 static inline void _set_entry(hlt_vector* v, hlt_vector_idx i, void* val, int dtor,
                               hlt_exception** excpt, hlt_execution_context* ctx)
 {
-    // Cancel old timer if active.
-    if ( v->tmgr && v->timers && v->timers[i] ) {
-        hlt_timer_cancel(v->timers[i], excpt, ctx);
-        v->timers[i] = 0;
-    }
-
-    char* dst = (char*)v->elems + i * v->type->size;
+    char* dst = _elem(v, i);
 
     if ( dtor )
         GC_DTOR_GENERIC(dst, v->type, ctx);
@@ -96,16 +192,19 @@ static inline void _set_entry(hlt_vector* v, hlt_vector_idx i, void* val, int dt
     memcpy(dst, val, v->type->size);
     GC_CCTOR_GENERIC(dst, v->type, ctx);
 
-    v->occupied[i] = 1;
+    _set_occupied(v, i);
+
+    // A new value restarts the element's expiration.
+    if ( v->expire_nodes && __hlt_expire_list_contains(&v->expire, &v->expire_nodes[i]) )
+        __hlt_expire_list_unlink(&v->expire, &v->expire_nodes[i]);
 
-    // Start timer if needed.
     if ( v->tmgr && v->timeout ) {
-        GC_CCTOR(v, hlt_vector, ctx);
-        __hlt_vector_timer_cookie cookie = {v, i};
-        v->timers[i] = __hlt_timer_new_vector(cookie, excpt, ctx); // Not memory-managed on our end.
+        if ( ! v->expire_nodes )
+            _resize_expire_nodes(v, v->capacity);
+
         hlt_time t = hlt_timer_mgr_current(v->tmgr, excpt, ctx) + v->timeout;
-        hlt_timer_mgr_schedule(v->tmgr, t, v->timers[i], excpt, ctx);
-        GC_DTOR(v->timers[i], hlt_timer, ctx); // Not memory-managed on our end.
+        __hlt_expire_list_append(&v->expire, &v->expire_nodes[i], t);
+        _schedule_vector(v, excpt, ctx);
     }
 }
 
@@ -113,16 +212,12 @@ static inline void _hlt_vector_init(hlt_vector* v, const hlt_type_info* elemtype
                                     struct __hlt_timer_mgr* tmgr, hlt_exception** excpt,
                                     hlt_execution_context* ctx)
 {
-    v->elems = hlt_malloc(elemtype->size * InitialCapacity);
-    v->occupied = hlt_malloc(InitialCapacity);
+    // Storage gets allocated on first insertion.
+    v->elems = 0;
+    v->occupied = 0;
+    v->expire_nodes = 0;
 
-    if ( tmgr ) {
-        GC_INIT(v->tmgr, tmgr, hlt_timer_mgr, ctx);
-        v->timers = hlt_malloc(sizeof(hlt_timer*) * InitialCapacity);
-        assert(v->timers);
-    }
-    else
-        v->timers = 0;
+    GC_INIT(v->tmgr, tmgr, hlt_timer_mgr, ctx);
 
     // We need to deep-copy the default element as the caller might have it
     // on its stack.
@@ -130,7 +225,7 @@ static inline void _hlt_vector_init(hlt_vector* v, const hlt_type_info* elemtype
     hlt_clone_deep(v->def, elemtype, def, excpt, ctx);
 
     v->last = -1;
-    v->capacity = InitialCapacity;
+    v->capacity = 0;
     v->type = elemtype;
     v->timeout = 0.0;
     v->strategy = hlt_enum_unset(excpt, ctx);
@@ -155,17 +250,7 @@ static void _clone_init_in_thread(const hlt_type_info* ti, void* dstp, hlt_excep
     dst->tmgr = ctx->tmgr;
     GC_CCTOR(dst->tmgr, hlt_timer_mgr, ctx);
 
-    assert(dst->timers);
-
-    for ( hlt_vector_idx i = 0; i <= dst->last; i++ ) {
-        hlt_timer* t = dst->timers[i];
-
-        if ( ! t )
-            continue;
-
-        hlt_timer_mgr_schedule(dst->tmgr, t->time, t, excpt, ctx);
-        GC_DTOR(t, hlt_timer, ctx); // Not memory-managed on our end.
-    }
+    _schedule_vector(dst, excpt, ctx);
 }
 
 void* hlt_vector_clone_alloc(const hlt_type_info* ti, void* srcp, __hlt_clone_state* cstate,
@@ -189,42 +274,44 @@ void hlt_vector_clone_init(void* dstp, const hlt_type_info* ti, void* srcp,
         return;
     }
 
-    dst->elems = hlt_malloc(src->type->size * src->capacity);
-
-    if ( src->timers && src->timeout )
-        dst->timers = hlt_malloc(sizeof(hlt_timer*) * src->capacity);
-    else
-        dst->timers = 0;
+    dst->elems = 0;
+    dst->occupied = 0;
+    dst->expire_nodes = 0;
+    dst->expire.head = dst->expire.tail = 0;
+    dst->expire.timer = 0; // Scheduled by init_in_thread().
+    dst->last = -1;
+    dst->capacity = 0;
+    dst->type = src->type;
+    dst->timeout = src->timeout;
+    dst->strategy = src->strategy;
+    dst->tmgr = 0; // Set by init_in_thread()
+    dst->def = hlt_malloc(dst->type->size);
+    __hlt_clone(dst->def, src->type, src->def, cstate, excpt, ctx);
 
-    for ( hlt_vector_idx i = 0; i <= src->last; i++ ) {
-        char* selem = (char*)src->elems + i * src->type->size;
-        char* delem = (char*)dst->elems + i * src->type->size;
+    hlt_vector_reserve(dst, src->capacity, excpt, ctx);
 
-        __hlt_clone(delem, src->type, selem, cstate, excpt, ctx);
+    if ( src->capacity ) {
+        if ( src->type->atomic )
+            memcpy(dst->elems, src->elems, (src->last + 1) * src->type->size);
 
-        if ( src->timers && src->timeout ) {
-            if ( src->timers[i] ) {
-                GC_CCTOR(dst, hlt_vector, ctx);
-                __hlt_vector_timer_cookie cookie = {dst, i};
-                dst->timers[i] = __hlt_timer_new_vector(cookie, excpt, ctx);
-                dst->timers[i]->time = src->timers[i]->time; // Preset time.
-            }
-            else
-                dst->timers[i] = 0;
+        else {
+            for ( hlt_vector_idx i = 0; i <= src->last; i++ )
+                __hlt_clone(_elem(dst, i), src->type, _elem(src, i), cstate, excpt, ctx);
         }
-    }
 
-    dst->occupied = hlt_malloc(src->capacity);
-    memcpy(dst->occupied, src->occupied, src->capacity);
+        memcpy(dst->occupied, src->occupied, _occupied_words(src->capacity) * sizeof(uint64_t));
+    }
 
     dst->last = src->last;
-    dst->capacity = src->capacity;
-    dst->type = src->type;
-    dst->timeout = src->timeout;
-    dst->strategy = src->strategy;
-    dst->tmgr = 0; // Set by init_in_thread()
-    dst->def = hlt_malloc(dst->type->size);
-    __hlt_clone(dst->def, src->type, src->def, cstate, excpt, ctx);
+
+    if ( src->expire.head ) {
+        // Rebuild the expiration list in the same order.
+        _resize_expire_nodes(dst, dst->capacity);
+
+        for ( __hlt_expire_node* n = src->expire.head; n; n = n->next )
+            __hlt_expire_list_append(&dst->expire, &dst->expire_nodes[n - src->expire_nodes],
+                                     n->time);
+    }
 
     if ( src->tmgr )
         __hlt_clone_init_in_thread(_clone_init_in_thread, ti, dstp, cstate, excpt, ctx);
@@ -249,8 +336,7 @@ void* hlt_vector_get(hlt_vector* v, hlt_vector_idx i, hlt_exception** excpt,
     }
 
     _access_entry(v, i, excpt, ctx);
-    char* elem = (char*)v->elems + i * v->type->size;
-    return elem;
+    return _elem(v, i);
 }
 
 void hlt_vector_set(hlt_vector* v, hlt_vector_idx i, const hlt_type_info* elemtype, void* val,
@@ -258,28 +344,13 @@ void hlt_vector_set(hlt_vector* v, hlt_vector_idx i, const hlt_type_info* elemty
 {
     assert(__hlt_type_equal(v->type, elemtype));
 
-    if ( i >= v->capacity ) {
-        // Allocate more memory.
-        hlt_vector_idx c = v->capacity;
-        while ( i >= c )
-            c *= (c + 1) * GrowthFactor;
-
-        hlt_vector_reserve(v, c, excpt, ctx);
-    }
-
-    for ( int j = v->last + 1; j <= i; j++ ) {
-        // Initialize elements between old and new end of vector.
-        char* dst = (char*)v->elems + j * v->type->size;
-        hlt_clone_deep(dst, v->type, v->def, excpt, ctx);
-
-        if ( v->tmgr ) {
-            assert(v->timers);
-            v->timers[j] = 0;
-        }
-    }
+    _make_room(v, i, excpt, ctx);
 
-    if ( i > v->last )
+    // Initialize elements between old and new end of vector.
+    if ( i > v->last ) {
+        _init_entries(v, v->last + 1, i, excpt, ctx);
         v->last = i;
+    }
 
     _set_entry(v, i, val, 1, excpt, ctx);
 }
@@ -290,7 +361,7 @@ int8_t hlt_vector_exists(hlt_vector* v, hlt_vector_idx i, hlt_exception** excpt,
     if ( i > v->last )
         return 0;
 
-    return v->occupied[i];
+    return _is_occupied(v, i);
 }
 
 void hlt_vector_push_back(hlt_vector* v, const hlt_type_info* elemtype, void* val,
@@ -299,22 +370,60 @@ void hlt_vector_push_back(hlt_vector* v, const hlt_type_info* elemtype, void* va
     assert(v);
     assert(__hlt_type_equal(v->type, elemtype));
 
+    _make_room(v, v->last + 1, excpt, ctx);
     ++v->last;
 
-    if ( v->last >= v->capacity ) {
-        // Allocate more memory.
-        hlt_vector_idx c = (v->capacity + 1) * GrowthFactor;
-        hlt_vector_reserve(v, c, excpt, ctx);
+    assert(v->last < v->capacity);
+
+    _set_entry(v, v->last, val, 0, excpt, ctx);
+}
+
+void hlt_vector_push_back_many(hlt_vector* v, const hlt_type_info* elemtype, void* vals,
+                               hlt_vector_idx n, hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    assert(v);
+    assert(__hlt_type_equal(v->type, elemtype));
+
+    if ( n <= 0 )
+        return;
+
+    _make_room(v, v->last + n, excpt, ctx);
+
+    if ( v->type->atomic && ! (v->tmgr && v->timeout) ) {
+        // Fast path: nothing to track per element beyond occupancy.
+        memcpy(_elem(v, v->last + 1), vals, n * v->type->size);
+
+        for ( hlt_vector_idx i = v->last + 1; i <= v->last + n; i++ )
+            _set_occupied(v, i);
+
+        v->last += n;
+        return;
     }
 
-    assert(v->last < v->capacity);
+    for ( hlt_vector_idx j = 0; j < n; j++ ) {
+        ++v->last;
+        _set_entry(v, v->last, (char*)vals + j * v->type->size, 0, excpt, ctx);
+    }
+}
 
-    if ( v->tmgr ) {
-        assert(v->timers);
-        v->timers[v->last] = 0;
+void hlt_vector_append(hlt_vector* v, hlt_vector* other, hlt_exception** excpt,
+                       hlt_execution_context* ctx)
+{
+    if ( ! other ) {
+        hlt_set_exception(excpt, &hlt_exception_null_reference, 0, ctx);
+        return;
     }
 
-    _set_entry(v, v->last, val, 0, excpt, ctx);
+    // Take a snapshot of the size in case we're appending a vector to itself.
+    hlt_vector_idx n = other->last + 1;
+
+    if ( n == 0 )
+        return;
+
+    // Grow first so that other's elements don't move underneath us if it's
+    // the same vector.
+    _make_room(v, v->last + n, excpt, ctx);
+    hlt_vector_push_back_many(v, other->type, other->elems, n, excpt, ctx);
 }
 
 hlt_vector_idx hlt_vector_size(hlt_vector* v, hlt_exception** excpt, hlt_execution_context* ctx)
@@ -322,21 +431,28 @@ hlt_vector_idx hlt_vector_size(hlt_vector* v, hlt_exception** excpt, hlt_executi
     return v->last + 1;
 }
 
-void hlt_vector_expire(__hlt_vector_timer_cookie cookie, hlt_exception** excpt,
+void hlt_vector_expire(__hlt_vector_timer_cookie v, hlt_exception** excpt,
                        hlt_execution_context* ctx)
 {
-    hlt_vector* v = cookie.vec;
-    hlt_vector_idx i = cookie.idx;
+    hlt_time now = __hlt_expire_list_now(&v->expire, v->tmgr, excpt, ctx);
+
+    // The timer manager deletes the timer once we return.
+    v->expire.timer = 0;
 
-    if ( v->tmgr )
-        v->timers[i] = 0;
+    __hlt_expire_node* n;
 
-    v->occupied[i] = 0;
+    while ( (n = __hlt_expire_list_expired(&v->expire, now)) ) {
+        hlt_vector_idx i = n - v->expire_nodes;
+        __hlt_expire_list_unlink(&v->expire, n);
 
-    char* dst = (char*)v->elems + i * v->type->size;
-    GC_DTOR_GENERIC(dst, v->type, ctx);
+        _clear_occupied(v, i);
 
-    hlt_clone_deep(dst, v->type, v->def, excpt, ctx);
+        char* dst = _elem(v, i);
+        GC_DTOR_GENERIC(dst, v->type, ctx);
+        hlt_clone_deep(dst, v->type, v->def, excpt, ctx);
+    }
+
+    _schedule_vector(v, excpt, ctx);
 }
 
 void hlt_vector_reserve(hlt_vector* v, hlt_vector_idx n, hlt_exception** excpt,
@@ -346,13 +462,11 @@ void hlt_vector_reserve(hlt_vector* v, hlt_vector_idx n, hlt_exception** excpt,
         return;
 
     v->elems = hlt_realloc(v->elems, v->type->size * n, v->type->size * v->capacity);
-    v->occupied = hlt_realloc(v->occupied, n, v->capacity);
+    v->occupied = hlt_realloc(v->occupied, _occupied_words(n) * sizeof(uint64_t),
+                              _occupied_words(v->capacity) * sizeof(uint64_t));
 
-    if ( v->timers ) {
-        v->timers =
-            hlt_realloc(v->timers, sizeof(hlt_timer*) * n, sizeof(hlt_timer*) * v->capacity);
-        assert(v->timers);
-    }
+    if ( v->expire_nodes )
+        _resize_expire_nodes(v, n);
 
     v->capacity = n;
 }
@@ -403,8 +517,7 @@ void* hlt_iterator_vector_deref(hlt_iterator_vector i, hlt_exception** excpt,
     }
 
     _access_entry(i.vec, i.idx, excpt, ctx);
-    char* elem = (char*)i.vec->elems + i.idx * i.vec->type->size;
-    return elem;
+    return _elem(i.vec, i.idx);
 }
 
 int8_t hlt_iterator_vector_eq(hlt_iterator_vector i1, hlt_iterator_vector i2, hlt_exception** excpt,
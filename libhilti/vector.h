@@ -17,8 +17,9 @@ struct __hlt_iterator_vector {
 
 struct __hlt_timer_mgr;
 
-/// Cookie for entry expiration timers.
-typedef struct __hlt_iterator_vector __hlt_vector_timer_cookie;
+/// Cookie for a vector's expiration timer. Each vector has at most one timer
+/// scheduled at any time, covering the element expiring next.
+typedef hlt_vector* __hlt_vector_timer_cookie;
 
 // Creates a new vector. *def* is an element which used as the default for
 // all not-initialized elements.
@@ -46,6 +47,18 @@ extern int8_t hlt_vector_exists(hlt_vector* m, hlt_vector_idx i, hlt_exception**
 extern void hlt_vector_push_back(hlt_vector* v, const hlt_type_info* elemtype, void* val,
                                  hlt_exception** excpt, hlt_execution_context* ctx);
 
+// Appends n elements stored consecutively at vals to the vector. This is
+// equivalent to calling hlt_vector_push_back() for each of them, but grows
+// the vector only once and copies atomic elements in bulk.
+extern void hlt_vector_push_back_many(hlt_vector* v, const hlt_type_info* elemtype, void* vals,
+                                      hlt_vector_idx n, hlt_exception** excpt,
+                                      hlt_execution_context* ctx);
+
+// Appends all elements of another vector of the same type to the vector.
+// other may be the vector itself.
+extern void hlt_vector_append(hlt_vector* v, hlt_vector* other, hlt_exception** excpt,
+                              hlt_execution_context* ctx);
+
 // Returns the size of the vector (i.e., the largest valid index + 1 )
 extern hlt_vector_idx hlt_vector_size(hlt_vector* v, hlt_exception** excpt,
                                       hlt_execution_context* ctx);
@@ -86,9 +99,10 @@ extern const hlt_type_info* hlt_vector_element_type(const hlt_type_info* type,
                                                     hlt_exception** excpt,
                                                     hlt_execution_context* ctx);
 
-/// Called by an expiring timer to remove an element from the vector.
+/// Called by the vector's expiration timer to reset all elements that have
+/// expired to the default, and to reschedule the timer for the next one.
 ///
-/// cookie: The cookie identifying the element to be removed.
+/// cookie: The cookie identifying the vector.
 extern void hlt_vector_expire(__hlt_vector_timer_cookie cookie, hlt_exception** excpt,
                               hlt_execution_context* ctx);
 
@@ -1,11 +1,47 @@
 
 #ifndef LIBSPICY_BASE64_H
+#define LIBSPICY_BASE64_H
 
 #include "libspicy.h"
 
+#include "3rdparty/libb64/include/b64/cdecode.h"
+
 extern hlt_bytes* spicy_base64_encode(hlt_bytes* b, hlt_exception** excpt,
                                       hlt_execution_context* ctx);
 extern hlt_bytes* spicy_base64_decode(hlt_bytes* b, hlt_exception** excpt,
                                       hlt_execution_context* ctx);
 
+/// Returns the size of the output buffer that __spicy_base64_decode_block()
+/// needs for decoding a given number of input bytes. That's a bit more than
+/// the decoded data itself because the vectorized code writes full
+/// registers.
+#define __spicy_base64_decode_buffer_size(len) (3 * ((len) / 4) + 32)
+
+/// Decodes a block of base64 data. This is a drop-in replacement for
+/// libb64's base64_decode_block() with the same semantics, including
+/// skipping any characters outside of the base64 alphabet and carrying
+/// partial groups over to the next call through *state*. Where the CPU
+/// supports it, runs of valid characters are decoded with SSSE3 or AVX2
+/// instructions.
+///
+/// in: The input to decode.
+/// len: The number of bytes at *in*.
+/// out: Buffer to write the decoded data into; must be at least
+/// __spicy_base64_decode_buffer_size(len) bytes large.
+/// state: The libb64 decoding state, updated for the next call.
+///
+/// Returns: The number of bytes written to *out*.
+extern int __spicy_base64_decode_block(const int8_t* in, int len, int8_t* out,
+                                       base64_decodestate* state);
+
+/// Selects the implementation that __spicy_base64_decode_block() uses.
+/// Normally, it picks the fastest one the CPU supports by itself. This is
+/// for testing and benchmarking.
+///
+/// level: 0 for the scalar code, 1 for SSSE3, and 2 for AVX2. Levels that
+/// the CPU doesn't support are lowered to the best one it does.
+///
+/// Returns: The level now in use.
+extern int __spicy_base64_set_kernel(int level);
+
 #endif
@@ -16,19 +16,19 @@ static struct __spicy_filter_definition filters[] = {
      "BASE64",
      __spicy_filter_base64_allocate,
      __spicy_filter_base64_dtor,
-     __spicy_filter_base64_decode,
+     __spicy_filter_base64_push,
      __spicy_filter_base64_close},
     {{0, 2},
      "GZIP",
-     __spicy_filter_zlib_allocate,
+     __spicy_filter_gzip_allocate,
      __spicy_filter_zlib_dtor,
-     __spicy_filter_zlib_decode,
+     __spicy_filter_zlib_push,
      __spicy_filter_zlib_close},
     {{0, 3},
      "ZLIB",
      __spicy_filter_zlib_allocate,
      __spicy_filter_zlib_dtor,
-     __spicy_filter_zlib_decode,
+     __spicy_filter_zlib_push,
      __spicy_filter_zlib_close},
     {{0, 0}, 0, 0, 0, 0},
 };
@@ -90,6 +90,10 @@ void spicyhilti_filter_close(spicy_filter* head, hlt_exception** excpt, hlt_exec
         (*f->def->close)(f, excpt, ctx);
         (*f->def->dtor)(0, f, ctx);
 
+        hlt_free(f->buffer);
+        f->buffer = 0;
+        f->buffer_size = 0;
+
         if ( f != head )
             // The reference to the first filter is owned by the struct.
             GC_CLEAR(f, spicy_filter, ctx);
@@ -103,26 +107,82 @@ extern void spicy_dbg_deliver(spicy_sink* sink, hlt_bytes* data, spicy_filter* f
 hlt_bytes* spicyhilti_filter_decode(spicy_filter* head, hlt_bytes* data, hlt_exception** excpt,
                                     hlt_execution_context* ctx) // &ref(!)
 {
-    spicy_filter* filter = head;
-
     if ( ! head )
         return data;
 
-    while ( head ) {
-        hlt_bytes* new_data = (*head->def->decode)(head, data, excpt, ctx);
+    // We push the input into the first filter block by block. Each filter
+    // passes its output on to the next one right away through
+    // __spicy_filter_emit(), and only the last one appends to the result.
+    hlt_bytes* decoded = hlt_bytes_new(excpt, ctx);
+
+    void* cookie = 0;
+    hlt_bytes_block block;
+    hlt_iterator_bytes begin = hlt_bytes_begin(data, excpt, ctx);
+    hlt_iterator_bytes end = hlt_bytes_end(data, excpt, ctx);
+
+    do {
+        cookie = hlt_bytes_iterate_raw(&block, cookie, begin, end, excpt, ctx);
+
+        uint64_t len = block.end - block.start;
+
+        if ( ! len )
+            continue;
 
-        if ( hlt_bytes_is_frozen(data, excpt, ctx) )
-            // No more data going to come.
-            hlt_bytes_freeze(new_data, 1, excpt, ctx);
+        (*head->def->push)(head, block.start, len, decoded, excpt, ctx);
 
-        if ( *excpt )
+        if ( *excpt ) {
+            GC_DTOR(decoded, hlt_bytes, ctx);
             return 0;
+        }
 
-        spicy_dbg_deliver(0, new_data, filter, excpt, ctx);
+    } while ( cookie );
 
-        data = new_data;
-        head = head->next;
+    if ( hlt_bytes_is_frozen(data, excpt, ctx) )
+        // No more data going to come.
+        hlt_bytes_freeze(decoded, 1, excpt, ctx);
+
+    spicy_dbg_deliver(0, decoded, head, excpt, ctx);
+
+    return decoded;
+}
+
+int8_t* __spicy_filter_buffer(spicy_filter* filter, uint64_t len)
+{
+    if ( ! filter->next )
+        return hlt_malloc_no_init(len);
+
+    if ( len > filter->buffer_size ) {
+        hlt_free(filter->buffer);
+        filter->buffer = hlt_malloc_no_init(len);
+        filter->buffer_size = len;
+    }
+
+    return filter->buffer;
+}
+
+void __spicy_filter_emit(spicy_filter* filter, int8_t* data, uint64_t len, hlt_bytes* out,
+                         hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    if ( filter->next ) {
+        // The scratch buffer remains with the filter.
+        if ( len )
+            (*filter->next->def->push)(filter->next, data, len, out, excpt, ctx);
+
+        return;
+    }
+
+    if ( ! len ) {
+        hlt_free(data);
+        return;
     }
 
-    return data;
+    // Give back what we didn't need.
+    data = hlt_realloc_no_init(data, len);
+    hlt_bytes_append_raw(out, data, len, excpt, ctx);
+}
+
+void __spicy_filter_discard(spicy_filter* filter, int8_t* data)
+{
+    if ( data != filter->buffer )
+        hlt_free(data);
 }
@@ -17,8 +17,10 @@ typedef struct spicy_filter* (*__spicy_filter_allocate)(hlt_exception** excpt,
                                                         hlt_execution_context* ctx);
 typedef void (*__spicy_filter_dtor)(hlt_type_info* ti, struct spicy_filter*,
                                     hlt_execution_context* ctx);
-typedef hlt_bytes* (*__spicy_filter_decode)(struct spicy_filter*, hlt_bytes* data,
-                                            hlt_exception** excpt, hlt_execution_context* ctx);
+// Decodes a block of input, passing all output on through __spicy_filter_emit().
+typedef void (*__spicy_filter_push)(struct spicy_filter*, const int8_t* data, uint64_t len,
+                                   hlt_bytes* out, hlt_exception** excpt,
+                                   hlt_execution_context* ctx);
 typedef void (*__spicy_filter_close)(struct spicy_filter*, hlt_exception** excpt,
                                      hlt_execution_context* ctx);
 
@@ -28,7 +30,7 @@ struct __spicy_filter_definition {
     const char* name;
     __spicy_filter_allocate allocate;
     __spicy_filter_dtor dtor;
-    __spicy_filter_decode decode;
+    __spicy_filter_push push;
     __spicy_filter_close close;
 };
 
@@ -42,6 +44,8 @@ struct spicy_filter {
     __hlt_gchdr __gch;              /// Header for garbage collection.
     __spicy_filter_definition* def; /// Type object describing the filter type.
     struct spicy_filter* next;      /// Link to next filter in chain.
+    int8_t* buffer;                 /// Scratch space for output passed on to the next filter.
+    uint64_t buffer_size;           /// Size of buffer.
 };
 
 typedef struct spicy_filter spicy_filter;
@@ -89,7 +93,9 @@ extern void spicyhilti_filter_close(spicy_filter* head, hlt_exception** excpt,
                                     hlt_execution_context* ctx);
 
 /// Pipes data into a filter chain. If further filters have been chained to
-/// this one, the data is passed through all of them.
+/// this one, the data is passed through all of them. The filters stream
+/// blocks of at most __SPICY_FILTER_BLOCK_SIZE bytes to each other, so only
+/// the final output gets materialized as a whole.
 ///
 /// chain: The chain to pass the data into.
 /// data: The data to be passed in.
@@ -111,4 +117,42 @@ extern hlt_bytes* spicyhilti_filter_decode(spicy_filter* head, hlt_bytes* data,
                                            hlt_exception** excpt,
                                            hlt_execution_context* ctx); // ref!
 
+/// Maximum size of the blocks that filters pass on to the next one in their
+/// chain. This bounds the memory that a chain needs for intermediary data,
+/// independent of the size of the input.
+#define __SPICY_FILTER_BLOCK_SIZE (64 * 1024)
+
+/// Returns memory for a filter to decode a block of output into, which it
+/// then passes on through __spicy_filter_emit(). If the filter is the last
+/// one in its chain, that's fresh memory that the final output will take
+/// over. Otherwise, it's the filter's scratch buffer, which gets reused for
+/// the next block. For internal use by filters.
+///
+/// filter: The filter producing the output.
+/// len: The number of bytes needed.
+extern int8_t* __spicy_filter_buffer(spicy_filter* filter, uint64_t len);
+
+/// Passes a block of output on to the next filter in the chain, or appends
+/// it to the final output if there's no further filter. For internal use by
+/// filters.
+///
+/// filter: The filter producing the output.
+/// data: The output, which must have been returned by __spicy_filter_buffer().
+/// The function takes ownership.
+/// len: The number of valid bytes at *data*, which may be less than
+/// requested from __spicy_filter_buffer().
+/// out: The final output of the chain, as passed to the filter's push function.
+/// excpt: &
+/// ctx: &
+extern void __spicy_filter_emit(spicy_filter* filter, int8_t* data, uint64_t len,
+                                hlt_bytes* out, hlt_exception** excpt,
+                                hlt_execution_context* ctx);
+
+/// Releases memory returned by __spicy_filter_buffer() without passing it
+/// on.
+///
+/// filter: The filter that requested the memory.
+/// data: The memory.
+extern void __spicy_filter_discard(spicy_filter* filter, int8_t* data);
+
 #endif
@@ -1,8 +1,7 @@
 
+#include "base64.h"
 #include "filter.h"
 
-#include "3rdparty/libb64/include/b64/cdecode.h"
-
 typedef struct {
     spicy_filter base;
     base64_decodestate state;
@@ -31,45 +30,27 @@ void __spicy_filter_base64_close(spicy_filter* filter, hlt_exception** excpt,
     // anyway.
 }
 
-hlt_bytes* __spicy_filter_base64_decode(spicy_filter* filter_gen, hlt_bytes* data,
-                                        hlt_exception** excpt, hlt_execution_context* ctx)
+void __spicy_filter_base64_push(spicy_filter* filter_gen, const int8_t* data, uint64_t len,
+                                hlt_bytes* out, hlt_exception** excpt, hlt_execution_context* ctx)
 {
     __spicy_filter_base64* filter = (__spicy_filter_base64*)filter_gen;
 
-    void* cookie = 0;
-    hlt_bytes_block block;
-    hlt_iterator_bytes begin = hlt_bytes_begin(data, excpt, ctx);
-    hlt_iterator_bytes end = hlt_bytes_end(data, excpt, ctx);
-
-    hlt_bytes* decoded = 0;
-
-    do {
-        cookie = hlt_bytes_iterate_raw(&block, cookie, begin, end, excpt, ctx);
-
-        int len = block.end - block.start;
-
-        if ( ! len )
-            continue;
-
-        // We will allocate a bit more than we'll need here.
-        int8_t* buffer = hlt_malloc(len);
+    // If we pass the output on to another filter, we decode in slices that
+    // fit into the chain's block size.
+    uint64_t slice = (filter_gen->next ? (__SPICY_FILTER_BLOCK_SIZE / 3) * 4 : len);
 
-        int n = base64_decode_block((const char*)block.start, len, (char*)buffer, &filter->state);
+    while ( len ) {
+        uint64_t n = (len < slice ? len : slice);
 
-        if ( n > 0 ) {
-            if ( ! decoded ) {
-                decoded = hlt_bytes_new_from_data(buffer, n, excpt, ctx);
-                buffer = 0;
-            }
-            else
-                hlt_bytes_append_raw(decoded, buffer, n, excpt, ctx);
-            buffer = 0;
-        }
+        int8_t* buffer = __spicy_filter_buffer(filter_gen, __spicy_base64_decode_buffer_size(n));
+        int decoded = __spicy_base64_decode_block(data, n, buffer, &filter->state);
 
-        if ( buffer )
-            hlt_free(buffer);
+        __spicy_filter_emit(filter_gen, buffer, decoded, out, excpt, ctx);
 
-    } while ( cookie );
+        if ( *excpt )
+            return;
 
-    return decoded ? decoded : hlt_bytes_new_from_data(0, 0, excpt, ctx);
+        data += n;
+        len -= n;
+    }
 }
@@ -1,15 +1,35 @@
 
 // This handles both gzip and zlib/deflate decompresssion.
-
+//
+// We inflate directly into memory chunks that the resulting bytes object
+// then takes ownership of, so that the output doesn't get copied. Inside a
+// chain, we inflate into the filter's scratch buffer instead and pass each
+// chunk on right away. The total amount of data a filter decompresses is
+// bounded by the runtime's max_inflated_size setting to protect against
+// decompression bombs.
+
+#include <string.h>
 #include <zlib.h>
 
 #include "filter.h"
 
+// Bounds for the size of the chunks we inflate into. We start with a guess
+// based on the size of the input and then double with each further chunk.
+#define __SPICY_ZLIB_MIN_CHUNK 4096
+#define __SPICY_ZLIB_MAX_CHUNK (256 * 1024)
+
 typedef struct {
     spicy_filter base;
     z_stream* zip;
+    uint64_t inflated;   // Number of bytes decompressed so far.
+    int8_t gzip;         // True if input may consist of several gzip members.
+    int8_t member_done;  // True if the last gzip member has been completed.
+    int8_t magic_held;   // True if input after a member ended with the magic's first byte.
 } __spicy_filter_zlib;
 
+// The magic starting each gzip member.
+static const Bytef __spicy_gzip_magic[2] = {0x1f, 0x8b};
+
 void __spicy_filter_zlib_close(spicy_filter* filter_gen, hlt_exception** excpt,
                                hlt_execution_context* ctx_)
 {
@@ -23,7 +43,8 @@ void __spicy_filter_zlib_close(spicy_filter* filter_gen, hlt_exception** excpt,
     filter->zip = 0;
 }
 
-spicy_filter* __spicy_filter_zlib_allocate(hlt_exception** excpt, hlt_execution_context* ctx)
+static spicy_filter* __spicy_filter_zlib_init(int8_t gzip, hlt_exception** excpt,
+                                              hlt_execution_context* ctx)
 {
     __spicy_filter_zlib* filter =
         GC_NEW_CUSTOM_SIZE(spicy_filter, sizeof(__spicy_filter_zlib), ctx);
@@ -35,6 +56,10 @@ spicy_filter* __spicy_filter_zlib_allocate(hlt_exception** excpt, hlt_execution_
     filter->zip->avail_out = 0;
     filter->zip->next_in = 0;
     filter->zip->avail_in = 0;
+    filter->inflated = 0;
+    filter->gzip = gzip;
+    filter->member_done = 0;
+    filter->magic_held = 0;
 
     // "15" here means maximum compression.  "32" is a gross overload hack
     // that means "check it for whether it's a gzip file". Sheesh.
@@ -50,73 +75,178 @@ spicy_filter* __spicy_filter_zlib_allocate(hlt_exception** excpt, hlt_execution_
     return (spicy_filter*)filter;
 }
 
+spicy_filter* __spicy_filter_zlib_allocate(hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    return __spicy_filter_zlib_init(0, excpt, ctx);
+}
+
+spicy_filter* __spicy_filter_gzip_allocate(hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    return __spicy_filter_zlib_init(1, excpt, ctx);
+}
+
 void __spicy_filter_zlib_dtor(hlt_type_info* ti, spicy_filter* filter, hlt_execution_context* ctx)
 {
     __spicy_filter_zlib_close(filter, 0, 0);
 }
 
-hlt_bytes* __spicy_filter_zlib_decode(spicy_filter* filter_gen, hlt_bytes* data,
+static void __spicy_filter_zlib_error(__spicy_filter_zlib* filter, const char* msg,
                                       hlt_exception** excpt, hlt_execution_context* ctx)
 {
-    __spicy_filter_zlib* filter = (__spicy_filter_zlib*)filter_gen;
+    __spicy_filter_zlib_close((spicy_filter*)filter, excpt, ctx);
+    hlt_string fname = hlt_string_from_asciiz(msg, excpt, ctx);
+    hlt_set_exception(excpt, &spicy_exception_filtererror, fname, ctx);
+}
+
+// Resets the stream for decompressing another gzip member. If the magic's
+// first byte came with the previous input, passes that on first.
+static int __spicy_filter_zlib_reset(__spicy_filter_zlib* filter)
+{
+    if ( inflateReset(filter->zip) != Z_OK )
+        return 0;
 
-    if ( ! filter->zip ) {
-        // hlt_string fname = hlt_string_from_asciiz("more inflate data after close", excpt, ctx);
-        // hlt_set_exception(excpt, &spicy_exception_filtererror, fname, ctx);
+    if ( ! filter->magic_held )
+        return 1;
 
-        // TODO: This can happen at least with our HTTP parser right now?
-        return hlt_bytes_new(excpt, ctx);
+    Bytef* next_in = filter->zip->next_in;
+    uInt avail_in = filter->zip->avail_in;
+    Bytef dummy;
+
+    // This just advances the header parsing, there's no output yet.
+    filter->zip->next_in = (Bytef*)__spicy_gzip_magic;
+    filter->zip->avail_in = 1;
+    filter->zip->next_out = &dummy;
+    filter->zip->avail_out = sizeof(dummy);
+
+    int zip_status = inflate(filter->zip, Z_SYNC_FLUSH);
+
+    filter->zip->next_in = next_in;
+    filter->zip->avail_in = avail_in;
+    filter->magic_held = 0;
+
+    return zip_status == Z_OK && filter->zip->avail_out == sizeof(dummy);
+}
+
+// Called once a gzip member has been completed and further input is
+// available. Per RFC 1952, a gzip file may consist of several members
+// concatenated; if the input continues with the magic starting another one,
+// we reset the stream to decompress that one as well. Anything else is
+// trailing garbage that we ignore, as we always did.
+static void __spicy_filter_zlib_next_member(__spicy_filter_zlib* filter, hlt_exception** excpt,
+                                            hlt_execution_context* ctx)
+{
+    const Bytef* in = filter->zip->next_in;
+    uInt avail = filter->zip->avail_in;
+
+    if ( filter->gzip ) {
+        int member = 0;
+
+        if ( filter->magic_held )
+            member = (in[0] == __spicy_gzip_magic[1]);
+
+        else if ( avail == 1 && in[0] == __spicy_gzip_magic[0] ) {
+            // Can't tell yet; hold on to the byte until more input arrives.
+            filter->magic_held = 1;
+            filter->zip->next_in++;
+            filter->zip->avail_in = 0;
+            return;
+        }
+
+        else
+            member = (avail >= 2 && memcmp(in, __spicy_gzip_magic, 2) == 0);
+
+        if ( member && __spicy_filter_zlib_reset(filter) ) {
+            filter->member_done = 0;
+            return;
+        }
     }
 
-    void* cookie = 0;
-    hlt_bytes_block block;
-    hlt_iterator_bytes begin = hlt_bytes_begin(data, excpt, ctx);
-    hlt_iterator_bytes end = hlt_bytes_end(data, excpt, ctx);
+    filter->member_done = 0;
+    __spicy_filter_zlib_close((spicy_filter*)filter, excpt, ctx);
+}
+
+void __spicy_filter_zlib_push(spicy_filter* filter_gen, const int8_t* data, uint64_t len,
+                              hlt_bytes* out, hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    __spicy_filter_zlib* filter = (__spicy_filter_zlib*)filter_gen;
+
+    if ( ! filter->zip )
+        // TODO: This can happen at least with our HTTP parser right now?
+        return;
+
+    uint64_t limit = hlt_config_get()->max_inflated_size;
+
+    // Chunks passed on to another filter are bounded by the chain's block size.
+    uint64_t max_chunk = (filter_gen->next ? __SPICY_FILTER_BLOCK_SIZE : __SPICY_ZLIB_MAX_CHUNK);
 
-    hlt_bytes* decoded = 0;
+    // Deflate rarely achieves less than 1:4 on the data we see.
+    uint64_t chunk_size = 4 * len;
 
-    do {
-        cookie = hlt_bytes_iterate_raw(&block, cookie, begin, end, excpt, ctx);
+    if ( chunk_size < __SPICY_ZLIB_MIN_CHUNK )
+        chunk_size = __SPICY_ZLIB_MIN_CHUNK;
 
-        int len = block.end - block.start;
+    filter->zip->next_in = (Bytef*)data;
+    filter->zip->avail_in = len;
 
-        if ( ! len )
+    while ( filter->zip ) {
+        if ( filter->member_done ) {
+            if ( ! filter->zip->avail_in )
+                break;
+
+            __spicy_filter_zlib_next_member(filter, excpt, ctx);
             continue;
+        }
 
-        filter->zip->next_in = (Bytef*)block.start;
-        filter->zip->avail_in = len;
+        if ( chunk_size > max_chunk )
+            chunk_size = max_chunk;
 
-        do {
-            Bytef buf[4096];
-            filter->zip->next_out = buf;
-            filter->zip->avail_out = sizeof(buf);
+        // No need to allocate more than we're still allowed to produce. One
+        // more byte tells us that we've exceeded the limit.
+        if ( limit && chunk_size > limit - filter->inflated + 1 )
+            chunk_size = limit - filter->inflated + 1;
 
-            int zip_status = inflate(filter->zip, Z_SYNC_FLUSH);
+        int8_t* chunk = __spicy_filter_buffer(filter_gen, chunk_size);
+        filter->zip->next_out = (Bytef*)chunk;
+        filter->zip->avail_out = chunk_size;
 
-            if ( zip_status != Z_STREAM_END && zip_status != Z_OK && zip_status != Z_BUF_ERROR ) {
-                __spicy_filter_zlib_close((spicy_filter*)filter, excpt, ctx);
-                hlt_string fname = hlt_string_from_asciiz("inflate failed", excpt, ctx);
-                hlt_set_exception(excpt, &spicy_exception_filtererror, fname, ctx);
-                return 0;
-            }
+        int zip_status = inflate(filter->zip, Z_SYNC_FLUSH);
 
-            int have = sizeof(buf) - filter->zip->avail_out;
+        if ( zip_status != Z_STREAM_END && zip_status != Z_OK && zip_status != Z_BUF_ERROR ) {
+            __spicy_filter_discard(filter_gen, chunk);
+            __spicy_filter_zlib_error(filter, "inflate failed", excpt, ctx);
+            return;
+        }
 
-            if ( have ) {
-                if ( ! decoded )
-                    decoded = hlt_bytes_new_from_data_copy((int8_t*)buf, have, excpt, ctx);
-                else
-                    hlt_bytes_append_raw_copy(decoded, (int8_t*)buf, have, excpt, ctx);
-            }
+        uint64_t have = chunk_size - filter->zip->avail_out;
+        int full = (filter->zip->avail_out == 0);
+
+        filter->inflated += have;
 
-            if ( zip_status == Z_STREAM_END ) {
+        if ( limit && filter->inflated > limit ) {
+            __spicy_filter_discard(filter_gen, chunk);
+            __spicy_filter_zlib_error(filter, "decompressed data exceeds limit", excpt, ctx);
+            return;
+        }
+
+        __spicy_filter_emit(filter_gen, chunk, have, out, excpt, ctx);
+
+        if ( *excpt )
+            return;
+
+        if ( zip_status == Z_STREAM_END ) {
+            if ( ! filter->gzip ) {
                 __spicy_filter_zlib_close((spicy_filter*)filter, excpt, ctx);
                 break;
             }
 
-        } while ( filter->zip->avail_out == 0 );
+            filter->member_done = 1;
+            continue;
+        }
 
-    } while ( cookie );
+        if ( ! full )
+            // Input exhausted, and no further output pending.
+            break;
 
-    return decoded ? decoded : hlt_bytes_new(excpt, ctx);
+        chunk_size *= 2;
+    }
 }
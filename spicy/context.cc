@@ -355,6 +355,20 @@ bool spicy::CompilerContext::finalize(shared_ptr<Module> node, bool verify)
 std::unique_ptr<llvm::Module> spicy::CompilerContext::compile(
     shared_ptr<Module> module, shared_ptr<hilti::Module>* hilti_module_out, bool hilti_only)
 {
+    // We can use the cache only if the caller doesn't need the intermediary
+    // HILTI module.
+    auto key = _hilti_context->cacheKey("spicy", module->id()->name());
+    bool use_cache = (_hilti_context->fileCache() && ! hilti_module_out && ! hilti_only);
+
+    if ( use_cache ) {
+        toCacheKey(module, &key);
+
+        auto cached = _hilti_context->checkCache(key);
+
+        if ( cached.size() == 1 )
+            return std::move(cached.front());
+    }
+
     CodeGen codegen(this);
 
     _beginPass(module, "CodeGen");
@@ -377,12 +391,37 @@ std::unique_ptr<llvm::Module> spicy::CompilerContext::compile(
     if ( ! llvm_module )
         return nullptr;
 
+    if ( use_cache )
+        _hilti_context->updateCache(key, llvm_module.get());
+
     return llvm_module;
 }
 
 std::unique_ptr<llvm::Module> spicy::CompilerContext::compile(
     const string& path, shared_ptr<hilti::Module>* hilti_module_out)
 {
+    auto full_path = _findModule(path);
+    auto key = _hilti_context->cacheKey("spicy", util::basename(full_path));
+    bool use_cache = (_hilti_context->fileCache() && full_path.size() && ! hilti_module_out);
+
+    if ( use_cache ) {
+        // Determine the key without parsing so that a cache hit skips
+        // everything but loading the bitcode.
+        std::set<string> deps;
+        _dependencies(_importsOf(full_path), &deps);
+        deps.erase(full_path);
+
+        _addFileToCacheKey(full_path, &key);
+
+        for ( auto d : deps )
+            _addFileToCacheKey(d, &key);
+
+        auto cached = _hilti_context->checkCache(key);
+
+        if ( cached.size() == 1 )
+            return std::move(cached.front());
+    }
+
     auto module = load(path);
 
     if ( ! module )
@@ -394,6 +433,9 @@ std::unique_ptr<llvm::Module> spicy::CompilerContext::compile(
 
     auto compiled = codegen.compile(module);
 
+    if ( ! compiled )
+        return nullptr;
+
     if ( hilti_module_out )
         *hilti_module_out = compiled;
 
@@ -404,6 +446,9 @@ std::unique_ptr<llvm::Module> spicy::CompilerContext::compile(
     if ( ! llvm_module )
         return nullptr;
 
+    if ( use_cache )
+        _hilti_context->updateCache(key, llvm_module.get());
+
     return llvm_module;
 }
 
@@ -431,11 +476,39 @@ shared_ptr<hilti::Type> spicy::CompilerContext::hiltiType(shared_ptr<spicy::Type
     return tb.hiltiType(type, deps);
 }
 
+// Returns the IDs that a Spicy source file imports, determined by scanning
+// for import statements without parsing the file.
+static std::list<string> _importsOf(const string& path)
+{
+    std::list<string> imports;
+    std::ifstream in(path);
+    string line;
+
+    while ( std::getline(in, line) ) {
+        line = util::strtrim(line);
+
+        if ( ! util::startsWith(line, "import ") || ! util::endsWith(line, ";") )
+            continue;
+
+        imports.push_back(util::strtrim(line.substr(7, line.size() - 8)));
+    }
+
+    return imports;
+}
+
+static void _addFileToCacheKey(const string& path, ::util::cache::FileCache::Key* key)
+{
+    key->files.insert(path);
+
+    std::ifstream in(path);
+    key->hashes.insert(::util::cache::hash(in));
+}
+
 void spicy::CompilerContext::toCacheKey(shared_ptr<Module> module,
                                         ::util::cache::FileCache::Key* key)
 {
     if ( module->path() != "-" )
-        key->files.insert(module->path());
+        _addFileToCacheKey(module->path(), key);
 
     else {
         std::ostringstream s;
@@ -445,11 +518,54 @@ void spicy::CompilerContext::toCacheKey(shared_ptr<Module> module,
     }
 
     for ( auto d : dependencies(module) )
-        key->files.insert(d);
+        _addFileToCacheKey(d, key);
+}
+
+string spicy::CompilerContext::_findModule(const string& id)
+{
+    auto p = util::strtolower(id);
+
+    if ( ! util::endsWith(p, ".spicy") )
+        p += ".spicy";
+
+    auto full_path = util::findInPaths(p, options().libdirs_spicy);
+
+    if ( full_path.empty() )
+        return "";
+
+    char buf[PATH_MAX];
+    if ( ! realpath(full_path.c_str(), buf) )
+        return "";
+
+    return buf;
+}
+
+void spicy::CompilerContext::_dependencies(const std::list<string>& imports,
+                                           std::set<string>* deps)
+{
+    for ( auto i : imports ) {
+        auto path = _findModule(i);
+
+        if ( path.empty() || deps->find(path) != deps->end() )
+            continue;
+
+        deps->insert(path);
+        _dependencies(_importsOf(path), deps);
+    }
 }
 
 std::list<string> spicy::CompilerContext::dependencies(shared_ptr<Module> module)
 {
-    // TODO: Not implementated.
-    return std::list<string>();
+    std::list<string> imports;
+
+    for ( auto i : module->importedIDs() )
+        imports.push_back(i->name());
+
+    std::set<string> deps;
+    _dependencies(imports, &deps);
+
+    if ( module->path() != "-" )
+        deps.erase(module->path());
+
+    return std::list<string>(deps.begin(), deps.end());
 }
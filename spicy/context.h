@@ -102,7 +102,9 @@ public:
 
     /// Compiles an AST into an LLVM module. This is the main interface to
     /// the code generater. The AST must have passed through finalize().
-    /// After compilation, it needs to be linked with linkModules().
+    /// After compilation, it needs to be linked with linkModules(). If
+    /// caching is enabled and neither *hilti_module* nor *hilti_only* is
+    /// given, this method may return a previously cached copy.
     ///
     /// module: The module to compile.
     ///
@@ -221,22 +223,28 @@ public:
     shared_ptr<hilti::CompilerContextJIT<JIT>> hiltiContext() const;
 
     /// Augments the cache key with values suitable to check if a module (or
-    /// any of its dependencies) has changed.
-    ///
-    /// \todo Dependencies aren't tracked yet.
+    /// any of its dependencies) has changed. This adds the content hashes
+    /// of all files involved.
     ///
     /// module: The module to update the key for.
     ///
     /// key: The key to update.
     void toCacheKey(shared_ptr<Module> module, ::util::cache::FileCache::Key* key);
 
-    /// Returns a list of path names that this module depends on.
-    ///
-    /// \todo This is actually not yet implemented and always returns an
-    /// empty list currently.
+    /// Returns a list of path names that this module depends on. This
+    /// follows imports transitively.
     std::list<string> dependencies(shared_ptr<Module> module);
 
 private:
+    /// Searches a module by its ID along the library path, without
+    /// reporting an error if not found. Returns the full path, or an empty
+    /// string if not found.
+    string _findModule(const string& id);
+
+    /// Recursively resolves a list of imported IDs into the paths of all
+    /// modules they depend on, adding them to *deps*.
+    void _dependencies(const std::list<string>& imports, std::set<string>* deps);
+
     shared_ptr<Options> _options;
     shared_ptr<hilti::CompilerContextJIT<JIT>> _hilti_context;
 
@@ -0,0 +1,170 @@
+
+#include "../declaration.h"
+#include "../expression.h"
+#include "../function.h"
+#include "../module.h"
+#include "../type.h"
+
+#include "field-pruner.h"
+
+using namespace spicy;
+using namespace spicy::passes;
+
+FieldPruner::FieldPruner() : Pass<AstInfo>("spicy::FieldPruner", false)
+{
+}
+
+FieldPruner::~FieldPruner()
+{
+}
+
+void FieldPruner::addUses(shared_ptr<Node> ast)
+{
+    processAllPreOrder(ast);
+}
+
+void FieldPruner::addUse(shared_ptr<Type> type)
+{
+    if ( ! type )
+        return;
+
+    if ( auto u = ast::rtti::tryCast<type::Unit>(type) ) {
+        if ( _kept.find(u.get()) != _kept.end() )
+            return;
+
+        _kept.insert(u.get());
+
+        for ( auto i : u->flattenedItems() )
+            addUse(i->fieldType());
+
+        return;
+    }
+
+    if ( auto c = ast::type::tryTrait<type::trait::Container>(type) )
+        addUse(c->elementType());
+
+    if ( auto t = ast::type::tryTrait<type::trait::TypeList>(type) ) {
+        for ( auto e : t->typeList() )
+            addUse(e);
+    }
+}
+
+void FieldPruner::addHook(const string& name)
+{
+    _hooked.insert(name);
+}
+
+bool FieldPruner::run(shared_ptr<ast::NodeBase> module)
+{
+    auto m = ast::rtti::checkedCast<Module>(module);
+
+    // A unit that's stored in a field we keep may be accessed as a whole.
+    // We do this only now that we have seen all the uses.
+    for ( auto u : _units ) {
+        for ( auto i : u->flattenedItems() ) {
+            if ( _used.find(i->id()->name()) != _used.end() )
+                addUse(i->fieldType());
+        }
+    }
+
+    for ( auto u : _units ) {
+        if ( u->firstParent<Module>() != m )
+            continue;
+
+        for ( auto f : u->fields() ) {
+            if ( ! _prunable(u, f) )
+                continue;
+
+            f->setTransient();
+            _pruned.push_back(util::fmt("%s::%s", u->id() ? u->id()->pathAsString() : "<unit>",
+                                        f->id()->name()));
+        }
+    }
+
+    return errors() == 0;
+}
+
+const std::list<string>& FieldPruner::pruned() const
+{
+    return _pruned;
+}
+
+bool FieldPruner::_prunable(type::Unit* u, shared_ptr<type::unit::item::Field> f)
+{
+    if ( _kept.find(u) != _kept.end() )
+        return false;
+
+    // Fields inside switches share storage logic with their switch; leave
+    // them alone.
+    if ( ast::rtti::isA<type::unit::item::field::Switch>(f) )
+        return false;
+
+    if ( f->transient() || f->anonymous() || f->aliased() || ! f->forParsing() )
+        return false;
+
+    if ( ! f->type() || ast::rtti::isA<type::Void>(f->type()) )
+        return false;
+
+    auto name = f->id()->name();
+
+    if ( _used.find(name) != _used.end() )
+        return false;
+
+    if ( _hooked.find(name) != _hooked.end() )
+        return false;
+
+    // Non-foreach hooks get the field's value from the parse object.
+    for ( auto h : f->hooks() ) {
+        if ( ! h->foreach () )
+            return false;
+    }
+
+    return true;
+}
+
+void FieldPruner::visit(declaration::Hook* h)
+{
+    if ( ! h->hook()->foreach () )
+        _hooked.insert(h->id()->local());
+}
+
+void FieldPruner::visit(expression::MemberAttribute* m)
+{
+    _used.insert(m->id()->name());
+}
+
+void FieldPruner::visit(expression::ParserState* s)
+{
+    // If the next operand of the operator we're part of is an attribute,
+    // that's a field access we record separately. Otherwise, the value
+    // may get used as a whole.
+    auto nodes = currentNodes();
+
+    if ( nodes.size() >= 2 ) {
+        auto parent = *std::next(nodes.rbegin());
+        expression_list ops;
+
+        if ( auto o = ast::rtti::tryCast<expression::UnresolvedOperator>(parent) )
+            ops = o->operands();
+
+        else if ( auto o = ast::rtti::tryCast<expression::ResolvedOperator>(parent) )
+            ops = o->operands();
+
+        for ( auto i = ops.begin(); i != ops.end(); i++ ) {
+            if ( i->get() != s )
+                continue;
+
+            if ( ++i != ops.end() && ast::rtti::isA<expression::MemberAttribute>(*i) )
+                return;
+
+            break;
+        }
+    }
+
+    addUse(s->type());
+}
+
+void FieldPruner::visit(type::Unit* u)
+{
+    _units.insert(u);
+}
@@ -0,0 +1,78 @@
+#ifndef SPICY_PASSES_FIELD_PRUNER_H
+#define SPICY_PASSES_FIELD_PRUNER_H
+
+#include <set>
+
+#include <ast/pass.h>
+
+#include "../ast-info.h"
+#include "../common.h"
+
+namespace spicy {
+namespace passes {
+
+/// Marks unit fields as transient that nobody ever reads, so that the
+/// parser no longer stores their values. A host application that knows all
+/// the code accessing a set of modules first feeds all that code into
+/// addUses(), and then calls run() on each module.
+///
+/// The analysis goes by field name: a field is considered used if any
+/// attribute expression anywhere references its name, if it has a hook
+/// that's not a \c foreach hook, or if its unit may be used as a whole,
+/// such as when it's passed to a function. That's conservative, but it
+/// catches the common case of fields that the host never asks for.
+class FieldPruner : public ast::Pass<AstInfo> {
+public:
+    /// Constructor.
+    FieldPruner();
+    virtual ~FieldPruner();
+
+    /// Records all field accesses inside an AST.
+    ///
+    /// ast: The AST to scan.
+    void addUses(shared_ptr<Node> ast);
+
+    /// Records that values of a type may be accessed in their entirety,
+    /// such as when passed to the host application. All fields of units
+    /// that the type contains are then retained.
+    ///
+    /// type: The type.
+    void addUse(shared_ptr<Type> type);
+
+    /// Records that a hook is attached to an item, which then needs its
+    /// value stored.
+    ///
+    /// name: The local name of the item.
+    void addHook(const string& name);
+
+    /// Marks the unused fields of all units defined in a module as
+    /// transient. This must run before the module gets compiled.
+    ///
+    /// module: The module.
+    ///
+    /// Returns: True if no errors were encountered.
+    bool run(shared_ptr<ast::NodeBase> module) override;
+
+    /// Returns the fully-qualified names of all fields that run() has
+    /// marked as transient so far.
+    const std::list<string>& pruned() const;
+
+protected:
+    void visit(declaration::Hook* h) override;
+    void visit(expression::MemberAttribute* m) override;
+    void visit(expression::ParserState* s) override;
+    void visit(type::Unit* u) override;
+
+private:
+    bool _prunable(type::Unit* u, shared_ptr<type::unit::item::Field> f);
+
+    std::set<string> _used;       // Names referenced through attribute expressions.
+    std::set<string> _hooked;     // Names of items with non-foreach hooks.
+    std::set<type::Unit*> _units; // All units seen while collecting uses.
+    std::set<type::Unit*> _kept;  // Units that may be accessed as a whole.
+    std::list<string> _pruned;    // Fields marked transient.
+};
+}
+}
+
+#endif
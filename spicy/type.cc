@@ -1225,6 +1225,17 @@ void unit::Item::addHook(shared_ptr<spicy::Hook> hook)
     addChild(_hooks.back());
 }
 
+void unit::Item::removeHook(shared_ptr<spicy::Hook> hook)
+{
+    for ( auto i = _hooks.begin(); i != _hooks.end(); i++ ) {
+        if ( (*i).get() == hook.get() ) {
+            removeChild(*i);
+            _hooks.erase(i);
+            return;
+        }
+    }
+}
+
 void unit::Item::setType(shared_ptr<spicy::Type> type)
 {
     removeChild(_type);
@@ -1343,6 +1354,12 @@ bool unit::item::Field::transient() const
     return attributes()->has("transient");
 }
 
+void unit::item::Field::setTransient()
+{
+    if ( ! transient() )
+        attributes()->add(std::make_shared<Attribute>("transient"));
+}
+
 /// Returns the item's associated condition, or null if none.
 shared_ptr<Expression> unit::item::Field::condition() const
 {
@@ -1481,6 +1498,7 @@ unit::item::field::Container::Container(shared_ptr<ID> id, shared_ptr<Field> fie
         auto hook_push = std::make_shared<spicy::Hook>(body_push, spicy::Hook::PARSE, 254, false,
                                                        true, parameter_list(), l);
         addHook(hook_push);
+        _push_hook = hook_push;
     }
 
     // If they have an &until/&while, they also get another (even higher
@@ -1527,6 +1545,16 @@ unit::item::field::Container::Container(shared_ptr<ID> id, shared_ptr<Field> fie
     }
 }
 
+void unit::item::field::Container::setTransient()
+{
+    Field::setTransient();
+
+    if ( _push_hook ) {
+        removeHook(_push_hook);
+        _push_hook = nullptr;
+    }
+}
+
 shared_ptr<unit::item::Field> unit::item::field::Container::field() const
 {
     return _field;
@@ -1383,6 +1383,9 @@ protected:
     /// resolve the AST.
     void addHook(shared_ptr<spicy::Hook> hook);
 
+    /// Removes a hook previously added with addHook().
+    void removeHook(shared_ptr<spicy::Hook> hook);
+
 private:
     bool _anonymous = false;
     bool _aliased = false;
@@ -1445,6 +1448,11 @@ public:
     /// object.
     bool transient() const;
 
+    /// Marks the field as transient after the fact, as if it had been
+    /// declared with \a &transient. This must be called before code
+    /// generation.
+    virtual void setTransient();
+
     shared_ptr<spicy::Type> fieldType() override;
 
     /// Create a field for parsing a type. This internally knows which field
@@ -1680,10 +1688,15 @@ public:
     /// Returns the contained field.
     shared_ptr<Field> field() const;
 
+    /// Marks the container as transient. Also removes the hook that
+    /// would otherwise add each element to the container.
+    void setTransient() override;
+
     ACCEPT_VISITOR(Field);
 
 private:
     node_ptr<Field> _field;
+    shared_ptr<spicy::Hook> _push_hook; // The hook adding parsed elements, if any.
 };
 
 namespace container {
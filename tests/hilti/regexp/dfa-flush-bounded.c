@@ -0,0 +1,110 @@
+/*
+
+  Matches a pattern with an exponentially sized DFA against lots of random
+  input, and checks that a budget for DFA states keeps all of the DFA's
+  memory bounded, including the NFA state sets that it keeps for
+  computing states. The input arrives in two chunks, so that flushes
+  happen while a match is in progress.
+
+  @TEST-EXEC:  hilti-build %INPUT -o a.out
+  @TEST-EXEC:  ./a.out 0 >output.unlimited 2>stats.unlimited
+  @TEST-EXEC:  ./a.out 4 >output 2>stats
+  @TEST-EXEC:  cmp output output.unlimited
+  @TEST-EXEC:  grep -q "more than 64 sets: yes" stats.unlimited
+  @TEST-EXEC:  btest-diff output
+  @TEST-EXEC:  btest-diff stats
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libhilti.h>
+
+// Any DFA for this needs to remember the last seven characters.
+static const char* pattern = "(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)";
+
+static uint32_t seed = 42;
+
+static int next_random()
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+static hlt_iterator_bytes chunk(const char* data, int len, int final, hlt_iterator_bytes* end,
+                                hlt_exception** excpt, hlt_execution_context* ctx)
+{
+    hlt_bytes* b = hlt_bytes_new_from_data_copy((const int8_t*)data, len, excpt, ctx);
+
+    if ( final )
+        hlt_bytes_freeze(b, 1, excpt, ctx);
+
+    *end = hlt_bytes_end(b, excpt, ctx);
+    return hlt_bytes_begin(b, excpt, ctx);
+}
+
+int main(int argc, char** argv)
+{
+    hlt_config cfg = *hlt_config_get();
+    cfg.regexp_max_dfa_states = atoi(argv[1]);
+    hlt_config_set(&cfg);
+
+    hlt_init();
+
+    hlt_execution_context* ctx = hlt_global_execution_context();
+    hlt_exception* excpt = 0;
+
+    hlt_regexp* re = hlt_regexp_new(HLT_REGEXP_NOSUB, &excpt, ctx);
+    hlt_regexp_compile(re, hlt_string_from_asciiz(pattern, &excpt, ctx), &excpt, ctx);
+
+    int matches = 0;
+    uint64_t max_sets = 0;
+
+    for ( int i = 0; i < 2000; i++ ) {
+        char data[32];
+        int len = 8 + next_random() % 24;
+
+        for ( int j = 0; j < len; j++ )
+            data[j] = (next_random() % 2) ? 'a' : 'b';
+
+        hlt_match_token_state* ms = hlt_regexp_match_token_init(re, &excpt, ctx);
+
+        hlt_iterator_bytes end;
+        hlt_iterator_bytes begin = chunk(data, len / 2, 0, &end, &excpt, ctx);
+        hlt_regexp_match_token m = hlt_regexp_bytes_match_token_advance(ms, begin, end, &excpt, ctx);
+
+        if ( m.rc < 0 ) {
+            begin = chunk(data + len / 2, len - len / 2, 1, &end, &excpt, ctx);
+            m = hlt_regexp_bytes_match_token_advance(ms, begin, end, &excpt, ctx);
+        }
+
+        if ( m.rc > 0 )
+            ++matches;
+
+        GC_DTOR(ms, hlt_match_token_state, ctx);
+
+        hlt_regexp_dfa_stats stats = hlt_regexp_dfa_stats_get(re, &excpt, ctx);
+
+        if ( stats.sets > max_sets )
+            max_sets = stats.sets;
+    }
+
+    printf("%d matches\n", matches);
+
+    // Each computed state adds at most one set per transition, and the
+    // pattern has two, plus there's the initial state and the one the
+    // pending match is in.
+    fprintf(stderr, "more than 64 sets: %s\n", (max_sets > 64 ? "yes" : "no"));
+
+    if ( cfg.regexp_max_dfa_states )
+        fprintf(stderr, "sets within budget: %s\n",
+                (max_sets <= 2 * cfg.regexp_max_dfa_states + 2 ? "yes" : "no"));
+
+    if ( excpt ) {
+        fprintf(stderr, "unexpected exception\n");
+        return 1;
+    }
+
+    return 0;
+}
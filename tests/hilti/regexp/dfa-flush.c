@@ -0,0 +1,87 @@
+/*
+
+  Matches with a tiny budget for DFA states to force flushing the computed
+  states, and checks that the results don't change.
+
+  @TEST-EXEC:  hilti-build %INPUT -o a.out
+  @TEST-EXEC:  ./a.out 0 >output.unlimited 2>stats.unlimited
+  @TEST-EXEC:  ./a.out 4 >output 2>stats
+  @TEST-EXEC:  cmp output output.unlimited
+  @TEST-EXEC:  btest-diff output
+  @TEST-EXEC:  btest-diff stats
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libhilti.h>
+
+static const char* patterns[] = {"(a|b)*abb[0-9]+x", "GET /[a-z]+(/[a-z]+)* HTTP/1\\.[01]",
+                                 "[0-9]+\\.[0-9]+\\.[0-9]+\\.[0-9]+", 0};
+
+static const char* inputs[] = {"ababbabb12345x",
+                               "bbbbaaaabb0xab",
+                               "xxabb7x",
+                               "GET /index/foo/bar HTTP/1.1",
+                               "GET /index/ HTTP/1.0",
+                               "addr 192.168.1.100 port",
+                               "1.2.3 and 10.20.30.40",
+                               "no match here at all",
+                               0};
+
+int main(int argc, char** argv)
+{
+    hlt_config cfg = *hlt_config_get();
+    cfg.regexp_max_dfa_states = atoi(argv[1]);
+    hlt_config_set(&cfg);
+
+    hlt_init();
+
+    hlt_execution_context* ctx = hlt_global_execution_context();
+    hlt_exception* excpt = 0;
+
+    uint64_t flushes = 0;
+
+    for ( const char** p = patterns; *p; p++ ) {
+        hlt_regexp* re = hlt_regexp_new(0, &excpt, ctx);
+        hlt_regexp_compile(re, hlt_string_from_asciiz(*p, &excpt, ctx), &excpt, ctx);
+
+        // Go through the inputs twice so that states get computed again
+        // after flushing.
+        for ( int round = 0; round < 2; round++ ) {
+            for ( const char** i = inputs; *i; i++ ) {
+                hlt_bytes* b =
+                    hlt_bytes_new_from_data_copy((const int8_t*)*i, strlen(*i), &excpt, ctx);
+                hlt_bytes_freeze(b, 1, &excpt, ctx);
+
+                hlt_iterator_bytes begin = hlt_bytes_begin(b, &excpt, ctx);
+                hlt_iterator_bytes end = hlt_bytes_end(b, &excpt, ctx);
+
+                hlt_regexp_span span = hlt_regexp_bytes_span(re, begin, end, &excpt, ctx);
+
+                if ( span.rc > 0 )
+                    printf("%s | %s | %d %ld-%ld\n", *p, *i, span.rc,
+                           hlt_iterator_bytes_diff(begin, span.span.begin, &excpt, ctx),
+                           hlt_iterator_bytes_diff(begin, span.span.end, &excpt, ctx));
+                else
+                    printf("%s | %s | no match\n", *p, *i);
+            }
+        }
+
+        hlt_regexp_dfa_stats stats = hlt_regexp_dfa_stats_get(re, &excpt, ctx);
+        flushes += stats.flushes;
+
+        if ( cfg.regexp_max_dfa_states && stats.states > cfg.regexp_max_dfa_states )
+            fprintf(stderr, "%s: too many states computed\n", *p);
+    }
+
+    fprintf(stderr, "flushed: %s\n", (flushes ? "yes" : "no"));
+
+    if ( excpt ) {
+        fprintf(stderr, "unexpected exception\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+/*
+
+  We don't integrate this into the test-suite, it's for manual benchmarking.
+  It measures base64 decoding throughput for each kernel the CPU supports,
+  on MIME-style input with line breaks every 76 characters.
+
+  @TEST-IGNORE
+  @TEST-EXEC:  hilti-build -B -O %INPUT -o a.out
+*/
+
+#include <assert.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <libspicy/base64.h>
+#include <libspicy/libspicy.h>
+
+static const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char* kernels[] = {"scalar", "ssse3", "avx2"};
+
+double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return (double)(tv.tv_sec) + (double)(tv.tv_usec) / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+    hlt_init();
+    spicy_init();
+
+    int size = 64 * 1024 * 1024;
+    int rounds = 20;
+    int chunk = 4096; // Feed input in chunks, as a filter would see it.
+
+    int8_t* in = malloc(size);
+    int len = 0;
+
+    srand(42);
+
+    while ( len < size - 2 ) {
+        for ( int i = 0; i < 76 && len < size - 2; i++ )
+            in[len++] = alphabet[rand() % 64];
+
+        in[len++] = '\r';
+        in[len++] = '\n';
+    }
+
+    int8_t* out = malloc(__spicy_base64_decode_buffer_size(len));
+    int8_t* reference = malloc(__spicy_base64_decode_buffer_size(len));
+    int reference_len = -1;
+
+    for ( int level = 0; level <= 2; level++ ) {
+        if ( __spicy_base64_set_kernel(level) != level ) {
+            fprintf(stderr, "%-8s not supported by CPU\n", kernels[level]);
+            continue;
+        }
+
+        int n = 0;
+        double start = current_time();
+
+        for ( int r = 0; r < rounds; r++ ) {
+            base64_decodestate state;
+            base64_init_decodestate(&state);
+            n = 0;
+
+            for ( int i = 0; i < len; i += chunk ) {
+                int c = (len - i < chunk ? len - i : chunk);
+                n += __spicy_base64_decode_block(in + i, c, out + n, &state);
+            }
+        }
+
+        double delta = current_time() - start;
+        double rate = ((double)len * rounds) / delta / (1024 * 1024);
+
+        fprintf(stderr, "%-8s %.2fs => %.1f MB/s\n", kernels[level], delta, rate);
+
+        if ( reference_len < 0 ) {
+            memcpy(reference, out, n);
+            reference_len = n;
+        }
+
+        else
+            assert(n == reference_len && memcmp(out, reference, n) == 0);
+    }
+
+    return 0;
+}
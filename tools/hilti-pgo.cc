@@ -0,0 +1,87 @@
+///
+/// Merges the execution profiles that code compiled with --pgo-generate
+/// writes into hlt.pgo.*.dat files, for use with --pgo-use.
+///
+
+#include <fstream>
+#include <getopt.h>
+#include <iostream>
+
+#include <hilti/codegen/profile-data.h>
+
+using namespace std;
+
+static const char* Name = "hilti-pgo";
+
+static struct option long_options[] = {{"help", no_argument, 0, 'h'},
+                                       {"output", required_argument, 0, 'o'},
+                                       {0, 0, 0, 0}};
+
+void usage()
+{
+    cerr << "Usage: " << Name
+         << " [options] <profiles>\n"
+            "\n"
+            "Merges profiles recorded by code compiled with --pgo-generate.\n"
+            "\n"
+            "  -h | --help           Print usage information.\n"
+            "  -o | --output <file>  Specify output file.                    [Default: stdout].\n"
+            "\n";
+}
+
+int main(int argc, char** argv)
+{
+    string output;
+
+    while ( true ) {
+        int c = getopt_long(argc, argv, "ho:", long_options, 0);
+
+        if ( c < 0 )
+            break;
+
+        switch ( c ) {
+        case 'o':
+            output = optarg;
+            break;
+
+        case 'h':
+            usage();
+            return 0;
+
+        default:
+            usage();
+            return 1;
+        }
+    }
+
+    if ( optind == argc ) {
+        usage();
+        return 1;
+    }
+
+    hilti::codegen::ProfileData profile;
+
+    for ( int i = optind; i < argc; i++ ) {
+        string err;
+
+        if ( ! profile.read(argv[i], &err) ) {
+            cerr << Name << ": " << err << endl;
+            return 1;
+        }
+    }
+
+    if ( output.empty() ) {
+        profile.write(cout);
+        return 0;
+    }
+
+    ofstream out(output);
+
+    if ( ! out ) {
+        cerr << Name << ": cannot open " << output << " for writing" << endl;
+        return 1;
+    }
+
+    profile.write(out);
+    return 0;
+}
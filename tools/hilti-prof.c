@@ -1,16 +1,358 @@
 //
-// Converts a HILTI profiling file into readable output.
+// Converts HILTI profiling files into readable output, or aggregates them
+// into reports.
+
+#include <getopt.h>
+#include <math.h>
 
 #include <libhilti.h>
 
 int optPretty = 1;
 
+// What to output.
+enum Mode { MODE_DUMP, MODE_COLLAPSED, MODE_TOTALS, MODE_DELTA };
+
+static enum Mode optMode = MODE_DUMP;
+static const char* optMetric = "wall";
+static const char* optPerfMap = 0;
+
 static void usage()
 {
-    fprintf(stderr, "hilti-prof <hlt-prof.dat>\n");
+    fprintf(stderr,
+            "hilti-prof [options] <hlt-prof.dat> ...\n"
+            "\n"
+            "  -c          Print collapsed stacks for flamegraph.pl, weighted by the metric.\n"
+            "  -d <file>   Print per-tag totals as deltas to those in <file>. Can be given "
+            "multiple times.\n"
+            "  -h          Print usage information.\n"
+            "  -m <metric> Metric to aggregate: wall, cycles, or alloced. [Default: wall]\n"
+            "  -p <map>    Resolve addresses in sampled stacks through a perf map.\n"
+            "  -t          Print per-tag totals and percentiles of the metric.\n"
+            "\n"
+            "Without -c/-d/-t, prints the records of each file. Reports from the fast\n"
+            "profiling mode always aggregate cycles, and have no percentiles. Reports\n"
+            "from the sampling profiler always count samples.\n");
     exit(1);
 }
 
+////// Aggregation.
+
+// Entry of a table keyed by tag or stack.
+typedef struct {
+    char* key;
+    int64_t total;     // Sum of the metric.
+    uint64_t count;    // Number of completed calls.
+    int64_t* values;   // Metric of each call, if known.
+    uint64_t num_values;
+    uint64_t max_values;
+    char* stack;       // For tags, the stack of the latest call.
+} Entry;
+
+typedef struct {
+    Entry* entries;
+    uint64_t size; // Number of buckets, a power of two.
+    uint64_t used;
+} Table;
+
+// Aggregated results of a set of profiling files.
+typedef struct {
+    Table totals;    // Per tag.
+    Table collapsed; // Per stack, with the metric excluding nested profilers.
+    Table stacks;    // Per tag, tracking the current stack during reading.
+} Profile;
+
+static uint64_t hashString(const char* s)
+{
+    // FNV-1a.
+    uint64_t h = 14695981039346656037ULL;
+
+    for ( ; *s; s++ ) {
+        h ^= (uint8_t)*s;
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+static Entry* lookupNoGrow(Table* t, const char* key)
+{
+    uint64_t i = hashString(key) & (t->size - 1);
+
+    while ( t->entries[i].key ) {
+        if ( strcmp(t->entries[i].key, key) == 0 )
+            return &t->entries[i];
+
+        i = (i + 1) & (t->size - 1);
+    }
+
+    return &t->entries[i];
+}
+
+// Returns the entry for a key, inserting one if not yet there.
+static Entry* lookup(Table* t, const char* key)
+{
+    if ( (t->used + 1) * 2 > t->size ) {
+        Table n;
+        n.size = t->size ? t->size * 2 : 64;
+        n.used = t->used;
+        n.entries = calloc(n.size, sizeof(Entry));
+
+        for ( uint64_t i = 0; i < t->size; i++ ) {
+            if ( t->entries[i].key )
+                *lookupNoGrow(&n, t->entries[i].key) = t->entries[i];
+        }
+
+        free(t->entries);
+        *t = n;
+    }
+
+    Entry* e = lookupNoGrow(t, key);
+
+    if ( ! e->key ) {
+        e->key = strdup(key);
+        ++t->used;
+    }
+
+    return e;
+}
+
+static void addValue(Entry* e, int64_t v)
+{
+    if ( e->num_values == e->max_values ) {
+        e->max_values = e->max_values ? e->max_values * 2 : 16;
+        e->values = realloc(e->values, e->max_values * sizeof(int64_t));
+    }
+
+    e->values[e->num_values++] = v;
+}
+
+static char* joinStack(const char* stack, const char* tag)
+{
+    char* s = malloc(strlen(stack) + strlen(tag) + 2);
+    sprintf(s, "%s;%s", stack, tag);
+    return s;
+}
+
+// Attributes a completed call to its stack, and takes it out of the
+// parent's own share.
+static void addCall(Profile* prof, const char* tag, const char* stack, int64_t v, uint64_t count,
+                    int with_value)
+{
+    Entry* t = lookup(&prof->totals, tag);
+    t->total += v;
+    t->count += count;
+
+    if ( with_value )
+        addValue(t, v);
+
+    lookup(&prof->collapsed, stack)->total += v;
+
+    const char* p = strrchr(stack, ';');
+
+    if ( p ) {
+        char* parent = strndup(stack, p - stack);
+        lookup(&prof->collapsed, parent)->total -= v;
+        free(parent);
+    }
+}
+
+static int64_t metric(const hlt_profiler_record* rec)
+{
+    if ( strcmp(optMetric, "cycles") == 0 )
+        return rec->cycles;
+
+    if ( strcmp(optMetric, "alloced") == 0 )
+        return (int64_t)rec->alloced;
+
+    return rec->wall;
+}
+
+static void aggregateRecord(Profile* prof, const char* tag, const char* parent,
+                            const hlt_profiler_record* rec)
+{
+    Entry* s = lookup(&prof->stacks, tag);
+
+    if ( rec->type == HLT_PROFILER_START ) {
+        // Determine the stack that this call runs in.
+        free(s->stack);
+
+        if ( *parent ) {
+            Entry* ps = lookup(&prof->stacks, parent);
+            s = lookup(&prof->stacks, tag); // May have moved.
+            s->stack = joinStack(ps->stack ? ps->stack : parent, tag);
+        }
+        else
+            s->stack = strdup(tag);
+    }
+
+    if ( rec->type == HLT_PROFILER_STOP )
+        addCall(prof, tag, s->stack ? s->stack : tag, metric(rec), 1, 1);
+}
+
+// Returns the stack of a profiler in the fast mode, following the parents
+// recorded.
+static char* fastStack(char (*tags)[HLT_PROFILER_MAX_TAG_LENGTH], uint64_t* parents,
+                       uint64_t num_tags, uint64_t id)
+{
+    char* stack = strdup(tags[id]);
+
+    // Guard against cycles.
+    for ( uint64_t i = 0; i < num_tags && parents[id]; i++ ) {
+        id = parents[id] - 1;
+        char* s = joinStack(tags[id], stack);
+        free(stack);
+        stack = s;
+    }
+
+    return stack;
+}
+
+static void aggregateFast(Profile* prof, char (*tags)[HLT_PROFILER_MAX_TAG_LENGTH],
+                          hlt_profiler_counters* last, uint64_t num_tags)
+{
+    uint64_t* parents = calloc(num_tags ? num_tags : 1, sizeof(uint64_t));
+
+    for ( uint64_t i = 0; i < num_tags; i++ )
+        parents[i] = last[i].parent <= num_tags ? last[i].parent : 0;
+
+    for ( uint64_t i = 0; i < num_tags; i++ ) {
+        if ( ! last[i].count )
+            continue;
+
+        char* stack = fastStack(tags, parents, num_tags, i);
+        addCall(prof, tags[i], stack, last[i].cycles, last[i].count, 0);
+        free(stack);
+    }
+
+    free(parents);
+}
+
+// Attributes a sampled stack to its innermost frame, rooted at the virtual
+// thread it ran in. Frames are given innermost first.
+static void aggregateSamples(Profile* prof, const hlt_sampler_record* rec,
+                             char (*frames)[HLT_PROFILER_MAX_TAG_LENGTH])
+{
+    if ( ! rec->depth )
+        return;
+
+    char root[64];
+
+    if ( rec->vid == HLT_SAMPLER_NO_VID )
+        snprintf(root, sizeof(root), "no-vthread");
+    else
+        snprintf(root, sizeof(root), "vthread-%" PRId64, rec->vid);
+
+    char* stack = strdup(root);
+
+    for ( uint64_t i = rec->depth; i > 0; i-- ) {
+        char* s = joinStack(stack, frames[i - 1]);
+        free(stack);
+        stack = s;
+    }
+
+    // Unlike with the profilers, the counts are exclusive already.
+    Entry* t = lookup(&prof->totals, frames[0]);
+    t->total += rec->count;
+    t->count += rec->count;
+
+    lookup(&prof->collapsed, stack)->total += rec->count;
+    free(stack);
+}
+
+////// Perf maps.
+
+// One symbol of a perf map.
+typedef struct {
+    uint64_t start;
+    uint64_t size;
+    char* name;
+} Symbol;
+
+static Symbol* perfMap = 0;
+static uint64_t perfMapSize = 0;
+
+static int cmpSymbol(const void* a, const void* b)
+{
+    uint64_t sa = ((const Symbol*)a)->start;
+    uint64_t sb = ((const Symbol*)b)->start;
+    return sa < sb ? -1 : (sa > sb ? 1 : 0);
+}
+
+// Reads a perf map, with lines of the form "<start> <size> <name>" and
+// addresses in hex.
+static int readPerfMap(const char* fname)
+{
+    FILE* in = fopen(fname, "r");
+
+    if ( ! in ) {
+        fprintf(stderr, "error opening perf map %s\n", fname);
+        return 1;
+    }
+
+    uint64_t max = 0;
+    char line[4096];
+
+    while ( fgets(line, sizeof(line), in) ) {
+        uint64_t start;
+        uint64_t size;
+        int n = 0;
+
+        if ( sscanf(line, "%" SCNx64 " %" SCNx64 " %n", &start, &size, &n) != 2 || ! n )
+            continue;
+
+        char* name = line + n;
+        name[strcspn(name, "\n")] = '\0';
+
+        if ( perfMapSize == max ) {
+            max = max ? max * 2 : 256;
+            perfMap = realloc(perfMap, max * sizeof(Symbol));
+        }
+
+        perfMap[perfMapSize].start = start;
+        perfMap[perfMapSize].size = size;
+        perfMap[perfMapSize].name = strdup(name);
+        ++perfMapSize;
+    }
+
+    fclose(in);
+    qsort(perfMap, perfMapSize, sizeof(Symbol), cmpSymbol);
+    return 0;
+}
+
+// Replaces a frame of the form "0x<addr>" with the name of the perf map's
+// symbol containing it, if any.
+static void resolveFrame(char* frame)
+{
+    uint64_t addr;
+    int n = 0;
+
+    if ( sscanf(frame, "0x%" SCNx64 "%n", &addr, &n) != 1 || frame[n] )
+        return;
+
+    // Find the last symbol starting at or before the address.
+    uint64_t lo = 0;
+    uint64_t hi = perfMapSize;
+
+    while ( lo < hi ) {
+        uint64_t mid = lo + (hi - lo) / 2;
+
+        if ( perfMap[mid].start <= addr )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if ( ! lo )
+        return;
+
+    Symbol* sym = &perfMap[lo - 1];
+
+    if ( addr < sym->start + sym->size )
+        snprintf(frame, HLT_PROFILER_MAX_TAG_LENGTH, "%s", sym->name);
+}
+
+////// Output.
+
 static void printHeader(time_t t)
 {
     fputs("#! "
@@ -26,6 +368,7 @@ static void printHeader(time_t t)
         "alloced "
         "heap "
         "user "
+        "parent "
         "\n",
         stdout
         );
@@ -36,6 +379,45 @@ static void printHeader(time_t t)
     fputs("#\n", stdout);
 }
 
+static void printFastHeader(time_t t)
+{
+    fputs("#! "
+        "cwall "
+        "ccycles "
+        "tag "
+        "count "
+        "cycles "
+        "updates "
+        "user "
+        "parent "
+        "\n",
+        stdout
+        );
+
+    fputs("#\n", stdout);
+    fputs("# ", stdout);
+    fputs(ctime(&t), stdout);
+    fputs("#\n", stdout);
+}
+
+static void printSamplesHeader(time_t t, uint64_t hz)
+{
+    fputs("#! "
+        "vid "
+        "fiber "
+        "count "
+        "stack "
+        "\n",
+        stdout
+        );
+
+    fputs("#\n", stdout);
+    fputs("# ", stdout);
+    fputs(ctime(&t), stdout);
+    printf("# %" PRIu64 " Hz\n", hz);
+    fputs("#\n", stdout);
+}
+
 static const char* fmtType(int8_t type)
 {
     switch ( type ) {
@@ -56,33 +438,272 @@ static const char* fmtType(int8_t type)
     exit(1);
 }
 
-static void printRecord(const char* tag, const hlt_profiler_record* rec)
+static void printRecord(const char* tag, const char* parent, const hlt_profiler_record* rec)
 {
-    printf("%" PRIu64 " %" PRIu64 " %s %s %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
-           rec->ctime, rec->cwall, tag, fmtType(rec->type), rec->time, rec->wall, rec->updates, rec->cycles, rec->misses, rec->alloced, rec->heap, rec->user);
+    printf("%" PRIu64 " %" PRIu64 " %s %s %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %s\n",
+           rec->ctime, rec->cwall, tag, fmtType(rec->type), rec->time, rec->wall, rec->updates, rec->cycles, rec->misses, rec->alloced, rec->heap, rec->user, *parent ? parent : "-");
 }
 
-int main(int argc, char** argv)
+static void printCounters(const hlt_profiler_snapshot* snapshot, const char* tag, const char* parent, const hlt_profiler_counters* c)
 {
-    if ( argc != 2 )
-        usage();
+    printf("%" PRIu64 " %" PRIu64 " %s %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %s\n",
+           snapshot->cwall, snapshot->cycles, tag, c->count, c->cycles, c->updates, c->user, parent);
+}
 
+static void printSamples(const hlt_sampler_record* rec, char (*frames)[HLT_PROFILER_MAX_TAG_LENGTH])
+{
+    if ( rec->vid == HLT_SAMPLER_NO_VID )
+        printf("- ");
+    else
+        printf("%" PRId64 " ", rec->vid);
+
+    printf("0x%" PRIx64 " %" PRIu64 " ", rec->fiber, rec->count);
+
+    for ( uint64_t i = 0; i < rec->depth; i++ )
+        printf("%s%s", i ? ";" : "", frames[i]);
+
+    printf("\n");
+}
+
+static int cmpKey(const void* a, const void* b)
+{
+    return strcmp((*(Entry**)a)->key, (*(Entry**)b)->key);
+}
+
+static int cmpTotal(const void* a, const void* b)
+{
+    int64_t ta = (*(Entry**)a)->total;
+    int64_t tb = (*(Entry**)b)->total;
+
+    if ( ta != tb )
+        return ta > tb ? -1 : 1;
+
+    return cmpKey(a, b);
+}
+
+static int cmpInt64(const void* a, const void* b)
+{
+    int64_t ia = *(int64_t*)a;
+    int64_t ib = *(int64_t*)b;
+    return ia < ib ? -1 : (ia > ib ? 1 : 0);
+}
+
+// Returns the table's entries sorted with the given function. The caller
+// must free the result.
+static Entry** sortedEntries(Table* t, int (*cmp)(const void*, const void*))
+{
+    Entry** sorted = calloc(t->used ? t->used : 1, sizeof(Entry*));
+    uint64_t n = 0;
+
+    for ( uint64_t i = 0; i < t->size; i++ ) {
+        if ( t->entries[i].key )
+            sorted[n++] = &t->entries[i];
+    }
+
+    qsort(sorted, n, sizeof(Entry*), cmp);
+    return sorted;
+}
+
+static void printCollapsed(Profile* prof)
+{
+    Entry** sorted = sortedEntries(&prof->collapsed, cmpKey);
+
+    for ( uint64_t i = 0; i < prof->collapsed.used; i++ )
+        printf("%s %" PRId64 "\n", sorted[i]->key, sorted[i]->total > 0 ? sorted[i]->total : 0);
+
+    free(sorted);
+}
+
+// Nearest-rank percentile of sorted values.
+static int64_t percentile(const Entry* e, double p)
+{
+    uint64_t rank = (uint64_t)ceil(p / 100.0 * e->num_values);
+    return e->values[rank ? rank - 1 : 0];
+}
+
+static void printTotals(Profile* prof)
+{
+    printf("#! tag count total mean p50 p90 p99 max\n");
+
+    Entry** sorted = sortedEntries(&prof->totals, cmpTotal);
+
+    for ( uint64_t i = 0; i < prof->totals.used; i++ ) {
+        Entry* e = sorted[i];
+
+        printf("%s %" PRIu64 " %" PRId64 " %" PRId64, e->key, e->count, e->total,
+               e->count ? e->total / (int64_t)e->count : 0);
+
+        if ( e->num_values ) {
+            qsort(e->values, e->num_values, sizeof(int64_t), cmpInt64);
+            printf(" %" PRId64 " %" PRId64 " %" PRId64 " %" PRId64 "\n", percentile(e, 50),
+                   percentile(e, 90), percentile(e, 99), e->values[e->num_values - 1]);
+        }
+        else
+            printf(" - - - -\n");
+    }
+
+    free(sorted);
+}
+
+static void printDelta(Profile* old, Profile* prof)
+{
+    printf("#! tag old new delta change\n");
+
+    // Make sure tags only in the old profile show up as well.
+    for ( uint64_t i = 0; i < old->totals.size; i++ ) {
+        if ( old->totals.entries[i].key )
+            lookup(&prof->totals, old->totals.entries[i].key);
+    }
+
+    Entry** sorted = sortedEntries(&prof->totals, cmpTotal);
+
+    for ( uint64_t i = 0; i < prof->totals.used; i++ ) {
+        Entry* e = sorted[i];
+        int64_t o = lookup(&old->totals, e->key)->total;
+
+        printf("%s %" PRId64 " %" PRId64 " %" PRId64, e->key, o, e->total, e->total - o);
+
+        if ( o )
+            printf(" %+.1f%%\n", (e->total - o) * 100.0 / o);
+        else
+            printf(" -\n");
+    }
+
+    free(sorted);
+}
+
+////// Reading.
+
+// Reads a file written by the fast mode.
+static int readFast(int fd, time_t t, uint64_t num_tags, Profile* prof)
+{
+    char (*tags)[HLT_PROFILER_MAX_TAG_LENGTH] = calloc(num_tags ? num_tags : 1, HLT_PROFILER_MAX_TAG_LENGTH);
+
+    // The counters are cumulative, so we aggregate the last ones we see.
+    hlt_profiler_counters* last = calloc(num_tags ? num_tags : 1, sizeof(hlt_profiler_counters));
+
+    for ( uint64_t i = 0; i < num_tags; i++ ) {
+        if ( hlt_profiler_fast_file_read_tag(fd, tags[i]) < 0 ) {
+            perror("cannot read profiler tag");
+            return 1;
+        }
+    }
+
+    if ( ! prof )
+        printFastHeader(t);
+
+    while ( 1 ) {
+        hlt_profiler_snapshot snapshot;
+
+        int ret = hlt_profiler_fast_file_read_snapshot(fd, &snapshot);
+
+        if ( ret == 0 )
+            // Eof.
+            break;
+
+        if ( ret < 0 ) {
+            perror("cannot read profiler snapshot");
+            return 1;
+        }
+
+        for ( uint64_t i = 0; i < snapshot.num; i++ ) {
+            hlt_profiler_counters c;
+
+            if ( hlt_profiler_fast_file_read_counters(fd, &c) < 0 || c.id >= num_tags ) {
+                perror("cannot read profiler counters");
+                return 1;
+            }
+
+            last[c.id] = c;
+
+            if ( ! prof ) {
+                const char* parent = (c.parent && c.parent <= num_tags) ? tags[c.parent - 1] : "-";
+                printCounters(&snapshot, tags[c.id], parent, &c);
+            }
+        }
+    }
+
+    if ( prof )
+        aggregateFast(prof, tags, last, num_tags);
+
+    free(last);
+    free(tags);
+    hlt_profiler_file_close(fd);
+
+    return 0;
+}
+
+// Reads a file written by the sampling profiler.
+static int readSamples(int fd, time_t t, uint64_t hz, Profile* prof)
+{
+    char frames[HLT_SAMPLER_MAX_DEPTH][HLT_PROFILER_MAX_TAG_LENGTH];
+    hlt_sampler_record rec;
+
+    if ( ! prof )
+        printSamplesHeader(t, hz);
+
+    while ( 1 ) {
+        int ret = hlt_sampler_file_read(fd, &rec, frames);
+
+        if ( ret == 0 )
+            // Eof.
+            break;
+
+        if ( ret < 0 ) {
+            perror("cannot read sampled stack");
+            return 1;
+        }
+
+        for ( uint64_t i = 0; i < rec.depth && perfMap; i++ )
+            resolveFrame(frames[i]);
+
+        if ( prof )
+            aggregateSamples(prof, &rec, frames);
+        else
+            printSamples(&rec, frames);
+    }
+
+    hlt_profiler_file_close(fd);
+
+    return 0;
+}
+
+// Reads one file, either printing its records or, if prof is given,
+// aggregating them.
+static int readFile(const char* fname, Profile* prof)
+{
     time_t t;
-    int fd = hlt_profiler_file_open(argv[1], &t);
+    uint64_t num_tags;
+    uint64_t hz;
+    int fd = hlt_sampler_file_open(fname, &t, &hz);
+
+    if ( fd >= 0 )
+        return readSamples(fd, t, hz, prof);
+
+    if ( fd == -2 )
+        fd = hlt_profiler_fast_file_open(fname, &t, &num_tags);
+
+    if ( fd >= 0 )
+        return readFast(fd, t, num_tags, prof);
+
+    if ( fd == -2 )
+        fd = hlt_profiler_file_open(fname, &t);
 
     if ( fd < 0 ) {
-        fprintf(stderr, "error opening input file\n");
+        fprintf(stderr, "error opening input file %s\n", fname);
         return 1;
     }
 
     char tag[HLT_PROFILER_MAX_TAG_LENGTH];
+    char parent[HLT_PROFILER_MAX_TAG_LENGTH];
     hlt_profiler_record rec;
 
-    printHeader(t);
+    if ( ! prof )
+        printHeader(t);
 
     while ( 1 ) {
 
-        int ret = hlt_profiler_file_read(fd, tag, &rec);
+        int ret = hlt_profiler_file_read(fd, tag, parent, &rec);
 
         if ( ret == 0 )
             // Eof.
@@ -93,7 +714,10 @@ int main(int argc, char** argv)
             return 1;
         }
 
-        printRecord(tag, &rec);
+        if ( prof )
+            aggregateRecord(prof, tag, parent, &rec);
+        else
+            printRecord(tag, parent, &rec);
 
     }
 
@@ -102,3 +726,87 @@ int main(int argc, char** argv)
     return 0;
 }
 
+int main(int argc, char** argv)
+{
+    Profile prof;
+    Profile old;
+    memset(&prof, 0, sizeof(prof));
+    memset(&old, 0, sizeof(old));
+
+    const char** old_files = calloc(argc, sizeof(char*));
+    int num_old_files = 0;
+
+    while ( 1 ) {
+        int c = getopt(argc, argv, "cd:hm:p:t");
+
+        if ( c < 0 )
+            break;
+
+        switch ( c ) {
+          case 'c':
+            optMode = MODE_COLLAPSED;
+            break;
+
+          case 'd':
+            optMode = MODE_DELTA;
+            old_files[num_old_files++] = optarg;
+            break;
+
+          case 'm':
+            optMetric = optarg;
+
+            if ( strcmp(optMetric, "wall") != 0 && strcmp(optMetric, "cycles") != 0 &&
+                 strcmp(optMetric, "alloced") != 0 )
+                usage();
+
+            break;
+
+          case 'p':
+            optPerfMap = optarg;
+            break;
+
+          case 't':
+            optMode = MODE_TOTALS;
+            break;
+
+          case 'h':
+          default:
+            usage();
+        }
+    }
+
+    if ( optind == argc )
+        usage();
+
+    if ( optPerfMap && readPerfMap(optPerfMap) != 0 )
+        return 1;
+
+    for ( int i = 0; i < num_old_files; i++ ) {
+        if ( readFile(old_files[i], &old) != 0 )
+            return 1;
+    }
+
+    for ( int i = optind; i < argc; i++ ) {
+        if ( readFile(argv[i], optMode == MODE_DUMP ? 0 : &prof) != 0 )
+            return 1;
+    }
+
+    switch ( optMode ) {
+      case MODE_DUMP:
+        break;
+
+      case MODE_COLLAPSED:
+        printCollapsed(&prof);
+        break;
+
+      case MODE_TOTALS:
+        printTotals(&prof);
+        break;
+
+      case MODE_DELTA:
+        printDelta(&old, &prof);
+        break;
+    }
+
+    return 0;
+}
@@ -27,6 +27,7 @@ int dump_libhilti_state = 0;
 bool add_stdlibs = false;
 bool disable_linker = false;
 bool cfg = false;
+unsigned int compile_threads = 1;
 string output;
 
 static struct option long_options[] = {{"ast", no_argument, 0, 'A'},
@@ -40,10 +41,21 @@ static struct option long_options[] = {{"ast", no_argument, 0, 'A'},
                                        {"output", required_argument, 0, 'o'},
                                        {"version", no_argument, 0, 'v'},
                                        {"profile", no_argument, 0, 'F'},
+                                       {"profile-fast", no_argument, 0, 'f'},
                                        {"jit", no_argument, 0, 'j'},
                                        {"opt", required_argument, 0, 'O'},
                                        {"add-stdlibs", no_argument, 0, 's'},
                                        {"disable-linker", no_argument, 0, 'C'},
+                                       {"cache", required_argument, 0, 'K'},
+                                       {"jobs", required_argument, 0, 'J'},
+                                       {"lazy", no_argument, 0, 'y'},
+                                       {"warm-up", required_argument, 0, 'Y'},
+                                       {"pgo-generate", no_argument, 0, 'g'},
+                                       {"pgo-use", required_argument, 0, 'G'},
+                                       {"thin-link", no_argument, 0, 'T'},
+                                       {"perf-map", no_argument, 0, 'm'},
+                                       {"jitdump", no_argument, 0, 'M'},
+                                       {"sample", required_argument, 0, 'S'},
                                        {0, 0, 0, 0}};
 
 void usage()
@@ -66,15 +78,23 @@ void usage()
         << dbgstr
         << ".\n"
            "  -F | --profile        Profile level. Each time increases level. [Default: 0]\n"
+           "  -G | --pgo-use <file> With -O, optimize for the execution profile in <file>.\n"
            "  -I | --import <dir>   Search library files in <dir>. Can be given multiple times.\n"
+           "  -J | --jobs <n>       Compile *.hlt inputs with <n> threads; 0 uses all cores. "
+           "[Default: 1]\n"
+           "  -K | --cache <dir>    Cache compiled code in <dir> and reuse it where unchanged.\n"
            "  -L | --llvm-always    Like -l, but don't verify correctness first.\n"
            "  -O | --opt            Optimize generated code.                [Default: off].\n"
+           "  -T | --thin-link      With -O, optimize the linked code separately per module; "
+           "uses -J threads.\n"
            "  -V | --llvm-first     Like -L, but print each file individually to stdout and don't "
            "link.\n"
            "  -W | --print-always   Like -p, but don't verify correctness first.\n"
            "  -b | --bitcode        Output LLVM bitcode.\n"
            "  -c | --cfg            Add control/data flow information to output of -p.\n"
            "  -d | --debug          Debug level. Each time increases level. [Default: 0]\n"
+           "  -f | --profile-fast   With -F, count profilers by linker-assigned IDs.\n"
+           "  -g | --pgo-generate   Instrument linked code to record a profile for -G.\n"
            "  -h | --help           Print usage information.\n"
            "  -j | --jit            JIT the final LLVM bitcode to native code and execute main().\n"
            "  -l | --llvm           Output the final LLVM assembly.\n"
@@ -85,10 +105,17 @@ void usage()
            "\n"
            "Options controlling JIT (-j) runtime behavior:\n"
            "\n"
+           "  -M | --jitdump        Write compiled code to jit-<pid>.dump for perf inject --jit.\n"
            "  -P | --enable-profile Activate profiling support..\n"
+           "  -S | --sample <hz>    Sample stacks <hz> times per second of CPU time into "
+           "hlt.prof.p<pid>.samples.dat.\n"
            "  -Z | --dump-libhilti-state With -j, dump global libhilti state to stderr for "
            "debugging. Use twice to print for host app, too.\n"
+           "  -m | --perf-map       Write symbols of compiled code to /tmp/perf-<pid>.map.\n"
            "  -t | --threads        Number of worker threads; zero disables. [Default: 2.].\n"
+           "  -y | --lazy           Compile functions to native code only once first called.\n"
+           "  -Y | --warm-up <pat>  With -y, compile functions matching <pat> upfront. Can be "
+           "given multiple times.\n"
            "\n"
            "\n";
 }
@@ -139,33 +166,41 @@ std::unique_ptr<llvm::Module> loadLLVM(std::shared_ptr<hilti::CompilerContext> c
 
 std::unique_ptr<llvm::Module> compileHILTI(std::shared_ptr<hilti::CompilerContext> ctx, string path)
 {
-    auto module = ctx->loadModule(path);
+    std::unique_ptr<llvm::Module> llvm_module;
 
-    if ( ! module )
-        error(path, "Aborting due to verification error.");
+    if ( ctx->fileCache() && ! (dump_ast || output_hilti) )
+        // Compile directly from the file so that a cache hit skips parsing.
+        llvm_module = ctx->compile(path);
 
-    if ( dump_ast )
-        ctx->dump(module, cerr);
+    else {
+        auto module = ctx->loadModule(path);
 
-    if ( output_hilti ) {
-        ofstream out;
-        openOutputStream(out, output);
+        if ( ! module )
+            error(path, "Aborting due to verification error.");
 
-        if ( num_input_files > 1 )
-            out << "<<< Begin " << path << endl;
+        if ( dump_ast )
+            ctx->dump(module, cerr);
 
-        bool success = ctx->print(module, out, cfg);
+        if ( output_hilti ) {
+            ofstream out;
+            openOutputStream(out, output);
 
-        if ( num_input_files > 1 )
-            out << ">>> End " << path << endl;
+            if ( num_input_files > 1 )
+                out << "<<< Begin " << path << endl;
 
-        if ( ! success )
-            error(path, "Aborting due to printer error.");
+            bool success = ctx->print(module, out, cfg);
 
-        return nullptr;
-    }
+            if ( num_input_files > 1 )
+                out << ">>> End " << path << endl;
 
-    std::unique_ptr<llvm::Module> llvm_module(ctx->compile(module));
+            if ( ! success )
+                error(path, "Aborting due to printer error.");
+
+            return nullptr;
+        }
+
+        llvm_module = ctx->compile(module);
+    }
 
     if ( ! llvm_module )
         error(path, "Aborting due to code generation error.");
@@ -226,7 +261,7 @@ int main(int argc, char** argv)
     hlt_config libhilti_config = *hlt_config_get();
 
     while ( true ) {
-        int c = getopt_long(argc, argv, "AdD:hjpcFWbClPt:LsVo:OvI:Z", long_options, 0);
+        int c = getopt_long(argc, argv, "AdD:hjpcFfWbClPt:LsVo:OvI:J:K:ZyY:gG:TmMS:", long_options, 0);
 
         if ( c < 0 )
             break;
@@ -297,6 +332,10 @@ int main(int argc, char** argv)
             ++options->profile;
             break;
 
+        case 'f':
+            options->profile_fast = true;
+            break;
+
         case 'j':
             options->jit = true;
             add_stdlibs = true;
@@ -311,6 +350,27 @@ int main(int argc, char** argv)
             disable_linker = true;
             break;
 
+        case 'J':
+            compile_threads = atoi(optarg);
+            options->thin_link_threads = compile_threads;
+            break;
+
+        case 'T':
+            options->thin_link = true;
+            break;
+
+        case 'm':
+            options->perf_map = true;
+            break;
+
+        case 'M':
+            options->perf_jitdump = true;
+            break;
+
+        case 'K':
+            options->module_cache = optarg;
+            break;
+
         case 'Z':
             ++dump_libhilti_state;
             break;
@@ -323,6 +383,30 @@ int main(int argc, char** argv)
             libhilti_config.profiling = 1;
             break;
 
+        case 'S':
+            if ( atoi(optarg) <= 0 )
+                error("", "Sampling rate must be positive");
+
+            libhilti_config.sampling = atoi(optarg);
+            options->frame_pointers = true;
+            break;
+
+        case 'y':
+            options->jit_lazy = true;
+            break;
+
+        case 'Y':
+            options->jit_warm_up.push_back(optarg);
+            break;
+
+        case 'g':
+            options->pgo_generate = true;
+            break;
+
+        case 'G':
+            options->pgo_use = optarg;
+            break;
+
         case 'v':
             ::version();
             return 0;
@@ -348,6 +432,9 @@ int main(int argc, char** argv)
 
     num_input_files = inputs.size();
 
+    if ( options->jit_lazy && libhilti_config.num_workers )
+        error("", "Cannot compile lazily with worker threads, use -t 0");
+
     if ( num_input_files == 0 )
         error("", "No input file given.");
 
@@ -382,11 +469,36 @@ int main(int argc, char** argv)
 
     auto ctx = std::make_shared<hilti::CompilerContextJIT<hilti::JIT>>(options);
 
+    // Compile HILTI sources concurrently if requested and we don't need to
+    // see the individual ASTs.
+    std::list<std::unique_ptr<llvm::Module>> compiled;
+
+    if ( compile_threads != 1 && ! (dump_ast || output_hilti || output_llvm_individually) ) {
+        std::list<string> hlts;
+
+        for ( auto input : inputs ) {
+            if ( util::endsWith(input, ".hlt") )
+                hlts.push_back(input);
+        }
+
+        if ( hlts.size() > 1 ) {
+            compiled = ctx->compile(hlts, compile_threads);
+
+            if ( compiled.empty() )
+                error("", "Aborting due to code generation error.");
+        }
+    }
+
     // Go through input files and prepare LLVM modules.
     for ( auto input : inputs ) {
         std::unique_ptr<llvm::Module> module = 0;
 
-        if ( util::endsWith(input, ".hlt") )
+        if ( util::endsWith(input, ".hlt") && compiled.size() ) {
+            module = std::move(compiled.front());
+            compiled.pop_front();
+        }
+
+        else if ( util::endsWith(input, ".hlt") )
             module = compileHILTI(ctx, input);
 
         else if ( util::endsWith(input, ".ll") || util::endsWith(input, ".bc") )
@@ -113,6 +113,7 @@ static void usage(const char* prog)
             "    -e <off:str>  Embed string <str> at offset <off>; can be given multiple times\n");
     fprintf(stderr, "    -l            Show available parsers\n");
     fprintf(stderr, "    -m <off>      Set mark at offset <off>; can be given multiple times\n");
+    fprintf(stderr, "    -z <n>        Limit output of decompression filters to <n> bytes\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "    -P            Enable profiling\n");
     fprintf(stderr, "    -c            After parsing, compose data back to binary\n");
@@ -558,6 +559,7 @@ bool jitSpicy(const std::list<string>& spcy, std::shared_ptr<spicy::Options> opt
 int main(int argc, char** argv)
 {
     int chunk_size = 0;
+    int64_t max_inflated_size = -1;
     int list_parsers = false;
     const char* parser = 0;
     char* reply_parser = 0;
@@ -577,7 +579,7 @@ int main(int argc, char** argv)
 #endif
 
     char ch;
-    while ( (ch = getopt(argc, argv, "i:p:t:v:s:dOBhD:UlTPgCI:e:m:c")) != -1 ) {
+    while ( (ch = getopt(argc, argv, "i:p:t:v:s:dOBhD:UlTPgCI:e:m:cz:")) != -1 ) {
         switch ( ch ) {
         case 'i':
             chunk_size = atoi(optarg);
@@ -587,6 +589,10 @@ int main(int argc, char** argv)
             parser = optarg;
             break;
 
+        case 'z':
+            max_inflated_size = atoll(optarg);
+            break;
+
         case 'd':
             options->debug = true;
             break;
@@ -683,6 +689,9 @@ int main(int argc, char** argv)
         cfg.profiling = 1;
     }
 
+    if ( max_inflated_size >= 0 )
+        cfg.max_inflated_size = max_inflated_size;
+
     hlt_config_set(&cfg);
 
 #ifdef SPICY_DRIVER_JIT
@@ -0,0 +1,75 @@
+
+#include <algorithm>
+
+#include "thread-pool.h"
+
+using namespace util;
+
+ThreadPool::ThreadPool(unsigned int threads)
+{
+    if ( ! threads )
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for ( unsigned int i = 0; i < threads; i++ )
+        _threads.emplace_back(&ThreadPool::_run, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    wait();
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+
+    _job_available.notify_all();
+
+    for ( auto& t : _threads )
+        t.join();
+}
+
+void ThreadPool::schedule(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push_back(std::move(job));
+        ++_pending;
+    }
+
+    _job_available.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _all_done.wait(lock, [this]() { return _pending == 0; });
+}
+
+void ThreadPool::_run()
+{
+    while ( true ) {
+        Job job;
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _job_available.wait(lock, [this]() { return _stop || ! _jobs.empty(); });
+
+            if ( _jobs.empty() )
+                // Stopping.
+                return;
+
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            if ( --_pending == 0 )
+                _all_done.notify_all();
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef HILTI_UTIL_THREAD_POOL_H
+#define HILTI_UTIL_THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+/// A fixed-size pool of worker threads executing jobs in the order they are
+/// scheduled.
+class ThreadPool {
+public:
+    typedef std::function<void()> Job;
+
+    /// Constructor. Starts the worker threads.
+    ///
+    /// threads: The number of threads; zero selects the number of hardware
+    /// threads available.
+    ThreadPool(unsigned int threads = 0);
+
+    /// Destructor. Waits for all scheduled jobs to finish and then
+    /// terminates the worker threads.
+    ~ThreadPool();
+
+    /// Schedules a job for execution by the next available worker thread.
+    ///
+    /// job: The job to execute.
+    void schedule(Job job);
+
+    /// Blocks until all scheduled jobs have finished.
+    void wait();
+
+    /// Returns the number of worker threads.
+    unsigned int threads() const
+    {
+        return _threads.size();
+    }
+
+private:
+    void _run();
+
+    std::vector<std::thread> _threads;
+    std::deque<Job> _jobs;
+    std::mutex _mutex;
+    std::condition_variable _job_available;
+    std::condition_variable _all_done;
+    unsigned int _pending = 0;
+    bool _stop = false;
+};
+}
+
+#endif